@@ -0,0 +1,11 @@
+#!/usr/bin/env bash
+set -ex
+
+cd tests/singlerod/short/openmc_ensemble
+rm -rf member_1 summary.h5 statepoint.*.h5
+mpirun -np 2 ../build/install/bin/enrico
+
+# Each member writes OpenMC's run output to its own directory
+test -f summary.h5
+test -f member_1/summary.h5
+ls statepoint.*.h5 member_1/statepoint.*.h5
@@ -5,3 +5,11 @@ cd tests/singlerod/short/openmc_nekrs
 export NEKRS_HOME=$(realpath ../build/install)
 ../build/install/bin/nrspre rod_short 2
 mpirun -np 2 ../build/install/bin/enrico
+
+# Rerun with the NekRS options that the default input leaves off (warm-started
+# solves and device coupling)
+# The default input is restored even if the run fails
+cp enrico.xml enrico_default.xml
+trap 'mv enrico_default.xml enrico.xml' EXIT
+cp enrico_options.xml enrico.xml
+mpirun -np 2 ../build/install/bin/enrico
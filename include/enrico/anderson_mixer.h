@@ -0,0 +1,61 @@
+//! \file anderson_mixer.h
+//! Anderson acceleration of a fixed-point iteration on a distributed field
+#ifndef ENRICO_ANDERSON_MIXER_H
+#define ENRICO_ANDERSON_MIXER_H
+
+#include "enrico/comm.h"
+
+#include <gsl/gsl>
+
+#include <deque>
+#include <vector>
+
+namespace enrico {
+
+//! Anderson mixing for a fixed-point iteration x = G(x)
+//!
+//! Instead of relaxing only the latest iterate, the next iterate combines the last
+//! few iterates so as to minimize the linearized residual G(x) - x.  With a history
+//! depth of 0, it reduces to constant relaxation with the mixing parameter.  The
+//! field may be split among the ranks of a communicator, and every rank takes the
+//! same combination, found from inner products summed over the ranks.
+class AndersonMixer {
+public:
+  AndersonMixer() = default;
+
+  //! \param comm The ranks that hold parts of the field
+  //! \param depth Number of previous iterates combined with the latest one
+  //! \param beta Mixing parameter, the fraction of the latest residual that is applied
+  AndersonMixer(const Comm& comm, int depth, double beta);
+
+  //! Compute the next iterate.  This is a collective operation on the communicator.
+  //!
+  //! If the combination would make any value negative, the iterate is relaxed
+  //! with the mixing parameter instead, since the coupled fields are all nonnegative.
+  //!
+  //! \param x Local part of the iterate that was passed to G
+  //! \param g Local part of G(x), overwritten with the next iterate
+  //! \return Whether the next iterate combines previous iterates
+  bool mix(gsl::span<const double> x, gsl::span<double> g);
+
+  //! Forget the previous iterates, e.g. when the fixed point changes
+  void reset();
+
+  //! Number of previous iterates in the history
+  int size() const { return delta_f_.size(); }
+
+private:
+  Comm comm_;       //!< The ranks that hold parts of the field
+  int depth_ = 0;   //!< Maximum number of previous iterates kept
+  double beta_ = 1; //!< Mixing parameter
+
+  std::vector<double> f_prev_; //!< Previous residual G(x) - x
+  std::vector<double> g_prev_; //!< Previous G(x)
+
+  std::deque<std::vector<double>> delta_f_; //!< Differences of successive residuals
+  std::deque<std::vector<double>> delta_g_; //!< Differences of successive G(x)
+};
+
+} // namespace enrico
+
+#endif // ENRICO_ANDERSON_MIXER_H
@@ -0,0 +1,67 @@
+//! \file async_writer.h
+//! Queue of output tasks run on a background thread
+#ifndef ENRICO_ASYNC_WRITER_H
+#define ENRICO_ASYNC_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace enrico {
+
+//! Runs output tasks in order on a dedicated I/O thread
+//!
+//! Tasks must only use data that they own (e.g. a snapshot of the solution captured by
+//! value), since the caller continues, and may modify its own data, while they run.
+//! Tasks must not make MPI calls.
+class AsyncWriter {
+public:
+  //! Start the I/O thread
+  //!
+  //! \param queue_depth Maximum number of pending tasks. If zero, tasks are run
+  //!                    synchronously by submit() and no thread is started.
+  explicit AsyncWriter(std::size_t queue_depth);
+
+  //! Wait for all pending tasks to complete and stop the I/O thread. An exception
+  //! thrown by a task that has not been reported by submit() or flush() is discarded.
+  ~AsyncWriter();
+
+  AsyncWriter(const AsyncWriter&) = delete;
+  AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+  //! Queue a task, blocking while the queue is full
+  //!
+  //! If a previous task threw an exception, it is rethrown instead.
+  //!
+  //! \param task The task to run
+  void submit(std::function<void()> task);
+
+  //! Wait for all pending tasks to complete
+  //!
+  //! If a task threw an exception, it is rethrown.
+  void flush();
+
+private:
+  //! Run tasks until the writer is destroyed
+  void run();
+
+  //! Rethrow and clear the stored exception, if any. Requires mutex_ to be held.
+  void check_error();
+
+  std::size_t queue_depth_;                 //!< Maximum number of pending tasks
+  std::deque<std::function<void()>> tasks_; //!< Pending tasks, oldest first
+  bool busy_{false};                        //!< Whether a task is running
+  bool done_{false};                        //!< Whether the thread should exit
+  std::exception_ptr error_;                //!< First exception thrown by a task
+  std::mutex mutex_;                        //!< Guards all of the above
+  std::condition_variable changed_;         //!< Signals any change of the above
+  std::thread thread_;                      //!< The I/O thread
+};
+
+} // namespace enrico
+
+#endif // ENRICO_ASYNC_WRITER_H
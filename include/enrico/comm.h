@@ -8,12 +8,152 @@
 
 #include <mpi.h>
 
+#include <cstddef> // for size_t
 #include <iostream>
 #include <string>
+#include <utility> // for move
 #include <vector>
 
 namespace enrico {
 
+//! Handle to pending nonblocking operations started through a Comm
+//!
+//! The buffers involved in the operations must stay alive and untouched until
+//! wait() returns or test() returns true.  A handle owns its operations: it can be
+//! moved but not copied, and one that is destroyed with operations still pending
+//! waits for them.
+class Request {
+public:
+  Request() = default;
+
+  Request(const Request&) = delete;
+  Request& operator=(const Request&) = delete;
+
+  Request(Request&& other) noexcept
+    : requests_(std::move(other.requests_))
+  {
+    other.requests_.clear();
+  }
+
+  //! Waits for the pending operations of this handle before taking over those of
+  //! another
+  Request& operator=(Request&& other) noexcept
+  {
+    if (this != &other) {
+      wait();
+      requests_ = std::move(other.requests_);
+      other.requests_.clear();
+    }
+    return *this;
+  }
+
+  //! Waits for any pending operations, so that none is left in flight
+  ~Request() { wait(); }
+
+  //! Add a pending operation to this handle
+  //! \param request An MPI request; MPI_REQUEST_NULL is ignored
+  void add(MPI_Request request)
+  {
+    if (request != MPI_REQUEST_NULL) {
+      requests_.push_back(request);
+    }
+  }
+
+  //! Move all pending operations of another handle into this one
+  //! \param other Handle whose operations are moved
+  void add(Request&& other)
+  {
+    requests_.insert(requests_.end(), other.requests_.begin(), other.requests_.end());
+    other.requests_.clear();
+  }
+
+  //! Block until all operations in this handle have completed
+  //!
+  //! Currently, a wrapper for MPI_Waitall.
+  //!
+  //! \return Error value
+  int wait()
+  {
+    if (requests_.empty()) {
+      return MPI_SUCCESS;
+    }
+    auto ierr = MPI_Waitall(requests_.size(), requests_.data(), MPI_STATUSES_IGNORE);
+    requests_.clear();
+    return ierr;
+  }
+
+  //! Check whether all operations in this handle have completed without blocking
+  //!
+  //! Currently, a wrapper for MPI_Testall.
+  //!
+  //! \return True if all operations have completed
+  bool test()
+  {
+    int flag = 1;
+    if (!requests_.empty()) {
+      MPI_Testall(requests_.size(), requests_.data(), &flag, MPI_STATUSES_IGNORE);
+    }
+    if (flag) {
+      requests_.clear();
+    }
+    return flag;
+  }
+
+  //! Queries whether this handle has no pending operations
+  bool empty() const { return requests_.empty(); }
+
+private:
+  std::vector<MPI_Request> requests_; //!< Pending MPI requests
+};
+
+//! Block until all operations in a collection of handles have completed
+//! \param requests Handles to wait on
+//! \return Error value
+inline int wait_all(std::vector<Request>& requests)
+{
+  Request all;
+  for (auto& r : requests) {
+    all.add(std::move(r));
+  }
+  return all.wait();
+}
+
+//! Precision with which double-precision field payloads are sent
+enum class Precision {
+  full,     //!< As double
+  single,   //!< As float
+  quantized //!< As uint16, relative to the minimum and maximum of each message
+};
+
+//! Number of bytes of a message of double-precision values sent with a given precision
+//! \param count Number of values
+//! \param precision Precision of the payload
+//! \return Size of the message in bytes
+std::size_t packed_size(int count, Precision precision);
+
+//! Replace values by those a receiver decodes from one message of them sent with a
+//! given precision
+//! \param values Values to send, replaced by the received values
+//! \param count Number of values
+//! \param precision Precision of the payload
+void round_trip(double* values, int count, Precision precision);
+
+//! Values of a type other than double are always sent in full.  \sa round_trip
+template<typename T>
+void round_trip(T*, int, Precision)
+{}
+
+//! Largest relative error from sending values in one message with a given precision
+//!
+//! The error is measured against the values themselves, i.e. the full-precision path,
+//! and relative to the largest magnitude among them.
+//!
+//! \param values Values to send
+//! \param count Number of values
+//! \param precision Precision of the payload
+//! \return Largest error divided by the largest magnitude, or 0 if all values are 0
+double precision_error(const double* values, int count, Precision precision);
+
 //! Info and function wrappers for a specified MPI communictor.
 class Comm {
 public:
@@ -73,6 +213,25 @@ public:
     return MPI_Bcast(buffer, count, datatype, root, comm);
   }
 
+  //! Broadcasts double-precision values, sending them with a given precision.
+  //!
+  //! Every rank, including the root, ends up with the values as received, so that
+  //! they are the same on every rank.
+  //!
+  //! \param[in,out] buffer Starting address of buffer
+  //! \param[in] count Number of entries in buffer
+  //! \param[in] precision Precision of the payload
+  //! \param[in] root Rank of broadcast root
+  //! \return Error value
+  int Bcast(double* buffer, int count, Precision precision, int root = 0) const;
+
+  //! Broadcasts values of a type that is always sent in full.  \sa Bcast
+  template<typename T>
+  int Bcast(T* buffer, int count, Precision, int root = 0) const
+  {
+    return Bcast(buffer, count, get_mpi_type<T>(), root);
+  }
+
   //! Broadcast a scalar value across ranks
   //! \param value Value to broadcast (significant at rank 0)
   template<typename T>
@@ -89,6 +248,36 @@ public:
   template<typename T, size_t N>
   void broadcast(xt::xtensor<T, N>& values, int root = 0) const;
 
+  //! Begin broadcasting a scalar value across ranks without blocking
+  //! \param value Value to broadcast (significant at root)
+  //! \param root Rank of broadcast root
+  //! \return Handle to the pending broadcast
+  template<typename T>
+  std::enable_if_t<std::is_scalar<std::decay_t<T>>::value, Request>
+  ibroadcast(T& value, int root = 0) const;
+
+  //! Begin broadcasting a vector across ranks without blocking
+  //!
+  //! Unlike broadcast(), the vector is not resized, so it must already have the
+  //! root's size on every rank.
+  //!
+  //! \param values Values to broadcast (significant at root)
+  //! \param root Rank of broadcast root
+  //! \return Handle to the pending broadcast
+  template<typename T>
+  Request ibroadcast(std::vector<T>& values, int root = 0) const;
+
+  //! Begin broadcasting an xtensor across ranks without blocking
+  //!
+  //! Unlike broadcast(), the xtensor is not resized, so it must already have the
+  //! root's shape on every rank.
+  //!
+  //! \param values Values to broadcast (significant at root)
+  //! \param root Rank of broadcast root
+  //! \return Handle to the pending broadcast
+  template<typename T, size_t N>
+  Request ibroadcast(xt::xtensor<T, N>& values, int root = 0) const;
+
   //! Send a scalar from one rank to another
   //! \param value Value to send (significant at source and destination)
   //! \param dest Destination rank
@@ -127,6 +316,38 @@ public:
                      xt::xtensor<T, N>& sendbuf,
                      int source) const;
 
+  //! Begin sending a vector from one rank to another without blocking
+  //!
+  //! Unlike send_and_recv(), the receive buffer is not resized, so it must already
+  //! have the size of the send buffer at the destination.
+  //!
+  //! \param recvbuf Receive buffer (significant at destination)
+  //! \param dest Destination rank
+  //! \param sendbuf Send buffer (significant at source)
+  //! \param source Source rank
+  //! \return Handle to the pending transfer
+  template<typename T>
+  Request isend_and_irecv(std::vector<T>& recvbuf,
+                          int dest,
+                          const std::vector<T>& sendbuf,
+                          int source) const;
+
+  //! Begin sending an xtensor from one rank to another without blocking
+  //!
+  //! Unlike send_and_recv(), the receive buffer is not resized, so it must already
+  //! have the shape of the send buffer at the destination.
+  //!
+  //! \param recvbuf Receive buffer (significant at destination)
+  //! \param dest Destination rank
+  //! \param sendbuf Send buffer (significant at source)
+  //! \param source Source rank
+  //! \return Handle to the pending transfer
+  template<typename T, size_t N>
+  Request isend_and_irecv(xt::xtensor<T, N>& recvbuf,
+                          int dest,
+                          const xt::xtensor<T, N>& sendbuf,
+                          int source) const;
+
   //! Gathers together values from the processes in this comm onto a given root.
   //!
   //! Currently, a wrapper for MPI_Gather.
@@ -151,6 +372,186 @@ public:
       sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
   }
 
+  //! Gathers varying amounts of data from the processes in this comm onto a given root.
+  //!
+  //! Currently, a wrapper for MPI_Gatherv.
+  //!
+  //! \param[in] sendbuf Starting address of send buffer
+  //! \param[in] sendcount Number of elements in send buffer
+  //! \param[in] sendtype Data type of send buffer elements
+  //! \param[out] recvbuf Address of receive buffer (significant at root)
+  //! \param[in] recvcounts Number of elements received from each process (significant
+  //! at root)
+  //! \param[in] displs Displacement in recvbuf for the data from each process
+  //! (significant at root)
+  //! \param[in] recvtype Data type of recv buffer elements
+  //! \param[in] root Rank of receiving process
+  //! \return Error value
+  int Gatherv(const void* sendbuf,
+              int sendcount,
+              MPI_Datatype sendtype,
+              void* recvbuf,
+              const int* recvcounts,
+              const int* displs,
+              MPI_Datatype recvtype,
+              int root = 0) const
+  {
+    return MPI_Gatherv(
+      sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm);
+  }
+
+  //! Gathers double-precision values onto a given root, sending them with a given
+  //! precision.  Arguments are otherwise the same as for Gatherv().
+  //!
+  //! \return Error value
+  int Gatherv(const double* sendbuf,
+              int sendcount,
+              double* recvbuf,
+              const int* recvcounts,
+              const int* displs,
+              Precision precision,
+              int root = 0) const;
+
+  //! Gathers values of a type that is always sent in full.  \sa Gatherv
+  template<typename T>
+  int Gatherv(const T* sendbuf,
+              int sendcount,
+              T* recvbuf,
+              const int* recvcounts,
+              const int* displs,
+              Precision,
+              int root = 0) const
+  {
+    return Gatherv(sendbuf,
+                   sendcount,
+                   get_mpi_type<T>(),
+                   recvbuf,
+                   recvcounts,
+                   displs,
+                   get_mpi_type<T>(),
+                   root);
+  }
+
+  //! Scatters varying amounts of data from a given root to the processes in this comm.
+  //!
+  //! Currently, a wrapper for MPI_Scatterv.
+  //!
+  //! \param[in] sendbuf Starting address of send buffer (significant at root)
+  //! \param[in] sendcounts Number of elements sent to each process (significant at root)
+  //! \param[in] displs Displacement in sendbuf for the data to each process
+  //! (significant at root)
+  //! \param[in] sendtype Data type of send buffer elements
+  //! \param[out] recvbuf Address of receive buffer
+  //! \param[in] recvcount Number of elements in receive buffer
+  //! \param[in] recvtype Data type of recv buffer elements
+  //! \param[in] root Rank of sending process
+  //! \return Error value
+  int Scatterv(const void* sendbuf,
+               const int* sendcounts,
+               const int* displs,
+               MPI_Datatype sendtype,
+               void* recvbuf,
+               int recvcount,
+               MPI_Datatype recvtype,
+               int root = 0) const
+  {
+    return MPI_Scatterv(
+      sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root, comm);
+  }
+
+  //! Scatters double-precision values from a given root, sending them with a given
+  //! precision.  Arguments are otherwise the same as for Scatterv().
+  //!
+  //! \return Error value
+  int Scatterv(const double* sendbuf,
+               const int* sendcounts,
+               const int* displs,
+               double* recvbuf,
+               int recvcount,
+               Precision precision,
+               int root = 0) const;
+
+  //! Scatters values of a type that is always sent in full.  \sa Scatterv
+  template<typename T>
+  int Scatterv(const T* sendbuf,
+               const int* sendcounts,
+               const int* displs,
+               T* recvbuf,
+               int recvcount,
+               Precision,
+               int root = 0) const
+  {
+    return Scatterv(sendbuf,
+                    sendcounts,
+                    displs,
+                    get_mpi_type<T>(),
+                    recvbuf,
+                    recvcount,
+                    get_mpi_type<T>(),
+                    root);
+  }
+
+  //! Begins a nonblocking gather of varying amounts of data onto a given root.
+  //!
+  //! Currently, a wrapper for MPI_Igatherv.  Arguments are the same as for Gatherv().
+  //!
+  //! \return Handle to the pending gather
+  Request Igatherv(const void* sendbuf,
+                   int sendcount,
+                   MPI_Datatype sendtype,
+                   void* recvbuf,
+                   const int* recvcounts,
+                   const int* displs,
+                   MPI_Datatype recvtype,
+                   int root = 0) const
+  {
+    MPI_Request request;
+    MPI_Igatherv(sendbuf,
+                 sendcount,
+                 sendtype,
+                 recvbuf,
+                 recvcounts,
+                 displs,
+                 recvtype,
+                 root,
+                 comm,
+                 &request);
+    Request r;
+    r.add(request);
+    return r;
+  }
+
+  //! Begins a nonblocking scatter of varying amounts of data from a given root.
+  //!
+  //! Currently, a wrapper for MPI_Iscatterv.  Arguments are the same as for
+  //! Scatterv().
+  //!
+  //! \return Handle to the pending scatter
+  Request Iscatterv(const void* sendbuf,
+                    const int* sendcounts,
+                    const int* displs,
+                    MPI_Datatype sendtype,
+                    void* recvbuf,
+                    int recvcount,
+                    MPI_Datatype recvtype,
+                    int root = 0) const
+  {
+    MPI_Request request;
+    MPI_Iscatterv(sendbuf,
+                  sendcounts,
+                  displs,
+                  sendtype,
+                  recvbuf,
+                  recvcount,
+                  recvtype,
+                  root,
+                  comm,
+                  &request);
+    Request r;
+    r.add(request);
+    return r;
+  }
+
   //! Gathers data from all tasks and distribute the combined data to all tasks.
   //!
   //! Currently, a wrapper for MPI_Allgather
@@ -173,6 +574,177 @@ public:
       sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
   }
 
+  //! Combines values from all processes and distributes the result back to all
+  //! processes.
+  //!
+  //! Currently, a wrapper for MPI_Allreduce
+  //!
+  //! \param[in] sendbuf Starting address of send buffer, or MPI_IN_PLACE
+  //! \param[out] recvbuf Starting address of receive buffer
+  //! \param[in] count Number of elements in send buffer
+  //! \param[in] datatype Data type of elements of send buffer
+  //! \param[in] op Reduction operation
+  //! \return Error value
+  int Allreduce(const void* sendbuf,
+                void* recvbuf,
+                int count,
+                MPI_Datatype datatype,
+                MPI_Op op) const
+  {
+    return MPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm);
+  }
+
+  //! Combines values from all processes onto a given root.
+  //!
+  //! Currently, a wrapper for MPI_Reduce
+  //!
+  //! \param[in] sendbuf Starting address of send buffer, or MPI_IN_PLACE at root
+  //! \param[out] recvbuf Starting address of receive buffer (significant at root)
+  //! \param[in] count Number of elements in send buffer
+  //! \param[in] datatype Data type of elements of send buffer
+  //! \param[in] op Reduction operation
+  //! \param[in] root Rank of receiving process
+  //! \return Error value
+  int Reduce(const void* sendbuf,
+             void* recvbuf,
+             int count,
+             MPI_Datatype datatype,
+             MPI_Op op,
+             int root = 0) const
+  {
+    return MPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+  }
+
+  //! Combines values from all processes and scatters varying amounts of the result.
+  //!
+  //! Currently, a wrapper for MPI_Reduce_scatter
+  //!
+  //! \param[in] sendbuf Starting address of send buffer
+  //! \param[out] recvbuf Starting address of receive buffer
+  //! \param[in] recvcounts Number of result elements received by each process
+  //! \param[in] datatype Data type of elements of send buffer
+  //! \param[in] op Reduction operation
+  //! \return Error value
+  int Reduce_scatter(const void* sendbuf,
+                     void* recvbuf,
+                     const int* recvcounts,
+                     MPI_Datatype datatype,
+                     MPI_Op op) const
+  {
+    return MPI_Reduce_scatter(sendbuf, recvbuf, recvcounts, datatype, op, comm);
+  }
+
+  //! Gathers varying amounts of data from all tasks and distribute the combined data
+  //! to all tasks.
+  //!
+  //! Currently, a wrapper for MPI_Allgatherv
+  //!
+  //! \param[in] sendbuf Starting address of send buffer
+  //! \param[in] sendcount Number of elements in send buffer
+  //! \param[in] sendtype Data type of send buffer elements
+  //! \param[out] recvbuf Starting address of receive buffer
+  //! \param[in] recvcounts Number of elements received from each process
+  //! \param[in] displs Displacement in recvbuf for the data from each process
+  //! \param[in] recvtype Data type of receive buffer elements
+  //! \return Error value
+  int Allgatherv(const void* sendbuf,
+                 int sendcount,
+                 MPI_Datatype sendtype,
+                 void* recvbuf,
+                 const int* recvcounts,
+                 const int* displs,
+                 MPI_Datatype recvtype) const
+  {
+    return MPI_Allgatherv(
+      sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, comm);
+  }
+
+  //! Sends the same amount of data from every task to every other task.
+  //!
+  //! Currently, a wrapper for MPI_Alltoall
+  //!
+  //! \param[in] sendbuf Starting address of send buffer
+  //! \param[in] sendcount Number of elements sent to each process
+  //! \param[in] sendtype Data type of send buffer elements
+  //! \param[out] recvbuf Starting address of receive buffer
+  //! \param[in] recvcount Number of elements received from any process
+  //! \param[in] recvtype Data type of receive buffer elements
+  //! \return Error value
+  int Alltoall(const void* sendbuf,
+               int sendcount,
+               MPI_Datatype sendtype,
+               void* recvbuf,
+               int recvcount,
+               MPI_Datatype recvtype) const
+  {
+    return MPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+  }
+
+  //! Sends varying amounts of data from every task to every other task.
+  //!
+  //! Currently, a wrapper for MPI_Alltoallv
+  //!
+  //! \param[in] sendbuf Starting address of send buffer
+  //! \param[in] sendcounts Number of elements sent to each process
+  //! \param[in] sdispls Displacement in sendbuf for the data to each process
+  //! \param[in] sendtype Data type of send buffer elements
+  //! \param[out] recvbuf Starting address of receive buffer
+  //! \param[in] recvcounts Number of elements received from each process
+  //! \param[in] rdispls Displacement in recvbuf for the data from each process
+  //! \param[in] recvtype Data type of receive buffer elements
+  //! \return Error value
+  int Alltoallv(const void* sendbuf,
+                const int* sendcounts,
+                const int* sdispls,
+                MPI_Datatype sendtype,
+                void* recvbuf,
+                const int* recvcounts,
+                const int* rdispls,
+                MPI_Datatype recvtype) const
+  {
+    return MPI_Alltoallv(sendbuf,
+                         sendcounts,
+                         sdispls,
+                         sendtype,
+                         recvbuf,
+                         recvcounts,
+                         rdispls,
+                         recvtype,
+                         comm);
+  }
+
+  //! Sends double-precision values from all processes to all processes with a given
+  //! precision.  Arguments are otherwise the same as for Alltoallv().
+  //!
+  //! \return Error value
+  int Alltoallv(const double* sendbuf,
+                const int* sendcounts,
+                const int* sdispls,
+                double* recvbuf,
+                const int* recvcounts,
+                const int* rdispls,
+                Precision precision) const;
+
+  //! Sends values of a type that is always sent in full.  \sa Alltoallv
+  template<typename T>
+  int Alltoallv(const T* sendbuf,
+                const int* sendcounts,
+                const int* sdispls,
+                T* recvbuf,
+                const int* recvcounts,
+                const int* rdispls,
+                Precision) const
+  {
+    return Alltoallv(sendbuf,
+                     sendcounts,
+                     sdispls,
+                     get_mpi_type<T>(),
+                     recvbuf,
+                     recvcounts,
+                     rdispls,
+                     get_mpi_type<T>());
+  }
+
   //! Displays a message from rank 0
   //! \param A message to display
   void message(const std::string& msg, int rank = 0) const
@@ -387,6 +959,93 @@ void Comm::broadcast(xt::xtensor<T, N>& values, int root) const
   }
 }
 
+template<typename T>
+std::enable_if_t<std::is_scalar<std::decay_t<T>>::value, Request>
+Comm::ibroadcast(T& value, int root) const
+{
+  Request r;
+  if (this->active()) {
+    MPI_Request request;
+    MPI_Ibcast(&value, 1, get_mpi_type<T>(), root, comm, &request);
+    r.add(request);
+  }
+  return r;
+}
+
+template<typename T>
+Request Comm::ibroadcast(std::vector<T>& values, int root) const
+{
+  Request r;
+  if (this->active()) {
+    MPI_Request request;
+    MPI_Ibcast(values.data(), values.size(), get_mpi_type<T>(), root, comm, &request);
+    r.add(request);
+  }
+  return r;
+}
+
+template<typename T, size_t N>
+Request Comm::ibroadcast(xt::xtensor<T, N>& values, int root) const
+{
+  Request r;
+  if (this->active()) {
+    MPI_Request request;
+    MPI_Ibcast(values.data(), values.size(), get_mpi_type<T>(), root, comm, &request);
+    r.add(request);
+  }
+  return r;
+}
+
+template<typename T>
+Request Comm::isend_and_irecv(std::vector<T>& recvbuf,
+                              int dest,
+                              const std::vector<T>& sendbuf,
+                              int source) const
+{
+  Request r;
+  if (this->active()) {
+    // When dest == source, the rank posts both the receive and the send to itself
+    int tag = source;
+    MPI_Request request;
+    if (rank == dest) {
+      MPI_Irecv(
+        recvbuf.data(), recvbuf.size(), get_mpi_type<T>(), source, tag, comm, &request);
+      r.add(request);
+    }
+    if (rank == source) {
+      MPI_Isend(
+        sendbuf.data(), sendbuf.size(), get_mpi_type<T>(), dest, tag, comm, &request);
+      r.add(request);
+    }
+  }
+  return r;
+}
+
+template<typename T, size_t N>
+Request Comm::isend_and_irecv(xt::xtensor<T, N>& recvbuf,
+                              int dest,
+                              const xt::xtensor<T, N>& sendbuf,
+                              int source) const
+{
+  Request r;
+  if (this->active()) {
+    // When dest == source, the rank posts both the receive and the send to itself
+    int tag = source;
+    MPI_Request request;
+    if (rank == dest) {
+      MPI_Irecv(
+        recvbuf.data(), recvbuf.size(), get_mpi_type<T>(), source, tag, comm, &request);
+      r.add(request);
+    }
+    if (rank == source) {
+      MPI_Isend(
+        sendbuf.data(), sendbuf.size(), get_mpi_type<T>(), dest, tag, comm, &request);
+      r.add(request);
+    }
+  }
+  return r;
+}
+
 } // namespace enrico
 
 #endif // ENRICO_COMM_H
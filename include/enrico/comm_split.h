@@ -5,9 +5,16 @@
 
 #include <array>
 #include <mpi.h>
+#include <vector>
 
 namespace enrico {
 
+//! Placement of the single-physics drivers' ranks on the nodes.
+//! 'split' gives the neutronics driver the left-hand nodes and the heat/fluids driver
+//! the right-hand nodes, while 'colocated' puts both drivers on every node, with the
+//! neutronics ranks first and the heat/fluids ranks after them on each node.
+enum class Placement { split, colocated };
+
 //! Splits a given MPI communicator into new communicators for each single-physics driver
 //!
 //! \param[in] super_comm An existing communicator that will be split
@@ -16,18 +23,62 @@ namespace enrico {
 //!            communicator will contain all nodes of super_comm
 //! \param[in] procs_per_node The desired number of procs/node for each single-physics
 //!            driver's new communicator.  If a value is <=, then the respective driver's
-//!            communicator will contain the maximum number of available procs/node
+//!            communicator will contain the maximum number of available procs/node.  With
+//!            colocated placement, that is the procs left over by the other driver, or
+//!            half of the procs on the node if neither value is given.
 //! \param[out] driver_comms The newly-created communicators, one for each driver.
 //!             Each is comm active on the calling rank if it's contained by the respective
 //!             driver; and null if not.
 //! \param[out] intranode_comm A new comm that spans the node that the calling rank is in
 //! \param[out] coupling_comm A new comm containing one proc per node.
+//! \param[in] placement How the drivers' ranks are placed on the nodes
 void get_driver_comms(Comm super_comm,
                       std::array<int, 2> num_nodes,
                       std::array<int, 2> procs_per_node,
                       std::array<Comm, 2>& driver_comms,
                       Comm& intranode_comm,
-                      Comm& coupling_comm);
+                      Comm& coupling_comm,
+                      Placement placement = Placement::split);
+
+//! Pairs each heat/fluids rank with a neutronics rank, preferring one on its own node
+//!
+//! The heat/fluids ranks on a node are dealt out in turn to the neutronics ranks on
+//! that node.  Heat/fluids ranks on a node without neutronics ranks are dealt out to
+//! all neutronics ranks.  This is a collective operation on super.
+//!
+//! \param super The communicator containing both drivers' ranks
+//! \param intranode_comm The comm that spans the node that the calling rank is in
+//! \param neutronics_comm The neutronics driver's comm (null if not on this rank)
+//! \param heat_comm The heat/fluids driver's comm (null if not on this rank)
+//! \return For each rank in super, the rank in neutronics_comm of its partner, or -1 if
+//!         the rank isn't in heat_comm
+std::vector<int> pair_driver_ranks(const Comm& super,
+                                   const Comm& intranode_comm,
+                                   const Comm& neutronics_comm,
+                                   const Comm& heat_comm);
+
+//! Pairs each heat/fluids rank with a neutronics rank from the gathered placement of
+//! every rank.  \sa pair_driver_ranks(const Comm&, const Comm&, const Comm&, const Comm&)
+//!
+//! \param all_info Three values for each rank in the super communicator: an ID of its
+//!        node, its rank in the neutronics comm (-1 if it isn't in it), and 1 if it is
+//!        in the heat/fluids comm (0 if not)
+//! \return For each rank, the neutronics rank of its partner, or -1 if the rank isn't
+//!         in the heat/fluids comm
+std::vector<int> pair_driver_ranks(const std::vector<int>& all_info);
+
+//! Splits a number of nodes or procs per node between the two drivers so as to minimize
+//! the modeled time of a Picard iteration
+//!
+//! Each driver's time is modeled as its work divided by its units, i.e., as perfect
+//! strong scaling.  Ties go to the most even split.
+//!
+//! \param work Measured time of each driver's solve times the number of units it used
+//! \param total Number of units to split, at least 2
+//! \param concurrent Whether the drivers solve at the same time, so that an iteration
+//!        takes the longer of their times rather than the sum
+//! \return Number of units for each driver, each at least 1
+std::array<int, 2> balance_units(std::array<double, 2> work, int total, bool concurrent);
 
 //! Gathers the ranks (wrt super) that are also in sub
 std::vector<int> gather_subcomm_ranks(const Comm& super, const Comm& sub);
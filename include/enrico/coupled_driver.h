@@ -4,16 +4,25 @@
 #ifndef ENRICO_COUPLED_DRIVER_H
 #define ENRICO_COUPLED_DRIVER_H
 
+#include "enrico/anderson_mixer.h"
+#include "enrico/comm_split.h"
+#include "enrico/coupling_plan.h"
 #include "enrico/driver.h"
 #include "enrico/heat_fluids_driver.h"
+#include "enrico/memory.h"
 #include "enrico/neutronics_driver.h"
+#include "enrico/output.h"
+#include "enrico/projection.h"
 #include "enrico/timer.h"
 
 #include <pugixml.hpp>
 #include <xtensor/xtensor.hpp>
 
-#include <map>
+#include <array>
+#include <cstdint> // for int32_t
+#include <deque>
 #include <memory> // for unique_ptr
+#include <string>
 #include <vector>
 
 namespace enrico {
@@ -30,6 +39,35 @@ public:
   //! while 'heat' sets temperature based on a thermal-fluids input (or restart) file.
   enum class Initial { neutronics, heat };
 
+  //! Enumeration of available coupling schemes.
+  //! 'gauss_seidel' solves neutronics and then heat-fluids with the newest fields,
+  //! while 'jacobi' solves both at the same time with the fields from the previous
+  //! Picard iteration.
+  enum class CouplingScheme { gauss_seidel, jacobi };
+
+  //! Enumeration of available convergence tests.
+  //! 'temperature' compares the temperature norm to epsilon, while 'statistical'
+  //! also accepts the solution once the change in the heat source between Picard
+  //! iterations is indistinguishable from its Monte Carlo noise.
+  enum class ConvergenceTest { temperature, statistical };
+
+  //! Enumeration of available heat source scatters.
+  //! 'root' sends every heat rank its heat sources from the neutronics root, while
+  //! 'sliced' splits the cells among the neutronics ranks, each of which sends the
+  //! heat sources of its cells directly to the heat ranks that need them.
+  enum class HeatSourceScatter { root, sliced };
+
+  //! Enumeration of available predictors of the first iterate of each timestep.
+  //! 'none' starts from the last iterate of the previous timestep, while 'linear' and
+  //! 'quadratic' extrapolate from the last two or three timesteps.
+  enum class Predictor { none, linear, quadratic };
+
+  //! Enumeration of available rules for adaptive particle counts.
+  //! 'geometric' grows the count by a fixed factor in each Picard iteration, while
+  //! 'error' grows it only once the relative change in the temperature is within the
+  //! relative error of the heat source tally.
+  enum class ParticleRule { geometric, error };
+
   //! Initializes coupled neutron transport and thermal-hydraulics solver with
   //! the given MPI communicator
   //!
@@ -57,14 +95,44 @@ public:
   //! \param relax Apply relaxation to density before updating neutronics solver
   void update_density(bool relax);
 
+  //! Update the temperature and density for the neutronics solver
+  //!
+  //! Equivalent to update_temperature() followed by update_density(), except that the
+  //! temperature transfer is overlapped with the heat/fluids ranks' density averaging,
+  //! and the density transfer with setting the neutronics temperatures.  These are the
+  //! only exchanges that overlap local work; the heat source scatter stays blocking
+  //! because the heat/fluids ranks have no work to do until it arrives.
+  //!
+  //! \param relax Apply relaxation before updating neutronics solver
+  void update_temperature_and_density(bool relax);
+
   //! Check convergence of the coupled solve for the current Picard iteration.
   bool is_converged();
 
+  //! Compare the change in the heat source between the last two Picard iterations to
+  //! its Monte Carlo noise
+  //!
+  //! For each cell, the change is divided by its standard deviation assuming that both
+  //! iterations estimate the same heat source. If they do, the mean square of these
+  //! ratios is close to 1.
+  //!
+  //! \param[out] n_cells Number of cells with a nonzero variance, over which the mean
+  //!             is taken
+  //! \return Mean square of the ratios over the cells with nonzero variance
+  //!         (significant on the neutronics root), or a negative value if fewer than
+  //!         two heat sources are available
+  double heat_source_noise_ratio(int& n_cells) const;
+
   //! Compute the norm of the temperature between two successive Picard iterations
   //! \param norm enumeration of norm to compute
   //! \return norm of the temperature between two iterations
   double temperature_norm(Norm n);
 
+  //! Compute the norm of the temperature at the current Picard iteration
+  //! \param norm enumeration of norm to compute
+  //! \return norm of the temperature (significant on the heat root)
+  double temperature_magnitude(Norm n);
+
   //! Get reference to neutronics driver
   //! \return reference to driver
   NeutronicsDriver& get_neutronics_driver() const { return *neutronics_driver_; }
@@ -110,6 +178,15 @@ public:
   //! relaxation applied to the heat source if not set
   double alpha_rho_{alpha_};
 
+  //! Number of previous Picard iterates combined by Anderson acceleration, or 0 to
+  //! only relax the latest iterate. With Anderson acceleration, alpha_, alpha_T_, and
+  //! alpha_rho_ are the mixing parameters of the respective fields.
+  int anderson_depth_{0};
+
+  AndersonMixer heat_source_mixer_; //!< Anderson mixing of the heat source
+  AndersonMixer temperature_mixer_; //!< Anderson mixing of the temperature
+  AndersonMixer density_mixer_;     //!< Anderson mixing of the density
+
   //! Where to obtain the temperature initial condition from. Defaults to the
   //! temperatures in the neutronics input file.
   Initial temperature_ic_{Initial::neutronics};
@@ -118,9 +195,137 @@ public:
   //! in the neutronics input file.
   Initial density_ic_{Initial::neutronics};
 
+  //! How the single-physics solves are ordered within a Picard iteration. Defaults
+  //! to Gauss-Seidel.
+  CouplingScheme coupling_scheme_{CouplingScheme::gauss_seidel};
+
+  //! How the first iterate of each timestep is predicted from the previous
+  //! timesteps. Defaults to the last iterate of the previous timestep.
+  Predictor predictor_{Predictor::none};
+
+  //! How convergence of the Picard iterations is determined. Defaults to the
+  //! temperature norm.
+  ConvergenceTest convergence_test_{ConvergenceTest::temperature};
+
+  //! Smallest change in a local cell temperature in [K] that is sent to the
+  //! neutronics ranks, or 0 if every temperature is sent in every update
+  double temperature_tolerance_{0.0};
+
+  //! Smallest change in a local cell density in [g/cm^3] that is sent to the
+  //! neutronics ranks, or 0 if every density is sent in every update
+  double density_tolerance_{0.0};
+
+  //! How the heat source is sent from the neutronics ranks to the heat ranks.
+  //! Defaults to sending from the neutronics root.
+  HeatSourceScatter heat_source_scatter_{HeatSourceScatter::root};
+
+  //! Whether the neutronics ranks of each node share one copy of the gathered
+  //! temperatures and densities in shared memory
+  bool shared_memory_{false};
+
+  //! Whether the buffers that the coupling layer only needs during an update are
+  //! freed between Picard iterations
+  bool release_buffers_{false};
+
+  //! Bytes held by each part of the coupling on the calling rank
+  MemoryUsage memory_;
+
+  //! Whether whole fields are exchanged through one leader rank per node
+  bool hierarchical_{false};
+
+  //! Number of quadrature points along each direction of an element with which
+  //! elements are split among the cells they overlap, or 0 if each element is
+  //! assigned to the cell containing its centroid
+  int projection_order_{0};
+
+  //! The ranks of comm_ on the calling rank's node
+  Comm intranode_comm_;
+
+  //! The first rank of comm_ on each node (null on other ranks)
+  Comm internode_comm_;
+
+  //! Precision with which the temperature, density, and heat source fields are sent
+  //! between the drivers. Defaults to double precision.
+  Precision precision_{Precision::full};
+
+  //! How the neutronics and heat ranks are placed on the nodes. Defaults to separate
+  //! nodes for each driver.
+  Placement placement_{Placement::split};
+
+  //! File to which the split of the nodes (or, with colocated placement, the procs per
+  //! node) between the drivers that balances their solve times is written after the
+  //! first Picard iteration, or empty if the balance isn't measured
+  std::string balance_file_;
+
+  //! Whether the split in balance_file_ from an earlier run replaces the drivers'
+  //! <nodes> and <procs_per_node>
+  bool balance_apply_{false};
+
+  //! Number of nodes and procs per node in comm_
+  int n_nodes_{0};
+  int n_procs_per_node_{0};
+
+  //! Number of nodes used by each driver, neutronics first
+  std::array<int, 2> driver_nodes_{0, 0};
+
+  //! Largest number of procs on a node used by each driver, neutronics first
+  std::array<int, 2> driver_procs_per_node_{0, 0};
+
+  //! File in which to store the element-to-cell mapping so that later runs with the
+  //! same mesh and geometry can skip the search in init_mapping(). Empty if the
+  //! mapping is not cached.
+  std::string mapping_cache_;
+
+  //! How often and what the single-physics drivers write
+  OutputSettings output_;
+
+  //! File to which a timeline of the timed phases on every rank is written at the
+  //! end of execute(), or empty if no trace is recorded
+  std::string trace_file_;
+
+  //! Path prefix of the checkpoint files, or empty if no checkpoints are written
+  std::string checkpoint_prefix_;
+
+  //! Number of timesteps between checkpoints, or 0 to only write them on SIGTERM
+  int checkpoint_interval_{0};
+
+  //! Whether a checkpoint is written, and the run stopped, at the next Picard
+  //! iteration after SIGTERM
+  bool checkpoint_on_signal_{true};
+
+  //! Whether to resume from the checkpoint at checkpoint_prefix_ if one exists
+  bool restart_{false};
+
+  //! Which of the two alternating sets of checkpoint files is written next
+  int checkpoint_generation_{0};
+
+  //! Timestep and Picard iteration that execute() starts from, which are nonzero
+  //! after a restart
+  int start_timestep_{0};
+  int start_picard_{0};
+
+  //! Particles per batch in the first Picard iteration of each timestep when the
+  //! particle count grows adaptively, or 0 if every Picard iteration uses the number
+  //! of particles in the neutronics input
+  int64_t particles_initial_{0};
+
+  //! Factor by which the particle count grows in each Picard iteration, defaults to 2.
+  //! With the error rule, the smallest factor by which it grows.
+  double particles_growth_{2.0};
+
+  //! How the particle count grows over the Picard iterations
+  ParticleRule particles_rule_{ParticleRule::geometric};
+
   //! Report cumulative times for CoupledDriver member functions
   void timer_report();
 
+  //! Sample the bytes held by the coupling layer and the drivers on the calling rank,
+  //! first freeing the replicated buffers between iterations if requested
+  void record_memory();
+
+  //! Report the current and peak bytes sampled by record_memory() over the ranks
+  void memory_report() const;
+
   Timer timer_init_comms;         //!< For initialzing subcommunicators, etc.
   Timer timer_init_mapping;       //!< For the init_mapping() member function
   Timer timer_init_tallies;       //!< For the init_tallies() member function
@@ -140,9 +345,118 @@ private:
   //! Create subcommunicators for single-physics drivers
   void init_comms(const pugi::xml_node& node);
 
+  //! Replace the drivers' nodes and procs per node with the split in balance_file_
+  //!
+  //! The split is only used if it was found for the same placement on an allocation
+  //! with the same numbers of nodes and procs per node.  This is a collective
+  //! operation on comm_.
+  //!
+  //! \param nodes Number of nodes of each driver, neutronics first
+  //! \param procs_per_node Procs per node of each driver, neutronics first
+  //! \return Whether the split was used
+  bool read_balance(std::array<int, 2>& nodes, std::array<int, 2>& procs_per_node);
+
+  //! Report the split between the drivers that balances their measured solve times,
+  //! and write it to balance_file_.  This is a collective operation on comm_.
+  void balance_report();
+
+  //! Determine the target particle count for adaptive particle counts
+  void init_particles();
+
+  //! Number of particles per batch for the current Picard iteration
+  int64_t n_particles() const;
+
+  //! Choose the particle count of the next Picard iteration with the error rule
+  //!
+  //! The count is kept while the relative change in the temperature exceeds the mean
+  //! relative error of the heat source, since the iterates are then far from the
+  //! noise.  Otherwise it grows by the square of their ratio, which is how much it
+  //! takes for the error to drop to the change, but at least by particles_growth_.
+  //! This is a collective operation on comm_.
+  //!
+  //! \param norm Temperature norm of the current Picard iteration
+  void grow_particles(double norm);
+
+  //! Whether the whole heat source is assembled on the neutronics root in every
+  //! Picard iteration, even with a sliced heat source scatter
+  //!
+  //! The statistical convergence test and the error rule of the particle count both
+  //! compare the heat source of every cell with its tally error, which only the root
+  //! has.  Otherwise the owners of the slices get their heat sources directly.
+  bool needs_root_heat_source() const;
+
   //! Create mappings between neutronics cell instances and heat/fluids elements
   void init_mapping();
 
+  //! Compute the key that identifies a mapping cache
+  //!
+  //! The key combines a hash of each heat/fluids rank's element centroids and the
+  //! projection order with the neutronics geometry hash.  This is a collective
+  //! operation on comm_.
+  //!
+  //! \return The key (significant on the neutronics root)
+  std::size_t mapping_key() const;
+
+  //! Load the element-to-cell mapping from mapping_cache_ if it matches the given key
+  //!
+  //! The mapping is loaded only if it matches on every rank.  This is a collective
+  //! operation on comm_.
+  //!
+  //! \param key Key returned by mapping_key()
+  //! \param n_points Number of quadrature points on the calling heat/fluids rank
+  //! \return Whether the mapping was loaded
+  bool read_mapping_cache(std::size_t key, int n_points);
+
+  //! Write the coupled fields to a checkpoint from which execute() can resume
+  //!
+  //! Each heat/fluids rank writes its local cell fields to its own file, and the root
+  //! then writes a manifest naming the timestep and Picard iteration to resume from.
+  //! Two sets of files alternate so that the last complete checkpoint survives a
+  //! failure while the next one is written.  This is a collective operation on comm_.
+  //!
+  //! \param timestep Timestep to resume from
+  //! \param picard Picard iteration to resume from
+  void write_checkpoint(int timestep, int picard);
+
+  //! Whether a checkpoint written between two Picard iterations holds all the state
+  //! that the rest of the timestep depends on
+  //!
+  //! Anderson mixing histories, the particle count of the error rule, and the heat
+  //! sources compared by the statistical convergence test are built up over the
+  //! Picard iterations of a timestep and start over in the next one, so they aren't
+  //! checkpointed.  With any of them, checkpoints are only written at the end of a
+  //! timestep.
+  bool can_checkpoint_mid_timestep() const;
+
+  //! Restore the coupled fields from the checkpoint at checkpoint_prefix_ and pass
+  //! them on to both drivers
+  //!
+  //! This is a collective operation on comm_.
+  //!
+  //! \return Whether a checkpoint was found; otherwise nothing is restored
+  bool read_checkpoint();
+
+  //! Check whether any rank has received SIGTERM.  This is a collective operation on
+  //! comm_.
+  bool stop_requested() const;
+
+  //! Gather the number of points of every rank onto the neutronics root
+  //!
+  //! This is a collective operation on comm_.
+  //!
+  //! \param n_points Number of points on the calling rank
+  //! \param counts Set to the number of points of each rank in comm_ (on the
+  //! neutronics root)
+  //! \param displs Set to the offset of each rank's points (on the neutronics root)
+  void gather_point_counts(int n_points,
+                           std::vector<int>& counts,
+                           std::vector<int>& displs) const;
+
+  //! Build the local cell arrays, the projection, and the coupling plan from
+  //! point_to_glob_cell_
+  //! \param quadrature Quadrature points of the local elements on heat/fluids ranks
+  void init_local_cells(const ElementQuadrature& quadrature);
+
   //! Initialize the Monte Carlo tallies for all cells
   void init_tallies();
 
@@ -169,6 +483,86 @@ private:
   //! this member function does not set any initial values.
   void init_heat_source();
 
+  //! On each heat/fluids rank, set the heat source of the local elements from the
+  //! local cell heat sources
+  void send_heat_source();
+
+  //! On each heat/fluids rank, relax the local cell heat sources with those of the
+  //! previous Picard iteration
+  //! \param relax Whether to apply relaxation
+  void relax_heat_source(bool relax);
+
+  //! Send the local cell temperatures to the neutronics ranks and set them there
+  void send_temperature();
+
+  //! Send the local cell densities to the neutronics ranks and set them there
+  void send_density();
+
+  //! In verbose mode, report the largest relative error from sending a field with
+  //! reduced precision rather than in full.  This is a collective operation on the
+  //! coupling communicator.
+  //!
+  //! \param field Name of the field
+  //! \param values Values sent by the calling rank
+  //! \param count Number of values sent by the calling rank
+  void check_precision(const std::string& field, const double* values, int count) const;
+
+  //! Extrapolate the heat source, temperature, and density from the previous
+  //! timesteps and pass them on to both drivers as the first iterate
+  void predict();
+
+  //! On each heat/fluids rank, keep the fields of the timestep just solved for
+  //! predict()
+  void store_history();
+
+  //! On each heat/fluids rank, compute (and optionally relax) the local cell-averaged
+  //! temperatures
+  //! \param relax Apply relaxation to the local cell temperatures
+  void compute_cell_temperature(bool relax);
+
+  //! On each neutronics rank, set cell temperatures from a gathered temperature field
+  //! \param entries Temperature field gathered by the coupling plan
+  //! \param cells Indices into CouplingPlan::cells() of the cells to set, or nullptr to
+  //! set all cells
+  void set_neutronics_temperature(const std::vector<double>& entries,
+                                  const std::vector<gsl::index>* cells = nullptr);
+
+  //! On each heat/fluids rank, compute (and optionally relax) the local cell-averaged
+  //! densities
+  //! \param relax Apply relaxation to the local cell densities
+  void compute_cell_density(bool relax);
+
+  //! On each neutronics rank, set cell densities from a gathered density field
+  //! \param entries Density field gathered by the coupling plan
+  //! \param cells Indices into CouplingPlan::cells() of the cells to set, or nullptr to
+  //! set all cells
+  void set_neutronics_density(const std::vector<double>& entries,
+                              const std::vector<gsl::index>* cells = nullptr);
+
+  //! Initialize and solve one step of the neutronics driver
+  void neutronics_step();
+
+  //! Initialize and solve one step of the heat-fluids driver
+  void heat_fluids_step();
+
+  //! Write the results of the current Picard iteration, if they are to be written,
+  //! and finalize the step of both drivers
+  //!
+  //! The output is written before the drivers finalize their step and before the
+  //! neutronics driver receives the next temperature/density, so it holds the
+  //! iteration's own solution.
+  //!
+  //! \param last Whether this is the last Picard iteration of the timestep, which is
+  //! always written
+  void finish_steps(bool last);
+
+  //! Send the local cell temperatures already computed by compute_cell_temperature()
+  //! to the neutronics solver, then compute and send the densities as
+  //! update_temperature_and_density() does
+  //!
+  //! \param relax Apply relaxation to the local cell densities
+  void send_temperature_and_density(bool relax);
+
   //! Print report of communicator layout if high verbosity is set
   void comm_report();
 
@@ -185,12 +579,30 @@ private:
   //! The rank in comm_ that corresponds to the root of the heat comm
   int heat_root_ = MPI_PROC_NULL;
 
+  //! Particles per batch in the neutronics input, which the adaptive particle count
+  //! grows to. Set on all ranks.
+  int64_t particles_target_{0};
+
+  //! Particles per batch in the current Picard iteration with the error rule. Set on
+  //! all ranks.
+  int64_t particles_current_{0};
+
+  //! Mean relative error of the last unrelaxed heat source, weighted by the heat
+  //! source, for the error rule of the adaptive particle count.  Set only on the
+  //! neutronics root.
+  double heat_source_mean_error_{0.0};
+
   //! List of ranks in this->comm_ that are in the heat/fluids subcomm
   std::vector<int> heat_ranks_;
 
   //! List of ranks in this->comm_ that are in the neutronics subcomm
   std::vector<int> neutronics_ranks_;
 
+  //! For each rank in this->comm_, the neutronics rank on its node that owns the cells
+  //! it refers to in sliced scatters, or -1 if it isn't a heat rank. Empty unless the
+  //! drivers are colocated.
+  std::vector<int> heat_partners_;
+
   //! Local cell temperature at current Picard iteration. Set only on heat/fluids ranks.
   xt::xtensor<double, 1> cell_temperature_;
 
@@ -209,27 +621,83 @@ private:
   //! Local cell heat source at previous Picard iteration. Set only on heat/fluids ranks.
   xt::xtensor<double, 1> cell_heat_source_prev_;
 
+  //! NeutronicsDriver::cell_index of the unique cells grouped by the neutronics rank
+  //! that owns them, when the sliced heat source is computed by the owners directly
+  //! (see needs_root_heat_source()). Set only on neutronics ranks.
+  std::vector<gsl::index> slice_tally_cells_;
+
+  //! Local cell heat sources at the end of the last few timesteps, oldest first, for
+  //! the predictor. Set only on heat/fluids ranks.
+  std::deque<xt::xtensor<double, 1>> heat_source_history_;
+
+  //! Local cell temperatures at the end of the last few timesteps, oldest first, for
+  //! the predictor. Set only on heat/fluids ranks.
+  std::deque<xt::xtensor<double, 1>> temperature_history_;
+
+  //! Local cell densities at the end of the last few timesteps, oldest first, for the
+  //! predictor. Set only on heat/fluids ranks.
+  std::deque<xt::xtensor<double, 1>> density_history_;
+
   std::unique_ptr<NeutronicsDriver> neutronics_driver_;  //!< The neutronics driver
   std::unique_ptr<HeatFluidsDriver> heat_fluids_driver_; //!< The heat-fluids driver
 
   //! 1 if local cell is in fluid, 0 if in solid. Set only on heat/fluids ranks.
   std::vector<int> cell_fluid_mask_;
 
-  //! Maps heat/fluids element index to global cell handle.  Set only on heat/fluids ranks.
-  std::vector<CellHandle> elem_to_glob_cell_;
+  //! Maps the index of each quadrature point of the heat/fluids elements to global cell
+  //! handle.  Without a projection order, the points are the element centroids.  Set
+  //! only on heat/fluids ranks.
+  std::vector<CellHandle> point_to_glob_cell_;
 
   //! Maps local cell index to global cell handle.  Set only on heat/fluid ranks.
   std::vector<CellHandle> cell_to_glob_cell_;
 
-  //! Maps global cell handle to local element index.  Set only on heat/fluids ranks.
-  std::map<CellHandle, std::vector<int32_t>> glob_cell_to_elem_;
+  //! Weights that project fields between the local elements and local cells.  Set
+  //! only on heat/fluids ranks.
+  Projection projection_;
+
+  //! Local cell temperatures last sent to the neutronics ranks when only changes are
+  //! sent.  Set only on heat/fluids ranks.
+  std::vector<double> cell_temperature_sent_;
+
+  //! Local cell densities last sent to the neutronics ranks when only changes are
+  //! sent.  Set only on heat/fluids ranks.
+  std::vector<double> cell_density_sent_;
+
+  //! Gathered temperatures, patched by each update when only changes are sent.  Set only
+  //! on neutronics ranks.
+  std::vector<double> temperature_entries_;
+
+  //! Gathered densities, patched by each update when only changes are sent.  Set only on
+  //! neutronics ranks.
+  std::vector<double> density_entries_;
+
+  //! Field over the local elements, reused by every field update so that Picard
+  //! iterations don't allocate element-sized arrays.  Set only on heat/fluids ranks.
+  std::vector<double> elem_field_;
+
+  //! Exchange pattern between the local cells of the heat/fluids ranks and the
+  //! neutronics ranks.  Built once by init_mapping().
+  CouplingPlan coupling_plan_;
+
+  //! Unrelaxed heat source in each neutronics cell at the current Picard iteration,
+  //! for the statistical convergence test.  Set only on the neutronics root.
+  xt::xtensor<double, 1> heat_source_raw_;
+
+  //! Unrelaxed heat source in each neutronics cell at the previous Picard iteration of
+  //! the same timestep.  Set only on the neutronics root.
+  xt::xtensor<double, 1> heat_source_raw_prev_;
+
+  //! Relative standard deviation of heat_source_raw_.  Set only on the neutronics root.
+  xt::xtensor<double, 1> heat_source_error_;
+
+  //! Relative standard deviation of heat_source_raw_prev_.  Set only on the
+  //! neutronics root.
+  xt::xtensor<double, 1> heat_source_error_prev_;
 
   //! Local cell volumes.  Set only on heat/fluids ranks.
   std::vector<double> cell_volume_;
 
-  //! Local element volumes.  Set only on heat/fluids ranks.
-  std::vector<double> elem_volume_;
-
   // Norm to use for convergence checks
   Norm norm_{Norm::LINF};
 
@@ -0,0 +1,838 @@
+//! \file coupling_plan.h
+//! Persistent exchange pattern between heat/fluids and neutronics ranks
+#ifndef ENRICO_COUPLING_PLAN_H
+#define ENRICO_COUPLING_PLAN_H
+
+#include "enrico/cell_handle.h"
+#include "enrico/comm.h"
+#include "enrico/mpi_types.h"
+#include "enrico/neutronics_driver.h"
+#include "enrico/shared_array.h"
+#include "enrico/trace.h"
+
+#include <gsl/gsl>
+
+#include <algorithm> // for sort, unique
+#include <cmath>     // for abs
+#include <numeric>   // for partial_sum
+#include <type_traits>
+#include <vector>
+
+namespace enrico {
+
+//! Decide which cells are in fluid from the fluid masks of their entries
+//!
+//! A cell is in fluid if more than half of its volume is in fluid entries, the same
+//! majority rule that Projection::set_fluid_mask() applies within a rank, so that a
+//! cell split among heat/fluids ranks is classified as if it were on one rank.  The
+//! fluid weights of a fluid cell are the volume weights of its fluid entries
+//! renormalized to sum to one; all other fluid weights are zero.
+//!
+//! \param entry_to_cell Index of the cell of each entry
+//! \param volume_weights Entry volume divided by the volume of its cell
+//! \param entry_mask 1 if an entry is in fluid, 0 otherwise
+//! \param cell_in_fluid Set to 1 if a cell is in fluid, 0 otherwise
+//! \param fluid_weights Set to the fluid weight of each entry
+void compute_fluid_weights(gsl::span<const gsl::index> entry_to_cell,
+                           gsl::span<const double> volume_weights,
+                           gsl::span<const int> entry_mask,
+                           gsl::span<int> cell_in_fluid,
+                           gsl::span<double> fluid_weights);
+
+//! Persistent exchange pattern between heat/fluids and neutronics ranks
+//!
+//! Every heat/fluids rank owns a list of local cells.  Because the mapping between
+//! elements and cells is fixed after CoupledDriver::init_mapping(), the plan gathers
+//! those lists once and stores, on the neutronics ranks, the concatenation of all
+//! local cells (the "entries"), the unique cells they refer to, the matching
+//! NeutronicsDriver::cell_index offsets, and the volume weights used to average
+//! local cell fields.  Field updates then only move the field values.
+class CouplingPlan {
+public:
+  CouplingPlan() = default;
+
+  //! Gather the local cell lists of all heat/fluids ranks
+  //!
+  //! This is a collective operation on comm.
+  //!
+  //! \param comm The coupling communicator
+  //! \param neutronics_root Rank in comm of the neutronics root
+  //! \param neutronics The neutronics driver
+  //! \param local_cells Global cell handles of the local cells (significant on
+  //! heat/fluids ranks)
+  CouplingPlan(const Comm& comm,
+               int neutronics_root,
+               const NeutronicsDriver& neutronics,
+               const std::vector<CellHandle>& local_cells);
+
+  //! Set the volume weights from the local cell volumes
+  //!
+  //! This is a collective operation on the coupling communicator.
+  //!
+  //! \param local_volumes Volumes of the local cells (significant on heat/fluids ranks)
+  void set_volumes(const std::vector<double>& local_volumes);
+
+  //! Set the fluid volume weights from the local cell fluid mask
+  //!
+  //! Cells are classified over all heat/fluids ranks by compute_fluid_weights().
+  //! Must be called after set_volumes().  This is a collective operation on the
+  //! coupling communicator.
+  //!
+  //! \param local_fluid_mask 1 if a local cell is in fluid, 0 otherwise (significant
+  //! on heat/fluids ranks)
+  void set_fluid_mask(const std::vector<int>& local_fluid_mask);
+
+  //! Set up sliced scatters, in which every neutronics rank owns a slice of the unique
+  //! cells and sends the values of its cells directly to the heat/fluids ranks whose
+  //! local cells refer to them
+  //!
+  //! The many-to-many pattern is derived once from the entries, so that later
+  //! scatters never assemble the entries of all heat/fluids ranks on one rank.  This
+  //! is a collective operation on the coupling communicator.
+  //!
+  //! \param partners For each rank in the coupling communicator, the neutronics rank
+  //! that should own the cells it refers to (see pair_driver_ranks()); each cell goes
+  //! to the partner of the first rank that refers to it.  If empty, the unique cells
+  //! are split into contiguous slices of nearly equal size.
+  //! \param intranode_comm The ranks of the coupling communicator on the calling
+  //! rank's node.  If given and every rank only exchanges values with ranks on its own
+  //! node, as with colocated partners, the scatters run over it instead of the
+  //! coupling communicator.
+  void init_slices(const std::vector<int>& partners = {},
+                   const Comm& intranode_comm = Comm{});
+
+  //! Whether the sliced scatters stay within each node (see init_slices())
+  bool slices_on_node() const { return sliced_ && slice_comm_.comm != comm_.comm; }
+
+  //! Whether init_slices() has been called
+  bool sliced() const { return sliced_; }
+
+  //! Indices into cells() of the unique cells owned by the calling neutronics rank in
+  //! sliced scatters, in the order of their values in scatter_slices()
+  gsl::span<const gsl::index> slice_cells() const
+  {
+    return {slice_order_.data() + slice_begin_, slice_size_};
+  }
+
+  //! Number of unique cells owned by the calling neutronics rank in sliced scatters
+  int slice_size() const { return slice_size_; }
+
+  //! Indices into cells() of the unique cells grouped by the neutronics rank that owns
+  //! them in sliced scatters (set on neutronics ranks)
+  const std::vector<gsl::index>& slice_order() const { return slice_order_; }
+
+  //! Number of unique cells owned by each neutronics rank in sliced scatters (set on
+  //! neutronics ranks)
+  const std::vector<int>& slice_counts() const { return slice_counts_; }
+
+  //! Share the gathered entries and the averaged fields among the neutronics ranks of
+  //! each node
+  //!
+  //! Afterwards, only one neutronics rank per node, its leader, receives the gathered
+  //! entries.  The leader averages them into a shared-memory segment that the other
+  //! neutronics ranks on the node read in place, and the other ranks drop their copies
+  //! of the per-entry weights.  Must be called after set_fluid_mask() and
+  //! init_slices().  This is a collective operation on the coupling communicator.
+  void init_shared();
+
+  //! Whether init_shared() has been called
+  bool shared() const { return shared_; }
+
+  //! Route gathers and scatters of whole fields through one leader per node
+  //!
+  //! Afterwards, the local cells of each node are collected by its leader, and the
+  //! leaders exchange one message per node with the neutronics root.  The gathered
+  //! entries are broadcast to the first neutronics rank of each node, which passes
+  //! them on within its node unless they are shared (see init_shared()).  If the
+  //! neutronics root doesn't lead its node, the plan is left unchanged.  This is a
+  //! collective operation on the coupling communicator.
+  //!
+  //! \param intranode_comm The ranks of the coupling communicator on the calling
+  //! rank's node
+  //! \param internode_comm The first rank of each intranode_comm (null on other ranks)
+  void init_hierarchical(const Comm& intranode_comm, const Comm& internode_comm);
+
+  //! Whether init_hierarchical() has taken effect
+  bool hierarchical() const { return hierarchical_; }
+
+  //! Bytes held by the plan on the calling rank, counting a shared segment only on
+  //! the rank that allocated it
+  std::size_t memory_usage() const;
+
+  //! Free the buffers that only hold the results of the latest volume_average() and
+  //! fluid_average() calls; they are allocated again by the next calls
+  void release_buffers();
+
+  //! Set the precision with which double-precision fields are exchanged
+  //!
+  //! Only the field values are affected; indices and the setup exchanges are always
+  //! sent in full.
+  //!
+  //! \param precision Precision of the field payloads
+  void set_precision(Precision precision) { precision_ = precision; }
+
+  //! Precision with which double-precision fields are exchanged
+  Precision precision() const { return precision_; }
+
+  //! Gather a local cell field from every heat/fluids rank onto all neutronics ranks
+  //!
+  //! \param local Local cell field (significant on heat/fluids ranks)
+  //! \param entries Gathered field, one value per entry (set on neutronics ranks, or
+  //! only on node leaders after init_shared())
+  template<typename T>
+  void gather(const T* local, std::vector<T>& entries) const;
+
+  //! Begin gathering a local cell field onto the neutronics root without blocking
+  //!
+  //! The gather is finished with finish_gather(). Until then, neither buffer may be
+  //! modified, but the calling rank is free to do other local work.  With a reduced
+  //! precision, the values must be decoded on arrival, and after init_hierarchical(),
+  //! they must pass through the node leaders, so in either case the gather blocks.
+  //!
+  //! \param local Local cell field (significant on heat/fluids ranks)
+  //! \param entries Gathered field, one value per entry (set on neutronics ranks by
+  //! finish_gather())
+  //! \return Handle to the pending gather
+  template<typename T>
+  Request igather(const T* local, std::vector<T>& entries) const;
+
+  //! Finish a gather started by igather() and share the result with all neutronics
+  //! ranks
+  //!
+  //! \param request Handle returned by igather()
+  //! \param entries The same buffer that was passed to igather()
+  template<typename T>
+  void finish_gather(Request& request, std::vector<T>& entries) const;
+
+  //! Gather only the local cell values that changed by more than a tolerance since
+  //! they were last sent, and patch them into a persistent gathered field
+  //!
+  //! Each changed value moves as an (index, value) pair, so the exchange is
+  //! proportional to the number of changes.  Every value is compared to the value the
+  //! neutronics ranks last received, so the gathered field never differs from the
+  //! local fields by more than the tolerance, except that a value sent with a reduced
+  //! precision differs by its encoding error until it changes again.  All values are
+  //! sent the first time.
+  //!
+  //! \param local Local cell field (significant on heat/fluids ranks)
+  //! \param tolerance Smallest change that is sent
+  //! \param sent Local cell values as last received by the neutronics ranks, updated
+  //! with the sent values (used on heat/fluids ranks)
+  //! \param entries Gathered field, one value per entry, updated in place (used on
+  //! neutronics ranks, or only on node leaders after init_shared())
+  //! \param changed_cells Sorted indices into cells() of the unique cells whose
+  //! entries changed (set on neutronics ranks)
+  template<typename T>
+  void gather_changes(const T* local,
+                      double tolerance,
+                      std::vector<T>& sent,
+                      std::vector<T>& entries,
+                      std::vector<gsl::index>& changed_cells) const;
+
+  //! Scatter per-cell values from the neutronics root to the local cells of every
+  //! heat/fluids rank
+  //!
+  //! \param values One value per unique cell (significant on the neutronics root)
+  //! \param local Local cell field (set on heat/fluids ranks)
+  template<typename T>
+  void scatter(const std::vector<T>& values, T* local) const;
+
+  //! Scatter per-cell values from the neutronics root to the local cells of every
+  //! heat/fluids rank through the neutronics ranks that own them
+  //!
+  //! The root sends each neutronics rank the values of its slice once, and the
+  //! owners then send them on with scatter_slices().  Requires init_slices().
+  //!
+  //! \param values One value per unique cell (significant on the neutronics root)
+  //! \param local Local cell field (set on heat/fluids ranks)
+  template<typename T>
+  void scatter_sliced(const std::vector<T>& values, T* local) const;
+
+  //! Scatter per-cell values from the neutronics ranks that own them to the local
+  //! cells of every heat/fluids rank. Requires init_slices().
+  //!
+  //! \param slice Values of the owned cells, slice_size() of them (significant on
+  //! neutronics ranks)
+  //! \param local Local cell field (set on heat/fluids ranks)
+  template<typename T>
+  void scatter_slices(const T* slice, T* local) const;
+
+  //! Gather a local cell field and compute its volume average over each unique cell
+  //!
+  //! The averages are stored by the plan, so they are only valid until the next call
+  //! of volume_average().  After init_shared(), they are read in place from memory
+  //! shared by the node, and every neutronics rank must make the call.
+  //!
+  //! \param local Local cell field (significant on heat/fluids ranks)
+  //! \return One value per unique cell (significant on neutronics ranks)
+  gsl::span<const double> volume_average(const double* local) const;
+
+  //! Compute the volume average over each unique cell of an already gathered field
+  //!
+  //! \param entries Gathered field, one value per entry (significant on neutronics
+  //! ranks, or only on node leaders after init_shared())
+  //! \return One value per unique cell (significant on neutronics ranks), valid until
+  //! the next call of volume_average()
+  gsl::span<const double> volume_average(const std::vector<double>& entries) const;
+
+  //! Gather a local cell field and compute its volume average over the fluid portion
+  //! of each unique cell
+  //!
+  //! Like volume_average(), the averages are only valid until the next call.
+  //!
+  //! \param local Local cell field (significant on heat/fluids ranks)
+  //! \return One value per unique cell, zero for cells not in fluid (significant on
+  //! neutronics ranks)
+  gsl::span<const double> fluid_average(const double* local) const;
+
+  //! Compute the volume average over the fluid portion of each unique cell of an
+  //! already gathered field
+  //!
+  //! \param entries Gathered field, one value per entry (significant on neutronics
+  //! ranks, or only on node leaders after init_shared())
+  //! \return One value per unique cell, zero for cells not in fluid (significant on
+  //! neutronics ranks), valid until the next call of fluid_average()
+  gsl::span<const double> fluid_average(const std::vector<double>& entries) const;
+
+  //! Unique cells coupled to the heat/fluids solver. Set only on neutronics ranks.
+  const std::vector<CellHandle>& cells() const { return cells_; }
+
+  //! NeutronicsDriver::cell_index of each unique cell. Set only on neutronics ranks.
+  const std::vector<gsl::index>& cell_index() const { return cell_index_; }
+
+  //! Volume of each unique cell summed over all heat/fluids ranks. Set only on
+  //! neutronics ranks.
+  const std::vector<double>& cell_volumes() const { return cell_volumes_; }
+
+  //! Whether each unique cell is in fluid. Set only on neutronics ranks.
+  const std::vector<int>& cell_in_fluid() const { return cell_in_fluid_; }
+
+private:
+  //! Create the communicators of the neutronics ranks on each node and of their
+  //! leaders, if they don't exist yet
+  void init_node_comms();
+
+  //! Start gathering a local cell field straight onto the neutronics root, which only
+  //! a field sent in full can do without blocking
+  //!
+  //! \param local Local cell field (significant on heat/fluids ranks)
+  //! \param entries Gathered field (set on the neutronics root, already sized)
+  //! \return Handle to the pending gather
+  template<typename T>
+  Request igather_direct(const T* local, std::vector<T>& entries, std::false_type) const;
+
+  //! Start gathering a double-precision field, which blocks with a reduced precision.
+  //! \sa igather_direct
+  Request igather_direct(const double* local,
+                         std::vector<double>& entries,
+                         std::true_type) const;
+
+  //! Gather a local cell field onto the neutronics root through the node leaders
+  //!
+  //! \param local Local cell field (significant on heat/fluids ranks)
+  //! \param entries Gathered field (set on the neutronics root, already sized)
+  template<typename T>
+  void gather_hierarchical(const T* local, std::vector<T>& entries) const;
+
+  //! Scatter per-entry values from the neutronics root through the node leaders
+  //!
+  //! \param entries Values of all entries (significant on the neutronics root)
+  //! \param local Local cell field (set on heat/fluids ranks)
+  template<typename T>
+  void scatter_hierarchical(const std::vector<T>& entries, T* local) const;
+
+  //! Sum weighted entries into their unique cells
+  //!
+  //! \param entries Gathered field, one value per entry
+  //! \param weights Weight of each entry
+  //! \param values Buffer for the sums of the calling rank
+  //! \param shared Buffer for the sums of the node after init_shared()
+  //! \return One value per unique cell
+  gsl::span<const double> reduce(const std::vector<double>& entries,
+                                 const std::vector<double>& weights,
+                                 std::vector<double>& values,
+                                 SharedArray<double>& shared) const;
+
+  //! Number of bytes of a message of field values
+  //! \param count Number of values
+  template<typename T>
+  std::size_t payload_bytes(int count) const
+  {
+    return std::is_same<T, double>::value ? packed_size(count, precision_)
+                                          : count * sizeof(T);
+  }
+
+  //! Whether the calling rank receives the gathered entries
+  bool receives_entries() const
+  {
+    return shared_ ? leader_comm_.active() : neutronics_comm_.active();
+  }
+
+  Comm comm_;            //!< The coupling communicator
+  Comm neutronics_comm_; //!< The neutronics communicator
+
+  //! The rank in comm_ that corresponds to the root of the neutronics comm
+  int neutronics_root_ = MPI_PROC_NULL;
+
+  //! Number of local cells on the calling rank
+  int n_local_ = 0;
+
+  //! Number of local cells on each rank in comm_. Set only on the neutronics root.
+  std::vector<int> counts_;
+
+  //! Offset of each rank's local cells within the entries. Set only on the neutronics
+  //! root.
+  std::vector<int> displs_;
+
+  //! Total number of entries over all heat/fluids ranks. Set only on neutronics ranks.
+  int n_entries_ = 0;
+
+  //! Index into cells_ of each entry. Set only on neutronics ranks.
+  std::vector<gsl::index> entry_to_cell_;
+
+  //! Unique cells. Set only on neutronics ranks.
+  std::vector<CellHandle> cells_;
+
+  //! NeutronicsDriver::cell_index of each unique cell. Set only on neutronics ranks.
+  std::vector<gsl::index> cell_index_;
+
+  //! Volume of each unique cell. Set only on neutronics ranks.
+  std::vector<double> cell_volumes_;
+
+  //! 1 if a unique cell is in fluid, 0 otherwise. Set only on neutronics ranks.
+  std::vector<int> cell_in_fluid_;
+
+  //! Entry volume divided by the volume of its cell. Set only on neutronics ranks.
+  std::vector<double> volume_weights_;
+
+  //! Entry fluid volume divided by the fluid volume of its cell. Set only on
+  //! neutronics ranks.
+  std::vector<double> fluid_weights_;
+
+  //! Whether the sliced scatter pattern has been set up
+  bool sliced_ = false;
+
+  //! Unique cells grouped by the neutronics rank that owns them, as indices into
+  //! cells_. Set only on neutronics ranks.
+  std::vector<gsl::index> slice_order_;
+
+  //! Index into slice_order_ of the first cell owned by the calling neutronics rank
+  gsl::index slice_begin_ = 0;
+
+  //! Number of cells owned by the calling neutronics rank
+  int slice_size_ = 0;
+
+  //! Number of cells owned by each neutronics rank. Set only on neutronics ranks.
+  std::vector<int> slice_counts_;
+
+  //! Offset into slice_order_ of each neutronics rank's slice. Set only on neutronics
+  //! ranks.
+  std::vector<int> slice_displs_;
+
+  //! The communicator of sliced scatters, either comm_ or the calling rank's node
+  Comm slice_comm_;
+
+  //! Number of values the calling rank sends to each rank in slice_comm_ in sliced
+  //! scatters
+  std::vector<int> slice_send_counts_;
+
+  //! Offset of the values sent to each rank in slice_comm_ in sliced scatters
+  std::vector<int> slice_send_displs_;
+
+  //! Number of values the calling rank receives from each rank in slice_comm_ in
+  //! sliced scatters
+  std::vector<int> slice_recv_counts_;
+
+  //! Offset of the values received from each rank in slice_comm_ in sliced scatters
+  std::vector<int> slice_recv_displs_;
+
+  //! Index into the owned slice of each value sent in sliced scatters
+  std::vector<gsl::index> slice_send_cells_;
+
+  //! Local cell of each value received in sliced scatters
+  std::vector<int> slice_recv_local_;
+
+  //! Whether the gathered entries and averages are shared within each node
+  bool shared_ = false;
+
+  //! Precision with which double-precision fields are exchanged
+  Precision precision_ = Precision::full;
+
+  //! The neutronics ranks on the calling rank's node. Set only on neutronics ranks
+  //! after init_shared() or init_hierarchical().
+  Comm node_comm_;
+
+  //! The first neutronics rank of each node. Set only on node leaders after
+  //! init_shared() or init_hierarchical().
+  Comm leader_comm_;
+
+  //! Whether whole fields are exchanged through the node leaders
+  bool hierarchical_ = false;
+
+  //! The ranks of comm_ on the calling rank's node after init_hierarchical()
+  Comm intranode_comm_;
+
+  //! The first rank of comm_ on each node. Set only on those ranks after
+  //! init_hierarchical().
+  Comm internode_comm_;
+
+  //! Rank in internode_comm_ of the neutronics root
+  int internode_root_ = 0;
+
+  //! Number of local cells on the calling rank's node. Set only on node leaders.
+  int n_node_local_ = 0;
+
+  //! Number of local cells on each rank of intranode_comm_. Set only on node leaders.
+  std::vector<int> intranode_counts_;
+
+  //! Offset of each rank's local cells within its node's. Set only on node leaders.
+  std::vector<int> intranode_displs_;
+
+  //! Number of local cells on each node. Set only on the neutronics root.
+  std::vector<int> internode_counts_;
+
+  //! Offset of each node's local cells in the values that arrive from the leaders.
+  //! Set only on the neutronics root.
+  std::vector<int> internode_displs_;
+
+  //! Rank in comm_ of each rank in the order in which their values arrive from the
+  //! leaders. Set only on the neutronics root.
+  std::vector<int> arrival_ranks_;
+
+  //! Latest volume averages of the calling rank, if they aren't shared
+  mutable std::vector<double> volume_averages_;
+
+  //! Latest fluid averages of the calling rank, if they aren't shared
+  mutable std::vector<double> fluid_averages_;
+
+  //! Latest volume averages of the node after init_shared()
+  mutable SharedArray<double> shared_volume_averages_;
+
+  //! Latest fluid averages of the node after init_shared()
+  mutable SharedArray<double> shared_fluid_averages_;
+};
+
+template<typename T>
+void CouplingPlan::gather(const T* local, std::vector<T>& entries) const
+{
+  auto request = igather(local, entries);
+  finish_gather(request, entries);
+}
+
+template<typename T>
+Request CouplingPlan::igather(const T* local, std::vector<T>& entries) const
+{
+  if (receives_entries()) {
+    entries.resize(n_entries_);
+  }
+  int n_recv = comm_.rank == neutronics_root_ ? n_entries_ : 0;
+  trace::bytes("gather", payload_bytes<T>(n_local_) + payload_bytes<T>(n_recv));
+  if (hierarchical_) {
+    gather_hierarchical(local, entries);
+    return {};
+  }
+  return igather_direct(local, entries, std::is_same<T, double>{});
+}
+
+template<typename T>
+Request CouplingPlan::igather_direct(const T* local,
+                                     std::vector<T>& entries,
+                                     std::false_type) const
+{
+  return comm_.Igatherv(local,
+                        n_local_,
+                        get_mpi_type<T>(),
+                        entries.data(),
+                        counts_.data(),
+                        displs_.data(),
+                        get_mpi_type<T>(),
+                        neutronics_root_);
+}
+
+template<typename T>
+void CouplingPlan::finish_gather(Request& request, std::vector<T>& entries) const
+{
+  request.wait();
+
+  // Every neutronics rank needs the gathered field (e.g., to set temperatures), or
+  // with shared averages, one rank per node
+  if (hierarchical_ && !shared_) {
+    // One broadcast between the nodes, then one within each node
+    if (leader_comm_.active()) {
+      leader_comm_.Bcast(entries.data(), n_entries_, precision_);
+      trace::bytes("gather_bcast", payload_bytes<T>(n_entries_));
+    }
+    if (node_comm_.active()) {
+      node_comm_.Bcast(entries.data(), n_entries_, precision_);
+      trace::bytes("gather_bcast_node", payload_bytes<T>(n_entries_));
+    }
+    return;
+  }
+  const auto& receivers = shared_ ? leader_comm_ : neutronics_comm_;
+  if (receivers.active()) {
+    receivers.Bcast(entries.data(), n_entries_, precision_);
+    trace::bytes("gather_bcast", payload_bytes<T>(n_entries_));
+  }
+}
+
+template<typename T>
+void CouplingPlan::gather_hierarchical(const T* local, std::vector<T>& entries) const
+{
+  // Each leader collects the local cells of its node
+  std::vector<T> node_values(n_node_local_);
+  intranode_comm_.Gatherv(local,
+                          n_local_,
+                          node_values.data(),
+                          intranode_counts_.data(),
+                          intranode_displs_.data(),
+                          precision_);
+  trace::bytes("gather_node",
+               payload_bytes<T>(n_local_) + payload_bytes<T>(n_node_local_));
+
+  // The leaders send one message per node to the neutronics root
+  if (!internode_comm_.active()) {
+    return;
+  }
+  std::vector<T> arrived(comm_.rank == neutronics_root_ ? n_entries_ : 0);
+  internode_comm_.Gatherv(node_values.data(),
+                          n_node_local_,
+                          arrived.data(),
+                          internode_counts_.data(),
+                          internode_displs_.data(),
+                          precision_,
+                          internode_root_);
+  trace::bytes("gather_leaders",
+               payload_bytes<T>(n_node_local_) + payload_bytes<T>(arrived.size()));
+
+  // Put the values in the order of the ranks in comm_
+  gsl::index k = 0;
+  for (auto r : arrival_ranks_) {
+    std::copy_n(arrived.cbegin() + k, counts_[r], entries.begin() + displs_[r]);
+    k += counts_[r];
+  }
+}
+
+template<typename T>
+void CouplingPlan::scatter_hierarchical(const std::vector<T>& entries, T* local) const
+{
+  std::vector<T> node_values(n_node_local_);
+  if (internode_comm_.active()) {
+    // The neutronics root sends one message per node to the leaders
+    std::vector<T> arriving;
+    if (comm_.rank == neutronics_root_) {
+      arriving.reserve(n_entries_);
+      for (auto r : arrival_ranks_) {
+        arriving.insert(arriving.end(),
+                        entries.cbegin() + displs_[r],
+                        entries.cbegin() + displs_[r] + counts_[r]);
+      }
+    }
+    internode_comm_.Scatterv(arriving.data(),
+                             internode_counts_.data(),
+                             internode_displs_.data(),
+                             node_values.data(),
+                             n_node_local_,
+                             precision_,
+                             internode_root_);
+    trace::bytes("scatter_leaders",
+                 payload_bytes<T>(arriving.size()) + payload_bytes<T>(n_node_local_));
+  }
+
+  // Each leader hands out the local cells of its node
+  intranode_comm_.Scatterv(node_values.data(),
+                           intranode_counts_.data(),
+                           intranode_displs_.data(),
+                           local,
+                           n_local_,
+                           precision_);
+  trace::bytes("scatter_node",
+               payload_bytes<T>(n_node_local_) + payload_bytes<T>(n_local_));
+}
+
+template<typename T>
+void CouplingPlan::gather_changes(const T* local,
+                                  double tolerance,
+                                  std::vector<T>& sent,
+                                  std::vector<T>& entries,
+                                  std::vector<gsl::index>& changed_cells) const
+{
+  // Select the local cells that moved by more than the tolerance
+  bool first = sent.size() != n_local_;
+  if (first) {
+    sent.assign(local, local + n_local_);
+  }
+  std::vector<int> index;
+  std::vector<T> values;
+  for (int i = 0; i < n_local_; ++i) {
+    if (first || std::abs(local[i] - sent[i]) > tolerance) {
+      index.push_back(i);
+      values.push_back(local[i]);
+    }
+  }
+
+  // Remember the values as the neutronics ranks will receive them, so that the error
+  // of a reduced precision is caught by the next comparison instead of accumulating
+  std::vector<T> received{values};
+  round_trip(received.data(), received.size(), precision_);
+  for (gsl::index k = 0; k < index.size(); ++k) {
+    sent[index[k]] = received[k];
+  }
+
+  // The neutronics root collects the changes of all ranks
+  int n_changed = index.size();
+  std::vector<int> counts;
+  std::vector<int> displs;
+  int n_total = 0;
+  if (comm_.rank == neutronics_root_) {
+    counts.resize(comm_.size);
+    displs.resize(comm_.size);
+  }
+  comm_.Gather(&n_changed, 1, MPI_INT, counts.data(), 1, MPI_INT, neutronics_root_);
+  if (comm_.rank == neutronics_root_) {
+    displs[0] = 0;
+    std::partial_sum(counts.cbegin(), counts.cend() - 1, displs.begin() + 1);
+    n_total = displs.back() + counts.back();
+  }
+
+  std::vector<int> entry_index(n_total);
+  std::vector<T> entry_values(n_total);
+  comm_.Gatherv(index.data(),
+                n_changed,
+                MPI_INT,
+                entry_index.data(),
+                counts.data(),
+                displs.data(),
+                MPI_INT,
+                neutronics_root_);
+  comm_.Gatherv(values.data(),
+                n_changed,
+                entry_values.data(),
+                counts.data(),
+                displs.data(),
+                precision_,
+                neutronics_root_);
+
+  if (comm_.rank == neutronics_root_) {
+    // Convert local cell indices to entry indices
+    for (int r = 0; r < comm_.size; ++r) {
+      for (int k = displs[r]; k < displs[r] + counts[r]; ++k) {
+        entry_index[k] += displs_[r];
+      }
+    }
+  }
+
+  // Every rank that holds the gathered field applies the changes
+  int n_gathered = comm_.rank == neutronics_root_ ? n_total : 0;
+  int n_recv = n_gathered;
+  const auto& receivers = shared_ ? leader_comm_ : neutronics_comm_;
+  if (receivers.active()) {
+    receivers.broadcast(n_total);
+    entry_index.resize(n_total);
+    entry_values.resize(n_total);
+    receivers.Bcast(entry_index.data(), n_total, MPI_INT);
+    // Encoding the values again would change them, so they go on in full
+    receivers.Bcast(entry_values.data(), n_total, Precision::full);
+
+    entries.resize(n_entries_);
+    changed_cells.clear();
+    for (int k = 0; k < n_total; ++k) {
+      entries[entry_index[k]] = entry_values[k];
+      changed_cells.push_back(entry_to_cell_[entry_index[k]]);
+    }
+    std::sort(changed_cells.begin(), changed_cells.end());
+    changed_cells.erase(std::unique(changed_cells.begin(), changed_cells.end()),
+                        changed_cells.end());
+    n_recv += n_total;
+  }
+
+  // The leaders tell the other neutronics ranks of their node which cells changed
+  if (shared_ && node_comm_.active()) {
+    node_comm_.broadcast(changed_cells);
+  }
+  trace::bytes("gather_changes",
+               (n_changed + n_recv) * sizeof(int) + payload_bytes<T>(n_changed) +
+                 payload_bytes<T>(n_gathered) + (n_recv - n_gathered) * sizeof(T));
+}
+
+template<typename T>
+void CouplingPlan::scatter(const std::vector<T>& values, T* local) const
+{
+  std::vector<T> entries;
+  if (comm_.rank == neutronics_root_) {
+    entries.resize(n_entries_);
+    for (gsl::index i = 0; i < n_entries_; ++i) {
+      entries[i] = values[entry_to_cell_[i]];
+    }
+  }
+  if (hierarchical_) {
+    scatter_hierarchical(entries, local);
+    return;
+  }
+  trace::bytes("scatter", payload_bytes<T>(entries.size()) + payload_bytes<T>(n_local_));
+  comm_.Scatterv(entries.data(),
+                 counts_.data(),
+                 displs_.data(),
+                 local,
+                 n_local_,
+                 precision_,
+                 neutronics_root_);
+}
+
+template<typename T>
+void CouplingPlan::scatter_sliced(const std::vector<T>& values, T* local) const
+{
+  Expects(sliced_);
+
+  // Unlike scatter(), the root sends every unique cell once rather than once per
+  // entry, and never builds the entries
+  std::vector<T> slice(slice_size_);
+  if (neutronics_comm_.active()) {
+    std::vector<T> ordered;
+    if (neutronics_comm_.rank == 0) {
+      ordered.reserve(slice_order_.size());
+      for (auto c : slice_order_) {
+        ordered.push_back(values[c]);
+      }
+    }
+    neutronics_comm_.Scatterv(ordered.data(),
+                              slice_counts_.data(),
+                              slice_displs_.data(),
+                              slice.data(),
+                              slice_size_,
+                              precision_);
+    int n_send = neutronics_comm_.rank == 0 ? cells_.size() : 0;
+    trace::bytes("scatter_to_slices",
+                 payload_bytes<T>(n_send) + payload_bytes<T>(slice_size_));
+  }
+  scatter_slices(slice.data(), local);
+}
+
+template<typename T>
+void CouplingPlan::scatter_slices(const T* slice, T* local) const
+{
+  Expects(sliced_);
+
+  std::vector<T> send(slice_send_cells_.size());
+  for (gsl::index i = 0; i < send.size(); ++i) {
+    send[i] = slice[slice_send_cells_[i]];
+  }
+
+  std::vector<T> recv(n_local_);
+  slice_comm_.Alltoallv(send.data(),
+                        slice_send_counts_.data(),
+                        slice_send_displs_.data(),
+                        recv.data(),
+                        slice_recv_counts_.data(),
+                        slice_recv_displs_.data(),
+                        precision_);
+  trace::bytes("scatter_slices",
+               payload_bytes<T>(send.size()) + payload_bytes<T>(n_local_));
+
+  for (gsl::index i = 0; i < n_local_; ++i) {
+    local[slice_recv_local_[i]] = recv[i];
+  }
+}
+
+} // namespace enrico
+
+#endif // ENRICO_COUPLING_PLAN_H
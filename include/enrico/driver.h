@@ -5,10 +5,13 @@
 
 #include "enrico/comm.h"
 #include "enrico/mpi_types.h"
+#include "enrico/output.h"
 #include "enrico/timer.h"
 
 #include <mpi.h>
 
+#include <cstddef>
+#include <string>
 #include <vector>
 
 #ifdef _OPENMP
@@ -22,13 +25,14 @@ class Driver {
 public:
   //! Initializes the solver with the given MPI communicator.
   //! \param comm An existing MPI communicator used to initialize the solver
-  explicit Driver(MPI_Comm comm)
+  //! \param category Trace category of the driver's timers
+  explicit Driver(MPI_Comm comm, const std::string& category = "driver")
     : comm_(comm)
-    , timer_driver_setup(comm_)
-    , timer_init_step(comm_)
-    , timer_solve_step(comm_)
-    , timer_write_step(comm_)
-    , timer_finalize_step(comm_)
+    , timer_driver_setup(comm_, category, "driver_setup")
+    , timer_init_step(comm_, category, "init_step")
+    , timer_solve_step(comm_, category, "solve_step")
+    , timer_write_step(comm_, category, "write_step")
+    , timer_finalize_step(comm_, category, "finalize_step")
   {
 #ifdef _OPENMP
 #pragma omp parallel default(none) shared(num_threads)
@@ -37,6 +41,10 @@ public:
 #endif
   }
 
+  //! Performs the necessary initialization for this solver at the start of a timestep,
+  //! before the init_step() of its first Picard iteration
+  virtual void init_timestep() {}
+
   //! Performs the necessary initialization for this solver in one Picard iteration
   virtual void init_step() {}
 
@@ -51,6 +59,21 @@ public:
   //! Write results for a physics solve at the end of the coupled simulation
   void write_step() { this->write_step(-1, -1); }
 
+  //! Wait for results that write_step() writes in the background to be complete
+  virtual void flush_write() {}
+
+  //! Bytes held by the driver's own arrays on the calling rank, not counting the
+  //! memory that the external solver allocates itself
+  virtual std::size_t memory_usage() const { return 0; }
+
+  //! Set how often and what write_step() writes
+  //! \param settings Output settings
+  virtual void set_output(const OutputSettings& settings)
+  {
+    output_ = settings;
+    output_history_ = OutputHistory{settings.keep};
+  }
+
   //! Performs the necessary finalization for this solver in one Picard iteration
   virtual void finalize_step() {}
 
@@ -68,6 +91,10 @@ public:
 
   //! Number of OpenMP threads
   int num_threads;
+
+protected:
+  OutputSettings output_;        //!< How often and what write_step() writes
+  OutputHistory output_history_; //!< Files written by write_step() that are kept
 };
 
 } // namespace enrico
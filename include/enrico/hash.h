@@ -0,0 +1,26 @@
+//! \file hash.h
+//! Helpers for building order-dependent hashes of several values
+#ifndef ENRICO_HASH_H
+#define ENRICO_HASH_H
+
+#include <cstddef>
+#include <functional> // for hash
+
+namespace enrico {
+
+//! Mix the hash of a value into an existing hash
+//!
+//! Uses the combination from boost::hash_combine, so the result depends on the order
+//! in which values are combined.
+//!
+//! \param seed The hash to update
+//! \param value The value to mix in
+template<typename T>
+void hash_combine(std::size_t& seed, const T& value)
+{
+  seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+} // namespace enrico
+
+#endif // ENRICO_HASH_H
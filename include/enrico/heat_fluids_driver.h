@@ -6,13 +6,25 @@
 #include "enrico/driver.h"
 #include "enrico/geom.h"
 #include "enrico/mpi_types.h"
+#include "enrico/water_properties.h"
 #include "pugixml.hpp"
 #include "xtensor/xtensor.hpp"
 
+#include <gsl/gsl>
+
 #include <cstddef> // for size_t
+#include <cstdint>
+#include <vector>
 
 namespace enrico {
 
+//! Quadrature points of the local mesh elements, in compressed-row form
+struct ElementQuadrature {
+  std::vector<int32_t> offsets; //!< Points of element e are [offsets[e], offsets[e + 1])
+  std::vector<Position> points; //!< Coordinates of each point
+  std::vector<double> weights;  //!< Fraction of its element's volume of each point
+};
+
 //! Base class for driver that controls a heat-fluids solve
 class HeatFluidsDriver : public Driver {
 public:
@@ -27,6 +39,14 @@ public:
 
   virtual int set_heat_source_at(int32_t local_elem, double heat) = 0;
 
+  //! Set the heat source of all local mesh elements at once
+  //!
+  //! The default implementation calls set_heat_source_at() for each element; drivers
+  //! should override it with a bulk update where possible.
+  //!
+  //! \param heat Heat source of each local element, indexed by local element ID
+  virtual void set_heat_source(gsl::span<const double> heat);
+
   //! Return true if a local element is in the fluid region
   //! \param local_elem  A local element ID
   //! \return 1 if the local element is in fluid; 0 otherwise
@@ -42,6 +62,9 @@ public:
 
   double pressure_bc_; //! System pressure in [MPa]
 
+  //! Water properties used to evaluate fluid temperatures and densities
+  WaterProperties water_;
+
   //! Get temperature of local mesh elements
   //! \return Temperature of local mesh elements in [K]
   virtual std::vector<double> temperature() const = 0;
@@ -50,6 +73,23 @@ public:
   //! \return Density of local mesh elements in [g/cm^3]
   virtual std::vector<double> density() const = 0;
 
+  //! Write the temperature of local mesh elements into a preallocated buffer
+  //!
+  //! Unlike temperature(), this doesn't allocate, so it is used for the field
+  //! updates of every Picard iteration. The default implementation copies
+  //! temperature(); drivers should override it to write directly into the buffer.
+  //!
+  //! \param values Temperature of each local element in [K], n_local_elem() values
+  virtual void fill_temperature(gsl::span<double> values) const;
+
+  //! Write the density of local mesh elements into a preallocated buffer
+  //!
+  //! The default implementation copies density(); drivers should override it to write
+  //! directly into the buffer.
+  //!
+  //! \param values Density of each local element in [g/cm^3], n_local_elem() values
+  virtual void fill_density(gsl::span<double> values) const;
+
   //! States whether each local region is in fluid
   //! \return For each local region, 1 if region is in fluid and 0 otherwise
   virtual std::vector<int> fluid_mask() const = 0;
@@ -58,6 +98,21 @@ public:
   //! \return Centroids of local mesh elements
   virtual std::vector<Position> centroid() const = 0;
 
+  //! Get quadrature points that sample the volumes of local mesh elements
+  //!
+  //! The points are used to split elements among the neutronics cells they overlap.
+  //! The default implementation samples each element only at its centroid; drivers
+  //! should override it where the element geometry is known.
+  //!
+  //! \param order Number of points along each direction of an element
+  //! \return Quadrature points of local mesh elements
+  virtual ElementQuadrature quadrature(int order) const;
+
+  //! Get the centroids of local mesh elements as quadrature points with one point per
+  //! element
+  //! \return Quadrature points of local mesh elements
+  ElementQuadrature centroid_quadrature() const;
+
   //! Get volumes of local mesh elements
   //! \return Volumes of local mesh elements
   virtual std::vector<double> volume() const = 0;
@@ -0,0 +1,96 @@
+//! \file memory.h
+//! Accounting of the memory held by the coupling data structures on each rank
+#ifndef ENRICO_MEMORY_H
+#define ENRICO_MEMORY_H
+
+#include "enrico/comm.h"
+
+#include <xtensor/xtensor.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <utility> // for pair
+#include <vector>
+
+namespace enrico {
+
+//! Bytes held by the storage of a vector
+template<typename T>
+std::size_t memory_bytes(const std::vector<T>& values)
+{
+  return values.capacity() * sizeof(T);
+}
+
+//! Bytes held by the storage of an xtensor
+template<typename T, std::size_t N>
+std::size_t memory_bytes(const xt::xtensor<T, N>& values)
+{
+  return values.size() * sizeof(T);
+}
+
+//! Bytes held by the elements of a deque
+template<typename T>
+std::size_t memory_bytes(const std::deque<T>& values)
+{
+  std::size_t bytes = 0;
+  for (const auto& v : values) {
+    bytes += memory_bytes(v);
+  }
+  return bytes;
+}
+
+//! Approximate bytes held by a hash map, counting its buckets and one node per
+//! element
+template<typename K, typename V>
+std::size_t memory_bytes(const std::unordered_map<K, V>& values)
+{
+  return values.bucket_count() * sizeof(void*) +
+         values.size() * (sizeof(std::pair<const K, V>) + 2 * sizeof(void*));
+}
+
+//! Current resident set size of the calling process
+//! \return Size in bytes, or 0 if it can't be determined
+std::size_t resident_bytes();
+
+//! Largest resident set size of the calling process so far
+//! \return Size in bytes, or 0 if it can't be determined
+std::size_t peak_resident_bytes();
+
+//! Current and peak bytes held by named subsystems on the calling rank
+//!
+//! The bytes are sampled with record(), so the peak is the largest sample rather than
+//! the true high-water mark between samples.  The resident set size of the process
+//! is reported as well, and its peak is the true one.
+class MemoryUsage {
+public:
+  //! Record the bytes currently held by a subsystem
+  //!
+  //! Every rank of the communicator later passed to report() must record the same
+  //! subsystems in the same order, with 0 bytes for those it doesn't hold.
+  //!
+  //! \param name Label of the subsystem
+  //! \param bytes Number of bytes held by the calling rank
+  void record(const std::string& name, std::size_t bytes);
+
+  //! Print the largest and mean current and peak bytes over the ranks of a
+  //! communicator for each subsystem.  This is a collective operation on comm.
+  //!
+  //! \param comm The root process of this Comm will print the output
+  void report(const Comm& comm) const;
+
+private:
+  //! Bytes held by one subsystem
+  struct Entry {
+    std::string name;    //!< Label of the subsystem
+    std::size_t current; //!< Bytes in the latest sample
+    std::size_t peak;    //!< Largest sample
+  };
+
+  std::vector<Entry> entries_; //!< Subsystems in the order first recorded
+};
+
+} // namespace enrico
+
+#endif // ENRICO_MEMORY_H
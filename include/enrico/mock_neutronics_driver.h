@@ -0,0 +1,96 @@
+//! \file mock_neutronics_driver.h
+//! Neutronics driver on a Cartesian mesh that stands in for a transport solver
+#ifndef ENRICO_MOCK_NEUTRONICS_DRIVER_H
+#define ENRICO_MOCK_NEUTRONICS_DRIVER_H
+
+#include "enrico/geom.h"
+#include "enrico/neutronics_driver.h"
+
+#include <gsl/gsl>
+#include <mpi.h>
+#include <pugixml.hpp>
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+namespace enrico {
+
+//! Neutronics driver whose cells are the boxes of a Cartesian mesh
+//!
+//! The driver doesn't transport particles: solve_step() does nothing and the heat
+//! source is uniform over the coupled cells.  It exercises the coupling layer
+//! (mapping, volume/fluid weights, and field exchanges) at any scale without a
+//! neutronics model, for example in the bench_coupling benchmark.
+class MockNeutronicsDriver : public NeutronicsDriver {
+public:
+  //! Set up the mesh
+  //! \param comm An existing MPI communicator
+  //! \param node XML node containing <lower_left>, <upper_right>, and <dimension>
+  MockNeutronicsDriver(MPI_Comm comm, pugi::xml_node node);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // NeutronicsDriver interface
+
+  //! Find the mesh boxes containing a vector of positions
+  //! \param positions (x,y,z) coordinates to search for
+  //! \return Handles to cells, which are the flattened mesh indices of the boxes
+  std::vector<CellHandle> find(const std::vector<Position>& positions) override;
+
+  void set_density(CellHandle cell, double rho) const override;
+
+  void set_temperature(CellHandle cell, double T) const override;
+
+  double get_density(CellHandle cell) const override;
+
+  double get_temperature(CellHandle cell) const override;
+
+  double get_volume(CellHandle cell) const override;
+
+  bool is_fissionable(CellHandle cell) const override { return true; }
+
+  std::size_t n_cells() const override { return cells_.size(); }
+
+  void create_tallies() override {}
+
+  //! Uniform heat source that integrates to the given power over the coupled cells
+  //! \param power User-specified power in [W]
+  //! \return Heat source in each cell as [W/cm3]
+  xt::xtensor<double, 1> heat_source(double power) const override;
+
+  std::string cell_label(CellHandle cell) const override;
+
+  gsl::index cell_index(CellHandle cell) const override;
+
+  std::size_t geometry_hash() const override;
+
+  std::size_t memory_usage() const override;
+
+  //! The handle of a mesh box doesn't depend on when it was found, so it is its key
+  std::uint64_t cell_key(CellHandle cell) const override { return cell; }
+
+  void restore_cells(const std::vector<std::uint64_t>& keys) override;
+
+private:
+  //! Register a cell the first time it is found
+  void add_cell(CellHandle cell);
+
+  //! Mesh index along each axis of a cell
+  std::array<int, 3> mesh_index(CellHandle cell) const;
+
+  Position lower_left_;          //!< Lower-left corner of the mesh in [cm]
+  Position upper_right_;         //!< Upper-right corner of the mesh in [cm]
+  std::array<int, 3> dimension_; //!< Number of boxes along each axis
+
+  std::vector<CellHandle> cells_;                       //!< Coupled cells
+  std::unordered_map<CellHandle, gsl::index> cell_index_; //!< Index into cells_
+
+  // The NeutronicsDriver interface sets properties through const member functions,
+  // so the stored properties are mutable
+  mutable std::vector<double> temperatures_; //!< Temperature of each cell in [K]
+  mutable std::vector<double> densities_;    //!< Density of each cell in [g/cm^3]
+};
+
+} // namespace enrico
+
+#endif // ENRICO_MOCK_NEUTRONICS_DRIVER_H
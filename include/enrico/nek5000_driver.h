@@ -115,6 +115,14 @@ private:
   //! \return Density of local mesh elements in [g/cm^3]
   std::vector<double> density() const override;
 
+  //! Write the temperature of local mesh elements into a preallocated buffer
+  //! \param values Temperature of each local element in [K]
+  void fill_temperature(gsl::span<double> values) const override;
+
+  //! Write the density of local mesh elements into a preallocated buffer
+  //! \param values Density of each local element in [g/cm^3]
+  void fill_density(gsl::span<double> values) const override;
+
   //! States whether each local region is in fluid
   //! \return For each local region, 1 if region is in fluid and 0 otherwise
   std::vector<int> fluid_mask() const override;
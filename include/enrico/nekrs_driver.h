@@ -13,6 +13,9 @@ public:
 
   ~NekRSDriver();
 
+  //! Restart the schedule of warm-started time steps
+  void init_timestep() override;
+
   void init_step() override;
   void solve_step() override;
   void write_step(int timestep, int iteration) override;
@@ -29,16 +32,41 @@ public:
 
   int set_heat_source_at(int32_t local_elem, double heat) override;
 
+  void set_heat_source(gsl::span<const double> heat) override;
+
 private:
   std::vector<Position> centroid() const override;
+  ElementQuadrature quadrature(int order) const override;
   std::vector<double> volume() const override;
   std::vector<double> temperature() const override;
   std::vector<double> density() const override;
+  void fill_temperature(gsl::span<double> values) const override;
+  void fill_density(gsl::span<double> values) const override;
   std::vector<int> fluid_mask() const override;
 
   void open_lib_udf();
   void close_lib_udf();
 
+  //! Build the OCCA kernels used when coupling data stays on the device
+  void init_device_coupling();
+
+  //! Compute the element-averaged temperatures on the device and download them
+  //! \param values Temperature of each local element in [K]
+  void device_temperature(gsl::span<double> values) const;
+
+  //! Time step from the current state for a warm-started Picard iteration
+  //!
+  //! Takes fewer steps in each later iteration of the timestep, and stops early once
+  //! the element temperatures stop changing.
+  void solve_warm_step();
+
+  //! Check whether the element temperatures have stopped changing
+  //! \param previous Element temperatures at the last check, replaced by the current
+  //! ones
+  //! \return Whether the largest change relative to the largest temperature is below
+  //! warm_tolerance_ on all ranks
+  bool temperature_plateaued(std::vector<double>& previous);
+
   std::string setup_file_;
   std::string thread_model_;
   std::string device_number_;
@@ -49,8 +77,8 @@ private:
   int poly_deg_;
   int n_gll_;
 
-  // TODO: These assume the default values of dfloat, dlong, and hlong in
-  //  nekrs/src/libP/include/types.h.  Might want to typedef them
+  // These require dfloat to be double (checked in nekrs_driver.cpp), and int to match
+  // the default dlong in nekrs/src/libP/include/types.h
   const double* x_;
   const double* y_;
   const double* z_;
@@ -58,10 +86,53 @@ private:
   const double* rho_cp_;
   const int* element_info_;
   std::vector<double> mass_matrix_;
+  //! Sum of mass_matrix_ over each element's GLL points
+  std::vector<double> elem_volume_;
+  //! Reciprocal of elem_volume_
+  std::vector<double> elem_inv_volume_;
 
   //! Output heat source to separate .fld file
   bool output_heat_source_ = false;
 
+  //! Compute element averages and set the heat source on the device instead of
+  //! copying the scalar fields to the host
+  bool device_coupling_ = false;
+
+  //! Computes rho*cp-weighted element-averaged temperature on the device
+  occa::kernel element_average_kernel_;
+
+  //! Expands one value per element to every GLL point of the element on the device
+  occa::kernel expand_element_kernel_;
+
+  //! Element-averaged temperatures on the device
+  occa::memory o_elem_temperature_;
+
+  //! Element heat sources on the device
+  occa::memory o_elem_heat_source_;
+
+  //! Number of time steps in the first warm-started Picard iteration of each timestep,
+  //! or 0 to time step from the start time in every Picard iteration
+  int warm_steps_ = 0;
+
+  //! Factor applied to the number of time steps in each later warm-started iteration
+  double warm_step_factor_ = 1.0;
+
+  //! Fewest time steps taken in a warm-started iteration
+  int warm_min_steps_ = 1;
+
+  //! Relative change in the element temperatures between checks below which a
+  //! warm-started iteration stops early, or 0 to always take every step
+  double warm_tolerance_ = 0.0;
+
+  //! Number of time steps between checks for a temperature plateau
+  int warm_check_interval_ = 10;
+
+  //! Number of calls to solve_step() so far
+  int n_solves_ = 0;
+
+  //! Number of warm-started solves so far in the current timestep
+  int n_warm_solves_ = 0;
+
   //! Handle to host when needed for occa::memory.
   occa::device host_;
 
@@ -70,7 +141,9 @@ private:
   void* lib_udf_handle_;
   // TODO: Get cache dir from env.  See udfLoadFunction in nekrs/udf/udf.cpp
   const std::string lib_udf_name_ = ".cache/udf/libUDF.so";
-  std::vector<double>* localq_;
+  std::vector<dfloat>* localq_;
+  //! Device copy of the heat source in the UDF. Null if the UDF does not define one.
+  occa::memory* o_localq_ = nullptr;
 };
 
 }
@@ -9,8 +9,13 @@
 #include "enrico/mpi_types.h"
 
 #include <gsl/gsl>
+#include <xtensor/xbuilder.hpp> // for empty
 #include <xtensor/xtensor.hpp>
 
+#include <cstdint> // for int64_t
+#include <numeric> // for partial_sum
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace enrico {
@@ -19,7 +24,7 @@ namespace enrico {
 class NeutronicsDriver : public Driver {
 public:
   explicit NeutronicsDriver(MPI_Comm comm)
-    : Driver(comm)
+    : Driver(comm, "neutronics")
   {}
 
   virtual ~NeutronicsDriver() = default;
@@ -29,9 +34,41 @@ public:
   //! \return Heat source in each material as [W/cm3]
   virtual xt::xtensor<double, 1> heat_source(double power) const = 0;
 
+  //! Get the heat source of every cell on the neutronics rank that owns it
+  //!
+  //! The default implementation scatters heat_source() from the root; drivers whose
+  //! tallies are spread over the ranks should override it to reduce them directly to
+  //! the owners.  This is a collective operation on the neutronics comm.
+  //!
+  //! \param power User-specified power in [W]
+  //! \param cells Indices of the cells as given by cell_index(), grouped by the rank
+  //! that owns them (the same on every rank)
+  //! \param counts Number of cells owned by each rank
+  //! \return Heat source of the calling rank's cells as [W/cm3], in the order of cells
+  virtual xt::xtensor<double, 1> heat_source_slices(double power,
+                                                    gsl::span<const gsl::index> cells,
+                                                    gsl::span<const int> counts) const;
+
+  //! Get the relative standard deviation of the energy deposition in each material
+  //!
+  //! This is a collective operation on the neutronics comm, like heat_source().
+  //!
+  //! \return Relative standard deviation of the mean heat source in each material,
+  //!         in the same order as heat_source() (zero where no energy is deposited)
+  virtual xt::xtensor<double, 1> heat_source_rel_error() const
+  {
+    throw std::runtime_error{"The neutronics driver does not report tally errors"};
+  }
+
   //! Find cells corresponding to a vector of positions
+  //!
+  //! This is a collective operation on the neutronics comm; every rank must pass the
+  //! same positions and registers the same cells.  Pass all positions in one call, as
+  //! each call synchronizes the neutronics ranks.
+  //!
   //! \param positions (x,y,z) coordinates to search for
-  //! \return Handles to cells
+  //! \return Handles to the cells of the positions (significant on the root of the
+  //! neutronics comm; other ranks may receive an empty vector)
   virtual std::vector<CellHandle> find(const std::vector<Position>& positions) = 0;
 
   //! Set the density of the material in a cell
@@ -44,6 +81,26 @@ public:
   //! \param T Temperature in [K]
   virtual void set_temperature(CellHandle cell, double T) const = 0;
 
+  //! Set the densities of the materials in many cells at once
+  //!
+  //! The default implementation calls set_density() for each cell; drivers should
+  //! override it to resolve the cells once and update them in bulk.
+  //!
+  //! \param cells Handles to cells
+  //! \param rho Density of each cell in [g/cm^3]
+  virtual void set_densities(gsl::span<const CellHandle> cells,
+                             gsl::span<const double> rho) const;
+
+  //! Set the temperatures of many cells at once
+  //!
+  //! The default implementation calls set_temperature() for each cell; drivers should
+  //! override it to resolve the cells once and update them in bulk.
+  //!
+  //! \param cells Handles to cells
+  //! \param T Temperature of each cell in [K]
+  virtual void set_temperatures(gsl::span<const CellHandle> cells,
+                                gsl::span<const double> T) const;
+
   //! Get the density of a cell
   //! \param cell Handle to a cell
   //! \return Cell density in [g/cm^3]
@@ -84,8 +141,127 @@ public:
   //! \param cell An existing cell handle
   //! \return The index of the handle in the cells_ ordered mapping
   virtual gsl::index cell_index(CellHandle cell) const = 0;
+
+  //! Get a hash of the geometry that determines the results of find()
+  //!
+  //! Used to detect whether a saved mapping is still valid for the current model.
+  //!
+  //! \return Hash of the geometry
+  virtual std::size_t geometry_hash() const
+  {
+    throw std::runtime_error{"The neutronics driver does not support a mapping cache"};
+  }
+
+  //! Get a key that identifies a cell independently of the order of find() calls
+  //! \param cell Handle to a cell
+  //! \return Key of the cell, as accepted by restore_cells()
+  virtual std::uint64_t cell_key(CellHandle cell) const
+  {
+    throw std::runtime_error{"The neutronics driver does not support a mapping cache"};
+  }
+
+  //! Register cells previously returned by find() without searching the geometry
+  //!
+  //! Afterwards, the driver is in the same state as if find() had returned the cells
+  //! in the given order, so a driver that assigns handles as it finds cells gives them
+  //! the same handles as before.  This must be called with the same keys on every rank
+  //! of the neutronics comm.
+  //!
+  //! \param keys Keys of cells given by cell_key(), in the order of their handles
+  virtual void restore_cells(const std::vector<std::uint64_t>& keys)
+  {
+    throw std::runtime_error{"The neutronics driver does not support a mapping cache"};
+  }
+
+  //! Get the number of particles simulated per batch
+  //! \return Number of particles per batch
+  virtual int64_t n_particles() const
+  {
+    throw std::runtime_error{"The neutronics driver does not support adaptive particles"};
+  }
+
+  //! Set the number of particles simulated per batch, starting with the next
+  //! init_step()
+  //! \param n Number of particles per batch
+  virtual void set_n_particles(int64_t n)
+  {
+    throw std::runtime_error{"The neutronics driver does not support adaptive particles"};
+  }
+
+  //! Get the seed of the pseudorandom number generator
+  //! \return Seed
+  virtual int64_t seed() const
+  {
+    throw std::runtime_error{"The neutronics driver does not support ensembles"};
+  }
+
+  //! Set the seed of the pseudorandom number generator, starting with the next
+  //! init_step()
+  //! \param seed Seed
+  virtual void set_seed(int64_t seed)
+  {
+    throw std::runtime_error{"The neutronics driver does not support ensembles"};
+  }
+
+  //! Set the directory that the solver's own run output (e.g., summary and statepoint
+  //! files) is written to, starting with the next init_step()
+  //!
+  //! This must be called on every rank of the neutronics comm.
+  //!
+  //! \param path Path to the directory, which is created if it doesn't exist
+  virtual void set_output_directory(const std::string& path)
+  {
+    throw std::runtime_error{"The neutronics driver does not support ensembles"};
+  }
 };
 
+inline xt::xtensor<double, 1> NeutronicsDriver::heat_source_slices(
+  double power,
+  gsl::span<const gsl::index> cells,
+  gsl::span<const int> counts) const
+{
+  Expects(counts.size() == comm_.size);
+  auto heat = heat_source(power);
+
+  std::vector<double> ordered;
+  if (comm_.is_root()) {
+    ordered.reserve(cells.size());
+    for (auto i : cells) {
+      ordered.push_back(heat(i));
+    }
+  }
+  std::vector<int> displs(counts.size(), 0);
+  std::partial_sum(counts.begin(), counts.end() - 1, displs.begin() + 1);
+
+  xt::xtensor<double, 1> slice = xt::empty<double>({counts[comm_.rank]});
+  comm_.Scatterv(ordered.data(),
+                 counts.data(),
+                 displs.data(),
+                 MPI_DOUBLE,
+                 slice.data(),
+                 counts[comm_.rank],
+                 MPI_DOUBLE);
+  return slice;
+}
+
+inline void NeutronicsDriver::set_densities(gsl::span<const CellHandle> cells,
+                                            gsl::span<const double> rho) const
+{
+  Expects(cells.size() == rho.size());
+  for (gsl::index i = 0; i < cells.size(); ++i) {
+    set_density(cells[i], rho[i]);
+  }
+}
+
+inline void NeutronicsDriver::set_temperatures(gsl::span<const CellHandle> cells,
+                                               gsl::span<const double> T) const
+{
+  Expects(cells.size() == T.size());
+  for (gsl::index i = 0; i < cells.size(); ++i) {
+    set_temperature(cells[i], T[i]);
+  }
+}
+
 } // namespace enrico
 
 #endif // NEUTRONICS_DRIVER_H
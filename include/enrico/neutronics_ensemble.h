@@ -0,0 +1,169 @@
+//! \file neutronics_ensemble.h
+//! Neutronics driver made of independent instances of another neutronics driver
+#ifndef ENRICO_NEUTRONICS_ENSEMBLE_H
+#define ENRICO_NEUTRONICS_ENSEMBLE_H
+
+#include "enrico/comm.h"
+#include "enrico/neutronics_driver.h"
+
+#include <gsl/gsl>
+#include <mpi.h>
+#include <xtensor/xtensor.hpp>
+
+#include <cstdint> // for int64_t, uint64_t
+#include <functional>
+#include <memory> // for unique_ptr
+#include <string>
+#include <vector>
+
+namespace enrico {
+
+//! Neutronics driver that runs several independent instances ("members") of another
+//! driver on disjoint sets of its ranks
+//!
+//! Each member solves the same model with its own random number seed, and the heat
+//! sources of the members are combined with weights inversely proportional to their
+//! variances.  To the coupled driver, the ensemble is a single neutronics driver on the
+//! union of the members' ranks: every member receives the same temperatures and
+//! densities, and the combined heat source is available on the root.  Only the first
+//! member writes output through write_step(), and member k > 0 writes the solver's own
+//! run output to a member_<k> directory so that the members' files don't collide.
+class NeutronicsEnsemble : public NeutronicsDriver {
+public:
+  //! Creates a member driver on a communicator
+  using Factory = std::function<std::unique_ptr<NeutronicsDriver>(MPI_Comm)>;
+
+  //! Split the ranks into members and set up a driver on each
+  //! \param comm An existing MPI communicator
+  //! \param n_members Number of members, each of which gets a contiguous block of ranks
+  //! \param make_member Creates the driver of a member
+  NeutronicsEnsemble(MPI_Comm comm, int n_members, const Factory& make_member);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // NeutronicsDriver interface
+
+  //! Get the variance-weighted mean of the members' heat sources
+  //!
+  //! Each member's heat source is weighted by the inverse of its variance summed over
+  //! the cells.  Since every member's heat source integrates to the given power, so
+  //! does the combination.  This is a collective operation on the ensemble's comm.
+  //!
+  //! \param power User-specified power in [W]
+  //! \return Heat source in each cell as [W/cm3] (significant on the root)
+  xt::xtensor<double, 1> heat_source(double power) const override;
+
+  //! Relative standard deviation of the heat source from the last heat_source()
+  xt::xtensor<double, 1> heat_source_rel_error() const override { return rel_error_; }
+
+  std::vector<CellHandle> find(const std::vector<Position>& positions) override
+  {
+    return member_->find(positions);
+  }
+
+  void set_density(CellHandle cell, double rho) const override
+  {
+    member_->set_density(cell, rho);
+  }
+
+  void set_temperature(CellHandle cell, double T) const override
+  {
+    member_->set_temperature(cell, T);
+  }
+
+  void set_densities(gsl::span<const CellHandle> cells,
+                     gsl::span<const double> rho) const override
+  {
+    member_->set_densities(cells, rho);
+  }
+
+  void set_temperatures(gsl::span<const CellHandle> cells,
+                        gsl::span<const double> T) const override
+  {
+    member_->set_temperatures(cells, T);
+  }
+
+  double get_density(CellHandle cell) const override
+  {
+    return member_->get_density(cell);
+  }
+
+  double get_temperature(CellHandle cell) const override
+  {
+    return member_->get_temperature(cell);
+  }
+
+  double get_volume(CellHandle cell) const override { return member_->get_volume(cell); }
+
+  bool is_fissionable(CellHandle cell) const override
+  {
+    return member_->is_fissionable(cell);
+  }
+
+  std::size_t n_cells() const override { return member_->n_cells(); }
+
+  void create_tallies() override { member_->create_tallies(); }
+
+  std::string cell_label(CellHandle cell) const override
+  {
+    return member_->cell_label(cell);
+  }
+
+  gsl::index cell_index(CellHandle cell) const override
+  {
+    return member_->cell_index(cell);
+  }
+
+  std::size_t geometry_hash() const override { return member_->geometry_hash(); }
+
+  std::uint64_t cell_key(CellHandle cell) const override
+  {
+    return member_->cell_key(cell);
+  }
+
+  void restore_cells(const std::vector<std::uint64_t>& keys) override
+  {
+    member_->restore_cells(keys);
+  }
+
+  //! Number of particles per batch in each member
+  int64_t n_particles() const override { return member_->n_particles(); }
+
+  //! Set the number of particles per batch in each member
+  void set_n_particles(int64_t n) override { member_->set_n_particles(n); }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Driver interface
+
+  void init_timestep() override { member_->init_timestep(); }
+
+  void init_step() override;
+
+  void solve_step() override;
+
+  //! Write the results of the first member
+  void write_step(int timestep, int iteration) override;
+
+  void flush_write() override;
+
+  std::size_t memory_usage() const override;
+
+  void set_output(const OutputSettings& settings) override;
+
+  void finalize_step() override;
+
+  //! Index of the member that the calling rank belongs to
+  int member_index() const { return member_index_; }
+
+private:
+  std::unique_ptr<NeutronicsDriver> member_; //!< Driver of this rank's member
+  int member_index_ = 0;                     //!< Index of this rank's member
+  Comm roots_comm_; //!< The root of every member, with the first member's root first
+
+  //! Relative standard deviation of the last combined heat source (significant on the
+  //! root)
+  mutable xt::xtensor<double, 1> rel_error_;
+};
+
+} // namespace enrico
+
+#endif // ENRICO_NEUTRONICS_ENSEMBLE_H
@@ -7,12 +7,16 @@
 #include "enrico/geom.h"
 #include "enrico/neutronics_driver.h"
 
+#include "openmc/bank.h"
 #include "openmc/cell.h"
 #include "openmc/tallies/filter_cell_instance.h"
 #include "openmc/tallies/tally.h"
 #include <gsl/gsl>
 #include <mpi.h>
+#include <pugixml.hpp>
 
+#include <cstdint>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -23,7 +27,8 @@ class OpenmcDriver : public NeutronicsDriver {
 public:
   //! One-time initalization of OpenMC and member variables
   //! \param comm An existing MPI communicator used to inialize OpenMC
-  explicit OpenmcDriver(MPI_Comm comm);
+  //! \param node XML node containing OpenMC-specific settings (may be empty)
+  explicit OpenmcDriver(MPI_Comm comm, pugi::xml_node node = {});
 
   //! One-time finalization of OpenMC
   ~OpenmcDriver();
@@ -32,8 +37,12 @@ public:
   // NeutronicsDriver interface
 
   //! Find cells corresponding to a vector of positions
+  //!
+  //! Each rank searches a slice of the positions with its OpenMP threads, and the
+  //! ranks then share only the distinct cell instances they found.
+  //!
   //! \param positions (x,y,z) coordinates to search for
-  //! \return Handles to cells
+  //! \return Handles to the cells of the positions (on the root of comm_ only)
   std::vector<CellHandle> find(const std::vector<Position>& position) override;
 
   //! Set the density of the material in a cell
@@ -46,6 +55,22 @@ public:
   //! \param T Temperature in [K]
   void set_temperature(CellHandle cell, double T) const override;
 
+  //! Set the densities of the materials in many cells at once
+  //!
+  //! Each material is set once, by the last cell it fills, and distinct materials are
+  //! set in parallel.
+  //!
+  //! \param cells Handles to cells
+  //! \param rho Density of each cell in [g/cm^3]
+  void set_densities(gsl::span<const CellHandle> cells,
+                     gsl::span<const double> rho) const override;
+
+  //! Set the temperatures of many cells at once
+  //! \param cells Handles to cells
+  //! \param T Temperature of each cell in [K]
+  void set_temperatures(gsl::span<const CellHandle> cells,
+                        gsl::span<const double> T) const override;
+
   //! Get the density of a cell
   //! \param cell Handle to a cell
   //! \return Cell density in [g/cm^3]
@@ -66,19 +91,64 @@ public:
   //! \return Whether the cell contains fissionable nuclides
   bool is_fissionable(CellHandle cell) const override;
 
-  std::size_t n_cells() const override { return cells_.size(); }
+  std::size_t n_cells() const override { return cell_volumes_.size(); }
 
   //! Create energy production tallies
   void create_tallies() override;
 
-  //! Determine number of cells participating in coupling
-  //! \return Number of cells
+  //! Get energy deposition in each cell normalized to a given power
+  //!
+  //! With distributed tallies, the local results of all ranks are summed in a single
+  //! reduction to the root.
+  //!
+  //! \param power User-specified power in [W]
+  //! \return Heat source in each cell as [W/cm3] (significant on the root)
   xt::xtensor<double, 1> heat_source(double power) const final;
 
+  //! Get the heat source of every cell on the rank that owns it
+  //!
+  //! With distributed tallies, the local results are reduced and scattered to the
+  //! owners in a single reduce-scatter, so no rank holds the whole heat source.
+  xt::xtensor<double, 1> heat_source_slices(double power,
+                                            gsl::span<const gsl::index> cells,
+                                            gsl::span<const int> counts) const final;
+
+  //! Get the relative standard deviation of the energy deposition in each cell
+  //!
+  //! With distributed tallies, each rank's batches are independent estimates of its
+  //! share of the tally, so the variances of the ranks' means are summed.
+  //!
+  //! \return Relative standard deviation in each cell (significant on the root)
+  xt::xtensor<double, 1> heat_source_rel_error() const final;
+
   std::string cell_label(CellHandle cell) const;
 
   gsl::index cell_index(CellHandle cell) const override;
 
+  std::size_t geometry_hash() const override;
+
+  //! Bytes held by the coupled cell arrays, the saved source, and the heat source
+  //! tally results
+  std::size_t memory_usage() const override;
+
+  //! Key of a cell made from its index and instance
+  //! \param cell Handle to a cell
+  //! \return Index in the high 32 bits and instance in the low 32 bits
+  std::uint64_t cell_key(CellHandle cell) const override;
+
+  void restore_cells(const std::vector<std::uint64_t>& keys) override;
+
+  int64_t n_particles() const override;
+
+  void set_n_particles(int64_t n) override;
+
+  int64_t seed() const override;
+
+  void set_seed(int64_t seed) override;
+
+  //! Write OpenMC's summary, statepoint, and tally output to a directory
+  void set_output_directory(const std::string& path) override;
+
   //////////////////////////////////////////////////////////////////////////////
   // Driver interface
 
@@ -97,16 +167,56 @@ public:
   void finalize_step() final;
 
 private:
-  CellInstance& cell_instance(CellHandle cell);
-  const CellInstance& cell_instance(CellHandle cell) const;
+  //! Key of a cell instance that is unique for any index and instance
+  static std::uint64_t instance_key(int32_t index, int32_t instance);
+
+  //! Store a cell instance the first time it is found
+  //! \param index Index in global cells array
+  //! \param instance Index of cell instance
+  //! \return Handle to the cell, which is its position in the stored arrays
+  CellHandle add_cell(int32_t index, int32_t instance);
+
+  //! Get the OpenMC cell of a stored cell instance
+  openmc::Cell* openmc_cell(CellHandle cell) const;
+
+  //! Get the material that fills a stored cell instance
+  openmc::Material* material(CellHandle cell) const;
 
   // Data members
-  openmc::Tally* tally_;               //!< Fission energy deposition tally
-  openmc::CellInstanceFilter* filter_; //!< Cell instance filter
-  std::vector<CellInstance> cells_;    //!< Array of cell instances
-  std::unordered_map<CellHandle, gsl::index>
-    cell_index_;            //!< Map handles to index in cells_
+  openmc::Tally* tally_{nullptr};               //!< Fission energy deposition tally
+  openmc::CellInstanceFilter* filter_{nullptr}; //!< Cell instance filter
+
+  // Cell instances participating in coupling, stored as parallel arrays indexed by
+  // handle.  Handles are assigned sequentially as find() discovers the instances.
+  std::vector<int32_t> cell_indices_;             //!< Index in global cells array
+  std::vector<int32_t> cell_instances_;           //!< Index of cell instance
+  std::vector<openmc::Material*> cell_materials_; //!< Material (nullptr if void)
+  std::vector<double> cell_volumes_;              //!< Volume in [cm^3]
+  std::unordered_map<std::uint64_t, CellHandle>
+    cell_handle_;           //!< Map instance_key() of stored instances to handles
   int n_fissionable_cells_; //!< Number of fissionable cells in model
+
+  //! Whether each Picard iteration starts from the fission source at the end of the
+  //! previous one, rather than from the source in the OpenMC input
+  bool reuse_source_{false};
+
+  //! Number of inactive batches once the source is reused
+  int reuse_inactive_{0};
+
+  //! Whether each rank keeps its own tally results, which OpenMC then doesn't reduce
+  //! at the end of every batch, so that heat_source() reduces them only once
+  bool distributed_tallies_{false};
+
+  int n_inactive_;    //!< Number of inactive batches in the OpenMC input
+  int n_batches_;     //!< Number of batches in the OpenMC input
+  int n_max_batches_; //!< Maximum number of batches in the OpenMC input
+
+  //! Whether source_bank_ holds the source from a previous solve_step() on all ranks
+  bool has_source_{false};
+
+  //! Local fission source sites at the end of the last solve_step(), if the source is
+  //! reused
+  std::vector<openmc::SourceSite> source_bank_;
 };
 
 } // namespace enrico
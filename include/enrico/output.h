@@ -0,0 +1,66 @@
+//! \file output.h
+//! Settings that control how often and what the drivers write
+#ifndef ENRICO_OUTPUT_H
+#define ENRICO_OUTPUT_H
+
+#include <pugixml.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace enrico {
+
+//! Output cadence and contents, read from the <output> element of enrico.xml
+struct OutputSettings {
+  //! Results written by the neutronics driver. 'all' writes tallies (statepoint) and
+  //! cell properties, while 'tallies' and 'properties' write only one of them.
+  enum class Contents { all, tallies, properties };
+
+  //! Write every Picard iteration and keep all files
+  OutputSettings() = default;
+
+  //! Read settings from an <output> node
+  //! \param node XML node containing output settings (may be empty)
+  explicit OutputSettings(pugi::xml_node node);
+
+  //! Whether a Picard iteration is written by its schedule
+  //!
+  //! The last Picard iteration of each timestep is written regardless.
+  //!
+  //! \param i_picard Picard iteration index within the timestep
+  bool is_write_iteration(int i_picard) const
+  {
+    return !final_only && i_picard % interval == 0;
+  }
+
+  int interval{1};                  //!< Write every interval-th Picard iteration
+  bool final_only{false};           //!< Only write the last Picard iteration
+  Contents contents{Contents::all}; //!< Results written by the neutronics driver
+  int keep{0}; //!< Number of most recent outputs kept on disk, or 0 to keep all
+};
+
+//! Files written by successive outputs of a driver, removing the oldest ones beyond
+//! the number that are kept
+class OutputHistory {
+public:
+  //! \param keep Number of most recent outputs kept on disk, or 0 to keep all
+  explicit OutputHistory(int keep = 0)
+    : keep_(keep)
+  {}
+
+  //! Record the files of a new output, removing those of the oldest output if more
+  //! than the number kept have been recorded
+  //!
+  //! \param files Files written by the output
+  void add(std::vector<std::string> files);
+
+private:
+  std::size_t keep_;                            //!< Number of outputs kept, or 0
+  std::deque<std::vector<std::string>> files_; //!< Files of each kept output
+};
+
+} // namespace enrico
+
+#endif // ENRICO_OUTPUT_H
@@ -0,0 +1,120 @@
+//! \file projection.h
+//! Conservative projection of fields between heat/fluids elements and neutronics cells
+#ifndef ENRICO_PROJECTION_H
+#define ENRICO_PROJECTION_H
+
+#include <gsl/gsl>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace enrico {
+
+//! Sparse weights that project fields between the local elements of a heat/fluids
+//! mesh and the local neutronics cells that overlap them
+//!
+//! Each element is split among the cells that its quadrature points fall in, in
+//! proportion to the weights of those points.  The weights are stored twice in
+//! compressed-row form, once by cell to average element fields over the cells and
+//! once by element to distribute cell fields to the elements, so that each product
+//! can be split among threads without races.  The fractions of each element sum to
+//! one, so averaging conserves the volume integral of an element field and
+//! distributing conserves the volume integral of a cell field, whether or not the
+//! element and cell boundaries align.
+class Projection {
+public:
+  Projection() = default;
+
+  //! \param point_offsets The quadrature points of element e are
+  //!   [point_offsets[e], point_offsets[e + 1])
+  //! \param point_cells Local cell index of each quadrature point
+  //! \param point_weights Weight of each quadrature point, only relative to the
+  //!   other points of its element
+  //! \param n_cells Number of local cells
+  Projection(gsl::span<const int32_t> point_offsets,
+             gsl::span<const int32_t> point_cells,
+             gsl::span<const double> point_weights,
+             int32_t n_cells);
+
+  //! Set the volumes of the local elements, from which the projection weights and
+  //! cell volumes are computed
+  //! \param elem_volumes Volume of each local element
+  void set_volumes(gsl::span<const double> elem_volumes);
+
+  //! Set which local elements are in fluid
+  //!
+  //! A cell is in fluid if more than half of its volume is covered by fluid
+  //! elements.  Must be called after set_volumes().
+  //!
+  //! \param elem_fluid_mask 1 if the local element is in fluid, 0 otherwise
+  void set_fluid_mask(gsl::span<const int> elem_fluid_mask);
+
+  //! Set the number of OpenMP threads that the products are split among
+  //!
+  //! The products run between the solves of the drivers, so they use the threads of
+  //! the heat/fluids driver rather than whatever the last solve left set.
+  //!
+  //! \param n Number of threads
+  void set_num_threads(int n);
+
+  //! Average an element field over each local cell, weighted by the volume of the
+  //! overlaps
+  //! \param elem_values Value of each local element
+  //! \param cell_values Average of each local cell
+  void average(gsl::span<const double> elem_values, gsl::span<double> cell_values) const;
+
+  //! Average an element field over the fluid elements of each fluid cell, leaving the
+  //! values of solid cells untouched
+  //! \param elem_values Value of each local element
+  //! \param cell_values Average of each local cell
+  void average_fluid(gsl::span<const double> elem_values,
+                     gsl::span<double> cell_values) const;
+
+  //! Distribute a cell field to the local elements, each of which takes the
+  //! overlap-weighted mean of its cells
+  //! \param cell_values Value of each local cell
+  //! \param elem_values Value of each local element
+  void distribute(gsl::span<const double> cell_values,
+                  gsl::span<double> elem_values) const;
+
+  //! Volume of each local cell covered by the local elements
+  const std::vector<double>& cell_volumes() const { return cell_volumes_; }
+
+  //! 1 if the local cell is in fluid, 0 otherwise
+  const std::vector<int>& cell_fluid_mask() const { return cell_fluid_mask_; }
+
+  //! Number of local cells that overlap both fluid and solid elements
+  int n_mixed_cells() const { return n_mixed_cells_; }
+
+  //! Number of nonzero weights
+  std::size_t n_weights() const { return elem_cells_.size(); }
+
+  //! Bytes held by the weights on the calling rank
+  std::size_t memory_usage() const;
+
+private:
+  //! Offsets into elem_cells_ of the cells overlapping each element
+  std::vector<int32_t> elem_offsets_;
+  std::vector<int32_t> elem_cells_;    //!< Cells overlapping each element
+  std::vector<double> elem_fractions_; //!< Fractions of each element in elem_cells_
+
+  //! Offsets into cell_elems_ of the elements overlapping each cell
+  std::vector<int32_t> cell_offsets_;
+  std::vector<int32_t> cell_elems_;    //!< Elements overlapping each cell
+  std::vector<double> cell_fractions_; //!< Fractions of the elements in cell_elems_
+  std::vector<double> cell_weights_;   //!< Overlap volumes of the elements in cell_elems_
+
+  //! Overlap volumes of the elements in cell_elems_ that are in fluid, or 0
+  std::vector<double> cell_fluid_weights_;
+
+  std::vector<double> cell_volumes_;       //!< Volume of each cell
+  std::vector<double> cell_fluid_volumes_; //!< Fluid volume of each cell
+  std::vector<int> cell_fluid_mask_;       //!< 1 if the cell is in fluid
+  int n_mixed_cells_{0};                   //!< Cells overlapping fluid and solid
+  int num_threads_{1};                     //!< OpenMP threads used by the products
+};
+
+} // namespace enrico
+
+#endif // ENRICO_PROJECTION_H
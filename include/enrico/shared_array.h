@@ -0,0 +1,87 @@
+//! \file shared_array.h
+//! Array in an MPI shared-memory window that all ranks on a node read in place
+#ifndef ENRICO_SHARED_ARRAY_H
+#define ENRICO_SHARED_ARRAY_H
+
+#include "enrico/comm.h"
+
+#include <gsl/gsl>
+#include <mpi.h>
+
+#include <cstddef>
+#include <utility> // for move, swap
+
+namespace enrico {
+
+//! Fixed-size array in one shared-memory segment per node
+//!
+//! The memory is allocated by the root of a communicator whose ranks share memory
+//! (e.g., one made with MPI_COMM_TYPE_SHARED), and every rank of that communicator
+//! accesses it directly.  Writes become visible to the other ranks at the next
+//! fence().
+template<typename T>
+class SharedArray {
+public:
+  SharedArray() = default;
+
+  //! Allocate the array.  This is a collective operation on node_comm.
+  //! \param node_comm Communicator whose ranks all share memory
+  //! \param n Number of elements
+  SharedArray(const Comm& node_comm, std::size_t n)
+    : size_(n)
+  {
+    MPI_Aint bytes = node_comm.is_root() ? n * sizeof(T) : 0;
+    T* local;
+    MPI_Win_allocate_shared(
+      bytes, sizeof(T), MPI_INFO_NULL, node_comm.comm, &local, &win_);
+
+    // Every rank addresses the root's segment
+    MPI_Aint root_bytes;
+    int disp_unit;
+    MPI_Win_shared_query(win_, 0, &root_bytes, &disp_unit, &data_);
+    Ensures(root_bytes == n * sizeof(T));
+    fence();
+  }
+
+  SharedArray(const SharedArray&) = delete;
+  SharedArray& operator=(const SharedArray&) = delete;
+
+  SharedArray(SharedArray&& other) noexcept { *this = std::move(other); }
+
+  SharedArray& operator=(SharedArray&& other) noexcept
+  {
+    std::swap(win_, other.win_);
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+
+  //! Free the window.  This is a collective operation on the node communicator.
+  ~SharedArray()
+  {
+    if (win_ != MPI_WIN_NULL) {
+      MPI_Win_free(&win_);
+    }
+  }
+
+  //! Complete all writes to the array and make them visible to the node's ranks.
+  //! This is a collective operation on the node communicator.
+  void fence() const { MPI_Win_fence(0, win_); }
+
+  T* data() { return data_; }
+  const T* data() const { return data_; }
+
+  std::size_t size() const { return size_; }
+
+  T& operator[](std::size_t i) { return data_[i]; }
+  const T& operator[](std::size_t i) const { return data_[i]; }
+
+private:
+  MPI_Win win_ = MPI_WIN_NULL; //!< Shared-memory window
+  T* data_ = nullptr;          //!< Start of the root's segment
+  std::size_t size_ = 0;       //!< Number of elements
+};
+
+} // namespace enrico
+
+#endif // ENRICO_SHARED_ARRAY_H
@@ -47,6 +47,18 @@ public:
   //! \param T Temperature in [K]
   void set_temperature(CellHandle handle, double T) const override;
 
+  //! Set the densities of the materials in many cells at once
+  //! \param handles Handles to cells
+  //! \param rho Density of each cell in [g/cm^3]
+  void set_densities(gsl::span<const CellHandle> handles,
+                     gsl::span<const double> rho) const override;
+
+  //! Set the temperatures of many cells at once
+  //! \param handles Handles to cells
+  //! \param T Temperature of each cell in [K]
+  void set_temperatures(gsl::span<const CellHandle> handles,
+                        gsl::span<const double> T) const override;
+
   //! Get the density of a cell
   //! \param handle Handle to a cell
   //! \return Cell density in [g/cm^3]
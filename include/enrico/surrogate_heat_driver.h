@@ -12,9 +12,13 @@
 #include <xtensor/xtensor.hpp>
 
 #include <cstddef>
+#include <memory> // for unique_ptr
 
 namespace enrico {
 
+class AsyncWriter;
+class SurrogateVtkWriter;
+
 //! Struct containing geometric information for a flow channel
 struct Channel {
   //! Channel index
@@ -159,10 +163,14 @@ public:
   //! \param node  XML node containing settings for surrogate
   SurrogateHeatDriver(MPI_Comm comm, pugi::xml_node node);
 
+  ~SurrogateHeatDriver();
+
   //! Verbosity options for printing simulation results
   enum class verbose { NONE, LOW, HIGH };
 
-  bool has_coupling_data() const final { return comm_.rank == 0; }
+  //! The pins are partitioned among all ranks of the heat comm, so every rank holds
+  //! coupling data (possibly for zero pins)
+  bool has_coupling_data() const final { return comm_.active(); }
 
   //! Get the number of local mesh elements
   //! \return Number of local mesh elements
@@ -181,9 +189,21 @@ public:
   //! \return Error code
   int set_heat_source_at(int32_t local_elem, double heat) override;
 
+  //! Set the heat source for all local elements
+  //!
+  //! \param heat Heat source of each local element
+  void set_heat_source(gsl::span<const double> heat) override;
+
   //! Solves the heat-fluids surrogate solver
   void solve_step() final;
 
+  //! Wait for visualization files queued by write_step() to be written
+  void flush_write() final;
+
+  //! Bytes held on this rank by the solution fields of its local pins and channels,
+  //! including their heat source
+  std::size_t memory_usage() const final;
+
   void solve_heat();
 
   void solve_fluid();
@@ -212,10 +232,20 @@ public:
   //! Returns number of pins in y-direction
   std::size_t n_pins_y() const { return n_pins_y_; }
 
-  //! Returns number of solid elements
+  //! Returns global index of the first pin on this rank
+  std::size_t pin_begin() const { return pin_begin_; }
+
+  //! Returns number of pins on this rank
+  std::size_t n_local_pins() const { return n_local_pins_; }
+
+  //! Returns rank in the heat comm that a given pin is assigned to
+  //! \param pin global pin index
+  int pin_rank(std::size_t pin) const;
+
+  //! Returns number of local solid elements
   std::size_t n_solid_;
 
-  //! Returns number of fluid elements
+  //! Returns number of local fluid elements
   std::size_t n_fluid_;
 
   //! Returns pin pitch
@@ -242,15 +272,19 @@ public:
   //! Write data to VTK
   void write_step(int timestep, int iteration) final;
 
-  //! Returns solid temperature in [K] for given region
+  //! Returns solid temperature in [K] for given region of a local pin
   double solid_temperature(std::size_t pin, std::size_t axial, std::size_t ring) const;
 
-  //! Returns fluid density in [g/cm^3] for given region
+  //! Returns fluid density in [g/cm^3] for given region of a local pin
   double fluid_density(std::size_t pin, std::size_t axial) const;
 
-  //! Returns fluid temperature in [K] for given region
+  //! Returns fluid temperature in [K] for given region of a local pin
   double fluid_temperature(std::size_t pin, std::size_t axial) const;
 
+  //! Returns channel pressures in [MPa] on the channel axial faces, indexed by
+  //! channel ID, axial face ID
+  const xt::xtensor<double, 2>& channel_pressure() const { return channel_pressure_; }
+
   // Data on fuel pins
   xt::xtensor<double, 2> pin_centers_; //!< (x,y) values for center of fuel pins
   xt::xtensor<double, 1> z_;           //!< Bounding z-values for axial segments
@@ -260,6 +294,13 @@ public:
   //! Total number of pins
   std::size_t n_pins_;
 
+  //! Global index of the first pin on this rank; pins are assigned to ranks in
+  //! contiguous blocks
+  std::size_t pin_begin_{0};
+
+  //! Number of pins on this rank
+  std::size_t n_local_pins_{0};
+
   // Dimensions for a single fuel pin axial segment
   double clad_outer_radius_;     //!< clad outer radius in [cm]
   double clad_inner_radius_;     //!< clad inner radius in [cm]
@@ -278,8 +319,8 @@ public:
   xt::xtensor<double, 1> channel_flowrates_;
 
   // solver variables and settings
-  xt::xtensor<double, 4>
-    source_; //!< heat source for each (pin, axial segment, ring, azimuthal segment)
+  //! heat source for each (local pin, axial segment, ring, azimuthal segment)
+  xt::xtensor<double, 4> source_;
   xt::xtensor<double, 1> r_grid_clad_; //!< radii of each clad ring in [cm]
   xt::xtensor<double, 1> r_grid_fuel_; //!< radii of each fuel ring in [cm]
 
@@ -294,6 +335,19 @@ public:
   std::string viz_data_{"all"}; //!< visualization data to write
   std::string viz_regions_{"all"}; //!< visualization regions to write
   size_t vtk_radial_res_{20};      //!< radial resolution of resulting vtk files
+  std::string viz_format_{"legacy"}; //!< visualization file format (legacy, vtu)
+
+  //! Writer for visualization files, created by the first write_step() so that the
+  //! mesh is only generated once
+  std::unique_ptr<SurrogateVtkWriter> vtk_writer_;
+
+  //! Maximum number of visualization files waiting to be written in the background;
+  //! if zero, files are written synchronously
+  std::size_t viz_queue_depth_{0};
+
+  //! Queue of visualization files written in the background. Declared after
+  //! vtk_writer_ so that it finishes the pending files before the writer is destroyed.
+  std::unique_ptr<AsyncWriter> viz_queue_;
 
 private:
   //! Get temperature of local mesh elements
@@ -304,6 +358,14 @@ private:
   //! \return Density of local mesh elements in [g/cm^3]
   std::vector<double> density() const override;
 
+  //! Write the temperature of local mesh elements into a preallocated buffer
+  //! \param values Temperature of each local element in [K]
+  void fill_temperature(gsl::span<double> values) const override;
+
+  //! Write the density of local mesh elements into a preallocated buffer
+  //! \param values Density of each local element in [g/cm^3]
+  void fill_density(gsl::span<double> values) const override;
+
   //! States whether each local region is in fluid
   //! \return For each local region, 1 if region is in fluid and 0 otherwise
   std::vector<int> fluid_mask() const override;
@@ -312,6 +374,16 @@ private:
   //! \return Centroids of local mesh elements
   std::vector<Position> centroid() const override;
 
+  //! Get quadrature points of local mesh elements
+  //!
+  //! Solid elements are sampled at the midpoints of equal-area radial, azimuthal, and
+  //! axial divisions.  Fluid elements are sampled on a grid over the pin cell that
+  //! excludes points inside the cladding.
+  //!
+  //! \param order Number of points along each direction of an element
+  //! \return Quadrature points of local mesh elements
+  ElementQuadrature quadrature(int order) const override;
+
   //! Get volumes of local mesh elements
   //! \return Volumes of local mesh elements
   std::vector<double> volume() const override;
@@ -319,12 +391,15 @@ private:
   //! Create internal arrays used for heat equation solver
   void generate_arrays();
 
+  //! Assign pins to the ranks of the heat comm and find the channels they touch
+  void partition_pins();
+
   //! Channel index in terms of row, column index
   int channel_index(int row, int col) const { return row * (n_pins_x_ + 1) + col; }
 
   //! Rod power at a given node in a given pin, computed by integrating the heat source
   //! (assumed constant in each ring) over the pin.
-  //! \param pin   pin index
+  //! \param pin   local pin index
   //! \param axial axial index
   double rod_axial_node_power(const int pin, const int axial) const;
 
@@ -348,18 +423,52 @@ private:
                            const xt::xtensor<double, 2>& h,
                            const xt::xtensor<double, 2>& q) const;
 
-  //!< solid temperature in [K] for each (pin, axial segment, ring)
+  //!< solid temperature in [K] for each (local pin, axial segment, ring)
   xt::xtensor<double, 3> solid_temperature_;
 
   //! Flow areas for coolant-centered channels
   xt::xtensor<double, 1> channel_areas_;
 
-  //! Fluid temperature in a rod-centered basis indexed by rod ID and axial ID
+  //! Fluid temperature in a rod-centered basis indexed by local rod ID and axial ID
   xt::xtensor<double, 2> fluid_temperature_;
 
-  //! Fluid density in [g/cm^3] in a rod-centered basis indexed by rod ID and axial ID
+  //! Fluid density in [g/cm^3] in a rod-centered basis indexed by local rod ID and
+  //! axial ID
   xt::xtensor<double, 2> fluid_density_;
 
+  // Subchannel solver workspace, allocated once by generate_arrays() and reused by
+  // every call to solve_fluid(). Channel fields are indexed by channel ID and axial ID
+  // and are only set for local channels.
+
+  //! Rod powers in [W] indexed by global rod ID and axial ID
+  xt::xtensor<double, 2> rod_powers_;
+
+  //! Channel powers in [W] in a cell-centered basis
+  xt::xtensor<double, 2> channel_powers_;
+
+  //! Channel enthalpy in [kJ/kg] in a face-centered basis
+  xt::xtensor<double, 2> channel_enthalpy_;
+
+  //! Channel pressure in [MPa] in a face-centered basis
+  xt::xtensor<double, 2> channel_pressure_;
+
+  //! Channel axial velocity in [m/s] in a face-centered basis
+  xt::xtensor<double, 2> channel_velocity_;
+
+  //! Channel temperature in [K] in a cell-centered basis
+  xt::xtensor<double, 2> channel_temperature_;
+
+  //! Channel density in [kg/m^3] in a cell-centered basis
+  xt::xtensor<double, 2> channel_density_;
+
+  //! Channels connected to at least one local rod; these are solved on this rank
+  std::vector<std::size_t> local_channels_;
+
+  //! Whether each channel in local_channels_ is owned by this rank.  A channel
+  //! shared by rods on several ranks is solved on all of them but owned by the rank
+  //! of its lowest-index rod, which alone counts it in global norms and balances.
+  std::vector<int> channel_owned_;
+
   //! Number of pins in the x-direction in a Cartesian grid
   std::size_t n_pins_x_;
 
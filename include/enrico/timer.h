@@ -4,10 +4,18 @@
 #include "comm.h"
 #include <iomanip>
 #include <string>
+#include <utility> // for move
+#include <vector>
 
 namespace enrico {
 
 //! Class for measuring and collecting time on a given MPI communicator
+//!
+//! By default, timers are synchronized: every start() and every elapsed() of a running
+//! timer begins with a barrier on the timer's communicator, so that all ranks measure
+//! the same interval.  Unsynchronized timers only record local MPI_Wtime differences,
+//! which adds no communication and exposes the spread of times across ranks (see
+//! TimeAmt::reduce()).
 class Timer {
 public:
   //! Initializes timer for a given MPI communicator
@@ -16,6 +24,16 @@ public:
     : comm_(comm)
   {}
 
+  //! Initializes a timer whose intervals are recorded as spans when tracing
+  //! \param comm The MPI communicator for which time is measured
+  //! \param category Trace category of the spans (see trace::span())
+  //! \param name Label of the spans
+  Timer(const Comm& comm, std::string category, std::string name)
+    : comm_(comm)
+    , category_(std::move(category))
+    , name_(std::move(name))
+  {}
+
   //! Begin accumulating elapsed time.
   //!
   //! If the timer has been previously stopped, then restarting it will
@@ -41,8 +59,23 @@ public:
   //! Reset the elapsed time to 0.
   void reset();
 
+  //! Whether the calling rank is in the timer's communicator
+  bool active() const { return comm_.active(); }
+
+  //! Set whether all timers barrier on their communicator when started and read
+  //!
+  //! \param synchronized True to barrier, false to record local times only
+  static void set_synchronized(bool synchronized) { synchronized_ = synchronized; }
+
+  //! Whether all timers barrier on their communicator when started and read
+  static bool synchronized() { return synchronized_; }
+
 private:
+  static bool synchronized_; //!< Whether timers barrier on their communicator
+
   const Comm comm_;      //!< MPI comm for which this instance measures time
+  std::string category_; //!< Trace category of the spans
+  std::string name_;     //!< Label of the spans, or empty if not traced
   double start_ = 0.0;   //!< Start time at most recent call to start()
   double elapsed_ = 0.0; //!< Time accumulated between all consecutive start/stops
   bool running_ = false; //!< True if started; false if stopped
@@ -61,6 +94,25 @@ public:
     , time(time)
     , percent(percent){};
 
+  //! Record the time elapsed on a timer
+  //!
+  //! \param name An arbitrary label
+  //! \param timer The timer to read. Ranks outside of its communicator record no time.
+  TimeAmt(const std::string& name, Timer& timer)
+    : name(name)
+    , time(timer.elapsed())
+    , active(timer.active()){};
+
+  //! Reduce the times for a vector of TimeAmt across the ranks of a communicator
+  //!
+  //! Afterwards, the root of comm holds the largest time over the active ranks in
+  //! TimeAmt::time, along with the smallest and mean times.  This is a collective
+  //! operation on comm.
+  //!
+  //! \param times The times recorded by the calling rank
+  //! \param comm The communicator over which to reduce
+  static void reduce(std::vector<TimeAmt>& times, const Comm& comm);
+
   //! Get the total time for a vector of TimeAmt
   static double sum_times(const std::vector<TimeAmt>& times);
 
@@ -79,6 +131,10 @@ public:
   const std::string name; //!< Arbitrary label
   double time;            //!< The time in arbitrary units
   double percent;         //!< The percent wrt. a total time
+  double time_min = 0.0;  //!< The smallest time over ranks, set by reduce()
+  double time_mean = 0.0; //!< The mean time over ranks, set by reduce()
+  bool active = true;     //!< Whether the calling rank recorded the time
+  bool reduced = false;   //!< Whether the times were reduced across ranks
 };
 
 }
@@ -0,0 +1,59 @@
+//! \file trace.h
+//! Per-rank timeline of named spans, written in the Chrome trace event format
+#ifndef ENRICO_TRACE_H
+#define ENRICO_TRACE_H
+
+#include "enrico/comm.h"
+
+#include <cstddef>
+#include <string>
+
+namespace enrico {
+namespace trace {
+
+//! Begin recording trace events on every rank of a communicator
+//!
+//! Event times are measured from a barrier in this call, so spans recorded on
+//! different ranks share one timeline.  This is a collective operation on comm.
+//!
+//! \param comm The communicator whose ranks record events
+void enable(const Comm& comm);
+
+//! Whether trace events are being recorded on the calling rank
+bool enabled();
+
+//! Record a span of time on the calling rank
+//!
+//! \param category The group of related spans (e.g., the driver), shown as one track
+//! \param name Label of the span
+//! \param start Start of the span as given by MPI_Wtime()
+//! \param stop End of the span as given by MPI_Wtime()
+void span(const std::string& category,
+          const std::string& name,
+          double start,
+          double stop);
+
+//! Record the number of bytes an exchange moved to or from the calling rank
+//!
+//! The bytes are added to bytes_moved() even if tracing isn't enabled.
+//!
+//! \param name Label of the exchange
+//! \param bytes Number of bytes sent plus bytes received
+void bytes(const std::string& name, std::size_t bytes);
+
+//! Total number of bytes recorded with bytes() on the calling rank
+std::size_t bytes_moved();
+
+//! Write the events of all ranks to a Chrome trace (JSON) file
+//!
+//! The file can be opened with Perfetto or chrome://tracing, which show one process
+//! per rank and one track per category.  This is a collective operation on the
+//! communicator given to enable(), and does nothing if tracing isn't enabled.
+//!
+//! \param filename Path of the file, written by the root of the communicator
+void write(const std::string& filename);
+
+} // namespace trace
+} // namespace enrico
+
+#endif // ENRICO_TRACE_H
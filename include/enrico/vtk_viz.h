@@ -1,6 +1,9 @@
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <ostream>
 #include <string>
+#include <vector>
 
 #include "enrico/surrogate_heat_driver.h"
 
@@ -23,10 +26,43 @@ public:
   //! (the fuel and cladding), fluid, and all of the above.
   enum class VizRegionType { solid = 1, fluid = 2, all = 3 };
 
+  //! File format to write. Valid options are legacy (ASCII .vtk) and vtu (XML
+  //! unstructured grid with raw binary appended data).
+  enum class VizFormat { legacy, vtu };
+
+  //! Values of each requested data array, in the order of data_names()
+  using Data = std::vector<std::vector<double>>;
+
 public:
   //! Write the surrogate model to VTK
+  //!
+  //! The mesh of the local pins is generated and encoded on the first call and reused
+  //! by later calls, which only encode the solution data.
   void write(std::string filename = "magnolia.vtk");
 
+  //! Copy the requested solution data of the local pins
+  //!
+  //! This also encodes the mesh on the first call, after which the const member
+  //! functions of the writer only read data owned by the writer and can be called from
+  //! another thread while the surrogate continues.
+  //!
+  //! \return Solution data to pass to write()
+  Data snapshot();
+
+  //! Write the surrogate model to VTK with previously copied solution data
+  //!
+  //! \param filename Name of the file
+  //! \param data     Solution data returned by snapshot()
+  void write(const std::string& filename, const Data& data) const;
+
+  //! Write a parallel VTU file that collects the pieces written by each rank
+  //!
+  //! \param filename Name of the .pvtu file
+  //! \param pieces   Names of the .vtu files written by each rank, relative to the
+  //!                 directory of the .pvtu file
+  void write_pvtu(const std::string& filename,
+                  const std::vector<std::string>& pieces) const;
+
 private:
   //! Initializes the surrogate to VTK writer with a surrogate model.
   //! Can only be called within the SurrogateHeatDriver.
@@ -35,10 +71,12 @@ private:
   //! \param t_res            Radial resolution of the generated VTK mesh
   //! \param regions_to_write Description of spatial regions to write
   //! \param data_to_write    Description of solution data to write
+  //! \param format           File format to write
   SurrogateVtkWriter(const SurrogateHeatDriver& surrogate_ptr,
                      size_t t_res,
                      const std::string& regions_to_write,
-                     const std::string& data_to_write);
+                     const std::string& data_to_write,
+                     VizFormat format = VizFormat::legacy);
 
   //! Set the number of sections, or cells, that appear in the various
   //! regions of space we may be plotting. When these are described in an
@@ -57,20 +95,37 @@ private:
   //! mesh element types (wedges, hexes, etc.) and the number of elements
   void set_number_of_entries();
 
+  //! Generate and encode the mesh of the local pins for the output format
+  void cache_geometry();
+
+  //! Write the model to a legacy ASCII vtk file
+  void write_legacy(const std::string& filename, const Data& data) const;
+
+  //! Write the model to a VTU file with raw binary appended data
+  void write_vtu(const std::string& filename, const Data& data) const;
+
   //! Write a vtk header for an unstructured grid
-  void write_header(ofstream& vtk_file);
+  void write_header(std::ostream& vtk_file);
 
   //! Write points to the vtk file
-  void write_points(ofstream& vtk_file);
+  void write_points(std::ostream& vtk_file);
 
   //! Write the wedge/hex element connectivity to the vtk file
-  void write_element_connectivity(ofstream& vtk_file);
+  void write_element_connectivity(std::ostream& vtk_file);
 
   //! Write the wedge/hex element types to the vtk file
-  void write_element_types(ofstream& vtk_file);
+  void write_element_types(std::ostream& vtk_file);
 
   //! Write requested data to the vtk file
-  void write_data(ofstream& vtk_file);
+  void write_data(std::ostream& vtk_file, const Data& data) const;
+
+  //! Names of the requested data arrays
+  std::vector<std::string> data_names() const;
+
+  //! Values of a requested data array for each element of the local pins
+  //! \param name Name of the data array, as returned by data_names()
+  //! \return One value per element (ordered like the elements)
+  std::vector<double> data_values(const std::string& name) const;
 
   //! Generate fuel mesh points
   //! \return fuel points (axial, radial_rings, xyz)
@@ -135,6 +190,7 @@ private:
   size_t azimuthal_res_;                 //!< azimuthal resolution
   VizDataType data_out_;                 //!< output region
   VizRegionType regions_out_;            //!< output data
+  VizFormat format_;                     //!< output file format
 
   //! Whether the output region contains the fluid region
   bool output_includes_fluid_;
@@ -163,6 +219,24 @@ private:
   //!< template of mesh element types for a single pin
   xtensor<int, 1> types_;
 
+  //! Whether the mesh of the local pins has been encoded by cache_geometry()
+  bool geometry_cached_{false};
+
+  //! Legacy format: header, points, connectivity and types of the local pins
+  std::string legacy_geometry_;
+
+  //! VTU format: xyz values of the points of the local pins
+  std::vector<float> vtu_points_;
+
+  //! VTU format: point indices of each element of the local pins
+  std::vector<int32_t> vtu_connectivity_;
+
+  //! VTU format: end of each element's point indices in vtu_connectivity_
+  std::vector<int32_t> vtu_offsets_;
+
+  //! VTU format: type of each element of the local pins
+  std::vector<uint8_t> vtu_types_;
+
   //! number of axial sections for a single rod
   size_t n_axial_sections_;
 
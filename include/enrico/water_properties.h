@@ -0,0 +1,192 @@
+//! \file water_properties.h
+//! Water properties from IAPWS-IF97, optionally tabulated for fast evaluation
+#ifndef ENRICO_WATER_PROPERTIES_H
+#define ENRICO_WATER_PROPERTIES_H
+
+#include "iapws/iapws.h"
+
+#include <gsl/gsl>
+#include <pugixml.hpp>
+
+#include <algorithm> // for min, max
+#include <cmath>     // for floor
+#include <vector>
+
+namespace enrico {
+
+//! A function of two variables tabulated on a uniform grid
+//!
+//! Values are interpolated with tensor-product cubic Lagrange polynomials over the
+//! 4x4 block of grid points surrounding the evaluation point.  The evaluation has no
+//! data-dependent branches, so loops over many points can be vectorized.
+class PropertyTable {
+public:
+  PropertyTable() = default;
+
+  //! Tabulate a function over [x_min, x_max] x [y_min, y_max]
+  //!
+  //! \param x_min Lower bound of the first variable
+  //! \param x_max Upper bound of the first variable
+  //! \param y_min Lower bound of the second variable
+  //! \param y_max Upper bound of the second variable
+  //! \param n Number of grid points along each variable (at least 4)
+  //! \param f Function to tabulate, called as f(x, y)
+  template<typename F>
+  PropertyTable(double x_min, double x_max, double y_min, double y_max, int n, F f);
+
+  //! Whether a point lies within the tabulated range
+  bool contains(double x, double y) const
+  {
+    return x >= x_min_ && x <= x_max_ && y >= y_min_ && y <= y_max_;
+  }
+
+  //! Interpolate the tabulated function at a point within the tabulated range
+  double operator()(double x, double y) const;
+
+  //! Largest relative difference between the table and the tabulated function at the
+  //! centers of the grid cells, where the interpolation error is largest
+  double max_error() const { return max_error_; }
+
+private:
+  //! Grid index of the first of the four points used for interpolation, and the
+  //! interpolation weights of those points
+  static int stencil(double u, int n, double w[4]);
+
+  double x_min_{0.0};     //!< Lower bound of the first variable
+  double x_max_{0.0};     //!< Upper bound of the first variable
+  double y_min_{0.0};     //!< Lower bound of the second variable
+  double y_max_{0.0};     //!< Upper bound of the second variable
+  double inv_dx_{0.0};    //!< Inverse of the grid spacing of the first variable
+  double inv_dy_{0.0};    //!< Inverse of the grid spacing of the second variable
+  int n_{0};              //!< Number of grid points along each variable
+  std::vector<double> f_; //!< Tabulated values, indexed by (x, y) in row-major order
+  double max_error_{0.0}; //!< Largest relative error at the grid cell centers
+};
+
+//! Water properties in IAPWS-IF97 region 1 (subcooled liquid)
+//!
+//! By default, every call evaluates the IAPWS correlations, which for the backward
+//! equations requires iterative inversions.  If tabulation is requested, properties
+//! within the tabulated pressure/temperature envelope are interpolated from tables
+//! built once at setup, and points outside the envelope fall back to IAPWS.
+class WaterProperties {
+public:
+  //! Evaluate all properties with the IAPWS correlations
+  WaterProperties() = default;
+
+  //! Read property settings from a <properties> node
+  //!
+  //! \param node XML node containing property settings (may be empty)
+  //! \param pressure System pressure in [MPa], used to set the default envelope
+  WaterProperties(pugi::xml_node node, double pressure);
+
+  //! Specific enthalpy in [kJ/kg] given pressure in [MPa] and temperature in [K]
+  double h1(double p, double T) const
+  {
+    return tabulated_ && h_pT_.contains(p, T) ? h_pT_(p, T) : iapws::h1(p, T);
+  }
+
+  //! Specific volume in [m^3/kg] given pressure in [MPa] and temperature in [K]
+  double nu1(double p, double T) const
+  {
+    return tabulated_ && nu_pT_.contains(p, T) ? nu_pT_(p, T) : iapws::nu1(p, T);
+  }
+
+  //! Temperature in [K] given pressure in [MPa] and specific enthalpy in [kJ/kg]
+  double T_from_p_h(double p, double h) const
+  {
+    return tabulated_ && T_ph_.contains(p, h) ? T_ph_(p, h) : iapws::T_from_p_h(p, h);
+  }
+
+  //! Density in [kg/m^3] given pressure in [MPa] and specific enthalpy in [kJ/kg]
+  double rho_from_p_h(double p, double h) const
+  {
+    return tabulated_ && rho_ph_.contains(p, h) ? rho_ph_(p, h)
+                                                 : iapws::rho_from_p_h(p, h);
+  }
+
+  //! Whether properties are interpolated from tables
+  bool tabulated() const { return tabulated_; }
+
+  //! Largest relative error over all tables, measured at the grid cell centers
+  double max_error() const;
+
+private:
+  bool tabulated_{false}; //!< Whether properties are interpolated from tables
+  PropertyTable h_pT_;    //!< Specific enthalpy as a function of (p, T)
+  PropertyTable nu_pT_;   //!< Specific volume as a function of (p, T)
+  PropertyTable T_ph_;    //!< Temperature as a function of (p, h)
+  PropertyTable rho_ph_;  //!< Density as a function of (p, h)
+};
+
+template<typename F>
+PropertyTable::PropertyTable(double x_min,
+                             double x_max,
+                             double y_min,
+                             double y_max,
+                             int n,
+                             F f)
+  : x_min_(x_min)
+  , x_max_(x_max)
+  , y_min_(y_min)
+  , y_max_(y_max)
+  , inv_dx_((n - 1) / (x_max - x_min))
+  , inv_dy_((n - 1) / (y_max - y_min))
+  , n_(n)
+  , f_(n * n)
+{
+  Expects(n >= 4);
+  Expects(x_max > x_min);
+  Expects(y_max > y_min);
+
+  double dx = (x_max - x_min) / (n - 1);
+  double dy = (y_max - y_min) / (n - 1);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      f_[i * n + j] = f(x_min + i * dx, y_min + j * dy);
+    }
+  }
+
+  // Estimate the interpolation error at the cell centers
+  for (int i = 0; i < n - 1; ++i) {
+    for (int j = 0; j < n - 1; ++j) {
+      double x = x_min + (i + 0.5) * dx;
+      double y = y_min + (j + 0.5) * dy;
+      double exact = f(x, y);
+      double error = std::abs((*this)(x, y) - exact) / std::abs(exact);
+      max_error_ = std::max(max_error_, error);
+    }
+  }
+}
+
+inline int PropertyTable::stencil(double u, int n, double w[4])
+{
+  // Use the points i-1, i, i+1, i+2 around the cell containing u, shifted inward at
+  // the edges of the table
+  int i = std::min(std::max(static_cast<int>(std::floor(u)), 1), n - 3);
+  double t = u - i;
+  w[0] = -t * (t - 1.0) * (t - 2.0) / 6.0;
+  w[1] = (t + 1.0) * (t - 1.0) * (t - 2.0) / 2.0;
+  w[2] = -(t + 1.0) * t * (t - 2.0) / 2.0;
+  w[3] = (t + 1.0) * t * (t - 1.0) / 6.0;
+  return i - 1;
+}
+
+inline double PropertyTable::operator()(double x, double y) const
+{
+  double wx[4];
+  double wy[4];
+  int i = stencil((x - x_min_) * inv_dx_, n_, wx);
+  int j = stencil((y - y_min_) * inv_dy_, n_, wy);
+
+  double value = 0.0;
+  for (int a = 0; a < 4; ++a) {
+    const double* row = &f_[(i + a) * n_ + j];
+    value += wx[a] * (wy[0] * row[0] + wy[1] * row[1] + wy[2] * row[2] + wy[3] * row[3]);
+  }
+  return value;
+}
+
+} // namespace enrico
+
+#endif // ENRICO_WATER_PROPERTIES_H
@@ -0,0 +1,169 @@
+#include "enrico/anderson_mixer.h"
+
+#include <algorithm> // for min_element
+#include <cmath>     // for abs
+#include <utility>   // for move, swap
+
+namespace enrico {
+
+namespace {
+
+//! Solve a small dense system in place by Gaussian elimination with partial pivoting
+//!
+//! \param n Order of the system
+//! \param a Row-major n x n matrix, overwritten
+//! \param b Right-hand side, overwritten with the solution
+//! \return Whether the matrix was found to be nonsingular
+bool solve(int n, std::vector<double>& a, std::vector<double>& b)
+{
+  for (int k = 0; k < n; ++k) {
+    int p = k;
+    for (int i = k + 1; i < n; ++i) {
+      if (std::abs(a[i * n + k]) > std::abs(a[p * n + k]))
+        p = i;
+    }
+    if (a[p * n + k] == 0.0)
+      return false;
+    if (p != k) {
+      for (int j = 0; j < n; ++j)
+        std::swap(a[k * n + j], a[p * n + j]);
+      std::swap(b[k], b[p]);
+    }
+    for (int i = k + 1; i < n; ++i) {
+      double factor = a[i * n + k] / a[k * n + k];
+      for (int j = k; j < n; ++j)
+        a[i * n + j] -= factor * a[k * n + j];
+      b[i] -= factor * b[k];
+    }
+  }
+  for (int k = n - 1; k >= 0; --k) {
+    for (int j = k + 1; j < n; ++j)
+      b[k] -= a[k * n + j] * b[j];
+    b[k] /= a[k * n + k];
+  }
+  return true;
+}
+
+} // namespace
+
+AndersonMixer::AndersonMixer(const Comm& comm, int depth, double beta)
+  : comm_(comm)
+  , depth_(depth)
+  , beta_(beta)
+{
+  Expects(depth >= 0);
+  Expects(beta > 0.0 && beta <= 1.0);
+}
+
+bool AndersonMixer::mix(gsl::span<const double> x, gsl::span<double> g)
+{
+  Expects(x.size() == g.size());
+  auto n = g.size();
+
+  std::vector<double> f(n);
+  for (gsl::index i = 0; i < n; ++i) {
+    f[i] = g[i] - x[i];
+  }
+
+  // Extend the history with the differences from the previous iterate
+  if (f_prev_.size() == n && depth_ > 0) {
+    std::vector<double> df(n);
+    std::vector<double> dg(n);
+    for (gsl::index i = 0; i < n; ++i) {
+      df[i] = f[i] - f_prev_[i];
+      dg[i] = g[i] - g_prev_[i];
+    }
+    delta_f_.push_back(std::move(df));
+    delta_g_.push_back(std::move(dg));
+    if (delta_f_.size() > depth_) {
+      delta_f_.pop_front();
+      delta_g_.pop_front();
+    }
+  }
+  f_prev_ = f;
+  g_prev_.assign(g.begin(), g.end());
+
+  // Find the combination of residual differences closest to the residual from the
+  // normal equations.  The local inner products are summed with one reduction.
+  int m = delta_f_.size();
+  std::vector<double> gamma;
+  bool mixed = false;
+  while (m > 0) {
+    std::vector<double> sums(m * m + m, 0.0);
+    for (int j = 0; j < m; ++j) {
+      const auto& dfj = delta_f_[delta_f_.size() - m + j];
+      for (int k = 0; k <= j; ++k) {
+        const auto& dfk = delta_f_[delta_f_.size() - m + k];
+        double s = 0.0;
+        for (gsl::index i = 0; i < n; ++i)
+          s += dfj[i] * dfk[i];
+        sums[j * m + k] = s;
+      }
+      double s = 0.0;
+      for (gsl::index i = 0; i < n; ++i)
+        s += dfj[i] * f[i];
+      sums[m * m + j] = s;
+    }
+    comm_.Allreduce(MPI_IN_PLACE, sums.data(), sums.size(), MPI_DOUBLE, MPI_SUM);
+
+    std::vector<double> a(m * m);
+    double trace = 0.0;
+    for (int j = 0; j < m; ++j) {
+      for (int k = 0; k <= j; ++k) {
+        a[j * m + k] = a[k * m + j] = sums[j * m + k];
+      }
+      trace += a[j * m + j];
+    }
+
+    // Regularize slightly so that nearly dependent differences don't blow up gamma
+    for (int j = 0; j < m; ++j) {
+      a[j * m + j] += 1.0e-12 * trace;
+    }
+    gamma.assign(sums.begin() + m * m, sums.end());
+    if (trace > 0.0 && solve(m, a, gamma)) {
+      mixed = true;
+      break;
+    }
+
+    // Drop the oldest difference and try again
+    --m;
+  }
+
+  std::vector<double> next(n);
+  for (gsl::index i = 0; i < n; ++i) {
+    next[i] = x[i] + beta_ * f[i];
+  }
+  if (mixed) {
+    std::vector<double> combined(next);
+    for (int j = 0; j < m; ++j) {
+      const auto& df = delta_f_[delta_f_.size() - m + j];
+      const auto& dg = delta_g_[delta_g_.size() - m + j];
+      for (gsl::index i = 0; i < n; ++i) {
+        // The iterate difference is dg - df
+        combined[i] -= gamma[j] * (dg[i] - (1.0 - beta_) * df[i]);
+      }
+    }
+
+    // Every rank must agree on whether the combination is used
+    int negative = n > 0 && *std::min_element(combined.cbegin(), combined.cend()) < 0.0;
+    comm_.Allreduce(MPI_IN_PLACE, &negative, 1, MPI_INT, MPI_MAX);
+    if (negative) {
+      mixed = false;
+    } else {
+      next = std::move(combined);
+    }
+  }
+
+  std::copy(next.cbegin(), next.cend(), g.begin());
+  return mixed;
+}
+
+void AndersonMixer::reset()
+{
+  f_prev_.clear();
+  g_prev_.clear();
+  delta_f_.clear();
+  delta_g_.clear();
+}
+
+} // namespace enrico
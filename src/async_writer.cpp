@@ -0,0 +1,89 @@
+#include "enrico/async_writer.h"
+
+#include <utility> // for move
+
+namespace enrico {
+
+AsyncWriter::AsyncWriter(std::size_t queue_depth)
+  : queue_depth_(queue_depth)
+{
+  if (queue_depth_ > 0) {
+    thread_ = std::thread{&AsyncWriter::run, this};
+  }
+}
+
+AsyncWriter::~AsyncWriter()
+{
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      done_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+  }
+}
+
+void AsyncWriter::submit(std::function<void()> task)
+{
+  if (queue_depth_ == 0) {
+    task();
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock{mutex_};
+  changed_.wait(lock, [this] { return tasks_.size() < queue_depth_ || error_; });
+  check_error();
+  tasks_.push_back(std::move(task));
+  lock.unlock();
+  changed_.notify_all();
+}
+
+void AsyncWriter::flush()
+{
+  std::unique_lock<std::mutex> lock{mutex_};
+  changed_.wait(lock, [this] { return (tasks_.empty() && !busy_) || error_; });
+  check_error();
+}
+
+void AsyncWriter::run()
+{
+  std::unique_lock<std::mutex> lock{mutex_};
+  while (true) {
+    // Pending tasks are still written after destruction is requested
+    changed_.wait(lock, [this] { return !tasks_.empty() || done_; });
+    if (tasks_.empty())
+      return;
+
+    auto task = std::move(tasks_.front());
+    tasks_.pop_front();
+    busy_ = true;
+    lock.unlock();
+    changed_.notify_all();
+
+    std::exception_ptr error;
+    try {
+      task();
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    lock.lock();
+    busy_ = false;
+    if (error && !error_) {
+      error_ = error;
+    }
+    changed_.notify_all();
+  }
+}
+
+void AsyncWriter::check_error()
+{
+  if (error_) {
+    auto error = error_;
+    error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+} // namespace enrico
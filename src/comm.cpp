@@ -0,0 +1,286 @@
+#include "enrico/comm.h"
+
+#include <algorithm> // for minmax_element
+#include <cmath>     // for abs, lround
+#include <cstdint>   // for uint16_t
+#include <cstring>   // for memcpy
+#include <limits>
+
+namespace enrico {
+
+namespace {
+
+//! Largest quantized value
+constexpr double QUANTIZED_MAX = std::numeric_limits<std::uint16_t>::max();
+
+//! Encode double-precision values as one message with a given precision
+//!
+//! Quantized values are stored after the minimum and maximum of the message.
+//!
+//! \param values Values to encode
+//! \param count Number of values
+//! \param precision Precision of the payload
+//! \param out Buffer of packed_size(count, precision) bytes
+void pack(const double* values, int count, Precision precision, unsigned char* out)
+{
+  switch (precision) {
+  case Precision::full:
+    std::memcpy(out, values, count * sizeof(double));
+    break;
+  case Precision::single:
+    for (int i = 0; i < count; ++i) {
+      float v = values[i];
+      std::memcpy(out + i * sizeof(float), &v, sizeof(float));
+    }
+    break;
+  case Precision::quantized: {
+    if (count == 0)
+      break;
+    auto range = std::minmax_element(values, values + count);
+    double bounds[] = {*range.first, *range.second};
+    std::memcpy(out, bounds, sizeof(bounds));
+    out += sizeof(bounds);
+    double scale = bounds[1] > bounds[0] ? QUANTIZED_MAX / (bounds[1] - bounds[0]) : 0.0;
+    for (int i = 0; i < count; ++i) {
+      auto q = static_cast<std::uint16_t>(std::lround((values[i] - bounds[0]) * scale));
+      std::memcpy(out + i * sizeof(q), &q, sizeof(q));
+    }
+    break;
+  }
+  }
+}
+
+//! Decode a message made by pack()
+//!
+//! \param in Buffer of packed_size(count, precision) bytes
+//! \param count Number of values
+//! \param precision Precision of the payload
+//! \param values Decoded values
+void unpack(const unsigned char* in, int count, Precision precision, double* values)
+{
+  switch (precision) {
+  case Precision::full:
+    std::memcpy(values, in, count * sizeof(double));
+    break;
+  case Precision::single:
+    for (int i = 0; i < count; ++i) {
+      float v;
+      std::memcpy(&v, in + i * sizeof(float), sizeof(float));
+      values[i] = v;
+    }
+    break;
+  case Precision::quantized: {
+    if (count == 0)
+      break;
+    double bounds[2];
+    std::memcpy(bounds, in, sizeof(bounds));
+    in += sizeof(bounds);
+    double step = (bounds[1] - bounds[0]) / QUANTIZED_MAX;
+    for (int i = 0; i < count; ++i) {
+      std::uint16_t q;
+      std::memcpy(&q, in + i * sizeof(q), sizeof(q));
+      values[i] = bounds[0] + q * step;
+    }
+    break;
+  }
+  }
+}
+
+//! Byte counts and offsets of messages packed one after another
+//!
+//! \param counts Number of values in each message
+//! \param n Number of messages
+//! \param precision Precision of the payloads
+//! \param bytes Number of bytes of each message
+//! \param offsets Offset of each message in the packed buffer
+//! \return Total number of bytes
+int packed_layout(const int* counts,
+                  int n,
+                  Precision precision,
+                  std::vector<int>& bytes,
+                  std::vector<int>& offsets)
+{
+  bytes.resize(n);
+  offsets.resize(n);
+  int total = 0;
+  for (int r = 0; r < n; ++r) {
+    bytes[r] = packed_size(counts[r], precision);
+    offsets[r] = total;
+    total += bytes[r];
+  }
+  return total;
+}
+
+} // namespace
+
+std::size_t packed_size(int count, Precision precision)
+{
+  switch (precision) {
+  case Precision::single:
+    return count * sizeof(float);
+  case Precision::quantized:
+    return count > 0 ? 2 * sizeof(double) + count * sizeof(std::uint16_t) : 0;
+  default:
+    return count * sizeof(double);
+  }
+}
+
+void round_trip(double* values, int count, Precision precision)
+{
+  if (precision == Precision::full)
+    return;
+
+  std::vector<unsigned char> packed(packed_size(count, precision));
+  pack(values, count, precision, packed.data());
+  unpack(packed.data(), count, precision, values);
+}
+
+double precision_error(const double* values, int count, Precision precision)
+{
+  std::vector<double> sent(values, values + count);
+  round_trip(sent.data(), count, precision);
+
+  double max_error = 0.0;
+  double max_value = 0.0;
+  for (int i = 0; i < count; ++i) {
+    max_error = std::max(max_error, std::abs(sent[i] - values[i]));
+    max_value = std::max(max_value, std::abs(values[i]));
+  }
+  return max_value > 0.0 ? max_error / max_value : 0.0;
+}
+
+int Comm::Bcast(double* buffer, int count, Precision precision, int root) const
+{
+  if (precision == Precision::full) {
+    return Bcast(buffer, count, MPI_DOUBLE, root);
+  }
+
+  std::vector<unsigned char> packed(packed_size(count, precision));
+  if (rank == root) {
+    pack(buffer, count, precision, packed.data());
+  }
+  auto ierr = Bcast(packed.data(), packed.size(), MPI_BYTE, root);
+  unpack(packed.data(), count, precision, buffer);
+  return ierr;
+}
+
+int Comm::Gatherv(const double* sendbuf,
+                  int sendcount,
+                  double* recvbuf,
+                  const int* recvcounts,
+                  const int* displs,
+                  Precision precision,
+                  int root) const
+{
+  if (precision == Precision::full) {
+    return Gatherv(
+      sendbuf, sendcount, MPI_DOUBLE, recvbuf, recvcounts, displs, MPI_DOUBLE, root);
+  }
+
+  std::vector<unsigned char> send(packed_size(sendcount, precision));
+  pack(sendbuf, sendcount, precision, send.data());
+
+  std::vector<int> bytes;
+  std::vector<int> offsets;
+  std::vector<unsigned char> recv;
+  if (rank == root) {
+    recv.resize(packed_layout(recvcounts, size, precision, bytes, offsets));
+  }
+  auto ierr = Gatherv(send.data(),
+                      send.size(),
+                      MPI_BYTE,
+                      recv.data(),
+                      bytes.data(),
+                      offsets.data(),
+                      MPI_BYTE,
+                      root);
+  if (rank == root) {
+    for (int r = 0; r < size; ++r) {
+      unpack(recv.data() + offsets[r], recvcounts[r], precision, recvbuf + displs[r]);
+    }
+  }
+  return ierr;
+}
+
+int Comm::Scatterv(const double* sendbuf,
+                   const int* sendcounts,
+                   const int* displs,
+                   double* recvbuf,
+                   int recvcount,
+                   Precision precision,
+                   int root) const
+{
+  if (precision == Precision::full) {
+    return Scatterv(
+      sendbuf, sendcounts, displs, MPI_DOUBLE, recvbuf, recvcount, MPI_DOUBLE, root);
+  }
+
+  std::vector<int> bytes;
+  std::vector<int> offsets;
+  std::vector<unsigned char> send;
+  if (rank == root) {
+    send.resize(packed_layout(sendcounts, size, precision, bytes, offsets));
+    for (int r = 0; r < size; ++r) {
+      pack(sendbuf + displs[r], sendcounts[r], precision, send.data() + offsets[r]);
+    }
+  }
+
+  std::vector<unsigned char> recv(packed_size(recvcount, precision));
+  auto ierr = Scatterv(send.data(),
+                       bytes.data(),
+                       offsets.data(),
+                       MPI_BYTE,
+                       recv.data(),
+                       recv.size(),
+                       MPI_BYTE,
+                       root);
+  unpack(recv.data(), recvcount, precision, recvbuf);
+  return ierr;
+}
+
+int Comm::Alltoallv(const double* sendbuf,
+                    const int* sendcounts,
+                    const int* sdispls,
+                    double* recvbuf,
+                    const int* recvcounts,
+                    const int* rdispls,
+                    Precision precision) const
+{
+  if (precision == Precision::full) {
+    return Alltoallv(sendbuf,
+                     sendcounts,
+                     sdispls,
+                     MPI_DOUBLE,
+                     recvbuf,
+                     recvcounts,
+                     rdispls,
+                     MPI_DOUBLE);
+  }
+
+  std::vector<int> send_bytes;
+  std::vector<int> send_offsets;
+  std::vector<unsigned char> send(
+    packed_layout(sendcounts, size, precision, send_bytes, send_offsets));
+  for (int r = 0; r < size; ++r) {
+    pack(sendbuf + sdispls[r], sendcounts[r], precision, send.data() + send_offsets[r]);
+  }
+
+  std::vector<int> recv_bytes;
+  std::vector<int> recv_offsets;
+  std::vector<unsigned char> recv(
+    packed_layout(recvcounts, size, precision, recv_bytes, recv_offsets));
+  auto ierr = Alltoallv(send.data(),
+                        send_bytes.data(),
+                        send_offsets.data(),
+                        MPI_BYTE,
+                        recv.data(),
+                        recv_bytes.data(),
+                        recv_offsets.data(),
+                        MPI_BYTE);
+  for (int r = 0; r < size; ++r) {
+    unpack(recv.data() + recv_offsets[r], recvcounts[r], precision, recvbuf + rdispls[r]);
+  }
+  return ierr;
+}
+
+} // namespace enrico
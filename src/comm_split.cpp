@@ -1,6 +1,11 @@
 #include "enrico/comm_split.h"
 #include <gsl/gsl>
 
+#include <algorithm> // for max
+#include <cstdlib>   // for abs
+#include <stdexcept>
+#include <unordered_map>
+
 namespace enrico {
 
 void get_driver_comms(Comm super_comm,
@@ -8,7 +13,8 @@ void get_driver_comms(Comm super_comm,
                       std::array<int, 2> procs_per_node,
                       std::array<Comm, 2>& driver_comms,
                       Comm& intranode_comm,
-                      Comm& coupling_comm)
+                      Comm& coupling_comm,
+                      Placement placement)
 {
   const int KEEP = 0;
   const int DISCARD = 1;
@@ -35,6 +41,44 @@ void get_driver_comms(Comm super_comm,
   int node_idx = coupling_comm.rank;
   intranode_comm.broadcast(node_idx);
 
+  if (placement == Placement::colocated) {
+    // Both drivers get the left-hand nodes.  On each node, driver_comms[0] gets the
+    // first ranks and driver_comms[1] the ranks after them.
+    int size = intranode_comm.size;
+    int ppn_neutronics = procs_per_node[0];
+    int ppn_heat = procs_per_node[1];
+    if (ppn_neutronics <= 0 && ppn_heat <= 0) {
+      ppn_heat = size / 2;
+      ppn_neutronics = size - ppn_heat;
+    } else if (ppn_neutronics <= 0) {
+      ppn_neutronics = size - ppn_heat;
+    } else if (ppn_heat <= 0) {
+      ppn_heat = size - ppn_neutronics;
+    }
+
+    // Every rank must agree that the layout fits before any of them splits
+    int fits = ppn_neutronics > 0 && ppn_heat > 0 && ppn_neutronics + ppn_heat <= size;
+    MPI_Allreduce(MPI_IN_PLACE, &fits, 1, MPI_INT, MPI_MIN, super_comm.comm);
+    if (!fits) {
+      throw std::runtime_error{"Invalid value for <procs_per_node>: colocated drivers "
+                               "need at least one proc each on every node"};
+    }
+
+    std::array<int, 2> first{0, ppn_neutronics};
+    std::array<int, 2> last{ppn_neutronics, ppn_neutronics + ppn_heat};
+    for (const int i : {0, 1}) {
+      auto n = num_nodes[i] > 0 ? num_nodes[i] : total_nodes;
+      int r = intranode_comm.rank;
+      int color = (node_idx < n && r >= first[i] && r < last[i]) ? KEEP : DISCARD;
+      MPI_Comm_split(super_comm.comm, color, super_comm.rank, &temp_comm);
+      driver_comms[i] = Comm(temp_comm);
+      if (color == DISCARD) {
+        driver_comms[i].free();
+      }
+    }
+    return;
+  }
+
   // Get the driver comms. driver_comms[0] gets the left-hand nodes, and
   // driver_comms[1] gets the right-hand nodes, both based on the node_idx
   for (const int i : {0, 1}) {
@@ -62,6 +106,78 @@ void get_driver_comms(Comm super_comm,
   }
 }
 
+std::vector<int> pair_driver_ranks(const Comm& super,
+                                   const Comm& intranode_comm,
+                                   const Comm& neutronics_comm,
+                                   const Comm& heat_comm)
+{
+  // Each node is identified by the rank (wrt super) of its root
+  int node = super.rank;
+  intranode_comm.broadcast(node);
+
+  std::array<int, 3> info{node,
+                          neutronics_comm.active() ? neutronics_comm.rank : -1,
+                          heat_comm.active() ? 1 : 0};
+  std::vector<int> all_info(3 * super.size);
+  super.Allgather(info.data(), 3, MPI_INT, all_info.data(), 3, MPI_INT);
+  return pair_driver_ranks(all_info);
+}
+
+std::vector<int> pair_driver_ranks(const std::vector<int>& all_info)
+{
+  Expects(all_info.size() % 3 == 0);
+  int n_ranks = all_info.size() / 3;
+
+  // Neutronics ranks on each node and overall
+  std::unordered_map<int, std::vector<int>> node_neutronics;
+  std::vector<int> all_neutronics;
+  for (int r = 0; r < n_ranks; ++r) {
+    if (all_info[3 * r + 1] >= 0) {
+      node_neutronics[all_info[3 * r]].push_back(all_info[3 * r + 1]);
+      all_neutronics.push_back(all_info[3 * r + 1]);
+    }
+  }
+  Expects(!all_neutronics.empty());
+
+  // Deal out the heat/fluids ranks in order of their rank in super, so that every rank
+  // computes the same pairs
+  std::vector<int> partners(n_ranks, -1);
+  std::unordered_map<int, int> n_dealt;
+  int n_remote = 0;
+  for (int r = 0; r < n_ranks; ++r) {
+    if (all_info[3 * r + 2] == 1) {
+      auto it = node_neutronics.find(all_info[3 * r]);
+      if (it != node_neutronics.end()) {
+        const auto& ranks = it->second;
+        partners[r] = ranks[n_dealt[it->first]++ % ranks.size()];
+      } else {
+        partners[r] = all_neutronics[n_remote++ % all_neutronics.size()];
+      }
+    }
+  }
+  return partners;
+}
+
+std::array<int, 2> balance_units(std::array<double, 2> work, int total, bool concurrent)
+{
+  Expects(total >= 2);
+  Expects(work[0] >= 0.0 && work[1] >= 0.0);
+
+  std::array<int, 2> best{0, 0};
+  double best_time = 0.0;
+  for (int n = 1; n < total; ++n) {
+    double t0 = work[0] / n;
+    double t1 = work[1] / (total - n);
+    double time = concurrent ? std::max(t0, t1) : t0 + t1;
+    bool more_even = std::abs(2 * n - total) < std::abs(2 * best[0] - total);
+    if (best[0] == 0 || time < best_time || (time == best_time && more_even)) {
+      best = {n, total - n};
+      best_time = time;
+    }
+  }
+  return best;
+}
+
 std::vector<int> gather_subcomm_ranks(const Comm& super, const Comm& sub)
 {
   std::vector<int> ranks(super.size);
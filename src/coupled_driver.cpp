@@ -3,6 +3,9 @@
 #include "enrico/comm_split.h"
 #include "enrico/driver.h"
 #include "enrico/error.h"
+#include "enrico/hash.h"
+#include "enrico/mock_neutronics_driver.h"
+#include "enrico/neutronics_ensemble.h"
 
 #ifdef USE_NEK5000
 #include "enrico/nek5000_driver.h"
@@ -17,16 +20,25 @@
 #include "enrico/shift_driver.h"
 #endif
 #include "enrico/surrogate_heat_driver.h"
+#include "enrico/trace.h"
 
 #include <gsl/gsl>
-#include <xtensor/xbuilder.hpp> // for empty
+#include <xtensor/xbuilder.hpp> // for empty, zeros
 #include <xtensor/xnorm.hpp>    // for norm_l1, norm_l2, norm_linf
 
-#include <algorithm> // for copy
+#include <algorithm> // for copy, sort, unique, lower_bound, min
+#include <cmath>     // for pow, sqrt
+#include <csignal>   // for signal, sig_atomic_t, SIGTERM
+#include <exception> // for exception_ptr, current_exception, rethrow_exception
+#include <cstdint>   // for uint64_t
+#include <cstdio>    // for rename
+#include <fstream>
 #include <iomanip>
 #include <map>
-#include <memory> // for make_unique
+#include <memory>  // for make_unique
+#include <numeric> // for partial_sum
 #include <string>
+#include <utility> // for swap
 
 // For gethostname
 #ifdef _WIN32
@@ -37,29 +49,157 @@
 
 namespace enrico {
 
+namespace {
+
+// Identifies a mapping cache file and the version of its layout
+constexpr char mapping_cache_magic[8] = {'E', 'N', 'R', 'I', 'C', 'O', 'M', 'C'};
+constexpr std::uint64_t mapping_cache_version = 2;
+
+// Identifies a checkpoint file of one rank and the version of its layout
+constexpr char checkpoint_magic[8] = {'E', 'N', 'R', 'I', 'C', 'O', 'C', 'P'};
+constexpr std::uint64_t checkpoint_version = 1;
+
+// Set by the SIGTERM handler so that the next Picard iteration writes a checkpoint
+volatile std::sig_atomic_t stop_signal = 0;
+
+extern "C" void handle_stop_signal(int)
+{
+  stop_signal = 1;
+}
+
+template<typename T>
+void write_binary(std::ofstream& out, const T& value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+void write_binary(std::ofstream& out, const std::vector<T>& values)
+{
+  write_binary(out, static_cast<std::uint64_t>(values.size()));
+  out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+template<typename T>
+void read_binary(std::ifstream& in, T& value)
+{
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+template<typename T>
+void read_binary(std::ifstream& in, std::vector<T>& values)
+{
+  std::uint64_t n = 0;
+  read_binary(in, n);
+  if (!in) {
+    return;
+  }
+  values.resize(n);
+  in.read(reinterpret_cast<char*>(values.data()), n * sizeof(T));
+}
+
+void write_binary(std::ofstream& out, const xt::xtensor<double, 1>& values)
+{
+  write_binary(out, static_cast<std::uint64_t>(values.size()));
+  out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+}
+
+void read_binary(std::ifstream& in, xt::xtensor<double, 1>& values)
+{
+  std::uint64_t n = 0;
+  read_binary(in, n);
+  if (!in) {
+    return;
+  }
+  values.resize({static_cast<std::size_t>(n)});
+  in.read(reinterpret_cast<char*>(values.data()), n * sizeof(double));
+}
+
+void write_binary(std::ofstream& out, const std::deque<xt::xtensor<double, 1>>& history)
+{
+  write_binary(out, static_cast<std::uint64_t>(history.size()));
+  for (const auto& values : history) {
+    write_binary(out, values);
+  }
+}
+
+void read_binary(std::ifstream& in, std::deque<xt::xtensor<double, 1>>& history)
+{
+  std::uint64_t n = 0;
+  read_binary(in, n);
+  history.clear();
+  for (std::uint64_t i = 0; i < n && in; ++i) {
+    history.emplace_back();
+    read_binary(in, history.back());
+  }
+}
+
+//! Name of the checkpoint file of one rank
+std::string checkpoint_file(const std::string& prefix, int generation, int rank)
+{
+  return prefix + "." + std::to_string(generation) + "." + std::to_string(rank);
+}
+
+//! Extrapolate a field to the next of equally spaced timesteps
+//!
+//! Fits a polynomial through the field at the given timesteps. Wherever the
+//! extrapolated value isn't positive, the last value is kept instead.
+//!
+//! \param history Field at the last one to three timesteps, oldest first
+//! \return Field predicted at the next timestep
+xt::xtensor<double, 1> extrapolate(const std::deque<xt::xtensor<double, 1>>& history)
+{
+  Expects(!history.empty() && history.size() <= 3);
+  const auto& last = history.back();
+  xt::xtensor<double, 1> next = last;
+  if (history.size() == 2) {
+    next = 2.0 * last - history[0];
+  } else if (history.size() == 3) {
+    next = 3.0 * last - 3.0 * history[1] + history[0];
+  }
+  for (gsl::index i = 0; i < next.size(); ++i) {
+    if (!(next(i) > 0.0)) {
+      next(i) = last(i);
+    }
+  }
+  return next;
+}
+
+} // namespace
+
 CoupledDriver::CoupledDriver(MPI_Comm comm, pugi::xml_node node)
   : comm_(comm)
-  , timer_init_comms(comm_)
-  , timer_init_mapping(comm_)
-  , timer_init_tallies(comm_)
-  , timer_init_volume(comm_)
-  , timer_init_fluid_mask(comm_)
-  , timer_init_temperature(comm_)
-  , timer_init_density(comm_)
-  , timer_init_heat_source(comm_)
-  , timer_update_density(comm_)
-  , timer_update_heat_source(comm_)
-  , timer_update_temperature(comm_)
+  , timer_init_comms(comm_, "coupling", "init_comms")
+  , timer_init_mapping(comm_, "coupling", "init_mapping")
+  , timer_init_tallies(comm_, "coupling", "init_tallies")
+  , timer_init_volume(comm_, "coupling", "init_volume")
+  , timer_init_fluid_mask(comm_, "coupling", "init_fluid_mask")
+  , timer_init_temperature(comm_, "coupling", "init_temperature")
+  , timer_init_density(comm_, "coupling", "init_density")
+  , timer_init_heat_source(comm_, "coupling", "init_heat_source")
+  , timer_update_density(comm_, "coupling", "update_density")
+  , timer_update_heat_source(comm_, "coupling", "update_heat_source")
+  , timer_update_temperature(comm_, "coupling", "update_temperature")
 {
   parse_xml_params(node);
   init_comms(node);
+  init_particles();
   init_mapping();
   init_tallies();
   init_volume();
   init_fluid_mask();
-  init_temperature();
-  init_density();
-  init_heat_source();
+
+  // A restart takes the fields from the checkpoint instead of the initial conditions
+  if (!restart_ || !read_checkpoint()) {
+    init_temperature();
+    init_density();
+    init_heat_source();
+  }
+
+  if (!checkpoint_prefix_.empty() && checkpoint_on_signal_) {
+    std::signal(SIGTERM, handle_stop_signal);
+  }
+  record_memory();
 }
 
 void CoupledDriver::parse_xml_params(const pugi::xml_node& node)
@@ -90,6 +230,19 @@ void CoupledDriver::parse_xml_params(const pugi::xml_node& node)
   set_alpha(coup_node.child("alpha_T"), alpha_T_);
   set_alpha(coup_node.child("alpha_rho"), alpha_rho_);
 
+  if (coup_node.child("anderson_depth")) {
+    anderson_depth_ = coup_node.child("anderson_depth").text().as_int();
+    if (anderson_depth_ < 0) {
+      throw std::runtime_error{"Invalid value for <anderson_depth>"};
+    }
+    if (anderson_depth_ > 0 &&
+        (alpha_ == ROBBINS_MONRO || alpha_T_ == ROBBINS_MONRO ||
+         alpha_rho_ == ROBBINS_MONRO)) {
+      throw std::runtime_error{
+        "Robbins-Monro relaxation can't be combined with <anderson_depth>"};
+    }
+  }
+
   // check for convergence norm
   if (coup_node.child("convergence_norm")) {
     std::string s = coup_node.child_value("convergence_norm");
@@ -104,6 +257,134 @@ void CoupledDriver::parse_xml_params(const pugi::xml_node& node)
     }
   }
 
+  if (coup_node.child("convergence_test")) {
+    std::string s = coup_node.child_value("convergence_test");
+    if (s == "temperature") {
+      convergence_test_ = ConvergenceTest::temperature;
+    } else if (s == "statistical") {
+      convergence_test_ = ConvergenceTest::statistical;
+    } else {
+      throw std::runtime_error{"Invalid value for <convergence_test>"};
+    }
+  }
+
+  if (coup_node.child("delta_update")) {
+    auto delta_node = coup_node.child("delta_update");
+    temperature_tolerance_ = delta_node.child("temperature").text().as_double();
+    density_tolerance_ = delta_node.child("density").text().as_double();
+    if (temperature_tolerance_ < 0.0) {
+      throw std::runtime_error{"Invalid value for <delta_update><temperature>"};
+    }
+    if (density_tolerance_ < 0.0) {
+      throw std::runtime_error{"Invalid value for <delta_update><density>"};
+    }
+  }
+
+  if (coup_node.child("timers")) {
+    std::string s = coup_node.child_value("timers");
+    if (s == "synchronized") {
+      Timer::set_synchronized(true);
+    } else if (s == "local") {
+      Timer::set_synchronized(false);
+    } else {
+      throw std::runtime_error{"Invalid value for <timers>"};
+    }
+  }
+
+  if (coup_node.child("heat_source_scatter")) {
+    std::string s = coup_node.child_value("heat_source_scatter");
+    if (s == "root") {
+      heat_source_scatter_ = HeatSourceScatter::root;
+    } else if (s == "sliced") {
+      heat_source_scatter_ = HeatSourceScatter::sliced;
+    } else {
+      throw std::runtime_error{"Invalid value for <heat_source_scatter>"};
+    }
+  }
+
+  if (coup_node.child("precision")) {
+    std::string s = coup_node.child_value("precision");
+    if (s == "double") {
+      precision_ = Precision::full;
+    } else if (s == "float") {
+      precision_ = Precision::single;
+    } else if (s == "uint16") {
+      precision_ = Precision::quantized;
+    } else {
+      throw std::runtime_error{"Invalid value for <precision>"};
+    }
+  }
+
+  if (coup_node.child("release_buffers")) {
+    release_buffers_ = coup_node.child("release_buffers").text().as_bool();
+  }
+
+  if (coup_node.child("hierarchical")) {
+    hierarchical_ = coup_node.child("hierarchical").text().as_bool();
+  }
+
+  if (coup_node.child("projection")) {
+    projection_order_ = coup_node.child("projection").text().as_int();
+    if (projection_order_ <= 0) {
+      throw std::runtime_error{"Invalid value for <projection>"};
+    }
+  }
+
+  if (coup_node.child("shared_memory")) {
+    shared_memory_ = coup_node.child("shared_memory").text().as_bool();
+  }
+
+  if (coup_node.child("placement")) {
+    std::string s = coup_node.child_value("placement");
+    if (s == "split") {
+      placement_ = Placement::split;
+    } else if (s == "colocated") {
+      placement_ = Placement::colocated;
+    } else {
+      throw std::runtime_error{"Invalid value for <placement>"};
+    }
+  }
+
+  if (coup_node.child("coupling_scheme")) {
+    std::string s = coup_node.child_value("coupling_scheme");
+    if (s == "gauss-seidel") {
+      coupling_scheme_ = CouplingScheme::gauss_seidel;
+    } else if (s == "jacobi") {
+      coupling_scheme_ = CouplingScheme::jacobi;
+    } else {
+      throw std::runtime_error{"Invalid value for <coupling_scheme>"};
+    }
+  }
+
+  if (coup_node.child("predictor")) {
+    std::string s = coup_node.child_value("predictor");
+    if (s == "none") {
+      predictor_ = Predictor::none;
+    } else if (s == "linear") {
+      predictor_ = Predictor::linear;
+    } else if (s == "quadratic") {
+      predictor_ = Predictor::quadratic;
+    } else {
+      throw std::runtime_error{"Invalid value for <predictor>"};
+    }
+  }
+
+  if (coup_node.child("auto_balance")) {
+    auto balance_node = coup_node.child("auto_balance");
+    balance_file_ = "balance.txt";
+    if (balance_node.child("file")) {
+      balance_file_ = balance_node.child_value("file");
+      if (balance_file_.empty()) {
+        throw std::runtime_error{"Invalid value for <auto_balance><file>"};
+      }
+    }
+    balance_apply_ = balance_node.child("apply").text().as_bool();
+  }
+
+  if (coup_node.child("mapping_cache")) {
+    mapping_cache_ = coup_node.child_value("mapping_cache");
+  }
+
   if (coup_node.child("temperature_ic")) {
     std::string s = coup_node.child_value("temperature_ic");
 
@@ -128,6 +409,59 @@ void CoupledDriver::parse_xml_params(const pugi::xml_node& node)
     }
   }
 
+  if (coup_node.child("adaptive_particles")) {
+    auto particles_node = coup_node.child("adaptive_particles");
+    particles_initial_ = particles_node.child("initial").text().as_llong();
+    if (particles_initial_ <= 0) {
+      throw std::runtime_error{"Invalid value for <adaptive_particles><initial>"};
+    }
+    if (particles_node.child("growth")) {
+      particles_growth_ = particles_node.child("growth").text().as_double();
+      if (particles_growth_ <= 1.0) {
+        throw std::runtime_error{"Invalid value for <adaptive_particles><growth>"};
+      }
+    }
+    if (particles_node.child("rule")) {
+      std::string s = particles_node.child_value("rule");
+      if (s == "geometric") {
+        particles_rule_ = ParticleRule::geometric;
+      } else if (s == "error") {
+        particles_rule_ = ParticleRule::error;
+      } else {
+        throw std::runtime_error{"Invalid value for <adaptive_particles><rule>"};
+      }
+    }
+  }
+
+  if (coup_node.child("checkpoint")) {
+    auto checkpoint_node = coup_node.child("checkpoint");
+    checkpoint_prefix_ = "checkpoint";
+    if (checkpoint_node.child("prefix")) {
+      checkpoint_prefix_ = checkpoint_node.child_value("prefix");
+      if (checkpoint_prefix_.empty()) {
+        throw std::runtime_error{"Invalid value for <checkpoint><prefix>"};
+      }
+    }
+    if (checkpoint_node.child("interval")) {
+      checkpoint_interval_ = checkpoint_node.child("interval").text().as_int();
+      if (checkpoint_interval_ < 0) {
+        throw std::runtime_error{"Invalid value for <checkpoint><interval>"};
+      }
+    }
+    if (checkpoint_node.child("signal")) {
+      checkpoint_on_signal_ = checkpoint_node.child("signal").text().as_bool();
+    }
+    restart_ = checkpoint_node.child("restart").text().as_bool();
+  }
+
+  output_ = OutputSettings{node.child("output")};
+
+  // Start tracing before the drivers are set up so that their setup is recorded
+  trace_file_ = node.child("output").child_value("trace");
+  if (!trace_file_.empty()) {
+    trace::enable(comm_);
+  }
+
   Expects(power_ > 0);
   Expects(max_timesteps_ >= 0);
   Expects(max_picard_iter_ >= 0);
@@ -147,60 +481,146 @@ void CoupledDriver::init_comms(const pugi::xml_node& node)
   std::array<int, 2> procs_per_node{neut_node.child("procs_per_node").text().as_int(),
                                     heat_node.child("procs_per_node").text().as_int()};
   std::array<Comm, 2> driver_comms;
-  Comm intranode_comm; // Not used in current comm scheme
-  Comm coupling_comm;  // Not used in current comm scheme
 
-  get_driver_comms(
-    comm_, nodes, procs_per_node, driver_comms, intranode_comm, coupling_comm);
+  if (balance_apply_ && read_balance(nodes, procs_per_node)) {
+    std::stringstream msg;
+    msg << "Using the balanced split from " << balance_file_ << ": neutronics "
+        << nodes[0] << " nodes x " << procs_per_node[0] << " procs, heat/fluids "
+        << nodes[1] << " nodes x " << procs_per_node[1] << " procs";
+    comm_.message(msg.str());
+  }
+
+  get_driver_comms(comm_,
+                   nodes,
+                   procs_per_node,
+                   driver_comms,
+                   intranode_comm_,
+                   internode_comm_,
+                   placement_);
 
   auto neutronics_comm = driver_comms[0];
   auto heat_comm = driver_comms[1];
 
+  // Record the layout that was applied for the load balance
+  n_procs_per_node_ = intranode_comm_.size;
+  n_nodes_ = intranode_comm_.is_root();
+  comm_.Allreduce(MPI_IN_PLACE, &n_nodes_, 1, MPI_INT, MPI_SUM);
+  comm_.Allreduce(MPI_IN_PLACE, &n_procs_per_node_, 1, MPI_INT, MPI_MAX);
+  for (const int i : {0, 1}) {
+    int on_node = driver_comms[i].active();
+    intranode_comm_.Allreduce(MPI_IN_PLACE, &on_node, 1, MPI_INT, MPI_SUM);
+    driver_procs_per_node_[i] = on_node;
+    driver_nodes_[i] = intranode_comm_.is_root() && on_node > 0;
+  }
+  comm_.Allreduce(
+    MPI_IN_PLACE, driver_procs_per_node_.data(), 2, MPI_INT, MPI_MAX);
+  comm_.Allreduce(MPI_IN_PLACE, driver_nodes_.data(), 2, MPI_INT, MPI_SUM);
+
   timer_init_comms.stop();
 
+  // The drivers are set up without synchronizing, so that each one's initialization
+  // (e.g., loading cross sections or building the mesh) overlaps with the other's
+  // on its own ranks.  Nothing may synchronize comm_ until both are constructed.
+
   // Instantiate neutronics driver
   std::string neut_driver = neut_node.child_value("driver");
-  if (neut_driver == "openmc") {
-    neutronics_driver_ = std::make_unique<OpenmcDriver>(neutronics_comm.comm);
-  } else if (neut_driver == "shift") {
+  auto make_neutronics = [&neut_driver, neut_node](MPI_Comm comm) {
+    std::unique_ptr<NeutronicsDriver> driver;
+    if (neut_driver == "openmc") {
+      driver = std::make_unique<OpenmcDriver>(comm, neut_node);
+    } else if (neut_driver == "shift") {
 #ifdef USE_SHIFT
-    neutronics_driver_ = std::make_unique<ShiftDriver>(comm, neut_node);
+      driver = std::make_unique<ShiftDriver>(comm, neut_node);
 #else
-    throw std::runtime_error{"ENRICO has not been built with Shift support enabled."};
+      throw std::runtime_error{"ENRICO has not been built with Shift support enabled."};
 #endif
-  } else {
-    throw std::runtime_error{"Invalid value for <neutronics><driver>"};
+    } else if (neut_driver == "mock") {
+      driver = std::make_unique<MockNeutronicsDriver>(comm, neut_node);
+    } else {
+      throw std::runtime_error{"Invalid value for <neutronics><driver>"};
+    }
+    return driver;
+  };
+
+  // An ensemble runs independent instances of the driver on blocks of the ranks.
+  // Every rank checks it against the size of the neutronics comm, so that all of them
+  // throw together; no driver is being set up yet.
+  int n_members = 1;
+  if (neut_node.child("ensemble")) {
+    n_members = neut_node.child("ensemble").text().as_int();
+    int n_neutronics = neutronics_comm.active() ? neutronics_comm.size : 0;
+    comm_.Allreduce(MPI_IN_PLACE, &n_neutronics, 1, MPI_INT, MPI_MAX);
+    if (n_members < 1 || n_members > n_neutronics) {
+      throw std::runtime_error{"Invalid value for <neutronics><ensemble>"};
+    }
   }
 
-  // Instantiate heat-fluids driver
-  std::string s = heat_node.child_value("driver");
-  if (s == "nek5000") {
+  // A driver that fails to set up on some ranks mustn't leave the other ranks waiting
+  // at the rendezvous, so the error is held until every rank knows about it
+  std::exception_ptr setup_error;
+  try {
+    if (n_members > 1) {
+      neutronics_driver_ = std::make_unique<NeutronicsEnsemble>(
+        neutronics_comm.comm, n_members, make_neutronics);
+    } else {
+      neutronics_driver_ = make_neutronics(neutronics_comm.comm);
+    }
+
+    // Instantiate heat-fluids driver
+    std::string s = heat_node.child_value("driver");
+    if (s == "nek5000") {
 #ifdef USE_NEK5000
-    heat_fluids_driver_ = std::make_unique<Nek5000Driver>(heat_comm.comm, heat_node);
+      heat_fluids_driver_ = std::make_unique<Nek5000Driver>(heat_comm.comm, heat_node);
 #else
-    throw std::runtime_error{
-      "nek5000 was specified as a solver, but is not enabled in this build of ENRICO"};
+      throw std::runtime_error{
+        "nek5000 was specified as a solver, but is not enabled in this build of "
+        "ENRICO"};
 #endif
-  } else if (s == "nekrs") {
+    } else if (s == "nekrs") {
 #ifdef USE_NEKRS
-    heat_fluids_driver_ = std::make_unique<NekRSDriver>(heat_comm.comm, heat_node);
+      heat_fluids_driver_ = std::make_unique<NekRSDriver>(heat_comm.comm, heat_node);
 #else
-    throw std::runtime_error{
-      "nekrs was specified as a solver, but is not enabled in this build of ENRICO"};
+      throw std::runtime_error{
+        "nekrs was specified as a solver, but is not enabled in this build of "
+        "ENRICO"};
 #endif
-  } else if (s == "surrogate") {
-    heat_fluids_driver_ =
-      std::make_unique<SurrogateHeatDriver>(heat_comm.comm, heat_node);
-  } else {
-    throw std::runtime_error{"Invalid value for <heat_fluids><driver>"};
+    } else if (s == "surrogate") {
+      heat_fluids_driver_ =
+        std::make_unique<SurrogateHeatDriver>(heat_comm.comm, heat_node);
+    } else {
+      throw std::runtime_error{"Invalid value for <heat_fluids><driver>"};
+    }
+  } catch (...) {
+    setup_error = std::current_exception();
   }
 
+  // Rendezvous once both drivers have finished setting up, and throw on every rank if
+  // any of them failed
+  int failed = setup_error != nullptr;
+  comm_.Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_LOR);
+  if (setup_error) {
+    std::rethrow_exception(setup_error);
+  }
+  if (failed) {
+    throw std::runtime_error{"A driver failed to set up on another rank"};
+  }
+
+  neutronics_driver_->set_output(output_);
+  heat_fluids_driver_->set_output(output_);
+  comm_.message("Neutronics and heat/fluids drivers are set up");
+
   timer_init_comms.start();
 
   // Discover the rank IDs (relative to comm_) that are in each single-physics subcomm
   neutronics_ranks_ = gather_subcomm_ranks(comm_, neutronics_comm);
   heat_ranks_ = gather_subcomm_ranks(comm_, heat_comm);
 
+  // Colocated heat ranks get their heat source from a neutronics rank on their node
+  if (placement_ == Placement::colocated) {
+    heat_partners_ =
+      pair_driver_ranks(comm_, intranode_comm_, neutronics_comm, heat_comm);
+  }
+
   // Send rank ID of neutronics subcomm root (relative to comm_) to all procs
   neutronics_root_ = this->get_neutronics_driver().comm_.is_root() ? comm_.rank : -1;
   MPI_Allreduce(MPI_IN_PLACE, &neutronics_root_, 1, MPI_INT, MPI_MAX, comm_.comm);
@@ -209,87 +629,377 @@ void CoupledDriver::init_comms(const pugi::xml_node& node)
   heat_root_ = this->get_heat_driver().comm_.is_root() ? comm_.rank : -1;
   MPI_Allreduce(MPI_IN_PLACE, &heat_root_, 1, MPI_INT, MPI_MAX, comm_.comm);
 
+  // The heat ranks hold the relaxed fields, so they mix them together
+  if (anderson_depth_ > 0) {
+    const auto& heat_comm = this->get_heat_driver().comm_;
+    heat_source_mixer_ = AndersonMixer{heat_comm, anderson_depth_, alpha_};
+    temperature_mixer_ = AndersonMixer{heat_comm, anderson_depth_, alpha_T_};
+    density_mixer_ = AndersonMixer{heat_comm, anderson_depth_, alpha_rho_};
+  }
+
   timer_init_comms.stop();
 
   comm_report();
 }
 
-void CoupledDriver::execute()
+bool CoupledDriver::read_balance(std::array<int, 2>& nodes,
+                                 std::array<int, 2>& procs_per_node)
 {
+  // The split only applies to an allocation of the same shape
+  MPI_Comm node_comm;
+  MPI_Comm_split_type(
+    comm_.comm, MPI_COMM_TYPE_SHARED, comm_.rank, MPI_INFO_NULL, &node_comm);
+  int node_rank;
+  int n_procs_per_node;
+  MPI_Comm_rank(node_comm, &node_rank);
+  MPI_Comm_size(node_comm, &n_procs_per_node);
+  MPI_Comm_free(&node_comm);
+  int n_nodes = node_rank == 0;
+  comm_.Allreduce(MPI_IN_PLACE, &n_nodes, 1, MPI_INT, MPI_SUM);
+  comm_.Allreduce(MPI_IN_PLACE, &n_procs_per_node, 1, MPI_INT, MPI_MAX);
+
+  // The root reads the split and shares it with every rank
+  std::array<int, 5> split{0, 0, 0, 0, 0};
+  if (comm_.rank == 0) {
+    std::ifstream in{balance_file_};
+    std::string key, placement;
+    int file_nodes = 0;
+    int file_procs_per_node = 0;
+    in >> key >> placement >> key >> file_nodes >> key >> file_procs_per_node >> key >>
+      split[1] >> split[2] >> key >> split[3] >> split[4];
+    std::string expected = placement_ == Placement::colocated ? "colocated" : "split";
+    split[0] = in && placement == expected && file_nodes == n_nodes &&
+               file_procs_per_node == n_procs_per_node;
+  }
+  comm_.Bcast(split.data(), split.size(), MPI_INT, 0);
+  if (!split[0]) {
+    comm_.message("No balanced split for this allocation in " + balance_file_);
+    return false;
+  }
+  nodes = {split[1], split[3]};
+  procs_per_node = {split[2], split[4]};
+  return true;
+}
 
+void CoupledDriver::balance_report()
+{
+  auto& neutronics = this->get_neutronics_driver();
+  auto& heat = this->get_heat_driver();
+
+  std::array<double, 2> times{
+    neutronics.active() ? neutronics.timer_solve_step.elapsed() : 0.0,
+    heat.active() ? heat.timer_solve_step.elapsed() : 0.0};
+  comm_.Allreduce(MPI_IN_PLACE, times.data(), 2, MPI_DOUBLE, MPI_MAX);
+
+  // Colocated drivers share every node, so only the procs per node can be traded
+  bool colocated = placement_ == Placement::colocated;
+  auto units = colocated ? driver_procs_per_node_ : driver_nodes_;
+  int total = colocated ? n_procs_per_node_ : n_nodes_;
+  if (total < 2) {
+    comm_.message("Load balance: too few nodes or procs per node to split");
+    return;
+  }
+  auto balanced =
+    balance_units({times[0] * units[0], times[1] * units[1]},
+                  total,
+                  coupling_scheme_ == CouplingScheme::jacobi);
+
+  std::string unit = colocated ? " procs per node" : " nodes";
+  std::stringstream msg;
+  msg << "Load balance: neutronics solve_step " << times[0] << " s on " << units[0]
+      << unit << ", heat/fluids solve_step " << times[1] << " s on " << units[1] << unit
+      << "; balanced split is " << balanced[0] << " and " << balanced[1] << unit;
+  comm_.message(msg.str());
+
+  auto nodes = driver_nodes_;
+  auto procs_per_node = driver_procs_per_node_;
+  (colocated ? procs_per_node : nodes) = balanced;
+  if (comm_.rank == 0) {
+    std::ofstream out{balance_file_};
+    out << "placement " << (colocated ? "colocated" : "split") << "\n"
+        << "nodes " << n_nodes_ << "\n"
+        << "procs_per_node " << n_procs_per_node_ << "\n"
+        << "neutronics " << nodes[0] << " " << procs_per_node[0] << "\n"
+        << "heat_fluids " << nodes[1] << " " << procs_per_node[1] << "\n";
+    if (!out) {
+      comm_.message("Could not write " + balance_file_);
+    }
+  }
+}
+
+void CoupledDriver::init_particles()
+{
+  if (particles_initial_ == 0)
+    return;
+
+  // The neutronics root knows the particle count from the neutronics input
+  auto& neutronics = this->get_neutronics_driver();
+  if (comm_.rank == neutronics_root_) {
+    particles_target_ = neutronics.n_particles();
+  }
+  comm_.broadcast(particles_target_, neutronics_root_);
+}
+
+int64_t CoupledDriver::n_particles() const
+{
+  if (particles_initial_ == 0)
+    return particles_target_;
+
+  if (particles_rule_ == ParticleRule::error) {
+    return std::min(particles_current_, particles_target_);
+  }
+
+  double n = particles_initial_ * std::pow(particles_growth_, i_picard_);
+  return n < particles_target_ ? static_cast<int64_t>(n) : particles_target_;
+}
+
+bool CoupledDriver::needs_root_heat_source() const
+{
+  return convergence_test_ == ConvergenceTest::statistical ||
+         (particles_initial_ > 0 && particles_rule_ == ParticleRule::error);
+}
+
+void CoupledDriver::grow_particles(double norm)
+{
+  // Relative change in the temperature, on the heat root
+  double change = 0.0;
+  double magnitude = this->temperature_magnitude(norm_);
+  if (comm_.rank == heat_root_ && magnitude > 0.0) {
+    change = norm / magnitude;
+  }
+  comm_.broadcast(change, heat_root_);
+
+  double error = heat_source_mean_error_;
+  comm_.broadcast(error, neutronics_root_);
+
+  if (change > error) {
+    return;
+  }
+  double factor = particles_growth_;
+  if (change > 0.0) {
+    factor = std::max(factor, (error / change) * (error / change));
+  }
+  double n = factor * particles_current_;
+  particles_current_ =
+    n < particles_target_ ? static_cast<int64_t>(n) : particles_target_;
+
+  std::stringstream msg;
+  msg << "temperature change " << change << " is within heat source error " << error
+      << "; particles per batch grow to " << particles_current_;
+  comm_.message(msg.str());
+}
+
+void CoupledDriver::execute()
+{
   auto& neutronics = get_neutronics_driver();
   auto& heat = get_heat_driver();
 
+  bool checkpoint = !checkpoint_prefix_.empty();
+  bool stopped = false;
+
   // loop over time steps
-  for (i_timestep_ = 0; i_timestep_ < max_timesteps_; ++i_timestep_) {
+  for (i_timestep_ = start_timestep_; i_timestep_ < max_timesteps_; ++i_timestep_) {
     std::string msg = "i_timestep: " + std::to_string(i_timestep_);
     comm_.message(msg);
 
+    if (neutronics.active()) {
+      neutronics.init_timestep();
+    }
+    if (heat.active()) {
+      heat.init_timestep();
+    }
+
+    // The particle count starts over in each timestep
+    particles_current_ = particles_initial_;
+
+    // The noise test compares heat sources within a timestep
+    heat_source_raw_prev_ = xt::xtensor<double, 1>{};
+    heat_source_raw_ = xt::xtensor<double, 1>{};
+
+    // Earlier iterates converged to a different fixed point
+    heat_source_mixer_.reset();
+    temperature_mixer_.reset();
+    density_mixer_.reset();
+
+    // A restart may resume in the middle of a timestep
+    int first_picard = i_timestep_ == start_timestep_ ? start_picard_ : 0;
+
+    // Start from the fields extrapolated from the previous timesteps once there are
+    // enough of them for at least a linear predictor
+    if (predictor_ != Predictor::none && i_timestep_ >= 2 && first_picard == 0) {
+      predict();
+    }
+
     // loop over picard iterations
-    for (i_picard_ = 0; i_picard_ < max_picard_iter_; ++i_picard_) {
+    for (i_picard_ = first_picard; i_picard_ < max_picard_iter_; ++i_picard_) {
       std::string msg = "i_picard: " + std::to_string(i_picard_);
       comm_.message(msg);
 
-      if (neutronics.active()) {
-#ifdef _OPENMP
-        omp_set_num_threads(neutronics.num_threads);
-#pragma omp parallel default(none) shared(neutronics)
-#pragma omp single
-        {
-          std::string msg = "OpenMP threads: " + std::to_string(omp_get_num_threads());
-          neutronics.comm_.message(msg);
-        }
-#endif
-        neutronics.init_step();
-        neutronics.solve_step();
-        neutronics.write_step(i_timestep_, i_picard_);
-        neutronics.finalize_step();
-      }
+      if (coupling_scheme_ == CouplingScheme::jacobi && !is_first_iteration()) {
+        // Both solvers run at the same time on their own ranks: neutronics uses the
+        // temperature/density from the previous iterate while heat-fluids uses the
+        // heat source from the previous iterate. The fields are exchanged afterward.
+        neutronics_step();
+        heat_fluids_step();
 
-      comm_.Barrier();
+        comm_.Barrier();
 
-      // Update heat source.
-      // On the first iteration, there is no previous iterate of heat source,
-      // so we can't apply underrelaxation at that point
-      update_heat_source(i_timestep_ > 0 || i_picard_ > 0);
+        update_heat_source(true);
+      } else {
+        neutronics_step();
 
-      if (heat.active()) {
-#ifdef _OPENMP
-        omp_set_num_threads(heat.num_threads);
-#pragma omp parallel default(none) shared(heat)
-#pragma omp single
-        {
-          std::string msg = "OpenMP threads: " + std::to_string(omp_get_num_threads());
-          heat.comm_.message(msg);
-        }
-#endif
-        heat.init_step();
-        heat.solve_step();
-        heat.write_step(i_timestep_, i_picard_);
-        heat.finalize_step();
-      }
+        comm_.Barrier();
 
-      comm_.Barrier();
+        // Update heat source.
+        // On the first iteration, there is no previous iterate of heat source,
+        // so we can't apply underrelaxation at that point
+        update_heat_source(i_timestep_ > 0 || i_picard_ > 0);
 
-      // Update temperature and density
-      // At this point, there is always a previous iterate of temperature and density
-      // (as assured by the initial conditions set in init_temperature and init_density)
-      // so we always apply underrelaxation here.
-      update_temperature(true);
-      update_density(true);
+        heat_fluids_step();
 
+        comm_.Barrier();
+      }
+
+      // Update temperature and density
+      // At this point, there is always a previous iterate of temperature and
+      // density (as assured by the initial conditions set in init_temperature and
+      // init_density) so we always apply underrelaxation here. The convergence test
+      // only needs the heat/fluids side, so it is done before the drivers finalize
+      // their step, and the last iteration is written while its results are live.
+      timer_update_temperature.start();
+      compute_cell_temperature(true);
+      timer_update_temperature.stop();
+      bool converged = is_converged();
+      finish_steps(converged || i_picard_ + 1 == max_picard_iter_);
+      send_temperature_and_density(true);
+
+      record_memory();
       timer_report();
+      memory_report();
 
-      if (is_converged()) {
+      // The first Picard iteration of the run gives the solve times to balance
+      if (!balance_file_.empty() && i_timestep_ == start_timestep_ &&
+          i_picard_ == first_picard) {
+        balance_report();
+      }
+
+      if (converged) {
         std::string msg = "converged at i_picard = " + std::to_string(i_picard_);
         comm_.message(msg);
         break;
       }
+
+      // After the last iteration, or when the state within the timestep can't be
+      // restored, the checkpoint is written at the end of the timestep
+      if (checkpoint && checkpoint_on_signal_ && i_picard_ + 1 < max_picard_iter_ &&
+          can_checkpoint_mid_timestep() && stop_requested()) {
+        write_checkpoint(i_timestep_, i_picard_ + 1);
+        stopped = true;
+        break;
+      }
     }
+    if (stopped) {
+      comm_.message("Stopped after SIGTERM at i_picard = " + std::to_string(i_picard_));
+      break;
+    }
+
+    if (predictor_ != Predictor::none) {
+      store_history();
+    }
+
     comm_.Barrier();
+
+    if (checkpoint && i_timestep_ + 1 < max_timesteps_) {
+      stopped = checkpoint_on_signal_ && stop_requested();
+      if (stopped || (checkpoint_interval_ > 0 &&
+                      (i_timestep_ + 1) % checkpoint_interval_ == 0)) {
+        write_checkpoint(i_timestep_ + 1, 0);
+      }
+      if (stopped) {
+        comm_.message("Stopped after SIGTERM at i_timestep = " +
+                      std::to_string(i_timestep_));
+        break;
+      }
+    }
   }
-  // TODO: Is this final heat.write_step still needed?
+  // Output that is only written once at the end of the run, such as the surrogate's
+  // visualization with <viz iterations="final">
   heat.write_step();
+
+  // Wait for any output still being written in the background
+  if (heat.active()) {
+    heat.flush_write();
+  }
+  if (neutronics.active()) {
+    neutronics.flush_write();
+  }
+
+  if (!trace_file_.empty()) {
+    trace::write(trace_file_);
+  }
+}
+
+void CoupledDriver::neutronics_step()
+{
+  auto& neutronics = get_neutronics_driver();
+
+  if (neutronics.active()) {
+#ifdef _OPENMP
+    omp_set_num_threads(neutronics.num_threads);
+#pragma omp parallel default(none) shared(neutronics)
+#pragma omp single
+    {
+      std::string msg = "OpenMP threads: " + std::to_string(omp_get_num_threads());
+      neutronics.comm_.message(msg);
+    }
+#endif
+    if (particles_initial_ > 0) {
+      neutronics.set_n_particles(n_particles());
+      neutronics.comm_.message("Particles per batch: " + std::to_string(n_particles()));
+    }
+    neutronics.init_step();
+    neutronics.solve_step();
+  }
+}
+
+void CoupledDriver::heat_fluids_step()
+{
+  auto& heat = get_heat_driver();
+
+  if (heat.active()) {
+#ifdef _OPENMP
+    omp_set_num_threads(heat.num_threads);
+#pragma omp parallel default(none) shared(heat)
+#pragma omp single
+    {
+      std::string msg = "OpenMP threads: " + std::to_string(omp_get_num_threads());
+      heat.comm_.message(msg);
+    }
+#endif
+    heat.init_step();
+    heat.solve_step();
+  }
+}
+
+void CoupledDriver::finish_steps(bool last)
+{
+  bool write = last || output_.is_write_iteration(i_picard_);
+
+  auto& neutronics = get_neutronics_driver();
+  if (neutronics.active()) {
+    if (write) {
+      neutronics.write_step(i_timestep_, i_picard_);
+    }
+    neutronics.finalize_step();
+  }
+
+  auto& heat = get_heat_driver();
+  if (heat.active()) {
+    if (write) {
+      heat.write_step(i_timestep_, i_picard_);
+    }
+    heat.finalize_step();
+  }
 }
 
 double CoupledDriver::temperature_norm(Norm norm)
@@ -319,94 +1029,554 @@ double CoupledDriver::temperature_norm(Norm norm)
     }
   }
 
-  return global_norm;
+  return global_norm;
+}
+
+double CoupledDriver::temperature_magnitude(Norm norm)
+{
+  auto& heat = this->get_heat_driver();
+  double global_norm = 0;
+
+  if (heat.active()) {
+    switch (norm) {
+    case Norm::L1: {
+      double local_norm = xt::norm_l1(cell_temperature_)();
+      MPI_Reduce(&local_norm, &global_norm, 1, MPI_DOUBLE, MPI_SUM, 0, heat.comm_.comm);
+      break;
+    }
+    case Norm::L2: {
+      double local_norm = xt::norm_sq(cell_temperature_)();
+      MPI_Reduce(&local_norm, &global_norm, 1, MPI_DOUBLE, MPI_SUM, 0, heat.comm_.comm);
+      global_norm = std::sqrt(global_norm);
+      break;
+    }
+    case Norm::LINF: {
+      double local_norm = xt::norm_linf(cell_temperature_)();
+      MPI_Reduce(&local_norm, &global_norm, 1, MPI_DOUBLE, MPI_MAX, 0, heat.comm_.comm);
+      break;
+    }
+    }
+  }
+
+  return global_norm;
+}
+
+double CoupledDriver::heat_source_noise_ratio(int& n_cells) const
+{
+  n_cells = 0;
+  if (heat_source_raw_prev_.size() != heat_source_raw_.size())
+    return -1.0;
+
+  double sum = 0.0;
+  int n = 0;
+  for (gsl::index i = 0; i < heat_source_raw_.size(); ++i) {
+    double sigma = heat_source_error_(i) * heat_source_raw_(i);
+    double sigma_prev = heat_source_error_prev_(i) * heat_source_raw_prev_(i);
+    double variance = sigma * sigma + sigma_prev * sigma_prev;
+    if (variance > 0.0) {
+      double change = heat_source_raw_(i) - heat_source_raw_prev_(i);
+      sum += change * change / variance;
+      ++n;
+    }
+  }
+  n_cells = n;
+  return n > 0 ? sum / n : -1.0;
+}
+
+bool CoupledDriver::is_converged()
+{
+  bool converged;
+  double norm;
+
+  // The heat root has the global temperature data
+  norm = this->temperature_norm(norm_);
+  if (comm_.rank == heat_root_) {
+    converged = norm < epsilon_;
+  }
+
+  comm_.broadcast(converged, heat_root_);
+  comm_.broadcast(norm, heat_root_);
+
+  std::stringstream msg;
+  msg << "temperature norm: " << norm;
+  comm_.message(msg.str());
+
+  // With n cells contributing to the mean, the mean square ratio of iterations that
+  // estimate the same heat source has a standard deviation of sqrt(2/n), so ratios
+  // below 1 + 3 sqrt(2/n) are indistinguishable from noise.  Cells without variance,
+  // e.g. non-fissionable ones, don't contribute.
+  if (convergence_test_ == ConvergenceTest::statistical && !converged) {
+    double ratio = -1.0;
+    double limit = 0.0;
+    if (comm_.rank == neutronics_root_) {
+      int n_cells;
+      ratio = heat_source_noise_ratio(n_cells);
+      if (n_cells > 0) {
+        limit = 1.0 + 3.0 * std::sqrt(2.0 / n_cells);
+      }
+    }
+    comm_.broadcast(ratio, neutronics_root_);
+    comm_.broadcast(limit, neutronics_root_);
+
+    if (ratio >= 0.0) {
+      std::stringstream msg;
+      msg << "heat source change / noise: " << ratio << " (limit " << limit << ")";
+      comm_.message(msg.str());
+      converged = ratio < limit;
+    }
+  }
+
+  // The solution is only accepted once the heat source has the full statistics
+  bool below_target = n_particles() < particles_target_;
+  if (converged && below_target) {
+    comm_.message("particle count is still below the target; continuing");
+    converged = false;
+  }
+
+  if (below_target && particles_rule_ == ParticleRule::error) {
+    grow_particles(norm);
+  }
+  return converged;
+}
+
+void CoupledDriver::update_heat_source(bool relax)
+{
+  comm_.message("Updating heat source");
+  timer_update_heat_source.start();
+
+  auto& neutronics = this->get_neutronics_driver();
+  auto& heat = this->get_heat_driver();
+
+  if (relax && heat.active()) {
+    std::copy(cell_heat_source_.cbegin(),
+              cell_heat_source_.cend(),
+              cell_heat_source_prev_.begin());
+  }
+
+  std::vector<double> cell_heat_send;
+  xt::xtensor<double, 1> all_cell_heat;
+
+  // Each neutronics rank gets the heat sources of the cells in its slice directly,
+  // without the whole heat source being assembled on the root
+  bool need_error = needs_root_heat_source();
+  if (coupling_plan_.sliced() && !need_error) {
+    xt::xtensor<double, 1> slice;
+    if (neutronics.active()) {
+      const auto& counts = coupling_plan_.slice_counts();
+      slice = neutronics.heat_source_slices(
+        power_,
+        {slice_tally_cells_.data(), slice_tally_cells_.size()},
+        {counts.data(), counts.size()});
+    }
+    check_precision("heat source", slice.data(), slice.size());
+    coupling_plan_.scatter_slices(slice.data(), cell_heat_source_.data());
+    relax_heat_source(relax);
+    send_heat_source();
+    timer_update_heat_source.stop();
+    return;
+  }
+
+  // For the coupling scheme, only the neutronics root needs the heat source.
+  // However, to compute the heat source, OpenmcDriver::heat_source must
+  // do a collective operation on all the ranks in the neutronics sub comm.
+  // Hence, all neutronics ranks must call OpenmcDriver::heat_source
+  if (neutronics.active()) {
+    all_cell_heat = neutronics.heat_source(power_);
+
+    // Keep the unrelaxed heat sources of the last two iterations for the noise test,
+    // and their mean error for the error rule of the particle count
+    if (need_error) {
+      auto error = neutronics.heat_source_rel_error();
+      if (comm_.rank == neutronics_root_) {
+        std::swap(heat_source_raw_prev_, heat_source_raw_);
+        std::swap(heat_source_error_prev_, heat_source_error_);
+        heat_source_raw_ = all_cell_heat;
+        heat_source_error_ = error;
+
+        double sum = xt::sum(all_cell_heat)();
+        double weighted = xt::sum(all_cell_heat * error)();
+        heat_source_mean_error_ = sum > 0.0 ? weighted / sum : 0.0;
+      }
+    }
+  }
+
+  // The neutronics root scatters the cell-averaged heat sources to the heat ranks.
+  // Each heat rank gets only the heat sources for its local cells.
+  if (comm_.rank == neutronics_root_) {
+    const auto& cell_index = coupling_plan_.cell_index();
+    cell_heat_send.resize(cell_index.size());
+    for (gsl::index i = 0; i < cell_index.size(); ++i) {
+      cell_heat_send[i] = all_cell_heat.at(cell_index[i]);
+    }
+  }
+  check_precision("heat source", cell_heat_send.data(), cell_heat_send.size());
+  if (coupling_plan_.sliced()) {
+    coupling_plan_.scatter_sliced(cell_heat_send, cell_heat_source_.data());
+  } else {
+    coupling_plan_.scatter(cell_heat_send, cell_heat_source_.data());
+  }
+
+  relax_heat_source(relax);
+  send_heat_source();
+  timer_update_heat_source.stop();
+}
+
+void CoupledDriver::relax_heat_source(bool relax)
+{
+  // On heat rank, update the elements' heat sources based on the cell-avged heat sources
+  if (relax && this->get_heat_driver().active()) {
+    if (anderson_depth_ > 0) {
+      heat_source_mixer_.mix(
+        {cell_heat_source_prev_.data(), cell_heat_source_prev_.size()},
+        {cell_heat_source_.data(), cell_heat_source_.size()});
+    } else if (alpha_ == ROBBINS_MONRO) {
+      int n = i_picard_ + 1;
+      cell_heat_source_ =
+        cell_heat_source_ / n + (1. - 1. / n) * cell_heat_source_prev_;
+    } else {
+      cell_heat_source_ =
+        alpha_ * cell_heat_source_ + (1.0 - alpha_) * cell_heat_source_prev_;
+    }
+  }
+}
+
+void CoupledDriver::send_heat_source()
+{
+  auto& heat = this->get_heat_driver();
+  if (heat.active()) {
+    projection_.distribute({cell_heat_source_.data(), cell_heat_source_.size()},
+                           elem_field_);
+    heat.set_heat_source(elem_field_);
+  }
+}
+
+void CoupledDriver::update_temperature(bool relax)
+{
+  comm_.message("Updating temperature");
+  timer_update_temperature.start();
+
+  compute_cell_temperature(relax);
+  send_temperature();
+
+  timer_update_temperature.stop();
+}
+
+void CoupledDriver::send_temperature()
+{
+  check_precision("temperature", cell_temperature_.data(), cell_temperature_.size());
+
+  // Step 3: On each neutron rank, volume-average the local cell T from all heat ranks
+  if (temperature_tolerance_ > 0.0) {
+    std::vector<gsl::index> changed;
+    coupling_plan_.gather_changes(cell_temperature_.data(),
+                                  temperature_tolerance_,
+                                  cell_temperature_sent_,
+                                  temperature_entries_,
+                                  changed);
+    set_neutronics_temperature(temperature_entries_, &changed);
+  } else {
+    std::vector<double> entries;
+    coupling_plan_.gather(cell_temperature_.data(), entries);
+    set_neutronics_temperature(entries);
+  }
+}
+
+void CoupledDriver::update_density(bool relax)
+{
+  comm_.message("Updating density");
+  timer_update_density.start();
+
+  compute_cell_density(relax);
+  send_density();
+
+  timer_update_density.stop();
 }
 
-bool CoupledDriver::is_converged()
+void CoupledDriver::send_density()
 {
-  bool converged;
-  double norm;
-
-  // The heat root has the global temperature data
-  norm = this->temperature_norm(norm_);
-  if (comm_.rank == heat_root_) {
-    converged = norm < epsilon_;
+  check_precision("density", cell_density_.data(), cell_density_.size());
+
+  // Step 3: On each neutron rank, volume-average the local cell rho from all heat
+  // ranks over the fluid portion of each cell
+  if (density_tolerance_ > 0.0) {
+    std::vector<gsl::index> changed;
+    coupling_plan_.gather_changes(cell_density_.data(),
+                                  density_tolerance_,
+                                  cell_density_sent_,
+                                  density_entries_,
+                                  changed);
+    set_neutronics_density(density_entries_, &changed);
+  } else {
+    std::vector<double> entries;
+    coupling_plan_.gather(cell_density_.data(), entries);
+    set_neutronics_density(entries);
   }
+}
 
-  comm_.broadcast(converged, heat_root_);
-  comm_.broadcast(norm, heat_root_);
+void CoupledDriver::check_precision(const std::string& field,
+                                    const double* values,
+                                    int count) const
+{
+  if (!verbose_ || precision_ == Precision::full)
+    return;
 
+  double error = precision_error(values, count, precision_);
+  comm_.Allreduce(MPI_IN_PLACE, &error, 1, MPI_DOUBLE, MPI_MAX);
   std::stringstream msg;
-  msg << "temperature norm: " << norm;
+  msg << "Largest relative error of the " << field << " sent with reduced precision: "
+      << std::scientific << std::setprecision(3) << error;
   comm_.message(msg.str());
-  return converged;
 }
 
-void CoupledDriver::update_heat_source(bool relax)
+void CoupledDriver::predict()
 {
-  comm_.message("Updating heat source");
-  timer_update_heat_source.start();
+  comm_.message("Predicting fields from previous timesteps");
 
-  auto& neutronics = this->get_neutronics_driver();
   auto& heat = this->get_heat_driver();
-
-  if (relax && heat.active()) {
-    std::copy(
-      cell_heat_source_.cbegin(), cell_heat_source_.cend(),
-              cell_heat_source_prev_.begin());
+  if (heat.active()) {
+    cell_heat_source_ = extrapolate(heat_source_history_);
+    cell_temperature_ = extrapolate(temperature_history_);
+    cell_density_ = extrapolate(density_history_);
   }
 
-  decltype(cell_to_glob_cell_) cells_recv;
-  decltype(cell_heat_source_) cell_heat_send;
-  xt::xtensor<double, 1> all_cell_heat;
+  timer_update_heat_source.start();
+  send_heat_source();
+  timer_update_heat_source.stop();
 
-  // For the coupling scheme, only the neutronics root needs the heat source.
-  // However, to compute the heat source, OpenmcDriver::heat_source must
-  // do a collective operation on all the ranks in the neutronics sub comm.
-  // Hence, all neutronics ranks must call OpenmcDriver::heat_source
-  if (neutronics.active()) {
-    all_cell_heat = neutronics.heat_source(power_);
+  timer_update_temperature.start();
+  send_temperature();
+  timer_update_temperature.stop();
+
+  timer_update_density.start();
+  send_density();
+  timer_update_density.stop();
+}
+
+void CoupledDriver::write_checkpoint(int timestep, int picard)
+{
+  std::string msg = "Writing checkpoint " + checkpoint_prefix_ + " to resume at " +
+                    "i_timestep = " + std::to_string(timestep) +
+                    ", i_picard = " + std::to_string(picard);
+  comm_.message(msg);
+
+  // Each heat rank writes its local cell fields
+  const auto& heat = this->get_heat_driver();
+  int ok = 1;
+  if (heat.active()) {
+    auto filename =
+      checkpoint_file(checkpoint_prefix_, checkpoint_generation_, comm_.rank);
+    std::ofstream out{filename, std::ios::binary};
+    out.write(checkpoint_magic, sizeof(checkpoint_magic));
+    write_binary(out, checkpoint_version);
+    write_binary(out, static_cast<std::uint64_t>(comm_.size));
+    write_binary(out, static_cast<std::uint64_t>(cell_to_glob_cell_.size()));
+    write_binary(out, cell_temperature_);
+    write_binary(out, cell_temperature_prev_);
+    write_binary(out, cell_density_);
+    write_binary(out, cell_density_prev_);
+    write_binary(out, cell_heat_source_);
+    write_binary(out, cell_heat_source_prev_);
+    write_binary(out, heat_source_history_);
+    write_binary(out, temperature_history_);
+    write_binary(out, density_history_);
+    out.close();
+    ok = static_cast<bool>(out);
+  }
+  comm_.Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN);
+  if (!ok) {
+    throw std::runtime_error{"Could not write checkpoint " + checkpoint_prefix_};
   }
 
-  // The neutronics root sends the cell-averaged heat sources to the heat ranks.
-  // Each heat rank gets only the heat sources for its local cells.
-  for (const auto& heat_rank : heat_ranks_) {
-    comm_.send_and_recv(cells_recv, neutronics_root_, cell_to_glob_cell_, heat_rank);
-    cell_heat_send.resize({cells_recv.size()});
-    if (comm_.rank == neutronics_root_) {
-      for (gsl::index i = 0; i < cells_recv.size(); ++i) {
-        auto j = neutronics.cell_index(cells_recv.at(i));
-        cell_heat_send.at(i) = all_cell_heat.at(j);
+  // The manifest is replaced only once every rank's file is complete, so it always
+  // names a complete set of files
+  if (comm_.rank == 0) {
+    std::string manifest = checkpoint_prefix_ + ".manifest";
+    std::ofstream out{manifest + ".tmp"};
+    out << "generation " << checkpoint_generation_ << "\n"
+        << "ranks " << comm_.size << "\n"
+        << "timestep " << timestep << "\n"
+        << "picard " << picard << "\n";
+    out.close();
+    ok = out && std::rename((manifest + ".tmp").c_str(), manifest.c_str()) == 0;
+  }
+  comm_.broadcast(ok);
+  if (!ok) {
+    throw std::runtime_error{"Could not write checkpoint " + checkpoint_prefix_};
+  }
+  checkpoint_generation_ = 1 - checkpoint_generation_;
+}
+
+bool CoupledDriver::can_checkpoint_mid_timestep() const
+{
+  return anderson_depth_ == 0 &&
+         !(particles_initial_ > 0 && particles_rule_ == ParticleRule::error) &&
+         convergence_test_ != ConvergenceTest::statistical;
+}
+
+bool CoupledDriver::read_checkpoint()
+{
+  // The root reads the manifest and shares it with every rank
+  int manifest[4] = {-1, 0, 0, 0};
+  if (comm_.rank == 0) {
+    std::ifstream in{checkpoint_prefix_ + ".manifest"};
+    std::string key;
+    if (in) {
+      in >> key >> manifest[0] >> key >> manifest[1] >> key >> manifest[2] >> key >>
+        manifest[3];
+      if (!in) {
+        manifest[0] = -2;
       }
     }
-    comm_.send_and_recv(cell_heat_source_, heat_rank, cell_heat_send, neutronics_root_);
+  }
+  comm_.Bcast(manifest, 4, MPI_INT, 0);
+  if (manifest[0] == -1) {
+    comm_.message("No checkpoint " + checkpoint_prefix_ + " found; starting from the "
+                  "initial conditions");
+    return false;
+  }
+  if (manifest[0] == -2) {
+    throw std::runtime_error{"Could not read manifest of checkpoint " +
+                             checkpoint_prefix_};
+  }
+  if (manifest[1] != comm_.size) {
+    throw std::runtime_error{"Checkpoint " + checkpoint_prefix_ + " was written by " +
+                             std::to_string(manifest[1]) + " ranks, not " +
+                             std::to_string(comm_.size)};
+  }
+  if (manifest[3] > 0 && !can_checkpoint_mid_timestep()) {
+    throw std::runtime_error{"Checkpoint " + checkpoint_prefix_ +
+                             " resumes within a timestep, which isn't possible with "
+                             "Anderson mixing, the error rule of the particle count, "
+                             "or the statistical convergence test"};
   }
 
-  // On heat rank, update the elements' heat sources based on the cell-avged heat sources
+  // Each heat rank reads its local cell fields
+  const auto& heat = this->get_heat_driver();
+  int ok = 1;
   if (heat.active()) {
-    if (relax) {
-      if (alpha_ == ROBBINS_MONRO) {
-        int n = i_picard_ + 1;
-        cell_heat_source_ = cell_heat_source_ / n + (1. - 1. / n) * cell_heat_source_prev_;
-      } else {
-        cell_heat_source_ = alpha_ * cell_heat_source_ + (1.0 - alpha_) * cell_heat_source_prev_;
-      }
-    }
-    for (gsl::index i = 0; i < cell_to_glob_cell_.size(); ++i) {
-      for (const auto& e : glob_cell_to_elem_.at(cell_to_glob_cell_.at(i))) {
-        heat.set_heat_source_at(e, cell_heat_source_.at(i));
-      }
-    }
+    std::ifstream in{checkpoint_file(checkpoint_prefix_, manifest[0], comm_.rank),
+                     std::ios::binary};
+    char magic[sizeof(checkpoint_magic)];
+    std::uint64_t version = 0;
+    std::uint64_t n_ranks = 0;
+    std::uint64_t n_cells = 0;
+    in.read(magic, sizeof(magic));
+    read_binary(in, version);
+    read_binary(in, n_ranks);
+    read_binary(in, n_cells);
+    read_binary(in, cell_temperature_);
+    read_binary(in, cell_temperature_prev_);
+    read_binary(in, cell_density_);
+    read_binary(in, cell_density_prev_);
+    read_binary(in, cell_heat_source_);
+    read_binary(in, cell_heat_source_prev_);
+    read_binary(in, heat_source_history_);
+    read_binary(in, temperature_history_);
+    read_binary(in, density_history_);
+    ok = in && std::equal(magic, magic + sizeof(magic), checkpoint_magic) &&
+         version == checkpoint_version && n_ranks == comm_.size &&
+         n_cells == cell_to_glob_cell_.size() &&
+         cell_temperature_.size() == n_cells && cell_density_.size() == n_cells &&
+         cell_heat_source_.size() == n_cells;
   }
-  timer_update_heat_source.stop();
+  comm_.Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN);
+  if (!ok) {
+    throw std::runtime_error{"Checkpoint " + checkpoint_prefix_ +
+                             " does not match the coupled problem"};
+  }
+
+  start_timestep_ = manifest[2];
+  start_picard_ = manifest[3];
+  checkpoint_generation_ = 1 - manifest[0];
+
+  std::string msg = "Restarting from checkpoint " + checkpoint_prefix_ +
+                    " at i_timestep = " + std::to_string(start_timestep_) +
+                    ", i_picard = " + std::to_string(start_picard_);
+  comm_.message(msg);
+
+  // Both drivers start from the restored fields
+  send_heat_source();
+  send_temperature();
+  send_density();
+  return true;
 }
 
-void CoupledDriver::update_temperature(bool relax)
+bool CoupledDriver::stop_requested() const
+{
+  int stop = stop_signal;
+  comm_.Allreduce(MPI_IN_PLACE, &stop, 1, MPI_INT, MPI_MAX);
+  return stop;
+}
+
+void CoupledDriver::store_history()
+{
+  if (!this->get_heat_driver().active()) {
+    return;
+  }
+
+  std::size_t n = predictor_ == Predictor::quadratic ? 3 : 2;
+  auto store = [n](std::deque<xt::xtensor<double, 1>>& history,
+                   const xt::xtensor<double, 1>& field) {
+    history.push_back(field);
+    if (history.size() > n) {
+      history.pop_front();
+    }
+  };
+  store(heat_source_history_, cell_heat_source_);
+  store(temperature_history_, cell_temperature_);
+  store(density_history_, cell_density_);
+}
+
+void CoupledDriver::update_temperature_and_density(bool relax)
 {
-  comm_.message("Updating temperature");
   timer_update_temperature.start();
+  compute_cell_temperature(relax);
+  timer_update_temperature.stop();
+  send_temperature_and_density(relax);
+}
 
-  auto& neutronics = this->get_neutronics_driver();
+void CoupledDriver::send_temperature_and_density(bool relax)
+{
+  comm_.message("Updating temperature and density");
+
+  // Sending only the changes takes several exchanges, which aren't overlapped
+  if (temperature_tolerance_ > 0.0 || density_tolerance_ > 0.0) {
+    timer_update_temperature.start();
+    send_temperature();
+    timer_update_temperature.stop();
+    update_density(relax);
+    return;
+  }
+
+  // The temperature transfer is posted first so that it is in flight while the heat
+  // ranks average the density
+  timer_update_temperature.start();
+  check_precision("temperature", cell_temperature_.data(), cell_temperature_.size());
+  std::vector<double> temperature_entries;
+  auto temperature_request =
+    coupling_plan_.igather(cell_temperature_.data(), temperature_entries);
+  timer_update_temperature.stop();
+
+  timer_update_density.start();
+  compute_cell_density(relax);
+  check_precision("density", cell_density_.data(), cell_density_.size());
+  std::vector<double> density_entries;
+  auto density_request = coupling_plan_.igather(cell_density_.data(), density_entries);
+  timer_update_density.stop();
+
+  timer_update_temperature.start();
+  coupling_plan_.finish_gather(temperature_request, temperature_entries);
+  set_neutronics_temperature(temperature_entries);
+  timer_update_temperature.stop();
+
+  timer_update_density.start();
+  coupling_plan_.finish_gather(density_request, density_entries);
+  set_neutronics_density(density_entries);
+  timer_update_density.stop();
+}
+
+void CoupledDriver::compute_cell_temperature(bool relax)
+{
   auto& heat = this->get_heat_driver();
 
   // Step 1: On each heat rank, assign the current iterate of local cell-avged T
@@ -418,22 +1588,19 @@ void CoupledDriver::update_temperature(bool relax)
 
   // Step 2: On each heat, compute cell-avged T
   if (heat.active()) {
-    auto elem_temperatures = heat.temperature();
+    heat.fill_temperature(elem_field_);
+    projection_.average(elem_field_,
+                        {cell_temperature_.data(), cell_temperature_.size()});
     for (gsl::index i = 0; i < cell_to_glob_cell_.size(); ++i) {
-      double T_avg = 0.0;
-      double V_tot = 0.0;
-      for (const auto& e : glob_cell_to_elem_.at(cell_to_glob_cell_.at(i))) {
-        double T = elem_temperatures.at(e);
-        double V = elem_volume_.at(e);
-        T_avg += T * V;
-      }
-      T_avg /= cell_volume_.at(i);
-      Ensures(T_avg > 0.0);
-      cell_temperature_.at(i) = T_avg;
+      Ensures(cell_temperature_[i] > 0.0);
     }
     // Apply relaxation to local cell-avged T
     if (relax) {
-      if (alpha_T_ == ROBBINS_MONRO) {
+      if (anderson_depth_ > 0) {
+        temperature_mixer_.mix(
+          {cell_temperature_prev_.data(), cell_temperature_prev_.size()},
+          {cell_temperature_.data(), cell_temperature_.size()});
+      } else if (alpha_T_ == ROBBINS_MONRO) {
         int n = i_picard_ + 1;
         cell_temperature_ =
           cell_temperature_ / n + (1. - 1. / n) * cell_temperature_prev_;
@@ -443,73 +1610,58 @@ void CoupledDriver::update_temperature(bool relax)
       }
     }
   }
+}
 
-  // Step 3: On each neutron rank, accumulate cell-avged volumes from all heat ranks
-  std::unordered_map<CellHandle, double> T_dot_V;
-  std::unordered_map<CellHandle, double> cell_V;
-  decltype(cell_to_glob_cell_) cells_recv;
-  decltype(cell_volume_) cell_volumes_recv;
-  decltype(cell_temperature_) cell_temperatures_recv;
-  for (const auto& heat_rank : heat_ranks_) {
-    comm_.send_and_recv(cells_recv, neutronics_root_, cell_to_glob_cell_, heat_rank);
-    neutronics.comm_.broadcast(cells_recv);
-
-    comm_.send_and_recv(
-      cell_temperatures_recv, neutronics_root_, cell_temperature_, heat_rank);
-    neutronics.comm_.broadcast(cell_temperatures_recv);
-
-    comm_.send_and_recv(cell_volumes_recv, neutronics_root_, cell_volume_, heat_rank);
-    neutronics.comm_.broadcast(cell_volumes_recv);
+void CoupledDriver::set_neutronics_temperature(const std::vector<double>& entries,
+                                               const std::vector<gsl::index>* cells)
+{
+  auto& neutronics = this->get_neutronics_driver();
 
-    if (neutronics.active()) {
-      for (gsl::index i = 0; i < cells_recv.size(); ++i) {
-        auto T = cell_temperatures_recv.at(i);
-        auto V = cell_volumes_recv.at(i);
-        cell_V[cells_recv.at(i)] += V;
-        T_dot_V[cells_recv.at(i)] += T * V;
+  if (neutronics.active()) {
+    auto T = coupling_plan_.volume_average(entries);
+    const auto& all_cells = coupling_plan_.cells();
+    if (cells) {
+      std::vector<CellHandle> handles;
+      std::vector<double> values;
+      handles.reserve(cells->size());
+      values.reserve(cells->size());
+      for (auto i : *cells) {
+        handles.push_back(all_cells[i]);
+        values.push_back(T[i]);
       }
+      neutronics.set_temperatures(handles, values);
+    } else {
+      neutronics.set_temperatures(all_cells, T);
     }
   }
-  for (const auto& kv : T_dot_V) {
-    auto cell = kv.first;
-    auto tv = kv.second;
-    neutronics.set_temperature(cell, tv / cell_V.at(cell));
-  }
-  timer_update_temperature.stop();
 }
 
-void CoupledDriver::update_density(bool relax)
+void CoupledDriver::compute_cell_density(bool relax)
 {
-  comm_.message("Updating density");
-  timer_update_density.start();
-
-  auto& neutronics = this->get_neutronics_driver();
   auto& heat = this->get_heat_driver();
 
   // Step 1: On each heat rank, assign the current iterate of local cell-avged rho
   // to the previous iterate
   if (relax && heat.active()) {
-    std::copy(cell_density_.cbegin(), cell_density_.cend(), cell_density_.begin());
+    std::copy(
+      cell_density_.cbegin(), cell_density_.cend(), cell_density_prev_.begin());
   }
 
   // Step 2: On each heat, compute cell-avged rho
   if (heat.active()) {
-    auto elem_densities = heat.density();
-
+    heat.fill_density(elem_field_);
+    projection_.average_fluid(elem_field_,
+                              {cell_density_.data(), cell_density_.size()});
     for (gsl::index i = 0; i < cell_to_glob_cell_.size(); ++i) {
-      if (cell_fluid_mask_.at(i) == 1) {
-        double rho_avg = 0.0;
-        double V_tot = 0.0;
-        for (const auto& e : glob_cell_to_elem_.at(cell_to_glob_cell_.at(i))) {
-          rho_avg += elem_densities.at(e) * elem_volume_.at(e);
-        }
-        rho_avg /= cell_volume_[i];
-        Ensures(rho_avg > 0.0);
-        cell_density_.at(i) = rho_avg;
+      if (cell_fluid_mask_[i] == 1) {
+        Ensures(cell_density_[i] > 0.0);
       }
     }
     if (relax) {
-      if (alpha_rho_ == ROBBINS_MONRO) {
+      if (anderson_depth_ > 0) {
+        density_mixer_.mix({cell_density_prev_.data(), cell_density_prev_.size()},
+                           {cell_density_.data(), cell_density_.size()});
+      } else if (alpha_rho_ == ROBBINS_MONRO) {
         int n = i_picard_ + 1;
         cell_density_ = cell_density_ / n + (1. - 1. / n) * cell_density_prev_;
       } else {
@@ -518,99 +1670,333 @@ void CoupledDriver::update_density(bool relax)
       }
     }
   }
+}
 
-  // Step 3: On each neutron rank, accumulate cell-avged volumes from all heat ranks
-  std::map<CellHandle, double> rho_dot_V;
-  std::map<CellHandle, double> cell_V;
-  decltype(cell_to_glob_cell_) cells_recv;
-  decltype(cell_volume_) cell_volumes_recv;
-  decltype(cell_density_) cell_densities_recv;
-  decltype(cell_fluid_mask_) cell_fluid_mask_recv;
+void CoupledDriver::set_neutronics_density(const std::vector<double>& entries,
+                                           const std::vector<gsl::index>* cells)
+{
+  auto& neutronics = this->get_neutronics_driver();
 
-  for (const auto& heat_rank : heat_ranks_) {
-    comm_.send_and_recv(cells_recv, neutronics_root_, cell_to_glob_cell_, heat_rank);
-    neutronics.comm_.broadcast(cells_recv);
+  if (neutronics.active()) {
+    auto rho = coupling_plan_.fluid_average(entries);
+    const auto& all_cells = coupling_plan_.cells();
+    const auto& in_fluid = coupling_plan_.cell_in_fluid();
+
+    // Only cells in the fluid get a density from the heat/fluids solver
+    std::vector<CellHandle> handles;
+    std::vector<double> values;
+    auto add = [&](gsl::index i) {
+      if (in_fluid[i] == 1) {
+        handles.push_back(all_cells[i]);
+        values.push_back(rho[i]);
+      }
+    };
+    if (cells) {
+      std::for_each(cells->cbegin(), cells->cend(), add);
+    } else {
+      for (gsl::index i = 0; i < all_cells.size(); ++i) {
+        add(i);
+      }
+    }
+    neutronics.set_densities(handles, values);
+  }
+}
 
-    comm_.send_and_recv(cell_volumes_recv, neutronics_root_, cell_volume_, heat_rank);
-    neutronics.comm_.broadcast(cell_volumes_recv);
+void CoupledDriver::init_mapping()
+{
+  comm_.message("Initializing mappings");
+  timer_init_mapping.start();
 
-    comm_.send_and_recv(
-      cell_densities_recv, neutronics_root_, cell_density_, heat_rank);
-    neutronics.comm_.broadcast(cell_densities_recv);
+  const auto& heat = this->get_heat_driver();
+  auto& neutronics = this->get_neutronics_driver();
 
-    comm_.send_and_recv(
-      cell_fluid_mask_recv, neutronics_root_, cell_fluid_mask_, heat_rank);
-    neutronics.comm_.broadcast(cell_fluid_mask_recv);
+  // Each heat rank finds the cells of its elements' centroids, or with a projection
+  // order, of quadrature points that split the elements among the cells
+  ElementQuadrature quadrature;
+  if (heat.active()) {
+    quadrature = projection_order_ > 0 ? heat.quadrature(projection_order_)
+                                       : heat.centroid_quadrature();
+  }
 
-    if (neutronics.active()) {
-      for (gsl::index i = 0; i < cells_recv.size(); ++i) {
-        if (cell_fluid_mask_recv.at(i) == 1) {
-          auto rho = cell_densities_recv.at(i);
-          auto V = cell_volumes_recv.at(i);
-          cell_V[cells_recv.at(i)] += V;
-          rho_dot_V[cells_recv.at(i)] += rho * V;
-        }
-      }
+  // Skip the search if an earlier run stored the mapping for the same mesh and
+  // geometry
+  std::size_t key = 0;
+  if (!mapping_cache_.empty()) {
+    key = mapping_key();
+    if (read_mapping_cache(key, quadrature.points.size())) {
+      comm_.message("Read mappings from " + mapping_cache_);
+      init_local_cells(quadrature);
+      timer_init_mapping.stop();
+      return;
     }
   }
 
-  for (const auto& kv : rho_dot_V) {
-    neutronics.set_density(kv.first, kv.second / cell_V.at(kv.first));
+  // The neutronics root gathers the points of all heat ranks at once, so that the
+  // search is a single collective call instead of one per heat rank.
+  // * IMPORTANT: every neutronics rank needs the full array of cells_ for
+  //   Openmc::create_tallies.  Hence, we broadcast the points to all neutronics
+  //   ranks and call neutronics.find on each of them.  NeutronicsDriver::find is
+  //   collective on the neutronics comm, so OpenmcDriver::find can split the
+  //   search among the neutronics ranks and share the cells they found.  Only the
+  //   neutronics root receives the handles of the points.
+  int n_points = quadrature.points.size();
+  std::vector<int> counts;
+  std::vector<int> displs;
+  gather_point_counts(n_points, counts, displs);
+
+  std::vector<Position> points;
+  if (comm_.rank == neutronics_root_) {
+    points.resize(displs.back() + counts.back());
   }
-  timer_update_density.stop();
+  comm_.Gatherv(quadrature.points.data(),
+                n_points,
+                get_mpi_type<Position>(),
+                points.data(),
+                counts.data(),
+                displs.data(),
+                get_mpi_type<Position>(),
+                neutronics_root_);
+  neutronics.comm_.broadcast(points);
+  std::vector<CellHandle> point_to_cell;
+  if (neutronics.comm_.active()) {
+    point_to_cell = neutronics.find(points);
+  }
+
+  // The neutronics root sends each heat rank the mapping of local point ID --> global
+  // cell handle
+  point_to_glob_cell_.resize(n_points);
+  comm_.Scatterv(point_to_cell.data(),
+                 counts.data(),
+                 displs.data(),
+                 get_mpi_type<CellHandle>(),
+                 point_to_glob_cell_.data(),
+                 n_points,
+                 get_mpi_type<CellHandle>(),
+                 neutronics_root_);
+
+  if (!mapping_cache_.empty() && comm_.rank == neutronics_root_) {
+    std::ofstream cache{mapping_cache_, std::ios::binary};
+    cache.write(mapping_cache_magic, sizeof(mapping_cache_magic));
+    write_binary(cache, mapping_cache_version);
+    write_binary(cache, static_cast<std::uint64_t>(key));
+    write_binary(cache, static_cast<std::uint64_t>(heat_ranks_.size()));
+    for (const auto& heat_rank : heat_ranks_) {
+      auto first = point_to_cell.cbegin() + displs[heat_rank];
+      write_binary(cache, std::vector<CellHandle>(first, first + counts[heat_rank]));
+    }
+
+    // Handles may depend on the order cells were found, so store their keys
+    std::vector<CellHandle> cells{point_to_cell};
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+    std::vector<std::uint64_t> cache_keys;
+    cache_keys.reserve(cells.size());
+    for (auto h : cells) {
+      cache_keys.push_back(neutronics.cell_key(h));
+    }
+    write_binary(cache, cache_keys);
+    cache.close();
+    if (!cache) {
+      comm_.message("Could not write mapping cache " + mapping_cache_, neutronics_root_);
+    }
+  }
+  init_local_cells(quadrature);
+  timer_init_mapping.stop();
 }
 
-void CoupledDriver::init_mapping()
+void CoupledDriver::init_local_cells(const ElementQuadrature& quadrature)
 {
-  comm_.message("Initializing mappings");
-  timer_init_mapping.start();
-
   const auto& heat = this->get_heat_driver();
   auto& neutronics = this->get_neutronics_driver();
 
-  // Send and recv buffers
-  std::vector<Position> centroids_send;
-  std::vector<Position> centroids_recv;
-  decltype(elem_to_glob_cell_) elem_to_cell_send;
-
-  for (const auto& heat_rank : heat_ranks_) {
-    // For the given heat rank, the neutronics root discovers the mapping of
-    // local elem ID --> global cell handle.
-    // * IMPORTANT: OpenmcDriver::find adds the cell instances it discovers to
-    //   the OpenmcDriver::cells_ array of the calling rank only.  However, every
-    //   neutronics rank needs the full array of cells_ for Openmc::create_tallies.
-    //   Hence, we broadcast the centroids to all neutronics ranks and then
-    //   call neutronics.find on each neutronics rank.
-    if (comm_.rank == heat_rank) {
-      centroids_send = heat.centroid();
-    }
-    this->comm_.send_and_recv(
-      centroids_recv, neutronics_root_, centroids_send, heat_rank);
-    neutronics.comm_.broadcast(centroids_recv);
-    if (neutronics.comm_.active()) {
-      elem_to_cell_send = neutronics.find(centroids_recv);
-    }
-
-    // The neutronics root send the mapping of local elem ID --> global cell handle
-    // back to the given heat rank.
-    this->comm_.send_and_recv(
-      elem_to_glob_cell_, heat_rank, elem_to_cell_send, neutronics_root_);
-    comm_.Barrier();
+  if (heat.active()) {
+    // The heat rank creates a sorted array of global cell handles for its local cells.
+    // This is useful in the coupling.
+    cell_to_glob_cell_ = point_to_glob_cell_;
+    std::sort(cell_to_glob_cell_.begin(), cell_to_glob_cell_.end());
+    cell_to_glob_cell_.erase(
+      std::unique(cell_to_glob_cell_.begin(), cell_to_glob_cell_.end()),
+      cell_to_glob_cell_.end());
+
+    // The heat rank builds the weights between its local elements and local cells
+    // from the local cell of each quadrature point
+    std::vector<int32_t> point_to_cell(point_to_glob_cell_.size());
+    for (gsl::index p = 0; p < point_to_glob_cell_.size(); ++p) {
+      auto it = std::lower_bound(
+        cell_to_glob_cell_.cbegin(), cell_to_glob_cell_.cend(), point_to_glob_cell_[p]);
+      point_to_cell[p] = it - cell_to_glob_cell_.cbegin();
+    }
+    projection_ = Projection{quadrature.offsets,
+                             point_to_cell,
+                             quadrature.weights,
+                             gsl::narrow<int32_t>(cell_to_glob_cell_.size())};
+#ifdef _OPENMP
+    projection_.set_num_threads(heat.num_threads);
+#endif
+  }
+  coupling_plan_ = CouplingPlan{comm_, neutronics_root_, neutronics, cell_to_glob_cell_};
+  coupling_plan_.set_precision(precision_);
+  if (hierarchical_) {
+    coupling_plan_.init_hierarchical(intranode_comm_, internode_comm_);
+    if (!coupling_plan_.hierarchical()) {
+      comm_.message("The neutronics root doesn't lead its node, so fields are "
+                    "exchanged directly with it");
+    }
+  }
+  if (heat_source_scatter_ == HeatSourceScatter::sliced) {
+    // Colocated partners may keep the sliced scatters within each node
+    if (placement_ == Placement::colocated) {
+      coupling_plan_.init_slices(heat_partners_, intranode_comm_);
+      if (coupling_plan_.slices_on_node()) {
+        comm_.message("Heat source slices are sent within each node");
+      }
+    } else {
+      coupling_plan_.init_slices(heat_partners_);
+    }
+
+    // Only when the whole heat source isn't needed on the root can the owners of the
+    // slices receive their heat sources straight from the tallies
+    slice_tally_cells_.clear();
+    if (neutronics.active() && !needs_root_heat_source()) {
+      const auto& cell_index = coupling_plan_.cell_index();
+      for (auto c : coupling_plan_.slice_order()) {
+        slice_tally_cells_.push_back(cell_index[c]);
+      }
+    }
+  }
+}
+
+void CoupledDriver::gather_point_counts(int n_points,
+                                        std::vector<int>& counts,
+                                        std::vector<int>& displs) const
+{
+  if (comm_.rank == neutronics_root_) {
+    counts.resize(comm_.size);
+    displs.resize(comm_.size);
+  }
+  comm_.Gather(&n_points, 1, MPI_INT, counts.data(), 1, MPI_INT, neutronics_root_);
+  if (comm_.rank == neutronics_root_) {
+    displs[0] = 0;
+    std::partial_sum(counts.cbegin(), counts.cend() - 1, displs.begin() + 1);
   }
+}
+
+std::size_t CoupledDriver::mapping_key() const
+{
+  const auto& heat = this->get_heat_driver();
+  const auto& neutronics = this->get_neutronics_driver();
+
+  // Each heat rank hashes its part of the mesh
+  std::size_t h = 0;
   if (heat.active()) {
-    // The heat rank sets the inverse mapping of global cell handle -> local element ID
-    // This is only for its local cells.
-    for (gsl::index e = 0; e < elem_to_glob_cell_.size(); ++e) {
-      auto c = elem_to_glob_cell_[e];
-      glob_cell_to_elem_[c].push_back(e); // Use [ ] instead of at() to insert new item
+    for (const auto& c : heat.centroid()) {
+      hash_combine(h, c.x);
+      hash_combine(h, c.y);
+      hash_combine(h, c.z);
     }
-    // The heat rank creates an array global cell handles for its local cells.
-    // This is useful in the coupling.
-    for (const auto& kv : glob_cell_to_elem_) {
-      cell_to_glob_cell_.push_back(kv.first);
+
+    // Centroid mappings stay valid for caches written before projections existed
+    if (projection_order_ > 0) {
+      hash_combine(h, projection_order_);
     }
   }
-  timer_init_mapping.stop();
+  std::vector<std::size_t> rank_hashes;
+  if (comm_.rank == neutronics_root_) {
+    rank_hashes.resize(comm_.size);
+  }
+  comm_.Gather(&h,
+               1,
+               get_mpi_type<std::size_t>(),
+               rank_hashes.data(),
+               1,
+               get_mpi_type<std::size_t>(),
+               neutronics_root_);
+
+  std::size_t key = 0;
+  if (comm_.rank == neutronics_root_) {
+    key = neutronics.geometry_hash();
+    for (const auto& heat_rank : heat_ranks_) {
+      hash_combine(key, heat_rank);
+      hash_combine(key, rank_hashes[heat_rank]);
+    }
+  }
+  return key;
+}
+
+bool CoupledDriver::read_mapping_cache(std::size_t key, int n_points)
+{
+  auto& neutronics = this->get_neutronics_driver();
+
+  // The neutronics root checks that the cache matches this run
+  std::ifstream cache;
+  int valid = 0;
+  if (comm_.rank == neutronics_root_) {
+    cache.open(mapping_cache_, std::ios::binary);
+    char magic[sizeof(mapping_cache_magic)];
+    std::uint64_t version = 0;
+    std::uint64_t cache_key = 0;
+    std::uint64_t n_heat_ranks = 0;
+    cache.read(magic, sizeof(magic));
+    read_binary(cache, version);
+    read_binary(cache, cache_key);
+    read_binary(cache, n_heat_ranks);
+    valid = cache && std::equal(magic, magic + sizeof(magic), mapping_cache_magic) &&
+            version == mapping_cache_version && cache_key == key &&
+            n_heat_ranks == heat_ranks_.size();
+  }
+  comm_.broadcast(valid, neutronics_root_);
+  if (!valid) {
+    return false;
+  }
+
+  // The neutronics root reads the mappings of all heat ranks, which must have as many
+  // points as the ranks have now
+  std::vector<int> counts;
+  std::vector<int> displs;
+  gather_point_counts(n_points, counts, displs);
+  std::vector<CellHandle> point_to_cell;
+  std::vector<std::uint64_t> keys;
+  int invalid = 0;
+  if (comm_.rank == neutronics_root_) {
+    point_to_cell.resize(displs.back() + counts.back());
+    decltype(point_to_glob_cell_) mapping;
+    for (const auto& heat_rank : heat_ranks_) {
+      read_binary(cache, mapping);
+      if (!cache || mapping.size() != static_cast<std::size_t>(counts[heat_rank])) {
+        invalid = 1;
+        break;
+      }
+      std::copy(
+        mapping.cbegin(), mapping.cend(), point_to_cell.begin() + displs[heat_rank]);
+    }
+
+    // Every neutronics rank registers the cells that find() would have discovered
+    read_binary(cache, keys);
+    invalid = invalid || !cache;
+  }
+
+  // Every rank must agree to use the cache before any of them uses it, or else all
+  // of them search for the cells
+  comm_.broadcast(invalid, neutronics_root_);
+  if (invalid) {
+    comm_.message("Mapping cache " + mapping_cache_ +
+                  " does not match the heat/fluids mesh; searching for the cells");
+    return false;
+  }
+  point_to_glob_cell_.resize(n_points);
+  comm_.Scatterv(point_to_cell.data(),
+                 counts.data(),
+                 displs.data(),
+                 get_mpi_type<CellHandle>(),
+                 point_to_glob_cell_.data(),
+                 n_points,
+                 get_mpi_type<CellHandle>(),
+                 neutronics_root_);
+  if (neutronics.comm_.active()) {
+    neutronics.comm_.broadcast(keys);
+    neutronics.restore_cells(keys);
+  }
+  return true;
 }
 
 void CoupledDriver::init_tallies()
@@ -641,22 +2027,14 @@ void CoupledDriver::init_temperature()
   }
 
   if (temperature_ic_ == Initial::neutronics) {
-    // Send and recv buffers
-    decltype(cell_to_glob_cell_) cells_recv;
-    decltype(cell_temperature_) cell_temperatures_send;
-    // The neutronics root sends cell T to each heat rank
-    for (const auto& heat_rank : heat_ranks_) {
-      comm_.send_and_recv(cells_recv, neutronics_root_, cell_to_glob_cell_, heat_rank);
-      if (comm_.rank == neutronics_root_) {
-        const auto sz = static_cast<unsigned long>(cells_recv.size());
-        cell_temperatures_send.resize({sz});
-        for (gsl::index i = 0; i < sz; ++i) {
-          cell_temperatures_send.at(i) = neutronics.get_temperature(cells_recv.at(i));
-        }
+    // The neutronics root scatters cell T to the heat ranks
+    std::vector<double> cell_temperatures_send;
+    if (comm_.rank == neutronics_root_) {
+      for (const auto& c : coupling_plan_.cells()) {
+        cell_temperatures_send.push_back(neutronics.get_temperature(c));
       }
-      comm_.send_and_recv(
-        cell_temperature_, heat_rank, cell_temperatures_send, neutronics_root_);
     }
+    coupling_plan_.scatter(cell_temperatures_send, cell_temperature_.data());
   } else if (temperature_ic_ == Initial::heat) {
     //  We do not want to apply underrelaxation here since, at this point, there is no
     //  previous iterate of temperature.
@@ -680,15 +2058,12 @@ void CoupledDriver::init_volume()
   const auto& neutronics = this->get_neutronics_driver();
 
   if (heat.active()) {
-    elem_volume_ = heat.volume();
-    for (const auto& c : cell_to_glob_cell_) {
-      double V = 0.0;
-      for (const auto& e : glob_cell_to_elem_.at(c)) {
-        V += elem_volume_.at(e);
-      }
-      cell_volume_.push_back(V);
-    }
+    auto elem_volume = heat.volume();
+    elem_field_.resize(elem_volume.size());
+    projection_.set_volumes(elem_volume);
+    cell_volume_ = projection_.cell_volumes();
   }
+  coupling_plan_.set_volumes(cell_volume_);
   timer_init_volume.stop();
 
   check_volumes();
@@ -699,22 +2074,9 @@ void CoupledDriver::check_volumes()
   comm_.message("Volume check");
   const auto& neutronics = this->get_neutronics_driver();
 
-  // An array of global cell volumes, which will be accumulated from local cell volumes.
-  std::map<CellHandle, double> glob_volumes;
-
-  // Get all local cell volumes from heat ranks and sum them into the global cell volumes.
-  for (const auto& heat_rank : heat_ranks_) {
-    decltype(cell_to_glob_cell_) cells_recv;
-    decltype(cell_volume_) cell_volumes_recv;
-    comm_.send_and_recv(cells_recv, neutronics_root_, cell_to_glob_cell_, heat_rank);
-    comm_.send_and_recv(cell_volumes_recv, neutronics_root_, cell_volume_, heat_rank);
-    if (comm_.rank == neutronics_root_) {
-      for (gsl::index i = 0; i < cells_recv.size(); ++i) {
-        glob_volumes[cells_recv.at(i)] += cell_volumes_recv.at(i);
-      }
-    }
-  }
-  comm_.Barrier();
+  // Global cell volumes accumulated from the local cell volumes of all heat ranks
+  const auto& cells = coupling_plan_.cells();
+  const auto& glob_volumes = coupling_plan_.cell_volumes();
 
   if (comm_.rank == neutronics_root_) {
     double v_rel_diff_min = std::numeric_limits<double>::max();
@@ -723,9 +2085,9 @@ void CoupledDriver::check_volumes()
     double v_rel_diff_count = 0;
 
     // Compare volume from neutron driver to accumulated volume
-    for (const auto& kv : glob_volumes) {
-      auto cell = kv.first;
-      auto v_accum = kv.second;
+    for (gsl::index i = 0; i < cells.size(); ++i) {
+      auto cell = cells[i];
+      auto v_accum = glob_volumes[i];
       auto v_neutronics = neutronics.get_volume(cell);
 
       // In neutronics model, volume = 1.0 is a dummy value
@@ -772,25 +2134,20 @@ void CoupledDriver::init_density()
 
   if (heat.active()) {
     auto sz = static_cast<unsigned long>(cell_to_glob_cell_.size());
-    cell_density_.resize({sz});
-    cell_density_prev_.resize({sz});
+    // Solid cells never receive a density from the heat/fluids driver, but their
+    // entries still take part in the relaxation, so they must hold a defined value
+    cell_density_ = xt::zeros<double>({sz});
+    cell_density_prev_ = xt::zeros<double>({sz});
   }
 
   if (density_ic_ == Initial::neutronics) {
-    decltype(cell_to_glob_cell_) cells_recv;
-    decltype(cell_density_) cell_densities_send;
-    for (const auto& heat_rank : heat_ranks_) {
-      comm_.send_and_recv(cells_recv, neutronics_root_, cell_to_glob_cell_, heat_rank);
-      if (comm_.rank == neutronics_root_) {
-        const auto sz = static_cast<unsigned long>(cells_recv.size());
-        cell_densities_send.resize({sz});
-        for (gsl::index i = 0; i < sz; ++i) {
-          cell_densities_send.at(i) = neutronics.get_density(cells_recv.at(i));
-        }
+    std::vector<double> cell_densities_send;
+    if (comm_.rank == neutronics_root_) {
+      for (const auto& c : coupling_plan_.cells()) {
+        cell_densities_send.push_back(neutronics.get_density(c));
       }
-      comm_.send_and_recv(
-        cell_density_, heat_rank, cell_densities_send, neutronics_root_);
     }
+    coupling_plan_.scatter(cell_densities_send, cell_density_.data());
   } else if (density_ic_ == Initial::heat) {
     // * We do not want to apply underrelaxation here (and at this point,
     //   there is no previous iterate of density, anyway).
@@ -812,19 +2169,18 @@ void CoupledDriver::init_fluid_mask()
   auto& heat = this->get_heat_driver();
 
   if (heat.active()) {
-    auto elem_fluid_mask = heat.fluid_mask();
-    for (const auto& kv : glob_cell_to_elem_) {
-
-      auto& elems = kv.second;
-      auto in_fluid = elem_fluid_mask.at(elems.at(0));
-      for (gsl::index i = 1; i < elems.size(); ++i) {
-        if (in_fluid != elem_fluid_mask.at(elems.at(i))) {
-          throw std::runtime_error("ENRICO detected a neutronics cell contains both "
-                                   "fluid and solid T/H elements.");
-        }
-      }
-      cell_fluid_mask_.push_back(in_fluid);
+    // With a projection, a cell that overlaps both fluid and solid elements takes the
+    // phase of most of its volume, and its density is averaged over the fluid part
+    projection_.set_fluid_mask(heat.fluid_mask());
+    if (projection_order_ == 0 && projection_.n_mixed_cells() > 0) {
+      throw std::runtime_error("ENRICO detected a neutronics cell contains both "
+                               "fluid and solid T/H elements.");
     }
+    cell_fluid_mask_ = projection_.cell_fluid_mask();
+  }
+  coupling_plan_.set_fluid_mask(cell_fluid_mask_);
+  if (shared_memory_) {
+    coupling_plan_.init_shared();
   }
   timer_init_fluid_mask.stop();
 }
@@ -876,36 +2232,91 @@ void CoupledDriver::comm_report()
   }
 }
 
-void CoupledDriver::timer_report()
+void CoupledDriver::record_memory()
+{
+  if (release_buffers_) {
+    coupling_plan_.release_buffers();
+  }
+
+  // Fields of the coupling layer itself, on either driver's ranks
+  std::size_t fields = 0;
+  for (const auto* f : {&cell_temperature_,
+                        &cell_temperature_prev_,
+                        &cell_density_,
+                        &cell_density_prev_,
+                        &cell_heat_source_,
+                        &cell_heat_source_prev_,
+                        &heat_source_raw_,
+                        &heat_source_raw_prev_,
+                        &heat_source_error_,
+                        &heat_source_error_prev_}) {
+    fields += memory_bytes(*f);
+  }
+  for (const auto* f : {&elem_field_,
+                        &cell_temperature_sent_,
+                        &cell_density_sent_,
+                        &temperature_entries_,
+                        &density_entries_}) {
+    fields += memory_bytes(*f);
+  }
+  for (const auto* f :
+       {&heat_source_history_, &temperature_history_, &density_history_}) {
+    fields += memory_bytes(*f);
+  }
+
+  // The mapping between elements and cells
+  std::size_t mapping =
+    memory_bytes(cell_fluid_mask_) + memory_bytes(point_to_glob_cell_) +
+    memory_bytes(cell_to_glob_cell_) + projection_.memory_usage() +
+    memory_bytes(slice_tally_cells_);
+
+  memory_.record("coupling_plan", coupling_plan_.memory_usage());
+  memory_.record("coupled_fields", fields);
+  memory_.record("mapping", mapping);
+  memory_.record("neutronics_driver", this->get_neutronics_driver().memory_usage());
+  memory_.record("heat_fluids_driver", this->get_heat_driver().memory_usage());
+}
+
+void CoupledDriver::memory_report() const
 {
+  memory_.report(comm_);
+}
 
+void CoupledDriver::timer_report()
+{
   auto& heat = this->get_heat_driver();
   auto& neut = this->get_neutronics_driver();
 
   std::vector<TimeAmt> coup_times{
-    {"init_comms", timer_init_comms.elapsed()},
-    {"init_fluid_mask", timer_init_fluid_mask.elapsed()},
-    {"init_density", timer_init_density.elapsed()},
-    {"init_heat_source", timer_init_heat_source.elapsed()},
-    {"init_mapping", timer_init_mapping.elapsed()},
-    {"init_tallies", timer_init_tallies.elapsed()},
-    {"init_temperature", timer_init_temperature.elapsed()},
-    {"init_volume", timer_init_volume.elapsed()},
-    {"update_density", timer_update_density.elapsed()},
-    {"update_heat_source", timer_update_heat_source.elapsed()},
-    {"update_temperature", timer_update_temperature.elapsed()}};
-
-  std::vector<TimeAmt> heat_times{{"driver_setup", heat.timer_driver_setup.elapsed()},
-                                  {"init_step", heat.timer_init_step.elapsed()},
-                                  {"solve_step", heat.timer_solve_step.elapsed()},
-                                  {"write_step", heat.timer_write_step.elapsed()},
-                                  {"finalize_step", heat.timer_finalize_step.elapsed()}};
-
-  std::vector<TimeAmt> neut_times{{"driver_setup", neut.timer_driver_setup.elapsed()},
-                                  {"init_step", neut.timer_init_step.elapsed()},
-                                  {"solve_step", neut.timer_solve_step.elapsed()},
-                                  {"write_step", neut.timer_write_step.elapsed()},
-                                  {"finalize_step", neut.timer_finalize_step.elapsed()}};
+    {"init_comms", timer_init_comms},
+    {"init_fluid_mask", timer_init_fluid_mask},
+    {"init_density", timer_init_density},
+    {"init_heat_source", timer_init_heat_source},
+    {"init_mapping", timer_init_mapping},
+    {"init_tallies", timer_init_tallies},
+    {"init_temperature", timer_init_temperature},
+    {"init_volume", timer_init_volume},
+    {"update_density", timer_update_density},
+    {"update_heat_source", timer_update_heat_source},
+    {"update_temperature", timer_update_temperature}};
+
+  std::vector<TimeAmt> heat_times{{"driver_setup", heat.timer_driver_setup},
+                                  {"init_step", heat.timer_init_step},
+                                  {"solve_step", heat.timer_solve_step},
+                                  {"write_step", heat.timer_write_step},
+                                  {"finalize_step", heat.timer_finalize_step}};
+
+  std::vector<TimeAmt> neut_times{{"driver_setup", neut.timer_driver_setup},
+                                  {"init_step", neut.timer_init_step},
+                                  {"solve_step", neut.timer_solve_step},
+                                  {"write_step", neut.timer_write_step},
+                                  {"finalize_step", neut.timer_finalize_step}};
+
+  // Report the spread of times across the coupling communicator. Ranks that aren't
+  // in a timer's communicator don't contribute to its statistics.
+  TimeAmt::reduce(coup_times, comm_);
+  TimeAmt::reduce(heat_times, comm_);
+  TimeAmt::reduce(neut_times, comm_);
 
   auto tot_time = TimeAmt::sum_times(coup_times) + TimeAmt::sum_times(heat_times) +
                   TimeAmt::sum_times(neut_times);
@@ -915,7 +2326,8 @@ void CoupledDriver::timer_report()
   std::for_each(neut_times.begin(), neut_times.end(), nrm);
 
   std::stringstream msg;
-  msg << "Cumulative times at i_timestep = " << i_timestep_ << " , i_picard = " << i_picard_;
+  msg << "Cumulative times at i_timestep = " << i_timestep_
+      << " , i_picard = " << i_picard_;
   comm_.message(msg.str());
 
   TimeAmt::print_times("CoupledDriver", coup_times, comm_);
@@ -926,6 +2338,19 @@ void CoupledDriver::timer_report()
                  TimeAmt::sum_percent(neut_times);
   std::vector<TimeAmt> total_time{{"total", tot_time, tot_pct}};
   TimeAmt::print_times("Total", total_time, comm_);
+
+  // The faster driver idles for this fraction of the slower one's solve when they
+  // solve at the same time, and the split between them could be rebalanced
+  double t_neut = neut_times[2].time;
+  double t_heat = heat_times[2].time;
+  double t_max = std::max(t_neut, t_heat);
+  if (t_max > 0.0) {
+    std::stringstream imbalance;
+    imbalance << "Driver imbalance (solve_step): neutronics " << t_neut
+              << " s, heat/fluids " << t_heat << " s, idle fraction "
+              << 1.0 - std::min(t_neut, t_heat) / t_max;
+    comm_.message(imbalance.str());
+  }
 }
 
 } // namespace enrico
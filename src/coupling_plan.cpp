@@ -0,0 +1,500 @@
+#include "enrico/coupling_plan.h"
+
+#include "enrico/memory.h"
+
+#include <algorithm> // for fill_n, sort, unique, lower_bound
+#include <numeric>   // for partial_sum
+#include <utility>   // for move
+
+namespace enrico {
+
+CouplingPlan::CouplingPlan(const Comm& comm,
+                           int neutronics_root,
+                           const NeutronicsDriver& neutronics,
+                           const std::vector<CellHandle>& local_cells)
+  : comm_(comm)
+  , neutronics_comm_(neutronics.comm_)
+  , neutronics_root_(neutronics_root)
+  , n_local_(local_cells.size())
+{
+  // The neutronics root learns how many local cells each rank in comm_ has.  Ranks
+  // without heat/fluids data contribute zero cells.
+  if (comm_.rank == neutronics_root_) {
+    counts_.resize(comm_.size);
+    displs_.resize(comm_.size);
+  }
+  comm_.Gather(&n_local_, 1, MPI_INT, counts_.data(), 1, MPI_INT, neutronics_root_);
+
+  if (comm_.rank == neutronics_root_) {
+    displs_[0] = 0;
+    std::partial_sum(counts_.cbegin(), counts_.cend() - 1, displs_.begin() + 1);
+    n_entries_ = displs_.back() + counts_.back();
+  }
+  neutronics_comm_.broadcast(n_entries_);
+
+  // Gather the local cells one time only; later exchanges only move field values
+  std::vector<CellHandle> entry_cells;
+  gather(local_cells.data(), entry_cells);
+
+  if (neutronics_comm_.active()) {
+    cells_ = entry_cells;
+    std::sort(cells_.begin(), cells_.end());
+    cells_.erase(std::unique(cells_.begin(), cells_.end()), cells_.end());
+
+    entry_to_cell_.resize(n_entries_);
+    for (gsl::index i = 0; i < n_entries_; ++i) {
+      auto it = std::lower_bound(cells_.cbegin(), cells_.cend(), entry_cells[i]);
+      entry_to_cell_[i] = it - cells_.cbegin();
+    }
+
+    cell_index_.reserve(cells_.size());
+    for (const auto& c : cells_) {
+      cell_index_.push_back(neutronics.cell_index(c));
+    }
+  }
+}
+
+void CouplingPlan::set_volumes(const std::vector<double>& local_volumes)
+{
+  Expects(local_volumes.size() == n_local_);
+
+  std::vector<double> entry_volumes;
+  gather(local_volumes.data(), entry_volumes);
+
+  if (neutronics_comm_.active()) {
+    cell_volumes_.assign(cells_.size(), 0.0);
+    for (gsl::index i = 0; i < n_entries_; ++i) {
+      cell_volumes_[entry_to_cell_[i]] += entry_volumes[i];
+    }
+
+    volume_weights_.resize(n_entries_);
+    for (gsl::index i = 0; i < n_entries_; ++i) {
+      volume_weights_[i] = entry_volumes[i] / cell_volumes_[entry_to_cell_[i]];
+    }
+  }
+}
+
+void compute_fluid_weights(gsl::span<const gsl::index> entry_to_cell,
+                           gsl::span<const double> volume_weights,
+                           gsl::span<const int> entry_mask,
+                           gsl::span<int> cell_in_fluid,
+                           gsl::span<double> fluid_weights)
+{
+  Expects(volume_weights.size() == entry_to_cell.size());
+  Expects(entry_mask.size() == entry_to_cell.size());
+  Expects(fluid_weights.size() == entry_to_cell.size());
+
+  // Fraction of the volume of each cell that is in fluid entries
+  std::vector<double> fluid_fraction(cell_in_fluid.size(), 0.0);
+  for (gsl::index i = 0; i < entry_to_cell.size(); ++i) {
+    if (entry_mask[i] == 1) {
+      fluid_fraction[entry_to_cell[i]] += volume_weights[i];
+    }
+  }
+
+  for (gsl::index c = 0; c < cell_in_fluid.size(); ++c) {
+    cell_in_fluid[c] = fluid_fraction[c] > 0.5 ? 1 : 0;
+  }
+
+  for (gsl::index i = 0; i < entry_to_cell.size(); ++i) {
+    auto c = entry_to_cell[i];
+    fluid_weights[i] = cell_in_fluid[c] == 1 && entry_mask[i] == 1
+                         ? volume_weights[i] / fluid_fraction[c]
+                         : 0.0;
+  }
+}
+
+void CouplingPlan::set_fluid_mask(const std::vector<int>& local_fluid_mask)
+{
+  Expects(local_fluid_mask.size() == n_local_);
+
+  std::vector<int> entry_mask;
+  gather(local_fluid_mask.data(), entry_mask);
+
+  if (neutronics_comm_.active()) {
+    Expects(volume_weights_.size() == n_entries_);
+
+    cell_in_fluid_.resize(cells_.size());
+    fluid_weights_.resize(n_entries_);
+    compute_fluid_weights(
+      entry_to_cell_, volume_weights_, entry_mask, cell_in_fluid_, fluid_weights_);
+  }
+}
+
+void CouplingPlan::init_slices(const std::vector<int>& partners,
+                               const Comm& intranode_comm)
+{
+  slice_send_counts_.assign(comm_.size, 0);
+  std::vector<int> send_local;
+
+  if (neutronics_comm_.active()) {
+    // Every neutronics rank needs to know which entries belong to which rank
+    std::vector<int> counts(comm_.size);
+    std::vector<int> displs(comm_.size);
+    if (comm_.rank == neutronics_root_) {
+      counts = counts_;
+      displs = displs_;
+    }
+    neutronics_comm_.Bcast(counts.data(), comm_.size, MPI_INT);
+    neutronics_comm_.Bcast(displs.data(), comm_.size, MPI_INT);
+
+    // Determine which neutronics rank owns each unique cell
+    int n_cells = cells_.size();
+    int n_slices = neutronics_comm_.size;
+    std::vector<int> owner(n_cells, -1);
+    if (partners.empty()) {
+      // Split the unique cells into contiguous slices of nearly equal size
+      for (int r = 0, c = 0; r < n_slices; ++r) {
+        int n = n_cells / n_slices + (r < n_cells % n_slices ? 1 : 0);
+        std::fill_n(owner.begin() + c, n, r);
+        c += n;
+      }
+    } else {
+      // Each cell goes to the partner of the first rank that refers to it, so a rank's
+      // values mostly come from its partner
+      Expects(partners.size() == comm_.size);
+      for (int r = 0; r < comm_.size; ++r) {
+        for (int i = 0; i < counts[r]; ++i) {
+          auto c = entry_to_cell_[displs[r] + i];
+          if (owner[c] < 0) {
+            Expects(partners[r] >= 0 && partners[r] < n_slices);
+            owner[c] = partners[r];
+          }
+        }
+      }
+    }
+
+    // Group the unique cells by owner so that each slice is contiguous
+    slice_counts_.assign(n_slices, 0);
+    for (auto r : owner) {
+      ++slice_counts_[r];
+    }
+    slice_displs_.resize(n_slices);
+    slice_displs_[0] = 0;
+    std::partial_sum(
+      slice_counts_.cbegin(), slice_counts_.cend() - 1, slice_displs_.begin() + 1);
+    slice_begin_ = slice_displs_[neutronics_comm_.rank];
+    slice_size_ = slice_counts_[neutronics_comm_.rank];
+
+    slice_order_.resize(n_cells);
+    std::vector<gsl::index> slice_position(n_cells);
+    std::vector<int> next(slice_displs_);
+    for (gsl::index c = 0; c < n_cells; ++c) {
+      auto k = next[owner[c]]++;
+      slice_order_[k] = c;
+      slice_position[c] = k - slice_displs_[owner[c]];
+    }
+
+    // Find the entries of each rank that refer to owned cells. Entries are visited in
+    // order, so the values for each rank are sent in the order of its local cells.
+    int me = neutronics_comm_.rank;
+    for (int r = 0; r < comm_.size; ++r) {
+      for (int i = 0; i < counts[r]; ++i) {
+        auto c = entry_to_cell_[displs[r] + i];
+        if (owner[c] == me) {
+          slice_send_cells_.push_back(slice_position[c]);
+          send_local.push_back(i);
+          ++slice_send_counts_[r];
+        }
+      }
+    }
+  }
+
+  slice_send_displs_.resize(comm_.size);
+  slice_send_displs_[0] = 0;
+  std::partial_sum(slice_send_counts_.cbegin(),
+                   slice_send_counts_.cend() - 1,
+                   slice_send_displs_.begin() + 1);
+
+  // Each rank learns how many values it receives from each owner and which local
+  // cells they belong to.  Every entry refers to exactly one owned cell, so each local
+  // cell receives exactly one value.
+  slice_recv_counts_.resize(comm_.size);
+  comm_.Alltoall(
+    slice_send_counts_.data(), 1, MPI_INT, slice_recv_counts_.data(), 1, MPI_INT);
+
+  slice_recv_displs_.resize(comm_.size);
+  slice_recv_displs_[0] = 0;
+  std::partial_sum(slice_recv_counts_.cbegin(),
+                   slice_recv_counts_.cend() - 1,
+                   slice_recv_displs_.begin() + 1);
+  Expects(slice_recv_displs_.back() + slice_recv_counts_.back() == n_local_);
+
+  slice_recv_local_.resize(n_local_);
+  comm_.Alltoallv(send_local.data(),
+                  slice_send_counts_.data(),
+                  slice_send_displs_.data(),
+                  MPI_INT,
+                  slice_recv_local_.data(),
+                  slice_recv_counts_.data(),
+                  slice_recv_displs_.data(),
+                  MPI_INT);
+
+  // If no rank exchanges values with another node, the scatters only need the ranks
+  // of each node, so that MPI can move them through shared memory without involving
+  // every rank of comm_
+  slice_comm_ = comm_;
+  if (intranode_comm.active()) {
+    std::vector<int> node_ranks(intranode_comm.size);
+    intranode_comm.Allgather(&comm_.rank, 1, MPI_INT, node_ranks.data(), 1, MPI_INT);
+    std::vector<int> on_node(comm_.size, 0);
+    for (auto r : node_ranks) {
+      on_node[r] = 1;
+    }
+    int off_node = 0;
+    for (int r = 0; r < comm_.size; ++r) {
+      if (!on_node[r] && (slice_send_counts_[r] > 0 || slice_recv_counts_[r] > 0)) {
+        off_node = 1;
+      }
+    }
+    comm_.Allreduce(MPI_IN_PLACE, &off_node, 1, MPI_INT, MPI_LOR);
+
+    if (!off_node) {
+      // The values keep their places in the buffers, which are ordered by rank in comm_
+      auto to_node = [&node_ranks](std::vector<int>& v) {
+        std::vector<int> node_v(node_ranks.size());
+        for (gsl::index i = 0; i < node_ranks.size(); ++i) {
+          node_v[i] = v[node_ranks[i]];
+        }
+        v = std::move(node_v);
+      };
+      to_node(slice_send_counts_);
+      to_node(slice_send_displs_);
+      to_node(slice_recv_counts_);
+      to_node(slice_recv_displs_);
+      slice_comm_ = intranode_comm;
+    }
+  }
+
+  sliced_ = true;
+}
+
+Request CouplingPlan::igather_direct(const double* local,
+                                     std::vector<double>& entries,
+                                     std::true_type) const
+{
+  if (precision_ != Precision::full) {
+    comm_.Gatherv(local,
+                  n_local_,
+                  entries.data(),
+                  counts_.data(),
+                  displs_.data(),
+                  precision_,
+                  neutronics_root_);
+    return {};
+  }
+  return igather_direct(local, entries, std::false_type{});
+}
+
+void CouplingPlan::init_node_comms()
+{
+  if (!neutronics_comm_.active() || node_comm_.active()) {
+    return;
+  }
+
+  MPI_Comm node;
+  MPI_Comm_split_type(neutronics_comm_.comm,
+                      MPI_COMM_TYPE_SHARED,
+                      neutronics_comm_.rank,
+                      MPI_INFO_NULL,
+                      &node);
+  node_comm_ = Comm(node);
+
+  // The first rank of each node receives the entries for it.  Since ranks are kept
+  // in order, the neutronics root leads its node.
+  MPI_Comm leaders;
+  int color = node_comm_.is_root() ? 0 : MPI_UNDEFINED;
+  MPI_Comm_split(neutronics_comm_.comm, color, neutronics_comm_.rank, &leaders);
+  leader_comm_ = Comm(leaders);
+}
+
+void CouplingPlan::init_shared()
+{
+  init_node_comms();
+  if (neutronics_comm_.active()) {
+    // The neutronics ranks of each node share one copy of the averages
+    shared_volume_averages_ = SharedArray<double>(node_comm_, cells_.size());
+    shared_fluid_averages_ = SharedArray<double>(node_comm_, cells_.size());
+
+    // Only the leaders average the entries
+    if (!leader_comm_.active()) {
+      std::vector<gsl::index>().swap(entry_to_cell_);
+      std::vector<double>().swap(volume_weights_);
+      std::vector<double>().swap(fluid_weights_);
+    }
+  }
+  shared_ = true;
+}
+
+void CouplingPlan::init_hierarchical(const Comm& intranode_comm,
+                                     const Comm& internode_comm)
+{
+  // The leaders' messages are collected where the entries are assembled
+  int root = internode_comm.active() ? internode_comm.rank : -1;
+  comm_.Bcast(&root, 1, MPI_INT, neutronics_root_);
+  if (root < 0) {
+    return;
+  }
+  intranode_comm_ = intranode_comm;
+  internode_comm_ = internode_comm;
+  internode_root_ = root;
+
+  // Each leader learns the local cell counts and ranks of its node
+  std::vector<int> node_ranks;
+  if (intranode_comm_.is_root()) {
+    intranode_counts_.resize(intranode_comm_.size);
+    intranode_displs_.resize(intranode_comm_.size);
+    node_ranks.resize(intranode_comm_.size);
+  }
+  intranode_comm_.Gather(
+    &n_local_, 1, MPI_INT, intranode_counts_.data(), 1, MPI_INT);
+  intranode_comm_.Gather(&comm_.rank, 1, MPI_INT, node_ranks.data(), 1, MPI_INT);
+  if (intranode_comm_.is_root()) {
+    intranode_displs_[0] = 0;
+    std::partial_sum(intranode_counts_.cbegin(),
+                     intranode_counts_.cend() - 1,
+                     intranode_displs_.begin() + 1);
+    n_node_local_ = intranode_displs_.back() + intranode_counts_.back();
+  }
+
+  // The neutronics root learns the same for every node
+  if (internode_comm_.active()) {
+    bool is_root = comm_.rank == neutronics_root_;
+    int n_node_ranks = node_ranks.size();
+    std::vector<int> node_sizes(is_root ? internode_comm_.size : 0);
+    std::vector<int> rank_displs(node_sizes.size());
+    internode_counts_.resize(node_sizes.size());
+    internode_displs_.resize(node_sizes.size());
+    internode_comm_.Gather(
+      &n_node_ranks, 1, MPI_INT, node_sizes.data(), 1, MPI_INT, internode_root_);
+    internode_comm_.Gather(&n_node_local_,
+                           1,
+                           MPI_INT,
+                           internode_counts_.data(),
+                           1,
+                           MPI_INT,
+                           internode_root_);
+    if (is_root) {
+      rank_displs[0] = 0;
+      std::partial_sum(
+        node_sizes.cbegin(), node_sizes.cend() - 1, rank_displs.begin() + 1);
+      arrival_ranks_.resize(comm_.size);
+      internode_displs_[0] = 0;
+      std::partial_sum(internode_counts_.cbegin(),
+                       internode_counts_.cend() - 1,
+                       internode_displs_.begin() + 1);
+    }
+    internode_comm_.Gatherv(node_ranks.data(),
+                            n_node_ranks,
+                            MPI_INT,
+                            arrival_ranks_.data(),
+                            node_sizes.data(),
+                            rank_displs.data(),
+                            MPI_INT,
+                            internode_root_);
+  }
+
+  init_node_comms();
+  hierarchical_ = true;
+}
+
+std::size_t CouplingPlan::memory_usage() const
+{
+  std::size_t bytes = 0;
+  for (const auto* v : {&counts_,
+                        &displs_,
+                        &slice_counts_,
+                        &slice_displs_,
+                        &slice_send_counts_,
+                        &slice_send_displs_,
+                        &slice_recv_counts_,
+                        &slice_recv_displs_,
+                        &slice_recv_local_,
+                        &cell_in_fluid_,
+                        &intranode_counts_,
+                        &intranode_displs_,
+                        &internode_counts_,
+                        &internode_displs_,
+                        &arrival_ranks_}) {
+    bytes += memory_bytes(*v);
+  }
+  for (const auto* v :
+       {&entry_to_cell_, &cell_index_, &slice_order_, &slice_send_cells_}) {
+    bytes += memory_bytes(*v);
+  }
+  for (const auto* v : {&cell_volumes_, &volume_weights_, &fluid_weights_}) {
+    bytes += memory_bytes(*v);
+  }
+  bytes += memory_bytes(cells_) + memory_bytes(volume_averages_) +
+           memory_bytes(fluid_averages_);
+  if (node_comm_.is_root()) {
+    bytes += (shared_volume_averages_.size() + shared_fluid_averages_.size()) *
+             sizeof(double);
+  }
+  return bytes;
+}
+
+void CouplingPlan::release_buffers()
+{
+  std::vector<double>().swap(volume_averages_);
+  std::vector<double>().swap(fluid_averages_);
+}
+
+gsl::span<const double> CouplingPlan::volume_average(const double* local) const
+{
+  std::vector<double> entries;
+  gather(local, entries);
+  return volume_average(entries);
+}
+
+gsl::span<const double> CouplingPlan::volume_average(
+  const std::vector<double>& entries) const
+{
+  return reduce(entries, volume_weights_, volume_averages_, shared_volume_averages_);
+}
+
+gsl::span<const double> CouplingPlan::fluid_average(const double* local) const
+{
+  std::vector<double> entries;
+  gather(local, entries);
+  return fluid_average(entries);
+}
+
+gsl::span<const double> CouplingPlan::fluid_average(
+  const std::vector<double>& entries) const
+{
+  return reduce(entries, fluid_weights_, fluid_averages_, shared_fluid_averages_);
+}
+
+gsl::span<const double> CouplingPlan::reduce(const std::vector<double>& entries,
+                                             const std::vector<double>& weights,
+                                             std::vector<double>& values,
+                                             SharedArray<double>& shared) const
+{
+  if (!neutronics_comm_.active()) {
+    return {};
+  }
+
+  if (!shared_) {
+    values.assign(cells_.size(), 0.0);
+    for (gsl::index i = 0; i < n_entries_; ++i) {
+      values[entry_to_cell_[i]] += weights[i] * entries[i];
+    }
+    return values;
+  }
+
+  // The leader may only overwrite the averages once every rank of the node is done
+  // reading the previous ones
+  shared.fence();
+  if (leader_comm_.active()) {
+    double* sums = shared.data();
+    std::fill_n(sums, cells_.size(), 0.0);
+    for (gsl::index i = 0; i < n_entries_; ++i) {
+      sums[entry_to_cell_[i]] += weights[i] * entries[i];
+    }
+  }
+  shared.fence();
+  return {shared.data(), shared.size()};
+}
+
+} // namespace enrico
@@ -1,16 +1,69 @@
 #include "enrico/heat_fluids_driver.h"
 
+#include "enrico/error.h"
+
 #include <gsl/gsl>
 #include <pugixml.hpp>
 #include <xtensor/xadapt.hpp>
 
+#include <algorithm> // for copy
+#include <iomanip>   // for setprecision
+#include <numeric>   // for iota
+#include <sstream>
+
 namespace enrico {
 
 HeatFluidsDriver::HeatFluidsDriver(MPI_Comm comm, pugi::xml_node node)
-  : Driver(comm)
+  : Driver(comm, "heat_fluids")
 {
   pressure_bc_ = node.child("pressure_bc").text().as_double();
   Expects(pressure_bc_ > 0.0);
+
+  water_ = WaterProperties{node.child("properties"), pressure_bc_};
+  if (water_.tabulated()) {
+    std::stringstream msg;
+    msg << "Tabulated water properties, max relative error " << std::scientific
+        << std::setprecision(2) << water_.max_error();
+    comm_.message(msg.str());
+  }
+}
+
+void HeatFluidsDriver::fill_temperature(gsl::span<double> values) const
+{
+  Expects(values.size() == n_local_elem());
+  auto T = temperature();
+  std::copy(T.cbegin(), T.cend(), values.begin());
+}
+
+void HeatFluidsDriver::fill_density(gsl::span<double> values) const
+{
+  Expects(values.size() == n_local_elem());
+  auto rho = density();
+  std::copy(rho.cbegin(), rho.cend(), values.begin());
+}
+
+ElementQuadrature HeatFluidsDriver::quadrature(int order) const
+{
+  Expects(order > 0);
+  return centroid_quadrature();
+}
+
+ElementQuadrature HeatFluidsDriver::centroid_quadrature() const
+{
+  ElementQuadrature q;
+  q.points = centroid();
+  q.weights.assign(q.points.size(), 1.0);
+  q.offsets.resize(q.points.size() + 1);
+  std::iota(q.offsets.begin(), q.offsets.end(), 0);
+  return q;
+}
+
+void HeatFluidsDriver::set_heat_source(gsl::span<const double> heat)
+{
+  Expects(heat.size() == n_local_elem());
+  for (int32_t e = 0; e < heat.size(); ++e) {
+    err_chk(set_heat_source_at(e, heat[e]), "Error setting heat source");
+  }
 }
 
 }
@@ -13,7 +13,7 @@ int main(int argc, char* argv[])
   enrico::init_mpi_datatypes();
 
   // Define enums for selecting drivers
-  enum class Transport { OpenMC, Shift, Surrogate };
+  enum class Transport { OpenMC, Shift, Surrogate, Mock };
 
   // Parse enrico.xml file
   pugi::xml_document doc;
@@ -35,6 +35,8 @@ int main(int argc, char* argv[])
     driver_transport = Transport::Shift;
   } else if (neut_driver == "surrogate") {
     driver_transport = Transport::Surrogate;
+  } else if (neut_driver == "mock") {
+    driver_transport = Transport::Mock;
   } else {
     throw std::runtime_error{"Invalid value for <neutronics><driver>"};
   }
@@ -42,7 +44,8 @@ int main(int argc, char* argv[])
   // Create driver according to selections
   switch (driver_transport) {
   case Transport::OpenMC:
-  case Transport::Shift: {
+  case Transport::Shift:
+  case Transport::Mock: {
     enrico::CoupledDriver driver{MPI_COMM_WORLD, root};
     driver.execute();
   } break;
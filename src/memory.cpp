@@ -0,0 +1,80 @@
+#include "enrico/memory.h"
+
+#include <algorithm> // for max
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <sys/resource.h> // for getrusage
+#include <unistd.h>       // for sysconf
+
+namespace enrico {
+
+std::size_t resident_bytes()
+{
+  // The second field of statm is the number of resident pages
+  std::ifstream statm{"/proc/self/statm"};
+  std::size_t size;
+  std::size_t resident;
+  if (!(statm >> size >> resident)) {
+    return 0;
+  }
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+std::size_t peak_resident_bytes()
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  // Linux reports kilobytes
+  return usage.ru_maxrss * 1024;
+#endif
+}
+
+void MemoryUsage::record(const std::string& name, std::size_t bytes)
+{
+  for (auto& e : entries_) {
+    if (e.name == name) {
+      e.current = bytes;
+      e.peak = std::max(e.peak, bytes);
+      return;
+    }
+  }
+  entries_.push_back({name, bytes, bytes});
+}
+
+void MemoryUsage::report(const Comm& comm) const
+{
+  auto entries = entries_;
+  entries.push_back({"process (resident)", resident_bytes(), peak_resident_bytes()});
+
+  // The largest and summed bytes of all entries each come from one reduction
+  int n = entries.size();
+  std::vector<double> send(2 * n);
+  for (int i = 0; i < n; ++i) {
+    send[i] = entries[i].current;
+    send[n + i] = entries[i].peak;
+  }
+  std::vector<double> max_recv(2 * n);
+  std::vector<double> sum_recv(2 * n);
+  comm.Reduce(send.data(), max_recv.data(), 2 * n, MPI_DOUBLE, MPI_MAX);
+  comm.Reduce(send.data(), sum_recv.data(), 2 * n, MPI_DOUBLE, MPI_SUM);
+
+  const double MiB = 1024.0 * 1024.0;
+  comm.message("  Memory (MiB, current max/mean and peak max/mean over ranks)");
+  for (int i = 0; i < n; ++i) {
+    std::stringstream msg;
+    msg << "    " << std::setw(22) << std::left << entries[i].name << std::right
+        << std::fixed << std::setprecision(2) << std::setw(12) << max_recv[i] / MiB
+        << std::setw(12) << sum_recv[i] / MiB / comm.size << std::setw(12)
+        << max_recv[n + i] / MiB << std::setw(12) << sum_recv[n + i] / MiB / comm.size;
+    comm.message(msg.str());
+  }
+}
+
+} // namespace enrico
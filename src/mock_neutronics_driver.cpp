@@ -0,0 +1,172 @@
+#include "enrico/mock_neutronics_driver.h"
+
+#include "enrico/hash.h"
+#include "enrico/memory.h"
+
+#include <cmath> // for floor
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace enrico {
+
+namespace {
+
+// Temperature and density of a cell before the coupled driver sets them
+constexpr double initial_temperature = 293.6; // [K]
+constexpr double initial_density = 1.0;       // [g/cm^3]
+
+template<typename T>
+std::array<T, 3> read_triplet(pugi::xml_node node, const char* name)
+{
+  std::array<T, 3> values;
+  std::istringstream in{node.child_value(name)};
+  if (!(in >> values[0] >> values[1] >> values[2])) {
+    throw std::runtime_error{"Invalid value for <neutronics><" + std::string{name} + ">"};
+  }
+  return values;
+}
+
+} // namespace
+
+MockNeutronicsDriver::MockNeutronicsDriver(MPI_Comm comm, pugi::xml_node node)
+  : NeutronicsDriver(comm)
+{
+  if (!active())
+    return;
+
+  timer_driver_setup.start();
+  auto ll = read_triplet<double>(node, "lower_left");
+  auto ur = read_triplet<double>(node, "upper_right");
+  dimension_ = read_triplet<int>(node, "dimension");
+  lower_left_ = {ll[0], ll[1], ll[2]};
+  upper_right_ = {ur[0], ur[1], ur[2]};
+  for (int i = 0; i < 3; ++i) {
+    Expects(ur[i] > ll[i]);
+    Expects(dimension_[i] > 0);
+  }
+  timer_driver_setup.stop();
+}
+
+std::vector<CellHandle> MockNeutronicsDriver::find(const std::vector<Position>& positions)
+{
+  double ll[3] = {lower_left_.x, lower_left_.y, lower_left_.z};
+  double ur[3] = {upper_right_.x, upper_right_.y, upper_right_.z};
+
+  std::vector<CellHandle> handles;
+  handles.reserve(positions.size());
+  for (const auto& p : positions) {
+    double r[3] = {p.x, p.y, p.z};
+    CellHandle h = 0;
+    for (int i = 2; i >= 0; --i) {
+      int ijk = std::floor((r[i] - ll[i]) / (ur[i] - ll[i]) * dimension_[i]);
+      if (ijk < 0 || ijk >= dimension_[i]) {
+        throw std::runtime_error{"Position is outside of the mock neutronics mesh"};
+      }
+      h = h * dimension_[i] + ijk;
+    }
+    handles.push_back(h);
+    add_cell(h);
+  }
+  return handles;
+}
+
+void MockNeutronicsDriver::set_density(CellHandle cell, double rho) const
+{
+  densities_.at(cell_index(cell)) = rho;
+}
+
+void MockNeutronicsDriver::set_temperature(CellHandle cell, double T) const
+{
+  temperatures_.at(cell_index(cell)) = T;
+}
+
+double MockNeutronicsDriver::get_density(CellHandle cell) const
+{
+  return densities_.at(cell_index(cell));
+}
+
+double MockNeutronicsDriver::get_temperature(CellHandle cell) const
+{
+  return temperatures_.at(cell_index(cell));
+}
+
+double MockNeutronicsDriver::get_volume(CellHandle cell) const
+{
+  return (upper_right_.x - lower_left_.x) / dimension_[0] *
+         (upper_right_.y - lower_left_.y) / dimension_[1] *
+         (upper_right_.z - lower_left_.z) / dimension_[2];
+}
+
+xt::xtensor<double, 1> MockNeutronicsDriver::heat_source(double power) const
+{
+  // Every cell has the same volume
+  double total_volume = 0.0;
+  for (const auto& c : cells_) {
+    total_volume += get_volume(c);
+  }
+  return xt::xtensor<double, 1>({cells_.size()}, power / total_volume);
+}
+
+std::string MockNeutronicsDriver::cell_label(CellHandle cell) const
+{
+  auto ijk = mesh_index(cell);
+  std::stringstream label;
+  label << "mesh box (" << ijk[0] << ", " << ijk[1] << ", " << ijk[2] << ")";
+  return label.str();
+}
+
+gsl::index MockNeutronicsDriver::cell_index(CellHandle cell) const
+{
+  return cell_index_.at(cell);
+}
+
+std::size_t MockNeutronicsDriver::geometry_hash() const
+{
+  std::size_t seed = 0;
+  hash_combine(seed, lower_left_.x);
+  hash_combine(seed, lower_left_.y);
+  hash_combine(seed, lower_left_.z);
+  hash_combine(seed, upper_right_.x);
+  hash_combine(seed, upper_right_.y);
+  hash_combine(seed, upper_right_.z);
+  for (int n : dimension_) {
+    hash_combine(seed, n);
+  }
+  return seed;
+}
+
+std::size_t MockNeutronicsDriver::memory_usage() const
+{
+  return memory_bytes(cells_) + memory_bytes(cell_index_) + memory_bytes(temperatures_) +
+         memory_bytes(densities_);
+}
+
+void MockNeutronicsDriver::restore_cells(const std::vector<std::uint64_t>& keys)
+{
+  for (auto h : keys) {
+    add_cell(h);
+  }
+}
+
+void MockNeutronicsDriver::add_cell(CellHandle cell)
+{
+  if (cell_index_.find(cell) == cell_index_.end()) {
+    cell_index_.emplace(cell, cells_.size());
+    cells_.push_back(cell);
+    temperatures_.push_back(initial_temperature);
+    densities_.push_back(initial_density);
+  }
+}
+
+std::array<int, 3> MockNeutronicsDriver::mesh_index(CellHandle cell) const
+{
+  std::array<int, 3> ijk;
+  for (int i = 0; i < 3; ++i) {
+    ijk[i] = cell % dimension_[i];
+    cell /= dimension_[i];
+  }
+  return ijk;
+}
+
+} // namespace enrico
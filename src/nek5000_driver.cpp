@@ -2,7 +2,6 @@
 
 #include "enrico/error.h"
 #include "gsl/gsl"
-#include "iapws/iapws.h"
 #include "nek5000/core/nek_interface.h"
 #include "xtensor/xadapt.hpp"
 
@@ -46,7 +45,6 @@ Nek5000Driver::Nek5000Driver(MPI_Comm comm, pugi::xml_node node)
       std::runtime_error(msg.str());
     }
   }
-  MPI_Barrier(MPI_COMM_WORLD);
   timer_driver_setup.stop();
 }
 
@@ -63,13 +61,18 @@ void Nek5000Driver::init_session_name()
 
 std::vector<double> Nek5000Driver::temperature() const
 {
-  // Each Nek proc finds the temperatures of its local elements
   std::vector<double> local_elem_temperatures(nelt_);
+  fill_temperature(local_elem_temperatures);
+  return local_elem_temperatures;
+}
+
+void Nek5000Driver::fill_temperature(gsl::span<double> values) const
+{
+  // Each Nek proc finds the temperatures of its local elements
+  Expects(values.size() == nelt_);
   for (int32_t i = 0; i < nelt_; ++i) {
-    local_elem_temperatures[i] = this->temperature_at(i);
+    values[i] = this->temperature_at(i);
   }
-
-  return local_elem_temperatures;
 }
 
 std::vector<int> Nek5000Driver::fluid_mask() const
@@ -84,18 +87,22 @@ std::vector<int> Nek5000Driver::fluid_mask() const
 std::vector<double> Nek5000Driver::density() const
 {
   std::vector<double> local_densities(nelt_);
+  fill_density(local_densities);
+  return local_densities;
+}
 
+void Nek5000Driver::fill_density(gsl::span<double> values) const
+{
+  Expects(values.size() == nelt_);
   for (int32_t i = 0; i < nelt_; ++i) {
     if (this->in_fluid_at(i) == 1) {
       auto T = this->temperature_at(i);
       // nu1 returns specific volume in [m^3/kg]
-      local_densities[i] = 1.0e-3 / iapws::nu1(pressure_bc_, T);
+      values[i] = 1.0e-3 / water_.nu1(pressure_bc_, T);
     } else {
-      local_densities[i] = 0.0;
+      values[i] = 0.0;
     }
   }
-
-  return local_densities;
 }
 
 void Nek5000Driver::solve_step()
@@ -1,6 +1,5 @@
 #include "enrico/nekrs_driver.h"
 #include "enrico/error.h"
-#include "iapws/iapws.h"
 #include "io.hpp"
 #include "nekrs.hpp"
 
@@ -10,9 +9,146 @@
 #include "nekrs_home.h"
 
 #include <algorithm>
+#include <cmath> // for abs, lround, pow
 #include <dlfcn.h>
+#include <limits> // for numeric_limits
+#include <type_traits> // for integral_constant, is_same
 
 namespace enrico {
+
+// The driver reads the NekRS mesh and fields, and writes the UDF's localq, through
+// double pointers
+static_assert(std::is_same<dfloat, double>::value,
+              "ENRICO requires NekRS to be built with dfloat as double");
+
+namespace {
+
+// OKL kernels for device-resident coupling.  p_Np, p_blockSize, dfloat, and dlong are
+// set as defines when the kernels are built.  The NekRS fields, including the UDF's
+// o_localq, are dfloat, while the element fields exchanged with ENRICO are double.
+const std::string device_coupling_kernels = R"(
+@kernel void elementAverage(const dlong Nelements,
+                            @restrict const dfloat* rhoCp,
+                            @restrict const dfloat* S,
+                            @restrict double* avg)
+{
+  for (dlong e = 0; e < Nelements; ++e; @tile(p_blockSize, @outer, @inner)) {
+    double sum0 = 0.0;
+    double sum1 = 0.0;
+    for (int n = 0; n < p_Np; ++n) {
+      const dlong id = e * p_Np + n;
+      sum0 += rhoCp[id] * S[id];
+      sum1 += rhoCp[id];
+    }
+    avg[e] = sum0 / sum1;
+  }
+}
+
+@kernel void expandElementField(const dlong Nelements,
+                                @restrict const double* elemField,
+                                @restrict dfloat* field)
+{
+  for (dlong id = 0; id < Nelements * p_Np; ++id; @tile(p_blockSize, @outer, @inner)) {
+    field[id] = elemField[id / p_Np];
+  }
+}
+)";
+
+// Host-side element reductions.  When NP > 0, the number of GLL points per element is
+// a compile-time constant so that the inner loops can be fully unrolled and
+// vectorized; NP == 0 falls back to the runtime value np.
+
+//! For each element e, avg[e] = sum(w * f) / sum(w) over the element's GLL points
+template<int NP>
+void weighted_average(gsl::index n_elem,
+                      int np,
+                      const double* w,
+                      const double* f,
+                      double* avg)
+{
+  const int n = NP > 0 ? NP : np;
+  for (gsl::index e = 0; e < n_elem; ++e) {
+    const double* we = w + e * n;
+    const double* fe = f + e * n;
+    double sum0 = 0.0;
+    double sum1 = 0.0;
+#pragma omp simd reduction(+ : sum0, sum1)
+    for (int i = 0; i < n; ++i) {
+      sum0 += we[i] * fe[i];
+      sum1 += we[i];
+    }
+    avg[e] = sum0 / sum1;
+  }
+}
+
+//! For each element e, the mass-weighted centroid of its GLL points
+template<int NP>
+void element_centroids(gsl::index n_elem,
+                       int np,
+                       const double* mass,
+                       const double* inv_volume,
+                       const double* x,
+                       const double* y,
+                       const double* z,
+                       Position* c)
+{
+  const int n = NP > 0 ? NP : np;
+  for (gsl::index e = 0; e < n_elem; ++e) {
+    const gsl::index offset = e * n;
+    double cx = 0.0;
+    double cy = 0.0;
+    double cz = 0.0;
+#pragma omp simd reduction(+ : cx, cy, cz)
+    for (int i = 0; i < n; ++i) {
+      const double m = mass[offset + i];
+      cx += x[offset + i] * m;
+      cy += y[offset + i] * m;
+      cz += z[offset + i] * m;
+    }
+    c[e] = {cx * inv_volume[e], cy * inv_volume[e], cz * inv_volume[e]};
+  }
+}
+
+//! Calls f with the number of GLL points as a compile-time constant for polynomial
+//! orders 1 through 9, or with 0 for any other order
+template<typename F>
+void dispatch_n_gll(int n_gll, F&& f)
+{
+  switch (n_gll) {
+  case 8:
+    f(std::integral_constant<int, 8>{});
+    break;
+  case 27:
+    f(std::integral_constant<int, 27>{});
+    break;
+  case 64:
+    f(std::integral_constant<int, 64>{});
+    break;
+  case 125:
+    f(std::integral_constant<int, 125>{});
+    break;
+  case 216:
+    f(std::integral_constant<int, 216>{});
+    break;
+  case 343:
+    f(std::integral_constant<int, 343>{});
+    break;
+  case 512:
+    f(std::integral_constant<int, 512>{});
+    break;
+  case 729:
+    f(std::integral_constant<int, 729>{});
+    break;
+  case 1000:
+    f(std::integral_constant<int, 1000>{});
+    break;
+  default:
+    f(std::integral_constant<int, 0>{});
+  }
+}
+
+} // namespace
+
 NekRSDriver::NekRSDriver(MPI_Comm comm, pugi::xml_node node)
   : HeatFluidsDriver(comm, node)
 {
@@ -28,6 +164,39 @@ NekRSDriver::NekRSDriver(MPI_Comm comm, pugi::xml_node node)
     if (node.child("output_heat_source")) {
       output_heat_source_ = node.child("output_heat_source").text().as_bool();
     }
+    if (node.child("device_coupling")) {
+      device_coupling_ = node.child("device_coupling").text().as_bool();
+    }
+    if (auto warm = node.child("warm_start")) {
+      warm_steps_ = warm.child("steps").text().as_int();
+      if (warm_steps_ <= 0) {
+        throw std::runtime_error{"Invalid value for <warm_start><steps>"};
+      }
+      if (warm.child("step_factor")) {
+        warm_step_factor_ = warm.child("step_factor").text().as_double();
+        if (warm_step_factor_ <= 0.0 || warm_step_factor_ > 1.0) {
+          throw std::runtime_error{"Invalid value for <warm_start><step_factor>"};
+        }
+      }
+      if (warm.child("min_steps")) {
+        warm_min_steps_ = warm.child("min_steps").text().as_int();
+        if (warm_min_steps_ <= 0) {
+          throw std::runtime_error{"Invalid value for <warm_start><min_steps>"};
+        }
+      }
+      if (warm.child("tolerance")) {
+        warm_tolerance_ = warm.child("tolerance").text().as_double();
+        if (warm_tolerance_ < 0.0) {
+          throw std::runtime_error{"Invalid value for <warm_start><tolerance>"};
+        }
+      }
+      if (warm.child("check_interval")) {
+        warm_check_interval_ = warm.child("check_interval").text().as_int();
+        if (warm_check_interval_ <= 0) {
+          throw std::runtime_error{"Invalid value for <warm_start><check_interval>"};
+        }
+      }
+    }
 
     host_.setup("mode: 'Serial'");
 
@@ -80,6 +249,22 @@ NekRSDriver::NekRSDriver(MPI_Comm comm, pugi::xml_node node)
         mass_matrix_[e * n_gll_ + n] = vgeo[e * n_gll_ * n_vgeo + JWID * n_gll_ + n];
       }
     }
+
+    // The mass matrix is constant, so element volumes are computed only once
+    elem_volume_.resize(n_local_elem_);
+    elem_inv_volume_.resize(n_local_elem_);
+    for (gsl::index e = 0; e < n_local_elem_; ++e) {
+      double v = 0.0;
+      for (gsl::index n = 0; n < n_gll_; ++n) {
+        v += mass_matrix_[e * n_gll_ + n];
+      }
+      elem_volume_[e] = v;
+      elem_inv_volume_[e] = 1.0 / v;
+    }
+
+    if (device_coupling_) {
+      init_device_coupling();
+    }
   }
 
 #ifdef _OPENMP
@@ -91,6 +276,12 @@ NekRSDriver::NekRSDriver(MPI_Comm comm, pugi::xml_node node)
   timer_driver_setup.stop();
 }
 
+void NekRSDriver::init_timestep()
+{
+  // The heat source of a new timestep may differ as much as in the first iteration
+  n_warm_solves_ = 0;
+}
+
 void NekRSDriver::init_step()
 {
   timer_init_step.start();
@@ -101,7 +292,15 @@ void NekRSDriver::init_step()
 
 void NekRSDriver::solve_step()
 {
+  // The first solve establishes the flow, and later ones only follow the changes in
+  // the heat source
+  if (warm_steps_ > 0 && n_solves_ > 0) {
+    solve_warm_step();
+    return;
+  }
+
   timer_solve_step.start();
+  ++n_solves_;
   const int runtime_stat_freq = 500;
   auto elapsed_time = MPI_Wtime();
   tstep_ = 0;
@@ -141,18 +340,92 @@ void NekRSDriver::solve_step()
   }
 
   // TODO:  Do we need this in v20.0 of nekRS?
-  nekrs::copyToNek(time_, tstep_);
+  // With device coupling, the coupling fields are reduced on the device instead
+  if (!device_coupling_) {
+    nekrs::copyToNek(time_, tstep_);
+  }
+  timer_solve_step.stop();
+}
+
+void NekRSDriver::solve_warm_step()
+{
+  timer_solve_step.start();
+
+  // Continue from the current time and step rather than restarting from startTime
+  double n = warm_steps_ * std::pow(warm_step_factor_, n_warm_solves_);
+  int n_steps = std::max(warm_min_steps_, static_cast<int>(std::lround(n)));
+  ++n_warm_solves_;
+  ++n_solves_;
+
+  std::stringstream msg;
+  msg << "timestepping for " << n_steps << " steps from time " << time_ << " ...";
+  comm_.message(msg.str());
+
+  std::vector<double> previous;
+  if (warm_tolerance_ > 0.0) {
+    temperature_plateaued(previous);
+  }
+
+  for (int i = 1; i <= n_steps; ++i) {
+    if (comm_.active())
+      comm_.Barrier();
+    ++tstep_;
+    double dt = nekrs::dt();
+    nekrs::runStep(time_, dt, tstep_);
+    time_ += dt;
+
+    nekrs::udfExecuteStep(time_, tstep_, 0);
+
+    if (warm_tolerance_ > 0.0 && i % warm_check_interval_ == 0 && i < n_steps &&
+        temperature_plateaued(previous)) {
+      std::stringstream done;
+      done << "temperature plateaued after " << i << " steps";
+      comm_.message(done.str());
+      break;
+    }
+  }
+  nekrs::printRuntimeStatistics();
+
+  if (!device_coupling_) {
+    nekrs::copyToNek(time_, tstep_);
+  }
   timer_solve_step.stop();
 }
 
+bool NekRSDriver::temperature_plateaued(std::vector<double>& previous)
+{
+  if (!device_coupling_) {
+    nekrs::copyToNek(time_, tstep_);
+  }
+  std::vector<double> current(n_local_elem());
+  fill_temperature(current);
+
+  // Largest change and largest temperature over all ranks
+  double max[2] = {0.0, 0.0};
+  bool first = previous.size() != current.size();
+  for (gsl::index i = 0; i < current.size(); ++i) {
+    if (!first) {
+      max[0] = std::max(max[0], std::abs(current[i] - previous[i]));
+    }
+    max[1] = std::max(max[1], std::abs(current[i]));
+  }
+  MPI_Allreduce(MPI_IN_PLACE, max, 2, MPI_DOUBLE, MPI_MAX, comm_.comm);
+  previous = std::move(current);
+
+  return !first && max[0] <= warm_tolerance_ * max[1];
+}
+
 void NekRSDriver::write_step(int timestep, int iteration)
 {
   timer_write_step.start();
   nekrs::outfld(time_);
   if (output_heat_source_) {
     comm_.message("Writing heat source to .fld file");
+    if (device_coupling_ && o_localq_) {
+      o_localq_->copyTo(localq_->data(), localq_->size() * sizeof(dfloat));
+    }
     occa::memory o_localq =
-      occa::cpu::wrapMemory(host_, localq_->data(), localq_->size() * sizeof(double));
+      occa::cpu::wrapMemory(host_, localq_->data(), localq_->size() * sizeof(dfloat));
     writeFld("qsc", time_, 1, 0, &nrs_ptr_->o_U, &nrs_ptr_->o_P, &o_localq, 1);
   }
   timer_write_step.stop();
@@ -161,89 +434,152 @@ void NekRSDriver::write_step(int timestep, int iteration)
 Position NekRSDriver::centroid_at(int32_t local_elem) const
 {
   Expects(local_elem < n_local_elem());
-  Position c{0., 0., 0.};
-  double mass = 0.;
-  for (gsl::index i = 0; i < n_gll_; ++i) {
-    auto idx = local_elem * n_gll_ + i;
-    c.x += x_[idx] * mass_matrix_[idx];
-    c.y += y_[idx] * mass_matrix_[idx];
-    c.z += z_[idx] * mass_matrix_[idx];
-    mass += mass_matrix_[idx];
-  }
-  c.x /= mass;
-  c.y /= mass;
-  c.z /= mass;
+  auto offset = local_elem * n_gll_;
+  Position c;
+  element_centroids<0>(1,
+                       n_gll_,
+                       &mass_matrix_[offset],
+                       &elem_inv_volume_[local_elem],
+                       x_ + offset,
+                       y_ + offset,
+                       z_ + offset,
+                       &c);
   return c;
 }
 
 std::vector<Position> NekRSDriver::centroid() const
 {
   std::vector<Position> c(n_local_elem());
-  for (int32_t i = 0; i < n_local_elem(); ++i) {
-    c[i] = this->centroid_at(i);
-  }
+  dispatch_n_gll(n_gll_, [&](auto np) {
+    element_centroids<decltype(np)::value>(n_local_elem_,
+                                           n_gll_,
+                                           mass_matrix_.data(),
+                                           elem_inv_volume_.data(),
+                                           x_,
+                                           y_,
+                                           z_,
+                                           c.data());
+  });
   return c;
 }
 
+ElementQuadrature NekRSDriver::quadrature(int order) const
+{
+  // Along each direction, the GLL points are split into order contiguous blocks, and
+  // each block of the element is lumped into one point at its mass-weighted centroid
+  // with the block's total mass, so the volume of the element is conserved.  An
+  // order of at least poly_deg_ + 1 gives the GLL points themselves.
+  Expects(order > 0);
+  int n1 = poly_deg_ + 1;
+  int m = std::min(order, n1);
+  int n_block = m * m * m;
+  Expects(n_local_elem_ <= std::numeric_limits<int32_t>::max() / n_block);
+
+  // Block of each GLL index along a direction
+  std::vector<int> block(n1);
+  for (int i = 0; i < n1; ++i) {
+    block[i] = i * m / n1;
+  }
+
+  ElementQuadrature q;
+  q.offsets.resize(n_local_elem_ + 1);
+  for (gsl::index e = 0; e <= n_local_elem_; ++e) {
+    q.offsets[e] = e * n_block;
+  }
+  q.points.reserve(n_local_elem_ * n_block);
+  q.weights.assign(n_local_elem_ * n_block, 0.0);
+
+  std::vector<double> x(n_block);
+  std::vector<double> y(n_block);
+  std::vector<double> z(n_block);
+  for (gsl::index e = 0; e < n_local_elem_; ++e) {
+    auto* w = q.weights.data() + e * n_block;
+    std::fill(x.begin(), x.end(), 0.0);
+    std::fill(y.begin(), y.end(), 0.0);
+    std::fill(z.begin(), z.end(), 0.0);
+    for (int k = 0; k < n1; ++k) {
+      for (int j = 0; j < n1; ++j) {
+        for (int i = 0; i < n1; ++i) {
+          auto g = e * n_gll_ + i + n1 * (j + n1 * k);
+          auto b = block[i] + m * (block[j] + m * block[k]);
+          w[b] += mass_matrix_[g];
+          x[b] += mass_matrix_[g] * x_[g];
+          y[b] += mass_matrix_[g] * y_[g];
+          z[b] += mass_matrix_[g] * z_[g];
+        }
+      }
+    }
+    for (int b = 0; b < n_block; ++b) {
+      q.points.emplace_back(x[b] / w[b], y[b] / w[b], z[b] / w[b]);
+    }
+  }
+  return q;
+}
+
 double NekRSDriver::volume_at(int32_t local_elem) const
 {
   Expects(local_elem < n_local_elem());
-  double v = 0.;
-  for (int32_t i = 0; i < n_gll_; ++i) {
-    v += mass_matrix_[local_elem * n_gll_ + i];
-  }
-  return v;
+  return elem_volume_[local_elem];
 }
 
 std::vector<double> NekRSDriver::volume() const
 {
-  std::vector<double> v(n_local_elem());
-  for (int32_t i = 0; i < n_local_elem(); ++i) {
-    v[i] = this->volume_at(i);
-  }
-  return v;
+  return elem_volume_;
 }
 
 double NekRSDriver::temperature_at(int32_t local_elem) const
 {
   Expects(local_elem < n_local_elem());
-
-  double sum0 = 0.;
-  double sum1 = 0.;
-  for (int32_t i = 0; i < n_gll_; ++i) {
-    auto idx = local_elem * n_gll_ + i;
-    sum0 += rho_cp_[idx] * temperature_[idx];
-    sum1 += rho_cp_[idx];
-  }
-  return sum0 / sum1;
+  auto offset = local_elem * n_gll_;
+  double t;
+  weighted_average<0>(1, n_gll_, rho_cp_ + offset, temperature_ + offset, &t);
+  return t;
 }
 
 std::vector<double> NekRSDriver::temperature() const
 {
   std::vector<double> t(n_local_elem());
-  for (int32_t i = 0; i < n_local_elem(); ++i) {
-    t[i] = this->temperature_at(i);
-  }
-
+  fill_temperature(t);
   return t;
 }
 
 std::vector<double> NekRSDriver::density() const
 {
-  nekrs::copyToNek(time_, tstep_);
   std::vector<double> local_densities(n_local_elem());
+  fill_density(local_densities);
+  return local_densities;
+}
+
+void NekRSDriver::fill_temperature(gsl::span<double> values) const
+{
+  Expects(values.size() == n_local_elem());
+  if (device_coupling_) {
+    device_temperature(values);
+    return;
+  }
 
+  dispatch_n_gll(n_gll_, [&](auto np) {
+    weighted_average<decltype(np)::value>(
+      n_local_elem_, n_gll_, rho_cp_, temperature_, values.data());
+  });
+}
+
+void NekRSDriver::fill_density(gsl::span<double> values) const
+{
+  if (!device_coupling_) {
+    nekrs::copyToNek(time_, tstep_);
+  }
+
+  // Convert the element temperatures to densities in place
+  fill_temperature(values);
   for (int32_t i = 0; i < n_local_elem(); ++i) {
     if (this->in_fluid_at(i) == 1) {
-      auto T = this->temperature_at(i);
       // nu1 returns specific volume in [m^3/kg]
-      local_densities[i] = 1.0e-3 / iapws::nu1(pressure_bc_, T);
+      values[i] = 1.0e-3 / water_.nu1(pressure_bc_, values[i]);
     } else {
-      local_densities[i] = 0.0;
+      values[i] = 0.0;
     }
   }
-
-  return local_densities;
 }
 
 int NekRSDriver::in_fluid_at(int32_t local_elem) const
@@ -270,6 +606,26 @@ int NekRSDriver::set_heat_source_at(int32_t local_elem, double heat)
   return 0;
 }
 
+void NekRSDriver::set_heat_source(gsl::span<const double> heat)
+{
+  Expects(heat.size() == n_local_elem());
+  Expects(localq_->size() >= n_local_elem_ * n_gll_);
+
+  // Upload only one value per element and expand it on the device
+  if (device_coupling_ && o_localq_) {
+    o_elem_heat_source_.copyFrom(heat.data(), n_local_elem_ * sizeof(double));
+    expand_element_kernel_(
+      static_cast<dlong>(n_local_elem_), o_elem_heat_source_, *o_localq_);
+    return;
+  }
+
+  // Every GLL point in an element gets the element's heat source
+  auto q = localq_->data();
+  for (gsl::index e = 0; e < n_local_elem_; ++e) {
+    std::fill_n(q + e * n_gll_, n_gll_, heat[e]);
+  }
+}
+
 void NekRSDriver::open_lib_udf()
 {
   lib_udf_handle_ = dlopen(lib_udf_name_.c_str(), RTLD_LAZY);
@@ -282,7 +638,57 @@ void NekRSDriver::open_lib_udf()
   if (dlerror()) {
     throw std::runtime_error("dlsym error for localq in " + lib_udf_name_);
   }
-  localq_ = reinterpret_cast<std::vector<double>*>(localq_void);
+  localq_ = reinterpret_cast<std::vector<dfloat>*>(localq_void);
+
+  // A device copy of the heat source is optional.  It is only used with device
+  // coupling.
+  dlerror();
+  void* o_localq_void = dlsym(lib_udf_handle_, "o_localq");
+  if (!dlerror()) {
+    o_localq_ = reinterpret_cast<occa::memory*>(o_localq_void);
+  }
+}
+
+void NekRSDriver::init_device_coupling()
+{
+  comm_.message("Building NekRS device coupling kernels");
+  auto& device = nrs_ptr_->cds->mesh->device;
+
+  // The kernels access NekRS's fields with the types NekRS was built with.  dfloat is
+  // double, as checked above.
+  occa::properties props;
+  props["defines/p_Np"] = n_gll_;
+  props["defines/p_blockSize"] = 256;
+  props["defines/dfloat"] = "double";
+  props["defines/dlong"] = sizeof(dlong) == sizeof(int) ? "int" : "long long int";
+
+  element_average_kernel_ =
+    device.buildKernelFromString(device_coupling_kernels, "elementAverage", props);
+  expand_element_kernel_ =
+    device.buildKernelFromString(device_coupling_kernels, "expandElementField", props);
+
+  o_elem_temperature_ = device.malloc(n_local_elem_ * sizeof(double));
+  o_elem_heat_source_ = device.malloc(n_local_elem_ * sizeof(double));
+
+  if (o_localq_) {
+    // The UDF copies o_localq into a dfloat field
+    if (o_localq_->size() != localq_->size() * sizeof(dfloat)) {
+      *o_localq_ = device.malloc(localq_->size() * sizeof(dfloat), localq_->data());
+    }
+  } else {
+    comm_.message("UDF does not define o_localq; heat source will be set on the host");
+  }
+}
+
+void NekRSDriver::device_temperature(gsl::span<double> values) const
+{
+  auto cds = nrs_ptr_->cds;
+  auto o_rho_cp = cds->o_prop.slice(cds->fieldOffset * sizeof(dfloat));
+  element_average_kernel_(
+    static_cast<dlong>(n_local_elem_), o_rho_cp, cds->o_S, o_elem_temperature_);
+
+  // Only one value per element crosses from the device to the host
+  o_elem_temperature_.copyTo(values.data(), n_local_elem_ * sizeof(double));
 }
 
 void NekRSDriver::close_lib_udf()
@@ -0,0 +1,144 @@
+#include "enrico/neutronics_ensemble.h"
+
+#include <xtensor/xbuilder.hpp> // for zeros
+
+#include <cmath> // for sqrt
+
+namespace enrico {
+
+NeutronicsEnsemble::NeutronicsEnsemble(MPI_Comm comm,
+                                       int n_members,
+                                       const Factory& make_member)
+  : NeutronicsDriver(comm)
+{
+  // Ranks outside the ensemble get an inactive member, like any other driver
+  if (!active()) {
+    member_ = make_member(MPI_COMM_NULL);
+    return;
+  }
+  Expects(n_members >= 1 && n_members <= comm_.size);
+
+  // Contiguous blocks of ranks keep each member on as few nodes as possible
+  timer_driver_setup.start();
+  member_index_ = static_cast<int64_t>(comm_.rank) * n_members / comm_.size;
+  MPI_Comm member_comm;
+  MPI_Comm_split(comm_.comm, member_index_, comm_.rank, &member_comm);
+  member_ = make_member(member_comm);
+  num_threads = member_->num_threads;
+
+  // The root of the first member is also the root of the ensemble
+  MPI_Comm roots_comm;
+  int color = member_->comm_.is_root() ? 0 : MPI_UNDEFINED;
+  MPI_Comm_split(comm_.comm, color, comm_.rank, &roots_comm);
+  roots_comm_ = Comm(roots_comm);
+
+  // Independent members need independent random number sequences
+  member_->set_seed(member_->seed() + member_index_);
+
+  // Every member runs a full solver in the same working directory, so the others write
+  // their run output (summary, statepoints, etc.) to directories of their own
+  if (member_index_ > 0) {
+    member_->set_output_directory("member_" + std::to_string(member_index_));
+  }
+  timer_driver_setup.stop();
+
+  std::string msg = "Neutronics ensemble of " + std::to_string(n_members) + " members";
+  comm_.message(msg);
+}
+
+xt::xtensor<double, 1> NeutronicsEnsemble::heat_source(double power) const
+{
+  auto heat = member_->heat_source(power);
+  auto error = member_->heat_source_rel_error();
+  if (!roots_comm_.active()) {
+    return heat;
+  }
+
+  // Each member is weighted by the inverse of its total variance.  If a member has no
+  // variance estimate (e.g., after a single batch), all members are weighted equally.
+  double variance = 0.0;
+  for (gsl::index i = 0; i < heat.size(); ++i) {
+    double sigma = error(i) * heat(i);
+    variance += sigma * sigma;
+  }
+  double min_variance = variance;
+  roots_comm_.Allreduce(MPI_IN_PLACE, &min_variance, 1, MPI_DOUBLE, MPI_MIN);
+  double weight = min_variance > 0.0 ? 1.0 / variance : 1.0;
+  double weight_sum = weight;
+  roots_comm_.Allreduce(MPI_IN_PLACE, &weight_sum, 1, MPI_DOUBLE, MPI_SUM);
+  weight /= weight_sum;
+
+  // Sum the weighted heat sources and their variances on the root
+  auto n = heat.size();
+  std::vector<double> sums(2 * n);
+  for (gsl::index i = 0; i < n; ++i) {
+    double sigma = error(i) * heat(i);
+    sums[i] = weight * heat(i);
+    sums[n + i] = weight * weight * sigma * sigma;
+  }
+  if (roots_comm_.is_root()) {
+    roots_comm_.Reduce(
+      MPI_IN_PLACE, sums.data(), sums.size(), MPI_DOUBLE, MPI_SUM, 0);
+    rel_error_ = xt::zeros<double>({n});
+    for (gsl::index i = 0; i < n; ++i) {
+      heat(i) = sums[i];
+      if (heat(i) > 0.0) {
+        rel_error_(i) = std::sqrt(sums[n + i]) / heat(i);
+      }
+    }
+  } else {
+    roots_comm_.Reduce(sums.data(), nullptr, sums.size(), MPI_DOUBLE, MPI_SUM, 0);
+  }
+  return heat;
+}
+
+void NeutronicsEnsemble::init_step()
+{
+  timer_init_step.start();
+  member_->init_step();
+  timer_init_step.stop();
+}
+
+void NeutronicsEnsemble::solve_step()
+{
+  timer_solve_step.start();
+  member_->solve_step();
+  timer_solve_step.stop();
+}
+
+void NeutronicsEnsemble::write_step(int timestep, int iteration)
+{
+  // The other members would write to the same files
+  timer_write_step.start();
+  if (member_index_ == 0) {
+    member_->write_step(timestep, iteration);
+  }
+  timer_write_step.stop();
+}
+
+void NeutronicsEnsemble::flush_write()
+{
+  if (member_index_ == 0) {
+    member_->flush_write();
+  }
+}
+
+std::size_t NeutronicsEnsemble::memory_usage() const
+{
+  return member_ ? member_->memory_usage() : 0;
+}
+
+void NeutronicsEnsemble::set_output(const OutputSettings& settings)
+{
+  NeutronicsDriver::set_output(settings);
+  member_->set_output(settings);
+}
+
+void NeutronicsEnsemble::finalize_step()
+{
+  timer_finalize_step.start();
+  member_->finalize_step();
+  timer_finalize_step.stop();
+}
+
+} // namespace enrico
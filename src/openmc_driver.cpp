@@ -2,32 +2,65 @@
 
 #include "enrico/const.h"
 #include "enrico/error.h"
+#include "enrico/hash.h"
+#include "enrico/memory.h"
 
 #include "openmc/capi.h"
 #include "openmc/cell.h"
 #include "openmc/constants.h"
+#include "openmc/lattice.h"
+#include "openmc/settings.h"
 #include "openmc/summary.h"
+#include "openmc/surface.h"
 #include "openmc/tallies/filter.h"
 #include "openmc/tallies/filter_material.h"
 #include "openmc/tallies/tally.h"
 #include "xtensor/xadapt.hpp"
 #include "xtensor/xarray.hpp"
+#include "xtensor/xbuilder.hpp"
 #include "xtensor/xview.hpp"
 #include <gsl/gsl>
-
+#include <sys/stat.h> // for mkdir
+
+#include <algorithm> // for max, min
+#include <array>
+#include <cerrno>    // for errno, EEXIST
+#include <cmath>     // for sqrt
+#include <cstdint>   // for uint64_t
+#include <numeric>   // for partial_sum
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace enrico {
 
-OpenmcDriver::OpenmcDriver(MPI_Comm comm)
+OpenmcDriver::OpenmcDriver(MPI_Comm comm, pugi::xml_node node)
   : NeutronicsDriver(comm)
 {
   timer_driver_setup.start();
   if (active()) {
     err_chk(openmc_init(0, nullptr, &comm));
   }
-  MPI_Barrier(MPI_COMM_WORLD);
+
+  n_inactive_ = openmc::settings::n_inactive;
+  n_batches_ = openmc::settings::n_batches;
+  n_max_batches_ = openmc::settings::n_max_batches;
+  if (node.child("reuse_source")) {
+    reuse_source_ = node.child("reuse_source").text().as_bool();
+  }
+  if (node.child("reuse_inactive")) {
+    reuse_inactive_ = node.child("reuse_inactive").text().as_int();
+    if (reuse_inactive_ < 0 || reuse_inactive_ > n_inactive_) {
+      throw std::runtime_error{"Invalid value for <neutronics><reuse_inactive>"};
+    }
+  }
+  if (node.child("distributed_tallies")) {
+    distributed_tallies_ = node.child("distributed_tallies").text().as_bool();
+    if (distributed_tallies_) {
+      openmc::settings::reduce_tallies = false;
+    }
+  }
 
   // determine number of fissionable cells in model to aid in catching
   // improperly mapped problems
@@ -68,25 +101,13 @@ void OpenmcDriver::create_tallies()
   using gsl::index;
   using gsl::narrow_cast;
 
-  // Build vector of material indices on each rank
-  // After CoupledDriver::init_mappings, the cells_ array is up-to-date on the root,
-  // so we need to send that info to all the other ranks
-  std::vector<int32_t> indices;
-  std::vector<int32_t> instances;
-  if (comm_.is_root()) {
-    for (const auto& c : cells_) {
-      indices.push_back(c.index_);
-      instances.push_back(c.instance_);
-    }
-  }
-  comm_.broadcast(indices);
-  comm_.broadcast(instances);
-  Ensures(indices.size() == instances.size());
-
+  // find() and restore_cells() store the same cells on every rank, so each rank builds
+  // the filter bins from its own arrays
   std::vector<openmc::CellInstance> openmc_instances;
-  for (index i = 0; i < indices.size(); ++i) {
-    openmc_instances.push_back(
-      {narrow_cast<index>(indices[i]), narrow_cast<index>(instances[i])});
+  openmc_instances.reserve(cell_indices_.size());
+  for (index i = 0; i < cell_indices_.size(); ++i) {
+    openmc_instances.push_back({narrow_cast<index>(cell_indices_[i]),
+                                narrow_cast<index>(cell_instances_[i])});
   }
   // Create material filter
   auto f = openmc::Filter::create("cellinstance");
@@ -106,9 +127,12 @@ xt::xtensor<double, 1> OpenmcDriver::heat_source(double power) const
   // Determine number of realizations for normalizing tallies
   int m = tally_->n_realizations_;
 
-  // Broadcast number of realizations
+  // Broadcast number of realizations. Without the reduction at every batch, every
+  // rank has accumulated the same number of realizations.
   // TODO: Change OpenMC so that it's correct on all ranks
-  comm_.broadcast(m);
+  if (!distributed_tallies_) {
+    comm_.broadcast(m);
+  }
 
   // Determine energy production in each material. Note that xt::view doesn't
   // work with enum
@@ -116,104 +140,463 @@ xt::xtensor<double, 1> OpenmcDriver::heat_source(double power) const
   auto mean_value = xt::view(tally_->results_, xt::all(), 0, i_sum);
   xt::xtensor<double, 1> heat = JOULE_PER_EV * mean_value / m;
 
+  // Each rank's results are its share of the tally
+  if (distributed_tallies_) {
+    if (comm_.is_root()) {
+      comm_.Reduce(MPI_IN_PLACE, heat.data(), heat.size(), MPI_DOUBLE, MPI_SUM);
+    } else {
+      comm_.Reduce(heat.data(), nullptr, heat.size(), MPI_DOUBLE, MPI_SUM);
+    }
+  }
+
   // Get total heat production [J/source]
   double total_heat = xt::sum(heat)();
 
   // Convert heat from [J/source] to [W/cm^3]
-  gsl::index i = 0;
-  for (const auto& c : cells_) {
-    double V = c.volume_;
-    heat.at(i++) *= power / (total_heat * V);
+  for (gsl::index i = 0; i < cell_volumes_.size(); ++i) {
+    heat.at(i) *= power / (total_heat * cell_volumes_[i]);
   }
   return heat;
 }
 
+xt::xtensor<double, 1> OpenmcDriver::heat_source_slices(
+  double power,
+  gsl::span<const gsl::index> cells,
+  gsl::span<const int> counts) const
+{
+  if (!distributed_tallies_) {
+    return NeutronicsDriver::heat_source_slices(power, cells, counts);
+  }
+  Expects(counts.size() == comm_.size);
+
+  // Every rank has accumulated the same number of realizations
+  int m = tally_->n_realizations_;
+  int i_sum = static_cast<int>(openmc::TallyResult::SUM);
+
+  // Get total heat production [J/source], summed over the ranks' shares
+  double total_heat = 0.0;
+  for (gsl::index i = 0; i < cell_volumes_.size(); ++i) {
+    total_heat += JOULE_PER_EV * tally_->results_(i, 0, i_sum) / m;
+  }
+  comm_.Allreduce(MPI_IN_PLACE, &total_heat, 1, MPI_DOUBLE, MPI_SUM);
+
+  // The normalization is linear, so each rank converts its share to [W/cm^3] before
+  // the owners sum them
+  std::vector<double> send;
+  send.reserve(cells.size());
+  for (auto i : cells) {
+    double heat = JOULE_PER_EV * tally_->results_(i, 0, i_sum) / m;
+    send.push_back(heat * power / (total_heat * cell_volumes_[i]));
+  }
+  xt::xtensor<double, 1> slice = xt::empty<double>({counts[comm_.rank]});
+  comm_.Reduce_scatter(send.data(), slice.data(), counts.data(), MPI_DOUBLE, MPI_SUM);
+  return slice;
+}
+
+xt::xtensor<double, 1> OpenmcDriver::heat_source_rel_error() const
+{
+  int m = tally_->n_realizations_;
+  if (!distributed_tallies_) {
+    comm_.broadcast(m);
+  }
+
+  int i_sum = static_cast<int>(openmc::TallyResult::SUM);
+  int i_sum_sq = static_cast<int>(openmc::TallyResult::SUM_SQ);
+  xt::xtensor<double, 1> error = xt::zeros<double>({cell_volumes_.size()});
+  if (m < 2)
+    return error;
+
+  if (distributed_tallies_) {
+    // Sum the means and the variances of the means of the ranks' shares
+    auto n = error.size();
+    std::vector<double> sums(2 * n);
+    for (gsl::index i = 0; i < n; ++i) {
+      double mean = tally_->results_(i, 0, i_sum) / m;
+      double mean_sq = tally_->results_(i, 0, i_sum_sq) / m;
+      sums[i] = mean;
+      sums[n + i] = std::max(mean_sq - mean * mean, 0.0) / (m - 1);
+    }
+    if (comm_.is_root()) {
+      comm_.Reduce(MPI_IN_PLACE, sums.data(), sums.size(), MPI_DOUBLE, MPI_SUM);
+      for (gsl::index i = 0; i < n; ++i) {
+        if (sums[i] > 0.0) {
+          error(i) = std::sqrt(sums[n + i]) / sums[i];
+        }
+      }
+    } else {
+      comm_.Reduce(sums.data(), nullptr, sums.size(), MPI_DOUBLE, MPI_SUM);
+    }
+    return error;
+  }
+
+  // Relative standard deviation of the mean over the realizations
+  for (gsl::index i = 0; i < error.size(); ++i) {
+    double mean = tally_->results_(i, 0, i_sum) / m;
+    double mean_sq = tally_->results_(i, 0, i_sum_sq) / m;
+    if (mean > 0.0) {
+      double variance = std::max(mean_sq - mean * mean, 0.0) / (m - 1);
+      error(i) = std::sqrt(variance) / mean;
+    }
+  }
+  return error;
+}
+
 std::vector<CellHandle> OpenmcDriver::find(const std::vector<Position>& positions)
 {
-  std::vector<CellHandle> handles;
-  handles.reserve(positions.size());
-
-  for (const auto& r : positions) {
-    // Determine cell instance corresponding to global element
-    CellInstance c{r};
-
-    // If this cell instance hasn't been saved yet, add it to cells_ and
-    // keep track of what index it corresponds to
-    auto h = c.get_handle();
-    if (cell_index_.find(h) == cell_index_.end()) {
-      cell_index_.emplace(h, cells_.size());
-      cells_.push_back(c);
+  // Each neutronics rank searches a contiguous slice of the positions
+  int n = positions.size();
+  std::vector<int> counts(comm_.size);
+  std::vector<int> displs(comm_.size);
+  for (int r = 0; r < comm_.size; ++r) {
+    int n_slice = n / comm_.size + (r < n % comm_.size ? 1 : 0);
+    counts[r] = 2 * n_slice;
+    displs[r] = r == 0 ? 0 : displs[r - 1] + counts[r - 1];
+  }
+
+  // Determine the cell index/instance of each position in the slice.  The search is
+  // independent for each position, so the OpenMP threads split the slice.
+  std::vector<int32_t> found(counts[comm_.rank]);
+  auto offset = displs[comm_.rank] / 2;
+  int n_local = found.size() / 2;
+  // Exceptions can't leave the parallel region, so keep the lowest error code
+  int err = E_SUCCESS;
+#pragma omp parallel for reduction(min : err)
+  for (int i = 0; i < n_local; ++i) {
+    const auto& r = positions[offset + i];
+    double xyz[3] = {r.x, r.y, r.z};
+    err = std::min(err, openmc_find_cell(xyz, &found[2 * i], &found[2 * i + 1]));
+  }
+  err_chk(err);
+
+  // Each rank numbers the distinct cell instances of its slice in order of first
+  // appearance, so that only those are shared instead of the results of every position
+  std::vector<int32_t> unique;
+  std::vector<int32_t> slice_index(n_local);
+  std::unordered_map<std::uint64_t, int32_t> seen;
+  for (int i = 0; i < n_local; ++i) {
+    auto it = seen.emplace(instance_key(found[2 * i], found[2 * i + 1]),
+                           static_cast<int32_t>(seen.size()));
+    if (it.second) {
+      unique.push_back(found[2 * i]);
+      unique.push_back(found[2 * i + 1]);
     }
+    slice_index[i] = it.first->second;
+  }
+
+  // Every neutronics rank registers the instances of all slices in the same order,
+  // which is their order of first appearance among all positions, so that the stored
+  // cells are identical on all ranks
+  int n_unique = unique.size();
+  std::vector<int> unique_counts(comm_.size);
+  std::vector<int> unique_displs(comm_.size);
+  comm_.Allgather(&n_unique, 1, MPI_INT, unique_counts.data(), 1, MPI_INT);
+  std::partial_sum(
+    unique_counts.cbegin(), unique_counts.cend() - 1, unique_displs.begin() + 1);
+  std::vector<int32_t> all_unique(unique_displs.back() + unique_counts.back());
+  comm_.Allgatherv(unique.data(),
+                   n_unique,
+                   MPI_INT32_T,
+                   all_unique.data(),
+                   unique_counts.data(),
+                   unique_displs.data(),
+                   MPI_INT32_T);
+  std::vector<CellHandle> unique_handles(all_unique.size() / 2);
+  for (gsl::index k = 0; k < unique_handles.size(); ++k) {
+    unique_handles[k] = add_cell(all_unique[2 * k], all_unique[2 * k + 1]);
+  }
 
-    // Set value for cell instance in array
-    handles.push_back(h);
+  // Only the root needs the handle of every position
+  for (int r = 0; r < comm_.size; ++r) {
+    counts[r] /= 2;
+    displs[r] /= 2;
+  }
+  std::vector<int32_t> all_index;
+  if (comm_.is_root()) {
+    all_index.resize(n);
   }
+  comm_.Gatherv(slice_index.data(),
+                n_local,
+                MPI_INT32_T,
+                all_index.data(),
+                counts.data(),
+                displs.data(),
+                MPI_INT32_T);
 
+  std::vector<CellHandle> handles;
+  if (comm_.is_root()) {
+    handles.reserve(n);
+    for (int r = 0; r < comm_.size; ++r) {
+      for (int i = displs[r]; i < displs[r] + counts[r]; ++i) {
+        handles.push_back(unique_handles[unique_displs[r] / 2 + all_index[i]]);
+      }
+    }
+  }
   return handles;
 }
 
 void OpenmcDriver::set_density(CellHandle cell, double rho) const
 {
-  this->cell_instance(cell).material()->set_density(rho, "g/cm3");
+  this->material(cell)->set_density(rho, "g/cm3");
 }
 
 void OpenmcDriver::set_temperature(CellHandle cell, double T) const
 {
-  const auto& c = this->cell_instance(cell);
-  c.cell()->set_temperature(T, c.instance_);
+  this->openmc_cell(cell)->set_temperature(T, cell_instances_.at(cell));
+}
+
+void OpenmcDriver::set_densities(gsl::span<const CellHandle> cells,
+                                 gsl::span<const double> rho) const
+{
+  Expects(cells.size() == rho.size());
+
+  // Resolve each cell once. Several cells may be filled with the same material, so the
+  // updates are collected per material and the last one wins, as with set_density().
+  std::vector<openmc::Material*> materials;
+  std::vector<double> densities;
+  std::unordered_map<openmc::Material*, gsl::index> material_index;
+  for (gsl::index i = 0; i < cells.size(); ++i) {
+    auto m = this->material(cells[i]);
+    auto it = material_index.emplace(m, materials.size());
+    if (it.second) {
+      materials.push_back(m);
+      densities.push_back(rho[i]);
+    } else {
+      densities[it.first->second] = rho[i];
+    }
+  }
+
+  // Distinct materials don't share data, so they can be set concurrently
+  int n = materials.size();
+#pragma omp parallel for num_threads(num_threads)
+  for (int i = 0; i < n; ++i) {
+    materials[i]->set_density(densities[i], "g/cm3");
+  }
+}
+
+void OpenmcDriver::set_temperatures(gsl::span<const CellHandle> cells,
+                                    gsl::span<const double> T) const
+{
+  Expects(cells.size() == T.size());
+
+  // Cells of a non-distributed temperature share one value across instances, and
+  // OpenMC reports out-of-range temperatures as it sets them, so this stays serial
+  for (gsl::index i = 0; i < cells.size(); ++i) {
+    this->openmc_cell(cells[i])->set_temperature(T[i], cell_instances_.at(cells[i]));
+  }
 }
 
 double OpenmcDriver::get_density(CellHandle cell) const
 {
-  return this->cell_instance(cell).material()->density();
+  return this->material(cell)->density();
 }
 
 double OpenmcDriver::get_temperature(CellHandle cell) const
 {
-  const auto& c = this->cell_instance(cell);
-  return c.cell()->temperature(c.instance_);
+  return this->openmc_cell(cell)->temperature(cell_instances_.at(cell));
 }
 
 double OpenmcDriver::get_volume(CellHandle cell) const
 {
-  return this->cell_instance(cell).volume_;
+  return cell_volumes_.at(cell);
 }
 
 bool OpenmcDriver::is_fissionable(CellHandle cell) const
 {
-  return this->cell_instance(cell).material()->fissionable();
+  return this->material(cell)->fissionable();
 }
 
 std::string OpenmcDriver::cell_label(CellHandle cell) const
 {
-  // Get cell instance
-  const auto& c = this->cell_instance(cell);
-
-  // Build label
   std::stringstream label;
-  label << openmc::model::cells[c.index_]->id_ << " (" << c.instance_ << ")";
+  label << this->openmc_cell(cell)->id_ << " (" << cell_instances_.at(cell) << ")";
   return label.str();
 }
 
 gsl::index OpenmcDriver::cell_index(CellHandle cell) const
 {
-  return cell_index_.at(cell);
+  // Handles are assigned in the order cells are stored
+  Expects(cell < cell_volumes_.size());
+  return cell;
+}
+
+std::size_t OpenmcDriver::geometry_hash() const
+{
+  // Surfaces and lattices have no common accessor for their parameters, so they are
+  // hashed through their values at fixed points, which change with any coefficient,
+  // pitch, or lower-left corner
+  const std::array<openmc::Position, 4> probes{{{0.1234, -0.5678, 0.9101},
+                                                {1.7321, 2.2361, -3.1416},
+                                                {-11.313, 7.7187, 53.917},
+                                                {-0.4142, -23.571, -6.2832}}};
+  auto hash_position = [](std::size_t& h, const openmc::Position& r) {
+    hash_combine(h, r.x);
+    hash_combine(h, r.y);
+    hash_combine(h, r.z);
+  };
+
+  // find() depends on how cells are nested, filled, and bounded, so hash the structure
+  // and region of every cell in the model
+  std::size_t h = openmc::model::cells.size();
+  for (const auto& c : openmc::model::cells) {
+    hash_combine(h, c->id_);
+    hash_combine(h, static_cast<int>(c->type_));
+    hash_combine(h, c->universe_);
+    hash_combine(h, c->fill_);
+    hash_combine(h, c->n_instances_);
+    for (auto m : c->material_) {
+      hash_combine(h, m);
+    }
+    for (auto token : c->region_) {
+      hash_combine(h, token);
+    }
+    hash_position(h, c->translation_);
+    for (auto r : c->rotation_) {
+      hash_combine(h, r);
+    }
+  }
+
+  hash_combine(h, openmc::model::surfaces.size());
+  for (const auto& s : openmc::model::surfaces) {
+    hash_combine(h, s->id_);
+    for (const auto& r : probes) {
+      hash_combine(h, s->evaluate(r));
+    }
+  }
+
+  hash_combine(h, openmc::model::lattices.size());
+  for (const auto& lat : openmc::model::lattices) {
+    hash_combine(h, lat->id_);
+    hash_combine(h, static_cast<int>(lat->type_));
+    hash_combine(h, lat->outer_);
+    for (auto u : lat->universes_) {
+      hash_combine(h, u);
+    }
+    for (const auto& r : probes) {
+      auto i_xyz = lat->get_indices(r, {0.0, 0.0, 1.0});
+      for (auto i : i_xyz) {
+        hash_combine(h, i);
+      }
+      hash_position(h, lat->get_local_position(r, i_xyz));
+    }
+  }
+  return h;
+}
+
+std::size_t OpenmcDriver::memory_usage() const
+{
+  std::size_t bytes = memory_bytes(cell_indices_) + memory_bytes(cell_instances_) +
+                      memory_bytes(cell_materials_) + memory_bytes(cell_volumes_) +
+                      memory_bytes(cell_handle_) + memory_bytes(source_bank_);
+  if (tally_) {
+    bytes += memory_bytes(tally_->results_);
+  }
+  return bytes;
+}
+
+std::uint64_t OpenmcDriver::cell_key(CellHandle cell) const
+{
+  return instance_key(cell_indices_.at(cell), cell_instances_.at(cell));
+}
+
+void OpenmcDriver::restore_cells(const std::vector<std::uint64_t>& keys)
+{
+  for (auto key : keys) {
+    add_cell(key >> 32, key & 0xffffffff);
+  }
+}
+
+int64_t OpenmcDriver::n_particles() const
+{
+  return openmc::settings::n_particles;
+}
+
+void OpenmcDriver::set_n_particles(int64_t n)
+{
+  Expects(n > 0);
+  // The work per rank is determined from the particle count in openmc_simulation_init
+  openmc::settings::n_particles = n;
 }
 
-CellInstance& OpenmcDriver::cell_instance(CellHandle cell)
+int64_t OpenmcDriver::seed() const
 {
-  return cells_.at(cell_index_.at(cell));
+  return openmc_get_seed();
 }
 
-const CellInstance& OpenmcDriver::cell_instance(CellHandle cell) const
+void OpenmcDriver::set_seed(int64_t seed)
 {
-  return cells_.at(cell_index_.at(cell));
+  openmc_set_seed(seed);
+}
+
+void OpenmcDriver::set_output_directory(const std::string& path)
+{
+  // Only the root writes OpenMC's output, so only it needs the directory
+  if (comm_.is_root() && mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+    throw std::runtime_error{"Unable to create output directory " + path};
+  }
+
+  // OpenMC prepends the path to its file names as is
+  openmc::settings::path_output = path;
+  if (path.empty() || path.back() != '/') {
+    openmc::settings::path_output += '/';
+  }
+}
+
+std::uint64_t OpenmcDriver::instance_key(int32_t index, int32_t instance)
+{
+  return static_cast<std::uint64_t>(index) << 32 | static_cast<std::uint32_t>(instance);
+}
+
+CellHandle OpenmcDriver::add_cell(int32_t index, int32_t instance)
+{
+  auto it = cell_handle_.emplace(instance_key(index, instance), cell_volumes_.size());
+  if (it.second) {
+    CellInstance c{index, instance};
+    cell_indices_.push_back(index);
+    cell_instances_.push_back(instance);
+    cell_materials_.push_back(c.material_index_ >= 0 ? c.material() : nullptr);
+    cell_volumes_.push_back(c.volume_);
+  }
+  return it.first->second;
+}
+
+openmc::Cell* OpenmcDriver::openmc_cell(CellHandle cell) const
+{
+  return openmc::model::cells[cell_indices_.at(cell)].get();
+}
+
+openmc::Material* OpenmcDriver::material(CellHandle cell) const
+{
+  auto m = cell_materials_.at(cell);
+  if (!m) {
+    throw std::runtime_error{"Cell " + cell_label(cell) +
+                             " is not filled with a material"};
+  }
+  return m;
 }
 
 void OpenmcDriver::init_step()
 {
   timer_init_step.start();
+
+  // Once a converged source is available, fewer batches are needed to converge it
+  // again; the number of active batches is unchanged
+  if (has_source_) {
+    int cut = n_inactive_ - reuse_inactive_;
+    openmc::settings::n_inactive = reuse_inactive_;
+    openmc::settings::n_batches = n_batches_ - cut;
+    openmc::settings::n_max_batches = n_max_batches_ - cut;
+  }
+
   err_chk(openmc_simulation_init());
+
+  // Replace the source sampled by openmc_simulation_init with the previous source. If
+  // the number of particles changed, sites are dropped or repeated.
+  if (has_source_ && !source_bank_.empty()) {
+    auto& bank = openmc::simulation::source_bank;
+    for (gsl::index i = 0; i < bank.size(); ++i) {
+      bank[i] = source_bank_[i % source_bank_.size()];
+    }
+  }
   timer_init_step.stop();
 }
 
@@ -222,6 +605,12 @@ void OpenmcDriver::solve_step()
   timer_solve_step.start();
   err_chk(openmc_run());
   err_chk(openmc_reset_timers());
+
+  // At the end of a run, the source bank holds the source for the next generation
+  if (reuse_source_) {
+    source_bank_ = openmc::simulation::source_bank;
+    has_source_ = true;
+  }
   timer_solve_step.stop();
 }
 
@@ -230,11 +619,23 @@ void OpenmcDriver::write_step(int timestep, int iteration)
   timer_write_step.start();
   std::string suffix{"_t" + std::to_string(timestep) + "_i" + std::to_string(iteration) +
                      ".h5"};
-  std::string filename{"openmc" + suffix};
-  err_chk(openmc_statepoint_write(filename.c_str(), nullptr));
+  std::vector<std::string> files;
+  if (output_.contents != OutputSettings::Contents::properties) {
+    std::string filename{"openmc" + suffix};
+    err_chk(openmc_statepoint_write(filename.c_str(), nullptr));
+    files.push_back(filename);
+  }
 
-  std::string prop_file{"properties" + suffix};
-  err_chk(openmc_properties_export(prop_file.c_str()));
+  if (output_.contents != OutputSettings::Contents::tallies) {
+    std::string prop_file{"properties" + suffix};
+    err_chk(openmc_properties_export(prop_file.c_str()));
+    files.push_back(prop_file);
+  }
+
+  // The files are written by the root
+  if (comm_.is_root()) {
+    output_history_.add(files);
+  }
   timer_write_step.stop();
 }
 
@@ -0,0 +1,61 @@
+#include "enrico/output.h"
+
+#include <algorithm> // for any_of, find
+#include <cstdio>    // for remove
+#include <stdexcept>
+#include <utility> // for move
+
+namespace enrico {
+
+OutputSettings::OutputSettings(pugi::xml_node node)
+{
+  if (node.child("interval")) {
+    interval = node.child("interval").text().as_int();
+    if (interval < 1) {
+      throw std::runtime_error{"Invalid value for <output><interval>"};
+    }
+  }
+  if (node.child("final_only")) {
+    final_only = node.child("final_only").text().as_bool();
+  }
+  if (node.child("contents")) {
+    std::string s = node.child_value("contents");
+    if (s == "all") {
+      contents = Contents::all;
+    } else if (s == "tallies") {
+      contents = Contents::tallies;
+    } else if (s == "properties") {
+      contents = Contents::properties;
+    } else {
+      throw std::runtime_error{"Invalid value for <output><contents>"};
+    }
+  }
+  if (node.child("keep")) {
+    keep = node.child("keep").text().as_int();
+    if (keep < 0) {
+      throw std::runtime_error{"Invalid value for <output><keep>"};
+    }
+  }
+}
+
+void OutputHistory::add(std::vector<std::string> files)
+{
+  if (keep_ == 0)
+    return;
+
+  files_.push_back(std::move(files));
+  if (files_.size() > keep_) {
+    // A file that was written again by a later output is still needed
+    for (const auto& f : files_.front()) {
+      bool rewritten = std::any_of(files_.begin() + 1, files_.end(), [&f](const auto& v) {
+        return std::find(v.begin(), v.end(), f) != v.end();
+      });
+      if (!rewritten) {
+        std::remove(f.c_str());
+      }
+    }
+    files_.pop_front();
+  }
+}
+
+} // namespace enrico
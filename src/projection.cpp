@@ -0,0 +1,193 @@
+#include "enrico/projection.h"
+
+#include "enrico/memory.h"
+
+#include <algorithm> // for sort
+#include <numeric>   // for partial_sum
+#include <utility>   // for pair
+
+namespace enrico {
+
+Projection::Projection(gsl::span<const int32_t> point_offsets,
+                       gsl::span<const int32_t> point_cells,
+                       gsl::span<const double> point_weights,
+                       int32_t n_cells)
+{
+  Expects(point_offsets.size() > 0);
+  Expects(point_cells.size() == point_weights.size());
+  Expects(point_offsets[point_offsets.size() - 1] == point_cells.size());
+  gsl::index n_elem = point_offsets.size() - 1;
+
+  // Merge the points of each element that fall in the same cell
+  elem_offsets_.reserve(n_elem + 1);
+  elem_offsets_.push_back(0);
+  std::vector<std::pair<int32_t, double>> overlaps;
+  for (gsl::index e = 0; e < n_elem; ++e) {
+    overlaps.clear();
+    double total = 0.0;
+    for (auto p = point_offsets[e]; p < point_offsets[e + 1]; ++p) {
+      Expects(point_cells[p] >= 0 && point_cells[p] < n_cells);
+      overlaps.emplace_back(point_cells[p], point_weights[p]);
+      total += point_weights[p];
+    }
+    Expects(total > 0.0);
+    std::sort(overlaps.begin(), overlaps.end());
+    for (gsl::index i = 0; i < overlaps.size();) {
+      auto cell = overlaps[i].first;
+      double w = 0.0;
+      for (; i < overlaps.size() && overlaps[i].first == cell; ++i) {
+        w += overlaps[i].second;
+      }
+      elem_cells_.push_back(cell);
+      elem_fractions_.push_back(w / total);
+    }
+    elem_offsets_.push_back(elem_cells_.size());
+  }
+
+  // Transpose the weights so that they are grouped by cell, with the elements of each
+  // cell in increasing order
+  cell_offsets_.assign(n_cells + 1, 0);
+  for (auto c : elem_cells_) {
+    ++cell_offsets_[c + 1];
+  }
+  std::partial_sum(cell_offsets_.cbegin(), cell_offsets_.cend(), cell_offsets_.begin());
+
+  cell_elems_.resize(elem_cells_.size());
+  cell_fractions_.resize(elem_cells_.size());
+  std::vector<int32_t> next(cell_offsets_.cbegin(), cell_offsets_.cend() - 1);
+  for (gsl::index e = 0; e < n_elem; ++e) {
+    for (auto j = elem_offsets_[e]; j < elem_offsets_[e + 1]; ++j) {
+      auto k = next[elem_cells_[j]]++;
+      cell_elems_[k] = e;
+      cell_fractions_[k] = elem_fractions_[j];
+    }
+  }
+}
+
+void Projection::set_volumes(gsl::span<const double> elem_volumes)
+{
+  Expects(elem_volumes.size() + 1 == elem_offsets_.size());
+
+  gsl::index n_cells = cell_offsets_.size() - 1;
+  cell_weights_.resize(cell_elems_.size());
+  cell_volumes_.assign(n_cells, 0.0);
+  for (gsl::index i = 0; i < n_cells; ++i) {
+    for (auto j = cell_offsets_[i]; j < cell_offsets_[i + 1]; ++j) {
+      cell_weights_[j] = elem_volumes[cell_elems_[j]] * cell_fractions_[j];
+      cell_volumes_[i] += cell_weights_[j];
+    }
+  }
+}
+
+void Projection::set_fluid_mask(gsl::span<const int> elem_fluid_mask)
+{
+  Expects(elem_fluid_mask.size() + 1 == elem_offsets_.size());
+  Expects(cell_weights_.size() == cell_elems_.size());
+
+  gsl::index n_cells = cell_offsets_.size() - 1;
+  cell_fluid_weights_.resize(cell_elems_.size());
+  cell_fluid_volumes_.assign(n_cells, 0.0);
+  cell_fluid_mask_.resize(n_cells);
+  n_mixed_cells_ = 0;
+  for (gsl::index i = 0; i < n_cells; ++i) {
+    int n_fluid = 0;
+    for (auto j = cell_offsets_[i]; j < cell_offsets_[i + 1]; ++j) {
+      bool in_fluid = elem_fluid_mask[cell_elems_[j]] == 1;
+      cell_fluid_weights_[j] = in_fluid ? cell_weights_[j] : 0.0;
+      cell_fluid_volumes_[i] += cell_fluid_weights_[j];
+      n_fluid += in_fluid;
+    }
+    if (n_fluid > 0 && n_fluid < cell_offsets_[i + 1] - cell_offsets_[i]) {
+      cell_fluid_mask_[i] = cell_fluid_volumes_[i] > 0.5 * cell_volumes_[i];
+      ++n_mixed_cells_;
+    } else {
+      cell_fluid_mask_[i] = n_fluid > 0;
+    }
+  }
+}
+
+void Projection::set_num_threads(int n)
+{
+  Expects(n > 0);
+  num_threads_ = n;
+}
+
+void Projection::average(gsl::span<const double> elem_values,
+                         gsl::span<double> cell_values) const
+{
+  Expects(elem_values.size() + 1 == elem_offsets_.size());
+  Expects(cell_values.size() == cell_volumes_.size());
+
+  gsl::index n_cells = cell_values.size();
+#pragma omp parallel for num_threads(num_threads_)
+  for (gsl::index i = 0; i < n_cells; ++i) {
+    double sum = 0.0;
+    for (auto j = cell_offsets_[i]; j < cell_offsets_[i + 1]; ++j) {
+      sum += elem_values[cell_elems_[j]] * cell_weights_[j];
+    }
+    cell_values[i] = sum / cell_volumes_[i];
+  }
+}
+
+void Projection::average_fluid(gsl::span<const double> elem_values,
+                               gsl::span<double> cell_values) const
+{
+  Expects(elem_values.size() + 1 == elem_offsets_.size());
+  Expects(cell_values.size() == cell_fluid_mask_.size());
+
+  gsl::index n_cells = cell_values.size();
+#pragma omp parallel for num_threads(num_threads_)
+  for (gsl::index i = 0; i < n_cells; ++i) {
+    if (cell_fluid_mask_[i] == 1) {
+      double sum = 0.0;
+      for (auto j = cell_offsets_[i]; j < cell_offsets_[i + 1]; ++j) {
+        sum += elem_values[cell_elems_[j]] * cell_fluid_weights_[j];
+      }
+      cell_values[i] = sum / cell_fluid_volumes_[i];
+    }
+  }
+}
+
+void Projection::distribute(gsl::span<const double> cell_values,
+                            gsl::span<double> elem_values) const
+{
+  Expects(cell_values.size() + 1 == cell_offsets_.size());
+  Expects(elem_values.size() + 1 == elem_offsets_.size());
+
+  gsl::index n_elem = elem_values.size();
+#pragma omp parallel for num_threads(num_threads_)
+  for (gsl::index e = 0; e < n_elem; ++e) {
+    auto first = elem_offsets_[e];
+    auto last = elem_offsets_[e + 1];
+
+    // An element in a single cell takes its value exactly
+    if (last - first == 1) {
+      elem_values[e] = cell_values[elem_cells_[first]];
+      continue;
+    }
+    double sum = 0.0;
+    for (auto j = first; j < last; ++j) {
+      sum += cell_values[elem_cells_[j]] * elem_fractions_[j];
+    }
+    elem_values[e] = sum;
+  }
+}
+
+std::size_t Projection::memory_usage() const
+{
+  std::size_t bytes = 0;
+  for (const auto* v : {&elem_offsets_, &elem_cells_, &cell_offsets_, &cell_elems_}) {
+    bytes += memory_bytes(*v);
+  }
+  for (const auto* v : {&elem_fractions_,
+                        &cell_fractions_,
+                        &cell_weights_,
+                        &cell_fluid_weights_,
+                        &cell_volumes_,
+                        &cell_fluid_volumes_}) {
+    bytes += memory_bytes(*v);
+  }
+  return bytes + memory_bytes(cell_fluid_mask_);
+}
+
+} // namespace enrico
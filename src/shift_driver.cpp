@@ -52,7 +52,6 @@ ShiftDriver::ShiftDriver(MPI_Comm comm, pugi::xml_node node)
     // Initialize number of cells
     num_cells_ = geometry_->num_cells();
   }
-  MPI_Barrier(MPI_COMM_WORLD);
 
 #ifdef _OPENMP
 #pragma omp parallel default(none) shared(num_threads)
@@ -132,6 +131,30 @@ void ShiftDriver::set_temperature(CellHandle handle, double T) const
   driver_->compositions()[matid]->set_temperature(T);
 }
 
+void ShiftDriver::set_densities(gsl::span<const CellHandle> handles,
+                                gsl::span<const double> rho) const
+{
+  Expects(handles.size() == rho.size());
+  const auto& compositions = driver_->compositions();
+  for (gsl::index i = 0; i < handles.size(); ++i) {
+    Expects(rho[i] > 0);
+    auto cell = cells_.at(handles[i]);
+    compositions[geometry_->matid(cell)]->set_density(rho[i]);
+  }
+}
+
+void ShiftDriver::set_temperatures(gsl::span<const CellHandle> handles,
+                                   gsl::span<const double> T) const
+{
+  Expects(handles.size() == T.size());
+  const auto& compositions = driver_->compositions();
+  for (gsl::index i = 0; i < handles.size(); ++i) {
+    Expects(T[i] > 0);
+    auto cell = cells_.at(handles[i]);
+    compositions[geometry_->matid(cell)]->set_temperature(T[i]);
+  }
+}
+
 double ShiftDriver::get_density(CellHandle handle) const
 {
   auto cell = cells_.at(handle);
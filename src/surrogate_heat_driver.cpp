@@ -1,7 +1,8 @@
 #include "enrico/surrogate_heat_driver.h"
 
+#include "enrico/async_writer.h"
+#include "enrico/memory.h"
 #include "enrico/vtk_viz.h"
-#include "iapws/iapws.h"
 #include "openmc/xml_interface.h"
 #include "surrogates/heat_xfer_backend.h"
 #include "xtensor/xadapt.hpp"
@@ -10,11 +11,13 @@
 #include "xtensor/xnorm.hpp"
 #include "xtensor/xview.hpp"
 
-#include <algorithm> // for fill_n
+#include <algorithm> // for fill, fill_n, min, sort, unique
 #define _USE_MATH_DEFINES
 #include <cmath>
 #include <iostream>
 #include <iterator> // for back_inserter
+#include <stdexcept>
+#include <utility> // for move
 
 namespace enrico {
 
@@ -33,8 +36,6 @@ SurrogateHeatDriver::SurrogateHeatDriver(MPI_Comm comm, pugi::xml_node node)
   n_pins_x_ = node.child("n_pins_x").text().as_int();
   n_pins_y_ = node.child("n_pins_y").text().as_int();
   n_pins_ = n_pins_x_ * n_pins_y_;
-  n_solid_ = n_pins_ * n_axial_ * n_rings() * n_azimuthal_;
-  n_fluid_ = n_pins_ * n_axial_;
   pin_pitch_ = node.child("pin_pitch").text().as_double();
 
   // Determine thermal-hydraulic parameters for fluid phase
@@ -153,6 +154,11 @@ SurrogateHeatDriver::SurrogateHeatDriver(MPI_Comm comm, pugi::xml_node node)
   z_ = openmc::get_node_xarray<double>(node, "z");
   n_axial_ = z_.size() - 1;
 
+  // Distribute the pins among the ranks of the heat comm
+  partition_pins();
+  n_solid_ = n_local_pins_ * n_axial_ * n_rings() * n_azimuthal_;
+  n_fluid_ = n_local_pins_ * n_axial_;
+
   // Check for visualization input
   if (node.child("viz")) {
     pugi::xml_node viz_node = node.child("viz");
@@ -175,12 +181,82 @@ SurrogateHeatDriver::SurrogateHeatDriver(MPI_Comm comm, pugi::xml_node node)
     if (viz_node.child("regions")) {
       viz_regions_ = viz_node.child("regions").text().as_string();
     }
+    if (viz_node.child("format")) {
+      viz_format_ = viz_node.child("format").text().as_string();
+      if (viz_format_ != "legacy" && viz_format_ != "vtu") {
+        throw std::runtime_error{"Invalid value for <viz><format>"};
+      }
+    }
+    if (viz_node.child("queue_depth")) {
+      int depth = viz_node.child("queue_depth").text().as_int();
+      if (depth < 0) {
+        throw std::runtime_error{"Invalid value for <viz><queue_depth>"};
+      }
+      viz_queue_depth_ = depth;
+    }
   }
 
   // Initialize heat transfer solver
   generate_arrays();
 };
 
+SurrogateHeatDriver::~SurrogateHeatDriver() = default;
+
+void SurrogateHeatDriver::flush_write()
+{
+  if (viz_queue_) {
+    viz_queue_->flush();
+  }
+}
+
+std::size_t SurrogateHeatDriver::memory_usage() const
+{
+  return memory_bytes(source_) + memory_bytes(solid_temperature_) +
+         memory_bytes(fluid_temperature_) + memory_bytes(fluid_density_) +
+         memory_bytes(rod_powers_) + memory_bytes(channel_powers_) +
+         memory_bytes(channel_enthalpy_) + memory_bytes(channel_pressure_) +
+         memory_bytes(channel_velocity_) + memory_bytes(channel_temperature_) +
+         memory_bytes(channel_density_) + memory_bytes(channel_owned_);
+}
+
+void SurrogateHeatDriver::partition_pins()
+{
+  if (!comm_.active())
+    return;
+
+  // Assign contiguous blocks of pins to ranks, with the first n_pins_ % size ranks
+  // getting one extra pin
+  std::size_t size = comm_.size;
+  std::size_t rank = comm_.rank;
+  pin_begin_ = rank * (n_pins_ / size) + std::min(rank, n_pins_ % size);
+  n_local_pins_ = n_pins_ / size + (rank < n_pins_ % size ? 1 : 0);
+
+  // Every channel touching a local rod is solved locally
+  for (gsl::index i = 0; i < n_local_pins_; ++i) {
+    const auto& ids = rods_[pin_begin_ + i].channel_ids_;
+    local_channels_.insert(local_channels_.end(), ids.begin(), ids.end());
+  }
+  std::sort(local_channels_.begin(), local_channels_.end());
+  local_channels_.erase(std::unique(local_channels_.begin(), local_channels_.end()),
+                        local_channels_.end());
+
+  for (auto chan : local_channels_) {
+    const auto& ids = channels_[chan].rod_ids_;
+    auto first_rod = *std::min_element(ids.begin(), ids.end());
+    channel_owned_.push_back(pin_rank(first_rod) == comm_.rank);
+  }
+}
+
+int SurrogateHeatDriver::pin_rank(std::size_t pin) const
+{
+  std::size_t size = comm_.size;
+  std::size_t n = n_pins_ / size;
+  std::size_t extra = n_pins_ % size;
+  if (pin < extra * (n + 1))
+    return pin / (n + 1);
+  return extra + (pin - extra * (n + 1)) / n;
+}
+
 void SurrogateHeatDriver::generate_arrays()
 {
   // Make a radial grid for the clad with equal spacing.
@@ -205,18 +281,27 @@ void SurrogateHeatDriver::generate_arrays()
 
   if (this->has_coupling_data()) {
     // Create empty arrays for source term and temperature in the solid phase
-    source_ = xt::empty<double>({n_pins_, n_axial_, n_rings(), n_azimuthal_});
-    solid_temperature_ = xt::empty<double>({n_pins_, n_axial_, n_rings()});
+    source_ = xt::empty<double>({n_local_pins_, n_axial_, n_rings(), n_azimuthal_});
+    solid_temperature_ = xt::empty<double>({n_local_pins_, n_axial_, n_rings()});
 
     // Create empty arrays for temperature and density in the fluid phase
-    fluid_temperature_ = xt::empty<double>({n_pins_, n_axial_});
-    fluid_density_ = xt::empty<double>({n_pins_, n_axial_});
+    fluid_temperature_ = xt::empty<double>({n_local_pins_, n_axial_});
+    fluid_density_ = xt::empty<double>({n_local_pins_, n_axial_});
+
+    // Create the subchannel solver workspace
+    rod_powers_ = xt::empty<double>({n_pins_, n_axial_});
+    channel_powers_ = xt::empty<double>({n_channels_, n_axial_});
+    channel_enthalpy_ = xt::empty<double>({n_channels_, n_axial_ + 1});
+    channel_pressure_ = xt::empty<double>({n_channels_, n_axial_ + 1});
+    channel_velocity_ = xt::empty<double>({n_channels_, n_axial_ + 1});
+    channel_temperature_ = xt::empty<double>({n_channels_, n_axial_});
+    channel_density_ = xt::empty<double>({n_channels_, n_axial_});
   }
 }
 
 int SurrogateHeatDriver::n_local_elem() const
 {
-  return this->has_coupling_data() ? this->n_global_elem() : 0;
+  return this->has_coupling_data() ? n_solid_ + n_fluid_ : 0;
 }
 
 std::size_t SurrogateHeatDriver::n_global_elem() const
@@ -236,9 +321,9 @@ std::vector<Position> SurrogateHeatDriver::centroid() const
   // Establish mappings between solid regions and OpenMC cells. The center
   // coordinate for each region in the T/H model is obtained and used to
   // determine the OpenMC cell at that position.
-  for (gsl::index i = 0; i < n_pins_; ++i) {
-    double x_center = pin_centers_(i, 0);
-    double y_center = pin_centers_(i, 1);
+  for (gsl::index i = 0; i < n_local_pins_; ++i) {
+    double x_center = pin_centers_(pin_begin_ + i, 0);
+    double y_center = pin_centers_(pin_begin_ + i, 1);
 
     for (gsl::index j = 0; j < n_axial_; ++j) {
       double zavg = 0.5 * (z_(j) + z_(j + 1));
@@ -270,9 +355,9 @@ std::vector<Position> SurrogateHeatDriver::centroid() const
   // can take a point on a 45 degree ray from the pin center. TODO: add a check to make
   // sure that the T/H model is finer than the OpenMC model.
 
-  for (gsl::index i = 0; i < n_pins_; ++i) {
-    double x_center = pin_centers_(i, 0);
-    double y_center = pin_centers_(i, 1);
+  for (gsl::index i = 0; i < n_local_pins_; ++i) {
+    double x_center = pin_centers_(pin_begin_ + i, 0);
+    double y_center = pin_centers_(pin_begin_ + i, 1);
 
     for (gsl::index j = 0; j < n_axial_; ++j) {
       double zavg = 0.5 * (z_(j) + z_(j + 1));
@@ -289,44 +374,131 @@ std::vector<Position> SurrogateHeatDriver::centroid() const
   return centroids;
 }
 
-std::vector<double> SurrogateHeatDriver::temperature() const
+ElementQuadrature SurrogateHeatDriver::quadrature(int order) const
 {
-  std::vector<double> local_temperatures;
+  Expects(order > 0);
+  ElementQuadrature q;
+  q.offsets.push_back(0);
+  if (!this->has_coupling_data())
+    return q;
 
-  if (this->has_coupling_data()) {
-    for (gsl::index i = 0; i < n_pins_; ++i) {
-      for (gsl::index j = 0; j < n_axial_; ++j) {
-        for (gsl::index k = 0; k < n_rings(); ++k) {
-          for (gsl::index m = 0; m < n_azimuthal_; ++m) {
-            local_temperatures.push_back(solid_temperature_(i, j, k));
+  const int n = order;
+  auto add_point = [&q](double x, double y, double z) {
+    q.points.emplace_back(x, y, z);
+    q.weights.push_back(1.0);
+  };
+
+  for (gsl::index i = 0; i < n_local_pins_; ++i) {
+    double x_center = pin_centers_(pin_begin_ + i, 0);
+    double y_center = pin_centers_(pin_begin_ + i, 1);
+
+    for (gsl::index j = 0; j < n_axial_; ++j) {
+      double dz = (z_(j + 1) - z_(j)) / n;
+
+      for (gsl::index k = 0; k < n_rings(); ++k) {
+        double r0;
+        double r1;
+        if (k < n_fuel_rings_) {
+          r0 = r_grid_fuel_(k);
+          r1 = r_grid_fuel_(k + 1);
+        } else {
+          int m = k - n_fuel_rings_;
+          r0 = r_grid_clad_(m);
+          r1 = r_grid_clad_(m + 1);
+        }
+
+        for (gsl::index m = 0; m < n_azimuthal_; ++m) {
+          // Equal-area divisions of the ring segment carry equal weights
+          for (int a = 0; a < n; ++a) {
+            double r = std::sqrt(r0 * r0 + (a + 0.5) / n * (r1 * r1 - r0 * r0));
+            for (int b = 0; b < n; ++b) {
+              double theta = 2.0 * M_PI * (m + (b + 0.5) / n) / n_azimuthal_;
+              for (int c = 0; c < n; ++c) {
+                add_point(x_center + r * std::cos(theta),
+                          y_center + r * std::sin(theta),
+                          z_(j) + (c + 0.5) * dz);
+              }
+            }
           }
+          q.offsets.push_back(q.points.size());
         }
       }
     }
+  }
+
+  // The fluid element of each pin and axial segment fills the pin cell outside the
+  // cladding.  If no grid point falls there, it is sampled at its centroid.
+  auto centroids = this->centroid();
+  double h = pin_pitch() / n;
+  for (gsl::index i = 0; i < n_local_pins_; ++i) {
+    double x_center = pin_centers_(pin_begin_ + i, 0);
+    double y_center = pin_centers_(pin_begin_ + i, 1);
 
-    for (double T : fluid_temperature_) {
-      local_temperatures.push_back(T);
+    for (gsl::index j = 0; j < n_axial_; ++j) {
+      double dz = (z_(j + 1) - z_(j)) / n;
+      for (int a = 0; a < n; ++a) {
+        double dx = (a + 0.5) * h - 0.5 * pin_pitch();
+        for (int b = 0; b < n; ++b) {
+          double dy = (b + 0.5) * h - 0.5 * pin_pitch();
+          if (dx * dx + dy * dy <= clad_outer_radius_ * clad_outer_radius_)
+            continue;
+          for (int c = 0; c < n; ++c) {
+            add_point(x_center + dx, y_center + dy, z_(j) + (c + 0.5) * dz);
+          }
+        }
+      }
+      if (q.points.size() == q.offsets.back()) {
+        const auto& p = centroids[q.offsets.size() - 1];
+        add_point(p.x, p.y, p.z);
+      }
+      q.offsets.push_back(q.points.size());
     }
   }
 
+  return q;
+}
+
+std::vector<double> SurrogateHeatDriver::temperature() const
+{
+  std::vector<double> local_temperatures(n_local_elem());
+  fill_temperature(local_temperatures);
   return local_temperatures;
 }
 
 std::vector<double> SurrogateHeatDriver::density() const
 {
-  std::vector<double> local_densities;
+  std::vector<double> local_densities(n_local_elem());
+  fill_density(local_densities);
+  return local_densities;
+}
 
-  if (this->has_coupling_data()) {
-    // Solid region just gets zeros for densities (not used)
-    auto n = n_pins_ * n_axial_ * n_rings() * n_azimuthal_;
-    std::fill_n(std::back_inserter(local_densities), n, 0.0);
+void SurrogateHeatDriver::fill_temperature(gsl::span<double> values) const
+{
+  Expects(values.size() == n_local_elem());
+  if (!this->has_coupling_data())
+    return;
 
-    // Add fluid densities and return
-    for (double rho : fluid_density_) {
-      local_densities.push_back(rho);
+  gsl::index e = 0;
+  for (gsl::index i = 0; i < n_local_pins_; ++i) {
+    for (gsl::index j = 0; j < n_axial_; ++j) {
+      for (gsl::index k = 0; k < n_rings(); ++k) {
+        std::fill_n(values.begin() + e, n_azimuthal_, solid_temperature_(i, j, k));
+        e += n_azimuthal_;
+      }
     }
   }
-  return local_densities;
+  std::copy(fluid_temperature_.cbegin(), fluid_temperature_.cend(), values.begin() + e);
+}
+
+void SurrogateHeatDriver::fill_density(gsl::span<double> values) const
+{
+  Expects(values.size() == n_local_elem());
+  if (!this->has_coupling_data())
+    return;
+
+  // Solid region just gets zeros for densities (not used)
+  std::fill_n(values.begin(), n_solid_, 0.0);
+  std::copy(fluid_density_.cbegin(), fluid_density_.cend(), values.begin() + n_solid_);
 }
 
 int SurrogateHeatDriver::in_fluid_at(int32_t local_elem) const
@@ -339,10 +511,8 @@ std::vector<int> SurrogateHeatDriver::fluid_mask() const
   std::vector<int> fluid_mask;
 
   if (this->has_coupling_data()) {
-    auto n_solid = n_pins_ * n_axial_ * n_rings() * n_azimuthal_;
-    auto n_fluid = n_pins_ * n_axial_;
-    std::fill_n(std::back_inserter(fluid_mask), n_solid, 0);
-    std::fill_n(std::back_inserter(fluid_mask), n_fluid, 1);
+    std::fill_n(std::back_inserter(fluid_mask), n_solid_, 0);
+    std::fill_n(std::back_inserter(fluid_mask), n_fluid_, 1);
   }
   return fluid_mask;
 }
@@ -353,7 +523,7 @@ std::vector<double> SurrogateHeatDriver::volume() const
 
   if (this->has_coupling_data()) {
     // Volume of solid regions
-    for (gsl::index i = 0; i < n_pins_; ++i) {
+    for (gsl::index i = 0; i < n_local_pins_; ++i) {
       for (gsl::index j = 0; j < n_axial_; ++j) {
         double dz = z_(j + 1) - z_(j);
         for (gsl::index k = 0; k < n_rings(); ++k) {
@@ -365,7 +535,7 @@ std::vector<double> SurrogateHeatDriver::volume() const
     }
 
     // Volume of fluid regions
-    for (gsl::index i = 0; i < n_pins_; ++i) {
+    for (gsl::index i = 0; i < n_local_pins_; ++i) {
       for (gsl::index j = 0; j < n_axial_; ++j) {
         double dz = z_(j + 1) - z_(j);
         double area =
@@ -380,7 +550,7 @@ std::vector<double> SurrogateHeatDriver::volume() const
 
 int SurrogateHeatDriver::set_heat_source_at(int32_t local_elem, double heat)
 {
-  if (local_elem >= n_pins_ * n_axial_ * n_rings() * n_azimuthal_)
+  if (local_elem >= n_solid_)
     return 0;
 
   // Determine indices
@@ -394,6 +564,18 @@ int SurrogateHeatDriver::set_heat_source_at(int32_t local_elem, double heat)
   return 0;
 }
 
+void SurrogateHeatDriver::set_heat_source(gsl::span<const double> heat)
+{
+  Expects(heat.size() == n_local_elem());
+  if (!has_coupling_data())
+    return;
+
+  // Solid elements come first and are ordered like source_; fluid elements have no
+  // heat source
+  auto n_solid = source_.size();
+  std::copy(heat.begin(), heat.begin() + n_solid, source_.begin());
+}
+
 double SurrogateHeatDriver::rod_axial_node_power(const int pin, const int axial) const
 {
   Expects(axial < n_axial_);
@@ -402,17 +584,21 @@ double SurrogateHeatDriver::rod_axial_node_power(const int pin, const int axial)
   double dz = z_(axial + 1) - z_(axial);
 
   for (gsl::index i = 0; i < n_rings(); ++i) {
+    double ring_source = 0.0;
     for (gsl::index j = 0; j < n_azimuthal_; ++j) {
-      power += source_(pin, axial, i, j) * solid_areas_(i) * dz / n_azimuthal_;
+      ring_source += source_(pin, axial, i, j);
     }
+    power += ring_source * solid_areas_(i);
   }
 
-  return power;
+  return power * dz / n_azimuthal_;
 }
 
 void SurrogateHeatDriver::solve_step()
 {
   timer_solve_step.start();
+  // Every rank takes part, even with zero local pins, since the fluid solve
+  // reduces over the heat comm
   if (has_coupling_data()) {
     solve_fluid();
     solve_heat();
@@ -426,12 +612,28 @@ void SurrogateHeatDriver::solve_fluid()
   // always be steady-state or pseudo-steady-state cases with no axial conduction such
   // that the power deposition in each channel is independent of a convective heat
   // transfer coefficient and only depends on the rod power at that axial elevation.
-  // The channel powers are indexed by channel ID, axial ID
-  xt::xtensor<double, 2> channel_powers({n_channels_, n_axial_}, 0.0);
-  for (int i = 0; i < n_channels_; ++i) {
-    for (int j = 0; j < n_axial_; ++j) {
+  // A channel may touch rods on other ranks, so the rod powers are summed over the
+  // heat comm first. The channel powers are indexed by channel ID, axial ID
+  auto& rod_powers = rod_powers_;
+  std::fill(rod_powers.begin(), rod_powers.end(), 0.0);
+#pragma omp parallel for num_threads(num_threads)
+  for (gsl::index i = 0; i < n_local_pins_; ++i) {
+    for (gsl::index j = 0; j < n_axial_; ++j) {
+      rod_powers(pin_begin_ + i, j) = rod_axial_node_power(i, j);
+    }
+  }
+  comm_.Allreduce(
+    MPI_IN_PLACE, rod_powers.data(), rod_powers.size(), MPI_DOUBLE, MPI_SUM);
+
+  auto& channel_powers = channel_powers_;
+#pragma omp parallel for num_threads(num_threads)
+  for (gsl::index k = 0; k < local_channels_.size(); ++k) {
+    auto i = local_channels_[k];
+    for (gsl::index j = 0; j < n_axial_; ++j) {
+      double power = 0.0;
       for (const auto& rod : channels_[i].rod_ids_)
-        channel_powers(i, j) += 0.25 * rod_axial_node_power(rod, j);
+        power += 0.25 * rod_powers(rod, j);
+      channel_powers(i, j) = power;
     }
   }
 
@@ -441,54 +643,76 @@ void SurrogateHeatDriver::solve_fluid()
   // are h (kJ/kg), P (MPa), u (m/s), rho (kg/m^3). Unit conversions are performed as
   // necessary on the converged results before being used in the Monte Carlo solver.
   // Enthalpy here requires a factor of 1e-3 to convert from J/kg to kJ/kg.
-  xt::xtensor<double, 2> h({n_channels_, n_axial_ + 1},
-                           iapws::h1(pressure_bc_, inlet_temperature_));
-  xt::xtensor<double, 2> p({n_channels_, n_axial_ + 1}, pressure_bc_);
+  auto& h = channel_enthalpy_;
+  auto& p = channel_pressure_;
+  auto& u = channel_velocity_;
+  std::fill(h.begin(), h.end(), water_.h1(pressure_bc_, inlet_temperature_));
+  std::fill(p.begin(), p.end(), pressure_bc_);
 
   // for certain verbosity settings, we will need to save the velocity solutions
-  xt::xtensor<double, 2> u = xt::zeros<double>({n_channels_, n_axial_ + 1});
+  std::fill(u.begin(), u.end(), 0.0);
 
   bool converged = false;
   for (gsl::index iter = 0; iter < max_subchannel_its_; ++iter) {
-    // save the previous solution
-    xt::xtensor<double, 2> h_old = h;
-    xt::xtensor<double, 2> p_old = p;
-
-    // solve each channel independently
-    for (gsl::index chan = 0; chan < n_channels_; ++chan) {
+    // although all channels are independent, to enable crossflow coupling between
+    // channels in the future, the convergence check is performed on all channels
+    // together, rather than each separately, since in a more sophisticated solver the
+    // channels would all be linked. Each channel is counted once, by the rank that
+    // owns it. The change from the previous iteration is accumulated as each value is
+    // overwritten, so no copy of the previous solution is needed.
+    double h_norm = 0.0;
+    double p_norm = 0.0;
+
+    // solve each local channel independently
+#pragma omp parallel for num_threads(num_threads) reduction(+ : h_norm, p_norm)
+    for (gsl::index k = 0; k < local_channels_.size(); ++k) {
+      auto chan = local_channels_[k];
       const auto& c = channels_[chan];
+      double dh = 0.0;
+      double dp = 0.0;
 
       // solve for enthalpy by simple energy balance q = mdot * dh by marching from
       // inlet; divide term on RHS by 1e3 to convert from J/kg to kJ/kg
-      h(chan, 0) = iapws::h1(p(chan, 0), inlet_temperature_);
-      for (gsl::index axial = 0; axial < n_axial_; ++axial)
-        h(chan, axial + 1) =
+      double h_new = water_.h1(p(chan, 0), inlet_temperature_);
+      dh += std::abs(h_new - h(chan, 0));
+      h(chan, 0) = h_new;
+      for (gsl::index axial = 0; axial < n_axial_; ++axial) {
+        h_new =
           h(chan, axial) + 1e-3 * channel_powers(chan, axial) / channel_flowrates_(chan);
+        dh += std::abs(h_new - h(chan, axial + 1));
+        h(chan, axial + 1) = h_new;
+      }
 
       // solve for pressure using one-sided finite difference approximation by
       // marching from outlet and solving the axial momentum equation.
+      dp += std::abs(pressure_bc_ - p(chan, n_axial_));
       p(chan, n_axial_) = pressure_bc_;
       for (gsl::index axial = n_axial_; axial > 0; axial--) {
-        double rho_high = iapws::rho_from_p_h(p(chan, axial), h(chan, axial));
-        double rho_low = iapws::rho_from_p_h(p(chan, axial - 1), h(chan, axial - 1));
+        double rho_high = water_.rho_from_p_h(p(chan, axial), h(chan, axial));
+        double rho_low = water_.rho_from_p_h(p(chan, axial - 1), h(chan, axial - 1));
 
         u(chan, axial) = channel_flowrates_(chan) / (rho_high * c.area_);
         u(chan, axial - 1) = channel_flowrates_(chan) / (rho_low * c.area_);
 
         // factor of 1e-6 needed for convert from Pa to MPa
-        p[axial - 1] = p[axial] + 1.0e-6 * (channel_flowrates_(chan) / c.area_ *
-                                              (u(chan, axial) - u(chan, axial - 1)) +
-                                            g_ * (z_(axial) - z_(axial - 1)) * rho_low);
+        double p_new =
+          p(chan, axial) + 1.0e-6 * (channel_flowrates_(chan) / c.area_ *
+                                       (u(chan, axial) - u(chan, axial - 1)) +
+                                     g_ * (z_(axial) - z_(axial - 1)) * rho_low);
+        dp += std::abs(p_new - p(chan, axial - 1));
+        p(chan, axial - 1) = p_new;
+      }
+
+      if (channel_owned_[k]) {
+        h_norm += dh;
+        p_norm += dp;
       }
     }
 
-    // after solving all channels, check for convergence; although all channels are
-    // independent, to enable crossflow coupling between channels in the future, this
-    // convergence check is performed on all channels together, rather than each
-    // separately, since in a more sophisticated solver the channels would all be
-    // linked
-    auto h_norm = xt::norm_l1(h - h_old)();
-    auto p_norm = xt::norm_l1(p - p_old)();
+    double norms[2] = {h_norm, p_norm};
+    comm_.Allreduce(MPI_IN_PLACE, norms, 2, MPI_DOUBLE, MPI_SUM);
+    h_norm = norms[0];
+    p_norm = norms[1];
 
     converged = (h_norm < subchannel_tol_h_) && (p_norm < subchannel_tol_p_);
 
@@ -497,7 +721,7 @@ void SurrogateHeatDriver::solve_fluid()
 
     // check if the solve didn't converge
     if (iter == max_subchannel_its_ - 1) {
-      if (verbosity_ >= verbose::LOW) {
+      if (verbosity_ >= verbose::LOW && comm_.is_root()) {
         std::cout << "Subchannel solver failed to converge! Enthalpy norm: " << h_norm
                   << " Pressure norm: " << p_norm << std::endl;
       }
@@ -506,16 +730,18 @@ void SurrogateHeatDriver::solve_fluid()
 
   // compute temperature and density from enthalpy and pressure in a cell-centered
   // basis
-  xt::xtensor<double, 2> T({n_channels_, n_axial_});
-  xt::xtensor<double, 2> rho({n_channels_, n_axial_});
+  auto& T = channel_temperature_;
+  auto& rho = channel_density_;
 
-  for (gsl::index chan = 0; chan < n_channels_; ++chan) {
+#pragma omp parallel for num_threads(num_threads)
+  for (gsl::index k = 0; k < local_channels_.size(); ++k) {
+    auto chan = local_channels_[k];
     for (gsl::index axial = 0; axial < n_axial_; ++axial) {
       double h_mean = 0.5 * (h(chan, axial) + h(chan, axial + 1));
       double p_mean = 0.5 * (p(chan, axial) + p(chan, axial + 1));
 
-      T(chan, axial) = iapws::T_from_p_h(p_mean, h_mean);
-      rho(chan, axial) = iapws::rho_from_p_h(p_mean, h_mean);
+      T(chan, axial) = water_.T_from_p_h(p_mean, h_mean);
+      rho(chan, axial) = water_.rho_from_p_h(p_mean, h_mean);
     }
   }
 
@@ -523,12 +749,13 @@ void SurrogateHeatDriver::solve_fluid()
   // basis, since this will most likely be the form desired by neutronics codes. At
   // this point only do we apply the conversion of kg/m^3 to g/cm^3 assumed by the
   // neutronics codes.
-  for (gsl::index rod = 0; rod < n_pins_; ++rod) {
+#pragma omp parallel for num_threads(num_threads)
+  for (gsl::index rod = 0; rod < n_local_pins_; ++rod) {
     for (gsl::index axial = 0; axial < n_axial_; ++axial) {
       fluid_temperature_(rod, axial) = 0.0;
       fluid_density_(rod, axial) = 0.0;
 
-      for (const auto& c : rods_[rod].channel_ids_) {
+      for (const auto& c : rods_[pin_begin_ + rod].channel_ids_) {
         fluid_temperature_(rod, axial) += 0.25 * T(c, axial);
 
         // factor of 1e-3 to convert from kg/m^3 to g/cm^3
@@ -552,20 +779,29 @@ bool SurrogateHeatDriver::is_mass_conserved(const xt::xtensor<double, 2>& rho,
 {
   bool mass_conserved = true;
 
+  // Sum the flowrate of the owned channels on each plane over the heat comm
+  std::vector<double> mass_flowrates(n_axial_, 0.0);
   for (gsl::index axial = 0; axial < n_axial_; ++axial) {
-    double mass_flowrate = 0.0;
-    for (gsl::index chan = 0; chan < n_channels_; ++chan) {
-      double u_cell_centered = 0.5 * (u(chan, axial) + u(chan, axial + 1));
-      mass_flowrate += u_cell_centered * channels_[chan].area_ * rho(chan, axial);
+    for (gsl::index k = 0; k < local_channels_.size(); ++k) {
+      if (channel_owned_[k]) {
+        auto chan = local_channels_[k];
+        double u_cell_centered = 0.5 * (u(chan, axial) + u(chan, axial + 1));
+        mass_flowrates[axial] +=
+          u_cell_centered * channels_[chan].area_ * rho(chan, axial);
+      }
     }
+  }
+  comm_.Allreduce(
+    MPI_IN_PLACE, mass_flowrates.data(), n_axial_, MPI_DOUBLE, MPI_SUM);
 
-    double tol = std::abs(mass_flowrate - mass_flowrate_) / mass_flowrate_;
+  for (gsl::index axial = 0; axial < n_axial_; ++axial) {
+    double tol = std::abs(mass_flowrates[axial] - mass_flowrate_) / mass_flowrate_;
 
     if (tol > 1e-3) {
       mass_conserved = false;
     }
 
-    if (verbosity_ == verbose::HIGH) {
+    if (verbosity_ == verbose::HIGH && comm_.is_root()) {
       std::cout << "Mass on plane " << axial << " conserved to a tolerance of " << tol
                 << std::endl;
     }
@@ -579,10 +815,18 @@ bool SurrogateHeatDriver::is_energy_conserved(const xt::xtensor<double, 2>& rho,
                                               const xt::xtensor<double, 2>& h,
                                               const xt::xtensor<double, 2>& q) const
 {
-  bool energy_conserved = true;
+  int energy_conserved = 1;
+
+  // Each channel is owned by one rank, so the balances are collected on the root and
+  // printed there, as for the mass
+  bool print = verbosity_ == verbose::HIGH;
+  std::vector<double> tols(print ? n_channels_ * n_axial_ : 0, 0.0);
 
   for (gsl::index axial = 0; axial < n_axial_; ++axial) {
-    for (gsl::index chan = 0; chan < n_channels_; ++chan) {
+    for (gsl::index k = 0; k < local_channels_.size(); ++k) {
+      if (!channel_owned_[k])
+        continue;
+      auto chan = local_channels_[k];
       double u_cell_centered = 0.5 * (u(chan, axial) + u(chan, axial + 1));
       double mass_flowrate = rho(chan, axial) * channels_[chan].area_ * u_cell_centered;
 
@@ -593,16 +837,32 @@ bool SurrogateHeatDriver::is_energy_conserved(const xt::xtensor<double, 2>& rho,
       double tol = std::abs(channel_energy_change - q(chan, axial)) / q(chan, axial);
 
       if (tol > 1e-3) {
-        energy_conserved = false;
+        energy_conserved = 0;
       }
 
-      if (verbosity_ == verbose::HIGH) {
-        std::cout << "Energy deposition in channel " << chan << ", axial node " << axial
-                  << " conserved to a tolerance of " << tol << std::endl;
+      if (print) {
+        tols[chan * n_axial_ + axial] = tol;
       }
     }
   }
 
+  if (print) {
+    if (comm_.is_root()) {
+      comm_.Reduce(MPI_IN_PLACE, tols.data(), tols.size(), MPI_DOUBLE, MPI_MAX);
+      for (gsl::index axial = 0; axial < n_axial_; ++axial) {
+        for (gsl::index chan = 0; chan < n_channels_; ++chan) {
+          std::cout << "Energy deposition in channel " << chan << ", axial node "
+                    << axial << " conserved to a tolerance of "
+                    << tols[chan * n_axial_ + axial] << std::endl;
+        }
+      }
+    } else {
+      comm_.Reduce(tols.data(), nullptr, tols.size(), MPI_DOUBLE, MPI_MAX);
+    }
+  }
+
+  // All ranks must agree so that they fail (or continue) together
+  comm_.Allreduce(MPI_IN_PLACE, &energy_conserved, 1, MPI_INT, MPI_MIN);
   return energy_conserved;
 }
 
@@ -617,7 +877,9 @@ void SurrogateHeatDriver::solve_heat()
   xt::xtensor<double, 1> r_fuel = 0.01 * r_grid_fuel_;
   xt::xtensor<double, 1> r_clad = 0.01 * r_grid_clad_;
 
-  for (gsl::index i = 0; i < n_pins_; ++i) {
+  // Each (pin, axial) pair is an independent 1D radial solve
+#pragma omp parallel for collapse(2) num_threads(num_threads)
+  for (gsl::index i = 0; i < n_local_pins_; ++i) {
     for (gsl::index j = 0; j < n_axial_; ++j) {
       // approximate cladding surface temperature as equal to the fluid
       // temperature, i.e. this neglects any heat transfer resistance
@@ -675,12 +937,54 @@ void SurrogateHeatDriver::write_step(int timestep, int iteration)
   if (iteration >= 0 && timestep >= 0) {
     filename << "_t" << timestep << "_i" << iteration;
   }
-  filename << ".vtk";
+  std::string basename = filename.str();
+  std::string extension = viz_format_ == "vtu" ? ".vtu" : ".vtk";
+
+  // Each rank writes the pins it owns
+  if (comm_.size > 1) {
+    filename << "_r" << comm_.rank;
+  }
+  filename << extension;
 
-  SurrogateVtkWriter vtk_writer(*this, vtk_radial_res_, viz_regions_, viz_data_);
+  if (!vtk_writer_) {
+    auto format = viz_format_ == "vtu" ? SurrogateVtkWriter::VizFormat::vtu
+                                       : SurrogateVtkWriter::VizFormat::legacy;
+    vtk_writer_.reset(new SurrogateVtkWriter(
+      *this, vtk_radial_res_, viz_regions_, viz_data_, format));
+  }
+
+  if (!viz_queue_) {
+    viz_queue_.reset(new AsyncWriter{viz_queue_depth_});
+  }
 
+  // The solution is copied now, so the file can be written while the solve continues
   comm_.message("Writing VTK file: " + filename.str());
-  vtk_writer.write(filename.str());
+  auto data = vtk_writer_->snapshot();
+  const SurrogateVtkWriter* writer = vtk_writer_.get();
+  std::string vtk_file = filename.str();
+  viz_queue_->submit(
+    [writer, vtk_file, data = std::move(data)] { writer->write(vtk_file, data); });
+  std::vector<std::string> files{vtk_file};
+
+  // For VTU output on several ranks, the root also writes a file that collects the
+  // pieces, which are referenced relative to its directory
+  if (viz_format_ == "vtu" && comm_.size > 1 && comm_.is_root()) {
+    auto dir_end = basename.find_last_of('/');
+    auto piece_base =
+      dir_end == std::string::npos ? basename : basename.substr(dir_end + 1);
+    std::vector<std::string> pieces;
+    for (int rank = 0; rank < comm_.size; ++rank) {
+      pieces.push_back(piece_base + "_r" + std::to_string(rank) + extension);
+    }
+    std::string pvtu_file = basename + ".pvtu";
+    viz_queue_->submit(
+      [writer, pvtu_file, pieces] { writer->write_pvtu(pvtu_file, pieces); });
+    files.push_back(pvtu_file);
+  }
+
+  // Old files are removed by the queue, after any pending writes to them
+  auto history = &output_history_;
+  viz_queue_->submit([history, files] { history->add(files); });
   // timer_write_step.stop();
   return;
 }
@@ -4,13 +4,20 @@
 
 #include "enrico/timer.h"
 
+#include "enrico/trace.h"
+
+#include <limits> // for numeric_limits
+
 namespace enrico {
 
+bool Timer::synchronized_ = true;
+
 void Timer::start()
 {
   if (comm_.active()) {
     running_ = true;
-    comm_.Barrier();
+    if (synchronized_)
+      comm_.Barrier();
     start_ = MPI_Wtime();
   }
 }
@@ -20,6 +27,9 @@ void Timer::stop()
   if (comm_.active()) {
     elapsed_ = elapsed();
     running_ = false;
+    if (!name_.empty() && trace::enabled()) {
+      trace::span(category_, name_, start_, MPI_Wtime());
+    }
   }
 }
 
@@ -35,7 +45,8 @@ double Timer::elapsed()
 {
   if (comm_.active()) {
     if (running_) {
-      comm_.Barrier();
+      if (synchronized_)
+        comm_.Barrier();
       auto diff = MPI_Wtime() - start_;
       return elapsed_ + diff;
     } else {
@@ -64,19 +75,59 @@ double TimeAmt::sum_percent(const std::vector<TimeAmt>& times)
   return tot;
 }
 
+void TimeAmt::reduce(std::vector<TimeAmt>& times, const Comm& comm)
+{
+  // The smallest time is the negated largest negated time, so both come from one
+  // MPI_MAX reduction.  Likewise, the sums of times and of active ranks share one
+  // MPI_SUM reduction.
+  int n = times.size();
+  std::vector<double> max_send(2 * n);
+  std::vector<double> sum_send(2 * n);
+  for (int i = 0; i < n; ++i) {
+    const auto& t = times[i];
+    max_send[i] = t.active ? t.time : 0.0;
+    max_send[n + i] = t.active ? -t.time : -std::numeric_limits<double>::max();
+    sum_send[i] = t.active ? t.time : 0.0;
+    sum_send[n + i] = t.active ? 1.0 : 0.0;
+  }
+
+  std::vector<double> max_recv(2 * n);
+  std::vector<double> sum_recv(2 * n);
+  comm.Reduce(max_send.data(), max_recv.data(), 2 * n, MPI_DOUBLE, MPI_MAX);
+  comm.Reduce(sum_send.data(), sum_recv.data(), 2 * n, MPI_DOUBLE, MPI_SUM);
+
+  if (comm.rank == 0) {
+    for (int i = 0; i < n; ++i) {
+      auto& t = times[i];
+      double n_active = sum_recv[n + i];
+      t.time = max_recv[i];
+      t.time_min = n_active > 0.0 ? -max_recv[n + i] : 0.0;
+      t.time_mean = n_active > 0.0 ? sum_recv[i] / n_active : 0.0;
+      t.reduced = true;
+    }
+  }
+}
+
 void TimeAmt::print_times(const std::string& header_name,
                           const std::vector<TimeAmt>& times,
                           const Comm& comm)
 {
   std::ios_base::fmtflags old_flags(std::cout.flags());
   std::stringstream msg;
-  msg << "  " << header_name << " time (seconds, percent)";
+  bool reduced = !times.empty() && times[0].reduced;
+  msg << "  " << header_name
+      << (reduced ? " time (seconds max/mean/min over ranks, percent of max)"
+                  : " time (seconds, percent)");
   comm.message(msg.str());
   for (const auto& t : times) {
     std::stringstream msg;
     msg << "    " << std::setw(22) << std::left << t.name << std::right << std::scientific
-        << std::setprecision(4) << t.time << "    " << std::setw(8) << std::fixed
-        << std::left << std::right << t.percent * 100.0;
+        << std::setprecision(4) << t.time;
+    if (t.reduced) {
+      msg << "  " << t.time_mean << "  " << t.time_min;
+    }
+    msg << "    " << std::setw(8) << std::fixed << std::left << std::right
+        << t.percent * 100.0;
     comm.message(msg.str());
   }
   std::cout.flags(old_flags);
@@ -0,0 +1,137 @@
+#include "enrico/trace.h"
+
+#include <fstream>
+#include <numeric> // for partial_sum
+#include <sstream>
+#include <vector>
+
+namespace enrico {
+namespace trace {
+
+namespace {
+
+//! A recorded span or byte count
+struct Event {
+  int track;         //!< Index into tracks of a span's category, or -1
+  std::string name;  //!< Label of the event
+  double start;      //!< Start time in [s] after the origin
+  double duration;   //!< Duration in [s] of a span
+  std::size_t bytes; //!< Bytes moved by an exchange
+};
+
+Comm trace_comm;                 //!< Communicator given to enable()
+bool is_enabled = false;         //!< Whether events are being recorded
+double origin = 0.0;             //!< MPI_Wtime() at the barrier in enable()
+std::vector<std::string> tracks; //!< Categories, in the order first recorded
+std::vector<Event> events;       //!< Events recorded on the calling rank
+std::size_t total_bytes = 0;     //!< Bytes recorded on the calling rank
+
+int track_index(const std::string& category)
+{
+  for (int i = 0; i < tracks.size(); ++i) {
+    if (tracks[i] == category)
+      return i;
+  }
+  tracks.push_back(category);
+  return tracks.size() - 1;
+}
+
+} // namespace
+
+void enable(const Comm& comm)
+{
+  trace_comm = comm;
+  if (!comm.active())
+    return;
+
+  comm.Barrier();
+  origin = MPI_Wtime();
+  is_enabled = true;
+}
+
+bool enabled()
+{
+  return is_enabled;
+}
+
+void span(const std::string& category,
+          const std::string& name,
+          double start,
+          double stop)
+{
+  if (!is_enabled)
+    return;
+  events.push_back({track_index(category), name, start - origin, stop - start, 0});
+}
+
+void bytes(const std::string& name, std::size_t bytes)
+{
+  total_bytes += bytes;
+  if (!is_enabled)
+    return;
+  events.push_back({-1, name, MPI_Wtime() - origin, 0.0, bytes});
+}
+
+std::size_t bytes_moved()
+{
+  return total_bytes;
+}
+
+void write(const std::string& filename)
+{
+  if (!is_enabled)
+    return;
+
+  // Each rank formats its own events; times are in microseconds
+  int pid = trace_comm.rank;
+  std::stringstream local;
+  local.precision(3);
+  local << std::fixed;
+  for (int i = 0; i < tracks.size(); ++i) {
+    local << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << i
+          << ",\"args\":{\"name\":\"" << tracks[i] << "\"}},\n";
+  }
+  for (const auto& e : events) {
+    if (e.track >= 0) {
+      local << "{\"name\":\"" << e.name << "\",\"cat\":\"" << tracks[e.track]
+            << "\",\"ph\":\"X\",\"ts\":" << 1.0e6 * e.start
+            << ",\"dur\":" << 1.0e6 * e.duration << ",\"pid\":" << pid
+            << ",\"tid\":" << e.track << "},\n";
+    } else {
+      local << "{\"name\":\"" << e.name << "\",\"ph\":\"C\",\"ts\":" << 1.0e6 * e.start
+            << ",\"pid\":" << pid << ",\"args\":{\"bytes\":" << e.bytes << "}},\n";
+    }
+  }
+  std::string text = local.str();
+
+  // Collect the events of all ranks on the root
+  int n = text.size();
+  std::vector<int> counts;
+  std::vector<int> displs;
+  if (trace_comm.rank == 0) {
+    counts.resize(trace_comm.size);
+    displs.resize(trace_comm.size);
+  }
+  trace_comm.Gather(&n, 1, MPI_INT, counts.data(), 1, MPI_INT);
+
+  std::string all;
+  if (trace_comm.rank == 0) {
+    displs[0] = 0;
+    std::partial_sum(counts.cbegin(), counts.cend() - 1, displs.begin() + 1);
+    all.resize(displs.back() + counts.back());
+  }
+  trace_comm.Gatherv(
+    text.data(), n, MPI_CHAR, &all[0], counts.data(), displs.data(), MPI_CHAR);
+
+  if (trace_comm.rank == 0) {
+    // Drop the separator after the last event
+    if (all.size() >= 2) {
+      all.resize(all.size() - 2);
+    }
+    std::ofstream out{filename};
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" << all << "\n]}\n";
+  }
+}
+
+} // namespace trace
+} // namespace enrico
@@ -1,4 +1,5 @@
 #include <cmath>
+#include <sstream>
 
 #include "enrico/vtk_viz.h"
 
@@ -75,9 +76,11 @@ xtensor<int, 2> hex_ring(size_t start_idx, size_t resolution, size_t z_shift)
 SurrogateVtkWriter::SurrogateVtkWriter(const SurrogateHeatDriver& surrogate_ref,
                                        size_t t_res,
                                        const std::string& regions_to_write,
-                                       const std::string& data_to_write)
+                                       const std::string& data_to_write,
+                                       VizFormat format)
   : surrogate_(surrogate_ref)
   , azimuthal_res_(t_res)
+  , format_(format)
 {
 
   // read data specs
@@ -203,43 +206,223 @@ void SurrogateVtkWriter::set_number_of_entries()
 
 void SurrogateVtkWriter::write(std::string filename)
 {
-  // open file
-  ofstream fh(filename, std::ofstream::out);
+  write(filename, snapshot());
+} // write_vtk
+
+SurrogateVtkWriter::Data SurrogateVtkWriter::snapshot()
+{
+  if (!geometry_cached_) {
+    cache_geometry();
+  }
 
-  // write vtk header
-  write_header(fh);
+  Data data;
+  for (const auto& name : data_names()) {
+    data.push_back(data_values(name));
+  }
+  return data;
+}
+
+void SurrogateVtkWriter::write(const std::string& filename, const Data& data) const
+{
+  Expects(geometry_cached_);
+
+  switch (format_) {
+  case VizFormat::legacy:
+    write_legacy(filename, data);
+    break;
+  case VizFormat::vtu:
+    write_vtu(filename, data);
+    break;
+  }
+}
+
+void SurrogateVtkWriter::cache_geometry()
+{
+  switch (format_) {
+  case VizFormat::legacy: {
+    std::ostringstream geometry;
+    write_header(geometry);
+    write_points(geometry);
+    write_element_connectivity(geometry);
+    write_element_types(geometry);
+    legacy_geometry_ = geometry.str();
+    break;
+  }
+  case VizFormat::vtu: {
+    auto n_pins = surrogate_.n_local_pins();
+    vtu_points_.clear();
+    vtu_points_.reserve(n_pins * n_points_ * 3);
+    vtu_connectivity_.clear();
+    vtu_offsets_.clear();
+    vtu_offsets_.reserve(n_pins * n_sections_);
+    vtu_types_.clear();
+    vtu_types_.reserve(n_pins * n_sections_);
+
+    for (size_t pin = 0; pin < n_pins; pin++) {
+      xtensor<double, 1> pnts =
+        points_for_pin(surrogate_.pin_centers_(surrogate_.pin_begin() + pin, 0),
+                       surrogate_.pin_centers_(surrogate_.pin_begin() + pin, 1));
+      vtu_points_.insert(vtu_points_.end(), pnts.cbegin(), pnts.cend());
+
+      // each element's entries start with its number of points
+      xtensor<int, 1> conn = conn_for_pin(pin * n_points_);
+      for (auto val = conn.cbegin(); val != conn.cend(); val += CONN_STRIDE_) {
+        vtu_connectivity_.insert(vtu_connectivity_.end(), val + 1, val + 1 + *val);
+        vtu_offsets_.push_back(vtu_connectivity_.size());
+      }
+
+      vtu_types_.insert(vtu_types_.end(), types_.cbegin(), types_.cend());
+    }
+    break;
+  }
+  }
 
-  // write vertex locations
-  write_points(fh);
+  geometry_cached_ = true;
+}
 
-  // write wedge/hex element connectivity
-  write_element_connectivity(fh);
+void SurrogateVtkWriter::write_legacy(const std::string& filename,
+                                      const Data& data) const
+{
+  ofstream fh(filename, std::ofstream::out);
 
-  // write types for wedge/hex elements
-  write_element_types(fh);
+  // write the header, vertex locations, and wedge/hex element connectivity and types
+  fh << legacy_geometry_;
 
   // write specified data to the vtk file
-  write_data(fh);
+  write_data(fh, data);
+}
 
-  // close the file
-  fh.close();
+namespace {
 
-} // write_vtk
+//! Byte order of this machine, as named in VTK XML files
+const char* vtk_byte_order()
+{
+  const uint16_t one = 1;
+  return *reinterpret_cast<const uint8_t*>(&one) == 1 ? "LittleEndian" : "BigEndian";
+}
 
-void SurrogateVtkWriter::write_header(ofstream& vtk_file)
+//! Offset of each block of raw appended data, each preceded by its size in bytes
+class AppendedData {
+public:
+  //! Reserve space for a block and return its offset
+  template<typename T>
+  uint64_t add(const std::vector<T>& block)
+  {
+    uint64_t offset = size_;
+    size_ += sizeof(uint64_t) + block.size() * sizeof(T);
+    return offset;
+  }
+
+  //! Write a block, which must be written in the order that it was added
+  template<typename T>
+  static void write(std::ostream& out, const std::vector<T>& block)
+  {
+    uint64_t n_bytes = block.size() * sizeof(T);
+    out.write(reinterpret_cast<const char*>(&n_bytes), sizeof(n_bytes));
+    out.write(reinterpret_cast<const char*>(block.data()), n_bytes);
+  }
+
+private:
+  uint64_t size_{0};
+};
+
+} // namespace
+
+void SurrogateVtkWriter::write_vtu(const std::string& filename, const Data& data) const
+{
+  auto names = data_names();
+  Expects(data.size() == names.size());
+
+  AppendedData appended;
+  auto points_offset = appended.add(vtu_points_);
+  auto connectivity_offset = appended.add(vtu_connectivity_);
+  auto offsets_offset = appended.add(vtu_offsets_);
+  auto types_offset = appended.add(vtu_types_);
+
+  ofstream fh(filename, std::ofstream::out | std::ofstream::binary);
+  fh << "<?xml version=\"1.0\"?>\n"
+     << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\""
+     << vtk_byte_order() << "\" header_type=\"UInt64\">\n"
+     << "<UnstructuredGrid>\n"
+     << "<Piece NumberOfPoints=\"" << vtu_points_.size() / 3 << "\" NumberOfCells=\""
+     << vtu_types_.size() << "\">\n"
+     << "<Points>\n"
+     << "<DataArray type=\"Float32\" NumberOfComponents=\"3\" format=\"appended\" "
+     << "offset=\"" << points_offset << "\"/>\n"
+     << "</Points>\n"
+     << "<Cells>\n"
+     << "<DataArray type=\"Int32\" Name=\"connectivity\" format=\"appended\" offset=\""
+     << connectivity_offset << "\"/>\n"
+     << "<DataArray type=\"Int32\" Name=\"offsets\" format=\"appended\" offset=\""
+     << offsets_offset << "\"/>\n"
+     << "<DataArray type=\"UInt8\" Name=\"types\" format=\"appended\" offset=\""
+     << types_offset << "\"/>\n"
+     << "</Cells>\n"
+     << "<CellData>\n";
+  for (gsl::index i = 0; i < names.size(); ++i) {
+    fh << "<DataArray type=\"Float64\" Name=\"" << names[i]
+       << "\" format=\"appended\" offset=\"" << appended.add(data[i]) << "\"/>\n";
+  }
+  fh << "</CellData>\n"
+     << "</Piece>\n"
+     << "</UnstructuredGrid>\n"
+     << "<AppendedData encoding=\"raw\">\n_";
+
+  AppendedData::write(fh, vtu_points_);
+  AppendedData::write(fh, vtu_connectivity_);
+  AppendedData::write(fh, vtu_offsets_);
+  AppendedData::write(fh, vtu_types_);
+  for (const auto& v : data) {
+    AppendedData::write(fh, v);
+  }
+
+  fh << "\n</AppendedData>\n"
+     << "</VTKFile>\n";
+}
+
+void SurrogateVtkWriter::write_pvtu(const std::string& filename,
+                                    const std::vector<std::string>& pieces) const
+{
+  ofstream fh(filename, std::ofstream::out);
+  fh << "<?xml version=\"1.0\"?>\n"
+     << "<VTKFile type=\"PUnstructuredGrid\" version=\"1.0\" byte_order=\""
+     << vtk_byte_order() << "\" header_type=\"UInt64\">\n"
+     << "<PUnstructuredGrid GhostLevel=\"0\">\n"
+     << "<PPoints>\n"
+     << "<PDataArray type=\"Float32\" NumberOfComponents=\"3\"/>\n"
+     << "</PPoints>\n"
+     << "<PCells>\n"
+     << "<PDataArray type=\"Int32\" Name=\"connectivity\"/>\n"
+     << "<PDataArray type=\"Int32\" Name=\"offsets\"/>\n"
+     << "<PDataArray type=\"UInt8\" Name=\"types\"/>\n"
+     << "</PCells>\n"
+     << "<PCellData>\n";
+  for (const auto& name : data_names()) {
+    fh << "<PDataArray type=\"Float64\" Name=\"" << name << "\"/>\n";
+  }
+  fh << "</PCellData>\n";
+  for (const auto& piece : pieces) {
+    fh << "<Piece Source=\"" << piece << "\"/>\n";
+  }
+  fh << "</PUnstructuredGrid>\n"
+     << "</VTKFile>\n";
+}
+
+void SurrogateVtkWriter::write_header(std::ostream& vtk_file)
 {
   vtk_file << "# vtk DataFile Version 2.0\n";
   vtk_file << "No comment\nASCII\nDATASET UNSTRUCTURED_GRID\n";
 }
 
-void SurrogateVtkWriter::write_points(ofstream& vtk_file)
+void SurrogateVtkWriter::write_points(std::ostream& vtk_file)
 {
-  vtk_file << "POINTS " << surrogate_.n_pins_ * n_points_ << " float\n";
+  vtk_file << "POINTS " << surrogate_.n_local_pins() * n_points_ << " float\n";
 
-  for (size_t pin = 0; pin < surrogate_.n_pins_; pin++) {
+  for (size_t pin = 0; pin < surrogate_.n_local_pins(); pin++) {
     // translate pin template to pin center
     xtensor<double, 1> pnts =
-      points_for_pin(surrogate_.pin_centers_(pin, 0), surrogate_.pin_centers_(pin, 1));
+      points_for_pin(surrogate_.pin_centers_(surrogate_.pin_begin() + pin, 0),
+                     surrogate_.pin_centers_(surrogate_.pin_begin() + pin, 1));
 
     for (auto val = pnts.cbegin(); val != pnts.cend(); val += 3) {
       vtk_file << *val << " " << *(val + 1) << " " << *(val + 2) << "\n";
@@ -247,13 +430,13 @@ void SurrogateVtkWriter::write_points(ofstream& vtk_file)
   }
 }
 
-void SurrogateVtkWriter::write_element_connectivity(ofstream& vtk_file)
+void SurrogateVtkWriter::write_element_connectivity(std::ostream& vtk_file)
 {
   // write number of connectivity entries
-  vtk_file << "\nCELLS " << surrogate_.n_pins_ * n_sections_ << " "
-           << surrogate_.n_pins_ * n_entries_ << "\n";
+  vtk_file << "\nCELLS " << surrogate_.n_local_pins() * n_sections_ << " "
+           << surrogate_.n_local_pins() * n_entries_ << "\n";
 
-  for (size_t pin = 0; pin < surrogate_.n_pins_; pin++) {
+  for (size_t pin = 0; pin < surrogate_.n_local_pins(); pin++) {
     // get the connectivity for a given pin, using an
     // offset to get the connectivity values correct
     xtensor<int, 1> conn = conn_for_pin(pin * n_points_);
@@ -271,12 +454,12 @@ void SurrogateVtkWriter::write_element_connectivity(ofstream& vtk_file)
   }
 } // write_element_connectivity
 
-void SurrogateVtkWriter::write_element_types(ofstream& vtk_file)
+void SurrogateVtkWriter::write_element_types(std::ostream& vtk_file)
 {
   // write number of cell type entries
-  vtk_file << "\nCELL_TYPES " << surrogate_.n_pins_ * n_sections_ << "\n";
+  vtk_file << "\nCELL_TYPES " << surrogate_.n_local_pins() * n_sections_ << "\n";
   // pin loop
-  for (size_t pin = 0; pin < surrogate_.n_pins_; pin++) {
+  for (size_t pin = 0; pin < surrogate_.n_local_pins(); pin++) {
     // write the template for each pin
     for (auto v : types_) {
       vtk_file << v << "\n";
@@ -285,133 +468,85 @@ void SurrogateVtkWriter::write_element_types(ofstream& vtk_file)
   vtk_file << "\n";
 } // write_element_types
 
-void SurrogateVtkWriter::write_data(ofstream& vtk_file)
+void SurrogateVtkWriter::write_data(std::ostream& vtk_file, const Data& data) const
 {
-  // fuel mesh elements are written first, followed by cladding elements
-  // the data needs to be written in a similar matter
+  vtk_file << "CELL_DATA " << surrogate_.n_local_pins() * n_sections_ << "\n";
 
-  // for each radial section, the data point for that radial ring
-  // is repeated azimuthal_res times
-  vtk_file << "CELL_DATA " << surrogate_.n_pins_ * n_sections_ << "\n";
-
-  // write temperatures
-  if (output_includes_temp_) {
-    vtk_file << "SCALARS TEMPERATURE double 1\n";
+  auto names = data_names();
+  Expects(data.size() == names.size());
+  for (gsl::index i = 0; i < names.size(); ++i) {
+    vtk_file << "SCALARS " << names[i] << " double 1\n";
     vtk_file << "LOOKUP_TABLE default\n";
-
-    // write data for each pin
-    for (size_t pin = 0; pin < surrogate_.n_pins_; pin++) {
-      if (output_includes_solid_) {
-        // write all fuel data first
-        for (size_t i = 0; i < n_axial_sections_; i++) {
-          for (size_t j = 0; j < n_radial_fuel_sections_; j++) {
-            for (size_t k = 0; k < azimuthal_res_; k++) {
-              vtk_file << surrogate_.solid_temperature(pin, i, j) << "\n";
-            }
-          }
-        }
-
-        // then write cladding data
-        for (size_t i = 0; i < n_axial_sections_; i++) {
-          for (size_t j = 0; j < n_radial_clad_sections_; j++) {
-            for (size_t k = 0; k < azimuthal_res_; k++) {
-              vtk_file << surrogate_.solid_temperature(
-                            pin, i, j + n_radial_fuel_sections_)
-                       << "\n";
-            }
-          }
-        }
-      } // end of solid writing
-
-      // then write fluid data
-      if (output_includes_fluid_) {
-        for (size_t i = 0; i < n_axial_sections_; ++i) {
-          for (size_t j = 0; j < n_fluid_sections_; ++j) {
-            vtk_file << surrogate_.fluid_temperature(pin, i) << "\n";
-          }
-        }
-      }
-    } // end pin loop
+    for (auto v : data[i]) {
+      vtk_file << v << "\n";
+    }
   }
+} // write_data
 
-  if (output_includes_density_) {
-    vtk_file << "SCALARS DENSITY double 1\n";
-    vtk_file << "LOOKUP_TABLE default\n";
-
-    // write data for each pin
-    for (size_t pin = 0; pin < surrogate_.n_pins_; pin++) {
-      if (output_includes_solid_) {
-        // write all fuel data first
-        for (size_t i = 0; i < n_axial_sections_; i++) {
-          for (size_t j = 0; j < n_radial_fuel_sections_; j++) {
-            for (size_t k = 0; k < azimuthal_res_; k++) {
-              vtk_file << 0.0 << "\n";
-            }
-          }
-        }
+std::vector<std::string> SurrogateVtkWriter::data_names() const
+{
+  std::vector<std::string> names;
+  if (output_includes_temp_)
+    names.push_back("TEMPERATURE");
+  if (output_includes_density_)
+    names.push_back("DENSITY");
+  if (output_includes_source_)
+    names.push_back("SOURCE");
+  return names;
+}
 
-        // then write cladding data
-        for (size_t i = 0; i < n_axial_sections_; i++) {
-          for (size_t j = 0; j < n_radial_clad_sections_; j++) {
-            for (size_t k = 0; k < azimuthal_res_; k++) {
-              vtk_file << 0.0 << "\n";
-            }
-          }
-        }
-      } // end of solid writing
-
-      // then write fluid data
-      if (output_includes_fluid_) {
-        for (size_t i = 0; i < n_axial_sections_; ++i) {
-          for (size_t j = 0; j < n_fluid_sections_; ++j) {
-            vtk_file << surrogate_.fluid_density(pin, i) << "\n";
-          }
+std::vector<double> SurrogateVtkWriter::data_values(const std::string& name) const
+{
+  // Average the source over the azimuthal sectors for each radial ring. This is
+  // consistent with how the source term is used by the surrogate solver.
+  xt::xtensor<double, 3> q;
+  if (name == "SOURCE")
+    q = xt::mean(surrogate_.source_, 3);
+
+  auto solid_value = [&](size_t pin, size_t axial, size_t ring) {
+    if (name == "TEMPERATURE")
+      return surrogate_.solid_temperature(pin, axial, ring);
+    if (name == "SOURCE")
+      return q(pin, axial, ring);
+    return 0.0;
+  };
+  auto fluid_value = [&](size_t pin, size_t axial) {
+    if (name == "TEMPERATURE")
+      return surrogate_.fluid_temperature(pin, axial);
+    if (name == "DENSITY")
+      return surrogate_.fluid_density(pin, axial);
+    return 0.0;
+  };
+
+  // fuel mesh elements come first, followed by cladding elements and then fluid
+  // elements; for each radial section, the data point for that radial ring is
+  // repeated azimuthal_res times
+  std::vector<double> values;
+  values.reserve(surrogate_.n_local_pins() * n_sections_);
+  for (size_t pin = 0; pin < surrogate_.n_local_pins(); pin++) {
+    if (output_includes_solid_) {
+      for (size_t i = 0; i < n_axial_sections_; i++) {
+        for (size_t j = 0; j < n_radial_fuel_sections_; j++) {
+          values.insert(values.end(), azimuthal_res_, solid_value(pin, i, j));
         }
       }
-    } // end pin loop
-  }
-
-  if (output_includes_source_) {
-    vtk_file << "SCALARS SOURCE double 1\n";
-    vtk_file << "LOOKUP_TABLE default\n";
-
-    // Average over the azimuthal sectors for each radial ring.
-    // This is consistent with how the source term is used by the surrogate solver.
-    xt::xtensor<double, 3> q = xt::mean(surrogate_.source_, 3);
-
-    for (size_t pin = 0; pin < surrogate_.n_pins_; pin++) {
-      // write all fuel data first
-      if (output_includes_solid_) {
-        for (size_t i = 0; i < n_axial_sections_; i++) {
-          for (size_t j = 0; j < n_radial_fuel_sections_; j++) {
-            for (size_t k = 0; k < azimuthal_res_; k++) {
-              vtk_file << q(pin, i, j) << "\n";
-            }
-          }
-        }
-
-        // then write the cladding data
-        for (size_t i = 0; i < n_axial_sections_; i++) {
-          for (size_t j = 0; j < n_radial_clad_sections_; j++) {
-            for (size_t k = 0; k < azimuthal_res_; k++) {
-              vtk_file << q(pin, i, j + n_radial_fuel_sections_) << "\n";
-            }
-          }
+      for (size_t i = 0; i < n_axial_sections_; i++) {
+        for (size_t j = 0; j < n_radial_clad_sections_; j++) {
+          auto ring = j + n_radial_fuel_sections_;
+          values.insert(values.end(), azimuthal_res_, solid_value(pin, i, ring));
         }
       }
+    }
 
-      // then write fluid data
-      if (output_includes_fluid_) {
-        for (size_t i = 0; i < n_axial_sections_; ++i) {
-          for (size_t j = 0; j < n_fluid_sections_; ++j) {
-            vtk_file << 0.0 << "\n";
-          }
-        }
+    if (output_includes_fluid_) {
+      for (size_t i = 0; i < n_axial_sections_; ++i) {
+        values.insert(values.end(), n_fluid_sections_, fluid_value(pin, i));
       }
-    } // end pin loop
+    }
   }
 
-} // write_data
+  return values;
+}
 
 xtensor<double, 1> SurrogateVtkWriter::points_for_pin(double x, double y)
 {
@@ -0,0 +1,76 @@
+#include "enrico/water_properties.h"
+
+#include "openmc/xml_interface.h"
+
+#include <algorithm> // for min, max
+#include <stdexcept>
+#include <string>
+
+namespace enrico {
+
+WaterProperties::WaterProperties(pugi::xml_node node, double pressure)
+{
+  if (!node.child("type"))
+    return;
+
+  std::string type = node.child_value("type");
+  if (type == "iapws") {
+    return;
+  } else if (type != "tabulated") {
+    throw std::runtime_error{"Invalid value for <properties><type>"};
+  }
+  tabulated_ = true;
+
+  // By default, cover pressures near the system pressure and the subcooled liquid
+  // temperatures at those pressures, keeping a margin from the edges of IAPWS-IF97
+  // region 1 so that the backward equations stay within it
+  double p_min = 0.9 * pressure;
+  double p_max = 1.1 * pressure;
+  if (node.child("pressure")) {
+    auto p = openmc::get_node_array<double>(node, "pressure");
+    Expects(p.size() == 2);
+    p_min = p[0];
+    p_max = p[1];
+  }
+  Expects(p_min > 0.0 && p_max > p_min);
+
+  double T_limit = std::min(622.15, iapws::sat_temp(p_min) - 1.0);
+  double T_min = 274.15;
+  double T_max = T_limit;
+  int n = 128;
+  if (node.child("temperature")) {
+    auto T = openmc::get_node_array<double>(node, "temperature");
+    Expects(T.size() == 2);
+    T_min = T[0];
+    T_max = T[1];
+  }
+  if (node.child("points")) {
+    n = node.child("points").text().as_int();
+  }
+  if (T_min < 274.15 || T_max > T_limit || T_max <= T_min) {
+    throw std::runtime_error{"Invalid value for <properties><temperature>"};
+  }
+  Expects(n >= 4);
+
+  h_pT_ = PropertyTable{p_min, p_max, T_min, T_max, n, iapws::h1};
+  nu_pT_ = PropertyTable{p_min, p_max, T_min, T_max, n, iapws::nu1};
+
+  // Enthalpy increases with temperature, so the (p, h) envelope spans the enthalpy at
+  // the corners of the (p, T) envelope
+  double h_min = std::min(iapws::h1(p_min, T_min), iapws::h1(p_max, T_min));
+  double h_max = std::max(iapws::h1(p_min, T_max), iapws::h1(p_max, T_max));
+  T_ph_ = PropertyTable{p_min, p_max, h_min, h_max, n, iapws::T_from_p_h};
+  rho_ph_ = PropertyTable{p_min, p_max, h_min, h_max, n, iapws::rho_from_p_h};
+}
+
+double WaterProperties::max_error() const
+{
+  if (!tabulated_)
+    return 0.0;
+  return std::max({h_pT_.max_error(),
+                   nu_pT_.max_error(),
+                   T_ph_.max_error(),
+                   rho_ph_.max_error()});
+}
+
+} // namespace enrico
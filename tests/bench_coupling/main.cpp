@@ -0,0 +1,139 @@
+//===========================================================================
+// Benchmarks the field exchanges of the coupling layer
+//
+// Sets up a CoupledDriver from an enrico.xml file, which would normally pair the
+// surrogate heat/fluids driver with the mock neutronics driver so that no transport
+// model is needed, and times repeated heat source, temperature, and density updates
+// without solving either physics.
+//
+// Usage:
+//   mpirun -np <nProcs> ./bench_coupling [<enrico.xml> [<nRepeats>]]
+//
+// Output:
+//   The setup time of the mapping, and for each update the time per call, the
+//   number of heat/fluids elements updated per second, and the number of bytes
+//   moved through the coupling exchanges per second (summed over all ranks)
+//===========================================================================
+
+#include "enrico/coupled_driver.h"
+#include "enrico/mpi_types.h"
+#include "enrico/trace.h"
+
+#include <mpi.h>
+#include <pugixml.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+//! Time repeated calls of an update and print its throughput
+//!
+//! \param name Label of the update
+//! \param update The update to time
+//! \param n_repeats Number of calls
+//! \param n_elem Number of heat/fluids elements updated by each call
+//! \param comm The coupling communicator
+void bench(const std::string& name,
+           const std::function<void()>& update,
+           int n_repeats,
+           std::size_t n_elem,
+           const enrico::Comm& comm)
+{
+  // Warm up once so that one-time allocations aren't timed
+  update();
+
+  comm.Barrier();
+  auto bytes_start = enrico::trace::bytes_moved();
+  double start = MPI_Wtime();
+  for (int i = 0; i < n_repeats; ++i) {
+    update();
+  }
+  double elapsed = MPI_Wtime() - start;
+  double bytes = enrico::trace::bytes_moved() - bytes_start;
+
+  // The slowest rank determines the time of a coupled update
+  double max_elapsed;
+  double total_bytes;
+  MPI_Reduce(&elapsed, &max_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, comm.comm);
+  MPI_Reduce(&bytes, &total_bytes, 1, MPI_DOUBLE, MPI_SUM, 0, comm.comm);
+
+  if (comm.rank == 0) {
+    std::cout << std::left << std::setw(22) << name << std::right << std::scientific
+              << std::setprecision(4) << std::setw(14) << max_elapsed / n_repeats
+              << std::setw(14) << n_elem * n_repeats / max_elapsed << std::setw(14)
+              << total_bytes / max_elapsed << std::endl;
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  MPI_Init(&argc, &argv);
+  enrico::init_mpi_datatypes();
+
+  std::string filename = argc > 1 ? argv[1] : "enrico.xml";
+  int n_repeats = argc > 2 ? std::stoi(argv[2]) : 10;
+
+  pugi::xml_document doc;
+  if (!doc.load_file(filename.c_str())) {
+    throw std::runtime_error{"Unable to load " + filename};
+  }
+
+  {
+    // Setting up the driver finds the mapping and the initial fields
+    enrico::CoupledDriver driver{MPI_COMM_WORLD, doc.document_element()};
+    const auto& comm = driver.comm_;
+    auto& heat = driver.get_heat_driver();
+    auto& neutronics = driver.get_neutronics_driver();
+
+    double mapping_time = driver.timer_init_mapping.elapsed();
+    double max_mapping_time;
+    MPI_Reduce(
+      &mapping_time, &max_mapping_time, 1, MPI_DOUBLE, MPI_MAX, 0, comm.comm);
+
+    long long n_elem = heat.active() ? heat.n_global_elem() : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &n_elem, 1, MPI_LONG_LONG, MPI_MAX, comm.comm);
+
+    int n_heat = heat.comm_.size;
+    int n_neutronics = neutronics.comm_.size;
+    MPI_Allreduce(MPI_IN_PLACE, &n_heat, 1, MPI_INT, MPI_MAX, comm.comm);
+    MPI_Allreduce(MPI_IN_PLACE, &n_neutronics, 1, MPI_INT, MPI_MAX, comm.comm);
+
+    if (comm.rank == 0) {
+      std::cout << "Ranks: " << comm.size << " (neutronics " << n_neutronics
+                << ", heat/fluids " << n_heat << ")" << std::endl;
+      std::cout << "Heat/fluids elements: " << n_elem << std::endl;
+      std::cout << "init_mapping: " << std::scientific << std::setprecision(4)
+                << max_mapping_time << " s" << std::endl;
+      std::cout << std::left << std::setw(22) << "update" << std::right << std::setw(14)
+                << "s/call" << std::setw(14) << "elements/s" << std::setw(14)
+                << "bytes/s" << std::endl;
+    }
+
+    bench("update_heat_source",
+          [&driver]() { driver.update_heat_source(false); },
+          n_repeats,
+          n_elem,
+          comm);
+    bench("update_temperature",
+          [&driver]() { driver.update_temperature(false); },
+          n_repeats,
+          n_elem,
+          comm);
+    bench("update_density",
+          [&driver]() { driver.update_density(false); },
+          n_repeats,
+          n_elem,
+          comm);
+  }
+
+  enrico::free_mpi_datatypes();
+  MPI_Finalize();
+  return 0;
+}
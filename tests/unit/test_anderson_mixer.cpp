@@ -0,0 +1,82 @@
+/**
+ * \file test_anderson_mixer.cpp
+ * \brief Unit tests for Anderson acceleration.
+ */
+
+#include "catch.hpp"
+#include "enrico/anderson_mixer.h"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Linear map G(x) = A x + b whose Jacobian has eigenvalues 0.9 and 0.2, so that
+// plain fixed-point iteration converges slowly to x = (15, 16.25)
+std::vector<double> apply(const std::vector<double>& x)
+{
+  return {0.5 * x[0] + 0.4 * x[1] + 1.0, 0.3 * x[0] + 0.6 * x[1] + 2.0};
+}
+
+double error(const std::vector<double>& x)
+{
+  return std::abs(x[0] - 15.0) + std::abs(x[1] - 16.25);
+}
+
+} // namespace
+
+TEST_CASE("Verify Anderson mixing of a linear fixed point", "[anderson]") {
+  enrico::Comm comm(MPI_COMM_SELF);
+
+  SECTION("Verify convergence with history") {
+    enrico::AndersonMixer mixer(comm, 2, 1.0);
+    std::vector<double> x{1.0, 1.0};
+    for (int i = 0; i < 10; ++i) {
+      auto g = apply(x);
+      mixer.mix(x, g);
+      x = g;
+      CHECK(mixer.size() <= 2);
+    }
+    CHECK(mixer.size() == 2);
+    CHECK(error(x) < 1.0e-8);
+  }
+
+  SECTION("Verify that a depth of 0 is constant relaxation") {
+    enrico::AndersonMixer mixer(comm, 0, 0.5);
+    std::vector<double> x{1.0, 1.0};
+    for (int i = 0; i < 10; ++i) {
+      auto g = apply(x);
+      auto expected = g;
+      for (int j = 0; j < 2; ++j) {
+        expected[j] = 0.5 * x[j] + 0.5 * g[j];
+      }
+      CHECK_FALSE(mixer.mix(x, g));
+      CHECK(mixer.size() == 0);
+      CHECK(g[0] == Approx(expected[0]));
+      CHECK(g[1] == Approx(expected[1]));
+      x = g;
+    }
+    CHECK(error(x) > 1.0);
+  }
+
+  SECTION("Verify that reset forgets the history") {
+    enrico::AndersonMixer mixer(comm, 2, 1.0);
+    std::vector<double> x{1.0, 1.0};
+    for (int i = 0; i < 3; ++i) {
+      auto g = apply(x);
+      mixer.mix(x, g);
+      x = g;
+    }
+    REQUIRE(mixer.size() > 0);
+
+    mixer.reset();
+    CHECK(mixer.size() == 0);
+
+    // The first iterate after a reset is plain relaxation
+    auto g = apply(x);
+    auto expected = g;
+    CHECK_FALSE(mixer.mix(x, g));
+    CHECK(g[0] == Approx(expected[0]));
+    CHECK(g[1] == Approx(expected[1]));
+  }
+}
@@ -0,0 +1,65 @@
+/**
+ * \file test_async_writer.cpp
+ * \brief Unit tests for the asynchronous output queue.
+ */
+
+#include "catch.hpp"
+#include "enrico/async_writer.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+TEST_CASE("Verify exceptions thrown by output tasks", "[async_writer]") {
+  auto fail = [] { throw std::runtime_error{"write failed"}; };
+
+  SECTION("Verify that an exception propagates to flush") {
+    std::atomic<int> n_run{0};
+    enrico::AsyncWriter writer{2};
+    writer.submit(fail);
+    CHECK_THROWS_AS(writer.flush(), std::runtime_error);
+
+    // The exception is reported once, and later tasks still run
+    writer.submit([&n_run] { ++n_run; });
+    writer.flush();
+    CHECK(n_run == 1);
+  }
+
+  SECTION("Verify that an exception propagates to submit") {
+    enrico::AsyncWriter writer{1};
+    writer.submit(fail);
+
+    // The failing task runs first, so a later submit must report it
+    bool thrown = false;
+    for (int i = 0; i < 1000 && !thrown; ++i) {
+      try {
+        writer.submit([] { std::this_thread::sleep_for(std::chrono::milliseconds(1)); });
+      } catch (const std::runtime_error&) {
+        thrown = true;
+      }
+    }
+    CHECK(thrown);
+  }
+
+  SECTION("Verify that the destructor runs pending tasks without throwing") {
+    std::atomic<int> n_run{0};
+    auto create = [&] {
+      enrico::AsyncWriter writer{4};
+      for (int i = 0; i < 3; ++i) {
+        writer.submit([&n_run] {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          ++n_run;
+        });
+      }
+      writer.submit(fail);
+    };
+    CHECK_NOTHROW(create());
+    CHECK(n_run == 3);
+  }
+
+  SECTION("Verify that a synchronous writer throws from submit") {
+    enrico::AsyncWriter writer{0};
+    CHECK_THROWS_AS(writer.submit(fail), std::runtime_error);
+  }
+}
@@ -0,0 +1,91 @@
+/**
+ * \file test_comm.cpp
+ * \brief Unit tests for the nonblocking transfers of Comm.
+ */
+
+#include "catch.hpp"
+#include "enrico/comm.h"
+
+#include <mpi.h>
+#include <xtensor/xbuilder.hpp> // for zeros
+#include <xtensor/xtensor.hpp>
+
+#include <utility> // for move
+#include <vector>
+
+TEST_CASE("Verify nonblocking transfers on a single rank", "[comm]") {
+  enrico::Comm comm(MPI_COMM_SELF);
+
+  SECTION("Verify isend_and_irecv of a vector to self") {
+    std::vector<double> send{1.0, 2.5, -3.0};
+    std::vector<double> recv(send.size(), 0.0);
+    auto r = comm.isend_and_irecv(recv, 0, send, 0);
+    CHECK(!r.empty());
+    CHECK(r.wait() == MPI_SUCCESS);
+    CHECK(r.empty());
+    CHECK(recv == send);
+  }
+
+  SECTION("Verify isend_and_irecv of an xtensor to self") {
+    xt::xtensor<int, 2> send{{1, 2, 3}, {4, 5, 6}};
+    xt::xtensor<int, 2> recv = xt::zeros<int>({2, 3});
+    auto r = comm.isend_and_irecv(recv, 0, send, 0);
+    r.wait();
+    CHECK(recv == send);
+  }
+
+  SECTION("Verify ibroadcast of a scalar and a vector") {
+    int value = 7;
+    std::vector<double> values{0.5, 1.5};
+    auto r = comm.ibroadcast(value);
+    r.add(comm.ibroadcast(values));
+    while (!r.test()) {
+    }
+    CHECK(r.empty());
+    CHECK(value == 7);
+    CHECK(values == std::vector<double>{0.5, 1.5});
+  }
+
+  SECTION("Verify wait_all over several handles") {
+    std::vector<int> send_a{1, 2};
+    std::vector<int> send_b{3, 4, 5};
+    std::vector<int> recv_a(2);
+    std::vector<int> recv_b(3);
+    std::vector<enrico::Request> requests;
+    requests.push_back(comm.isend_and_irecv(recv_a, 0, send_a, 0));
+    requests.push_back(comm.isend_and_irecv(recv_b, 0, send_b, 0));
+    CHECK(enrico::wait_all(requests) == MPI_SUCCESS);
+    for (const auto& r : requests) {
+      CHECK(r.empty());
+    }
+    CHECK(recv_a == send_a);
+    CHECK(recv_b == send_b);
+  }
+
+  SECTION("Verify that moving a handle transfers its operations") {
+    std::vector<double> send{4.0, 5.0};
+    std::vector<double> recv(2);
+    auto r = comm.isend_and_irecv(recv, 0, send, 0);
+    enrico::Request moved{std::move(r)};
+    CHECK(r.empty());
+    CHECK(!moved.empty());
+    moved.wait();
+    CHECK(recv == send);
+  }
+
+  SECTION("Verify that destroying a handle completes its operations") {
+    std::vector<double> send{6.0, 7.0};
+    std::vector<double> recv(2);
+    { auto r = comm.isend_and_irecv(recv, 0, send, 0); }
+    CHECK(recv == send);
+  }
+
+  SECTION("Verify that an inactive comm posts nothing") {
+    enrico::Comm null_comm;
+    std::vector<double> send{1.0};
+    std::vector<double> recv{0.0};
+    auto r = null_comm.isend_and_irecv(recv, 0, send, 0);
+    CHECK(r.empty());
+    CHECK(recv[0] == 0.0);
+  }
+}
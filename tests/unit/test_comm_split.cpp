@@ -0,0 +1,35 @@
+/**
+ * \file test_comm_split.cpp
+ * \brief Unit tests for pairing heat/fluids ranks with neutronics ranks.
+ */
+
+#include "catch.hpp"
+#include "enrico/comm_split.h"
+
+#include <mpi.h>
+
+#include <vector>
+
+TEST_CASE("Verify pairing of heat/fluids ranks with neutronics ranks", "[comm_split]") {
+  SECTION("Verify that heat/fluids ranks are dealt to neutronics ranks on their node") {
+    // Node 0: neutronics ranks 0 and 1, then three heat ranks
+    // Node 5: neutronics rank 2, then two heat ranks
+    std::vector<int> info{0, 0, 0, 0, 1, 0, 0, -1, 1, 0, -1, 1, 0, -1, 1,
+                          5, 2, 0, 5, -1, 1, 5, -1, 1};
+    auto partners = enrico::pair_driver_ranks(info);
+    CHECK(partners == std::vector<int>{-1, -1, 0, 1, 0, -1, 2, 2});
+  }
+
+  SECTION("Verify that heat/fluids ranks off the neutronics nodes are dealt to all") {
+    // Node 0 has neutronics ranks 0 and 1, node 3 only three heat ranks
+    std::vector<int> info{0, 0, 0, 0, 1, 0, 3, -1, 1, 3, -1, 1, 3, -1, 1};
+    auto partners = enrico::pair_driver_ranks(info);
+    CHECK(partners == std::vector<int>{-1, -1, 0, 1, 0});
+  }
+
+  SECTION("Verify that a rank in both drivers is its own partner") {
+    enrico::Comm self{MPI_COMM_SELF};
+    auto partners = enrico::pair_driver_ranks(self, self, self, self);
+    CHECK(partners == std::vector<int>{0});
+  }
+}
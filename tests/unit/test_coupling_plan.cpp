@@ -0,0 +1,97 @@
+/**
+ * \file test_coupling_plan.cpp
+ * \brief Unit tests for the fluid weights and changed-only gathers of the coupling plan.
+ */
+
+#include "catch.hpp"
+#include "enrico/coupling_plan.h"
+#include "enrico/mock_neutronics_driver.h"
+#include "pugixml.hpp"
+
+#include <mpi.h>
+
+#include <algorithm> // for find, max, minmax_element
+#include <cmath>     // for abs
+#include <limits>
+#include <vector>
+
+TEST_CASE("Verify fluid weights of cells split across heat ranks", "[coupling]") {
+  // Cell 0 has a fluid entry from one heat rank and a larger solid entry from another,
+  // cell 1 the opposite, and cell 2 two fluid entries from different ranks
+  std::vector<gsl::index> entry_to_cell{0, 1, 2, 0, 1, 2};
+  std::vector<double> volume_weights{0.3, 0.7, 0.5, 0.7, 0.3, 0.5};
+  std::vector<int> entry_mask{1, 1, 1, 0, 0, 1};
+
+  std::vector<int> cell_in_fluid(3);
+  std::vector<double> fluid_weights(6);
+  enrico::compute_fluid_weights(
+    entry_to_cell, volume_weights, entry_mask, cell_in_fluid, fluid_weights);
+
+  SECTION("Verify majority rule") {
+    CHECK(cell_in_fluid[0] == 0);
+    CHECK(cell_in_fluid[1] == 1);
+    CHECK(cell_in_fluid[2] == 1);
+  }
+
+  SECTION("Verify fluid weights") {
+    // A solid cell has no fluid weights, even from its fluid entries
+    CHECK(fluid_weights[0] == 0.0);
+    CHECK(fluid_weights[3] == 0.0);
+
+    CHECK(fluid_weights[1] == Approx(1.0));
+    CHECK(fluid_weights[4] == 0.0);
+
+    CHECK(fluid_weights[2] == Approx(0.5));
+    CHECK(fluid_weights[5] == Approx(0.5));
+  }
+}
+
+TEST_CASE("Verify changed-only gathers with a reduced precision", "[coupling]") {
+  // One rank is both the heat/fluids rank and the neutronics root, with one local cell
+  // in each of the 8 boxes of a mock mesh
+  pugi::xml_document doc;
+  REQUIRE(doc.load_string("<neutronics><lower_left>0 0 0</lower_left>"
+                          "<upper_right>8 1 1</upper_right>"
+                          "<dimension>8 1 1</dimension></neutronics>"));
+  enrico::MockNeutronicsDriver neutronics(MPI_COMM_SELF, doc.document_element());
+  std::vector<enrico::Position> centers;
+  for (int i = 0; i < 8; ++i) {
+    centers.emplace_back(i + 0.5, 0.5, 0.5);
+  }
+  auto local_cells = neutronics.find(centers);
+
+  enrico::Comm comm(MPI_COMM_SELF);
+  enrico::CouplingPlan plan{comm, 0, neutronics, local_cells};
+
+  for (auto precision : {enrico::Precision::single, enrico::Precision::quantized}) {
+    plan.set_precision(precision);
+
+    // Temperatures that drift by less than the tolerance in each update
+    double tolerance = 0.05;
+    std::vector<double> local{550.0, 560.0, 575.0, 580.0, 600.0, 610.0, 630.0, 650.0};
+    std::vector<double> sent;
+    std::vector<double> entries;
+    std::vector<gsl::index> changed;
+    for (int update = 0; update < 20; ++update) {
+      for (gsl::index i = 0; i < local.size(); ++i) {
+        local[i] += 0.03 * (i % 3);
+      }
+      plan.gather_changes(local.data(), tolerance, sent, entries, changed);
+
+      // The neutronics fields are what the heat/fluids rank recorded as sent, and
+      // they differ from the local fields by at most the tolerance, or for values
+      // sent in this update, their encoding error
+      REQUIRE(entries == sent);
+      auto range = std::minmax_element(local.cbegin(), local.cend());
+      double encoding_error = precision == enrico::Precision::single
+                                ? std::numeric_limits<float>::epsilon() * *range.second
+                                : (*range.second - *range.first) / 65535.0;
+      for (gsl::index i = 0; i < local.size(); ++i) {
+        CHECK(std::abs(entries[i] - local[i]) <= std::max(tolerance, encoding_error));
+      }
+    }
+
+    // Cells whose values never move are sent only once
+    CHECK(std::find(changed.begin(), changed.end(), 0) == changed.end());
+  }
+}
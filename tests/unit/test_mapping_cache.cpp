@@ -0,0 +1,121 @@
+/**
+ * \file test_mapping_cache.cpp
+ * \brief Unit tests for the round trip of the element-to-cell mapping cache.
+ */
+
+#include "catch.hpp"
+#include "enrico/coupled_driver.h"
+#include "enrico/mpi_types.h"
+#include "pugixml.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace {
+
+const char* cache_file = "test_mapping_cache.bin";
+
+//! Input that pairs the mock neutronics driver with a single surrogate pin
+std::string input(const std::string& dimension)
+{
+  return R"(<enrico>
+  <neutronics>
+    <driver>mock</driver>
+    <lower_left>-1.0 -1.0 0.0</lower_left>
+    <upper_right>1.0 1.0 1.0</upper_right>
+    <dimension>)" +
+         dimension + R"(</dimension>
+  </neutronics>
+  <heat_fluids>
+    <driver>surrogate</driver>
+    <pressure_bc>12.7553</pressure_bc>
+    <pellet_radius>0.406</pellet_radius>
+    <clad_inner_radius>0.414</clad_inner_radius>
+    <clad_outer_radius>0.475</clad_outer_radius>
+    <fuel_rings>3</fuel_rings>
+    <clad_rings>2</clad_rings>
+    <pin_pitch>1.26</pin_pitch>
+    <n_pins_x>1</n_pins_x>
+    <n_pins_y>1</n_pins_y>
+    <mass_flowrate>0.3</mass_flowrate>
+    <inlet_temperature>500.0</inlet_temperature>
+    <z>0.0 0.5 1.0</z>
+  </heat_fluids>
+  <coupling>
+    <power>1000.0</power>
+    <max_timesteps>1</max_timesteps>
+    <max_picard_iter>1</max_picard_iter>
+    <mapping_cache>)" +
+         cache_file + R"(</mapping_cache>
+  </coupling>
+</enrico>)";
+}
+
+//! Set up a coupled driver, which finds or reads the mapping, and count the cells
+std::size_t n_cells(const std::string& dimension)
+{
+  pugi::xml_document doc;
+  REQUIRE(doc.load_string(input(dimension).c_str()));
+  enrico::CoupledDriver driver{MPI_COMM_SELF, doc.document_element()};
+  return driver.get_neutronics_driver().n_cells();
+}
+
+//! Mark the cache as written long ago, so that rewriting it is detected
+void age_cache()
+{
+  utimbuf times{0, 0};
+  REQUIRE(utime(cache_file, &times) == 0);
+}
+
+bool cache_rewritten()
+{
+  struct stat info;
+  REQUIRE(stat(cache_file, &info) == 0);
+  return info.st_mtime != 0;
+}
+
+} // namespace
+
+TEST_CASE("Verify round trip of the mapping cache", "[mapping]") {
+  enrico::init_mpi_datatypes();
+  std::remove(cache_file);
+
+  // The first run searches for the cells and writes the cache
+  auto n_searched = n_cells("2 2 2");
+  REQUIRE(n_searched > 0);
+  REQUIRE(std::ifstream{cache_file}.good());
+
+  SECTION("Verify that a matching cache is read") {
+    age_cache();
+    CHECK(n_cells("2 2 2") == n_searched);
+    CHECK_FALSE(cache_rewritten());
+  }
+
+  SECTION("Verify that a cache for another geometry is replaced") {
+    auto n_fresh = n_cells("3 3 2");
+    CHECK(n_fresh != n_searched);
+
+    // The replaced cache then matches the new geometry
+    age_cache();
+    CHECK(n_cells("3 3 2") == n_fresh);
+    CHECK_FALSE(cache_rewritten());
+  }
+
+  SECTION("Verify that a truncated cache is replaced") {
+    struct stat info;
+    REQUIRE(stat(cache_file, &info) == 0);
+    REQUIRE(truncate(cache_file, info.st_size - sizeof(std::uint64_t)) == 0);
+    age_cache();
+    CHECK(n_cells("2 2 2") == n_searched);
+    CHECK(cache_rewritten());
+  }
+
+  std::remove(cache_file);
+  enrico::free_mpi_datatypes();
+}
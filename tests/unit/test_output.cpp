@@ -0,0 +1,113 @@
+/**
+ * \file test_output.cpp
+ * \brief Unit tests for the output cadence and the files kept on disk.
+ */
+
+#include "catch.hpp"
+#include "enrico/output.h"
+#include "pugixml.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace {
+
+//! Write an empty file and return its name
+std::string touch(const std::string& name)
+{
+  std::ofstream{name};
+  return name;
+}
+
+bool exists(const std::string& name)
+{
+  return std::ifstream{name}.good();
+}
+
+//! Read output settings from the contents of an <output> element
+enrico::OutputSettings read_settings(const std::string& contents)
+{
+  pugi::xml_document doc;
+  REQUIRE(doc.load_string(("<output>" + contents + "</output>").c_str()));
+  return enrico::OutputSettings{doc.document_element()};
+}
+
+} // namespace
+
+TEST_CASE("Verify removal of old outputs", "[output]") {
+  SECTION("Verify that keep=1 removes the previous output") {
+    enrico::OutputHistory history{1};
+    history.add({touch("test_output_a1"), touch("test_output_b1")});
+    history.add({touch("test_output_a2")});
+    CHECK_FALSE(exists("test_output_a1"));
+    CHECK_FALSE(exists("test_output_b1"));
+    CHECK(exists("test_output_a2"));
+    std::remove("test_output_a2");
+  }
+
+  SECTION("Verify that keep=2 removes outputs older than the last two") {
+    enrico::OutputHistory history{2};
+    history.add({touch("test_output_1")});
+    history.add({touch("test_output_2")});
+    CHECK(exists("test_output_1"));
+    history.add({touch("test_output_3")});
+    CHECK_FALSE(exists("test_output_1"));
+    CHECK(exists("test_output_2"));
+    CHECK(exists("test_output_3"));
+    std::remove("test_output_2");
+    std::remove("test_output_3");
+  }
+
+  SECTION("Verify that a file rewritten by a later output is kept") {
+    // Each output rewrites the same summary file next to its own statepoint
+    enrico::OutputHistory history{1};
+    history.add({touch("test_output_summary"), touch("test_output_sp1")});
+    history.add({touch("test_output_summary"), touch("test_output_sp2")});
+    CHECK(exists("test_output_summary"));
+    CHECK_FALSE(exists("test_output_sp1"));
+    CHECK(exists("test_output_sp2"));
+    std::remove("test_output_summary");
+    std::remove("test_output_sp2");
+  }
+
+  SECTION("Verify that keep=0 keeps every output") {
+    enrico::OutputHistory history;
+    history.add({touch("test_output_1")});
+    history.add({touch("test_output_2")});
+    CHECK(exists("test_output_1"));
+    CHECK(exists("test_output_2"));
+    std::remove("test_output_1");
+    std::remove("test_output_2");
+  }
+}
+
+TEST_CASE("Verify which Picard iterations are written", "[output]") {
+  SECTION("Verify that every iteration is written by default") {
+    auto settings = read_settings("");
+    for (int i = 0; i < 4; ++i) {
+      CHECK(settings.is_write_iteration(i));
+    }
+  }
+
+  SECTION("Verify <interval>") {
+    auto settings = read_settings("<interval>3</interval>");
+    CHECK(settings.is_write_iteration(0));
+    CHECK_FALSE(settings.is_write_iteration(1));
+    CHECK_FALSE(settings.is_write_iteration(2));
+    CHECK(settings.is_write_iteration(3));
+    CHECK(settings.is_write_iteration(6));
+  }
+
+  SECTION("Verify <final_only>") {
+    auto settings = read_settings("<interval>2</interval><final_only>true</final_only>");
+    for (int i = 0; i < 4; ++i) {
+      CHECK_FALSE(settings.is_write_iteration(i));
+    }
+  }
+
+  SECTION("Verify invalid settings") {
+    CHECK_THROWS(read_settings("<interval>0</interval>"));
+    CHECK_THROWS(read_settings("<keep>-1</keep>"));
+  }
+}
@@ -0,0 +1,125 @@
+/**
+ * \file test_precision.cpp
+ * \brief Unit tests for sending double-precision payloads with a reduced precision.
+ */
+
+#include "catch.hpp"
+#include "enrico/comm.h"
+
+#include <mpi.h>
+
+#include <algorithm> // for max, minmax_element
+#include <cmath>     // for abs, sin
+#include <cstdint>   // for uint16_t
+#include <limits>
+#include <vector>
+
+namespace {
+
+using enrico::Precision;
+
+//! Send values to self with Gatherv and then back with Scatterv
+std::vector<double> round_trip(const std::vector<double>& values, Precision precision)
+{
+  enrico::Comm comm(MPI_COMM_SELF);
+  int count = values.size();
+  int displ = 0;
+
+  std::vector<double> gathered(count);
+  comm.Gatherv(values.data(), count, gathered.data(), &count, &displ, precision);
+
+  std::vector<double> scattered(count);
+  comm.Scatterv(gathered.data(), &count, &displ, scattered.data(), count, precision);
+
+  // Every trip is encoded the same way, so the second one doesn't add any error
+  CHECK(scattered == gathered);
+  return gathered;
+}
+
+//! Largest absolute difference between two fields
+double max_difference(const std::vector<double>& a, const std::vector<double>& b)
+{
+  double diff = 0.0;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    diff = std::max(diff, std::abs(a[i] - b[i]));
+  }
+  return diff;
+}
+
+} // namespace
+
+TEST_CASE("Verify payload sizes of each precision", "[precision]") {
+  CHECK(enrico::packed_size(10, Precision::full) == 10 * sizeof(double));
+  CHECK(enrico::packed_size(10, Precision::single) == 10 * sizeof(float));
+  CHECK(enrico::packed_size(10, Precision::quantized) ==
+        2 * sizeof(double) + 10 * sizeof(std::uint16_t));
+  for (auto p : {Precision::full, Precision::single, Precision::quantized}) {
+    CHECK(enrico::packed_size(0, p) == 0);
+  }
+}
+
+TEST_CASE("Verify round trips of payloads with each precision", "[precision]") {
+  // A smooth field between 550 and 650, like a temperature
+  std::vector<double> values(1000);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] = 600.0 + 50.0 * std::sin(0.01 * i);
+  }
+  auto range = std::minmax_element(values.cbegin(), values.cend());
+  double max = *range.second;
+  int count = values.size();
+
+  SECTION("Verify that full precision is exact") {
+    CHECK(round_trip(values, Precision::full) == values);
+    CHECK(enrico::precision_error(values.data(), count, Precision::full) == 0.0);
+  }
+
+  SECTION("Verify the error of single precision") {
+    auto sent = round_trip(values, Precision::single);
+    double eps = std::numeric_limits<float>::epsilon();
+    CHECK(max_difference(sent, values) <= eps * max);
+
+    double error = enrico::precision_error(values.data(), count, Precision::single);
+    CHECK(error > 0.0);
+    CHECK(error <= eps);
+  }
+
+  SECTION("Verify the quantization error bound") {
+    auto sent = round_trip(values, Precision::quantized);
+
+    // The endpoints are sent exactly, and the rest are within one step of 1/65535 of
+    // the range
+    double step = (*range.second - *range.first) / 65535.0;
+    CHECK(sent[range.first - values.cbegin()] == *range.first);
+    CHECK(sent[range.second - values.cbegin()] == *range.second);
+    CHECK(max_difference(sent, values) <= step);
+
+    double error = enrico::precision_error(values.data(), count, Precision::quantized);
+    CHECK(error > 0.0);
+    CHECK(error <= step / max);
+    CHECK(error == Approx(max_difference(sent, values) / max));
+  }
+
+  SECTION("Verify that a constant field is quantized exactly") {
+    // The range is zero, so every value is sent as the minimum
+    std::vector<double> constant(100, 573.15);
+    CHECK(round_trip(constant, Precision::quantized) == constant);
+    CHECK(enrico::precision_error(
+            constant.data(), constant.size(), Precision::quantized) == 0.0);
+  }
+
+  SECTION("Verify that a field of zeros has no relative error") {
+    std::vector<double> zeros(100, 0.0);
+    for (auto p : {Precision::single, Precision::quantized}) {
+      CHECK(round_trip(zeros, p) == zeros);
+      CHECK(enrico::precision_error(zeros.data(), zeros.size(), p) == 0.0);
+    }
+  }
+
+  SECTION("Verify empty payloads") {
+    std::vector<double> empty;
+    for (auto p : {Precision::full, Precision::single, Precision::quantized}) {
+      CHECK(round_trip(empty, p).empty());
+      CHECK(enrico::precision_error(empty.data(), 0, p) == 0.0);
+    }
+  }
+}
@@ -0,0 +1,85 @@
+/**
+ * \file test_projection.cpp
+ * \brief Unit tests for the projection between elements and cells.
+ */
+
+#include "catch.hpp"
+#include "enrico/projection.h"
+
+#include <vector>
+
+namespace {
+
+double integral(const std::vector<double>& values, const std::vector<double>& volumes)
+{
+  double sum = 0.0;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    sum += values[i] * volumes[i];
+  }
+  return sum;
+}
+
+} // namespace
+
+TEST_CASE("Verify projection between elements and cells", "[projection]") {
+  // Element 0 lies in cell 0, element 2 in cell 1, and element 1 is split between the
+  // cells, a quarter in cell 0 and three quarters in cell 1
+  std::vector<int32_t> offsets{0, 2, 6, 7};
+  std::vector<int32_t> cells{0, 0, 0, 1, 1, 1, 1};
+  std::vector<double> weights{1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 3.0};
+  std::vector<double> elem_volumes{2.0, 4.0, 1.0};
+
+  enrico::Projection proj(offsets, cells, weights, 2);
+  proj.set_volumes(elem_volumes);
+
+  CHECK(proj.n_weights() == 4);
+  const auto& cell_volumes = proj.cell_volumes();
+  REQUIRE(cell_volumes.size() == 2);
+  CHECK(cell_volumes[0] == Approx(3.0));
+  CHECK(cell_volumes[1] == Approx(4.0));
+
+  SECTION("Verify that distributing and averaging conserve the integral") {
+    std::vector<double> cell_values{2.0, 5.0};
+    std::vector<double> elem_values(3);
+    proj.distribute(cell_values, elem_values);
+    CHECK(elem_values[0] == Approx(2.0));
+    CHECK(elem_values[1] == Approx(4.25));
+    CHECK(elem_values[2] == Approx(5.0));
+    CHECK(integral(elem_values, elem_volumes) ==
+          Approx(integral(cell_values, cell_volumes)));
+
+    std::vector<double> averaged(2);
+    proj.average(elem_values, averaged);
+    CHECK(integral(averaged, cell_volumes) ==
+          Approx(integral(cell_values, cell_volumes)));
+  }
+
+  SECTION("Verify fluid mask of a mostly fluid mixed cell") {
+    proj.set_fluid_mask(std::vector<int>{1, 0, 0});
+    const auto& mask = proj.cell_fluid_mask();
+    CHECK(mask[0] == 1);
+    CHECK(mask[1] == 0);
+    CHECK(proj.n_mixed_cells() == 1);
+
+    // Only the fluid elements contribute to a fluid cell, and solid cells are kept
+    std::vector<double> elem_values{300.0, 900.0, 1200.0};
+    std::vector<double> cell_values{-1.0, -1.0};
+    proj.average_fluid(elem_values, cell_values);
+    CHECK(cell_values[0] == Approx(300.0));
+    CHECK(cell_values[1] == -1.0);
+  }
+
+  SECTION("Verify fluid mask of a mostly solid mixed cell") {
+    proj.set_fluid_mask(std::vector<int>{0, 1, 1});
+    const auto& mask = proj.cell_fluid_mask();
+    CHECK(mask[0] == 0);
+    CHECK(mask[1] == 1);
+    CHECK(proj.n_mixed_cells() == 1);
+
+    std::vector<double> elem_values{1200.0, 600.0, 500.0};
+    std::vector<double> cell_values{-1.0, -1.0};
+    proj.average_fluid(elem_values, cell_values);
+    CHECK(cell_values[0] == -1.0);
+    CHECK(cell_values[1] == Approx((3.0 * 600.0 + 500.0) / 4.0));
+  }
+}
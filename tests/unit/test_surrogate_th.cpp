@@ -437,3 +437,33 @@ TEST_CASE("Verify construction of surrogate thermal-hydraulics driver", "[constr
   }
 
 }
+
+TEST_CASE("Verify per-channel pressure of surrogate subchannel solver", "[solve]") {
+  pugi::xml_document doc;
+  auto result = doc.load_file("inputs/test_surrogate_th.xml");
+
+  CHECK(result);
+
+  auto node = doc.document_element().child("heat_fluids");
+  node.child("pressure_bc").text().set(15.5);
+
+  enrico::SurrogateHeatDriver driver(MPI_COMM_SELF, node);
+
+  // with no heat source every channel carries the same column of water, so each one
+  // must march the same pressure drop up from the outlet
+  std::vector<double> heat(driver.n_local_elem(), 0.0);
+  driver.set_heat_source(heat);
+  driver.solve_fluid();
+
+  const auto& p = driver.channel_pressure();
+  auto n_axial = driver.n_axial_;
+  auto n_channels = driver.channels_.size();
+  REQUIRE(p.shape()[0] == n_channels);
+  REQUIRE(p.shape()[1] == n_axial + 1);
+
+  for (std::size_t chan = 0; chan < n_channels; ++chan) {
+    CHECK(p(chan, n_axial) == Approx(15.5));
+    CHECK(p(chan, 0) > 15.5);
+    CHECK(p(chan, 0) == Approx(p(0, 0)));
+  }
+}
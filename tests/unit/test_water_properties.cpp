@@ -0,0 +1,45 @@
+/**
+ * \file test_water_properties.cpp
+ * \brief Unit tests for tabulated water properties.
+ */
+
+#include "catch.hpp"
+#include "pugixml.hpp"
+#include "enrico/water_properties.h"
+
+TEST_CASE("Verify tabulated water properties", "[properties]") {
+  pugi::xml_document doc;
+  auto node = doc.append_child("properties");
+  node.append_child("type").text().set("tabulated");
+
+  enrico::WaterProperties water{node, 15.5};
+  REQUIRE(water.tabulated());
+  CHECK(water.max_error() < 1.0e-5);
+
+  SECTION("Verify interpolation against IAPWS-IF97") {
+    for (double p : {14.0, 15.5, 17.0}) {
+      for (double T : {300.0, 450.0, 560.0, 600.0}) {
+        double h = iapws::h1(p, T);
+        CHECK(water.h1(p, T) == Approx(h).epsilon(1.0e-5));
+        CHECK(water.nu1(p, T) == Approx(iapws::nu1(p, T)).epsilon(1.0e-5));
+        CHECK(water.T_from_p_h(p, h) == Approx(iapws::T_from_p_h(p, h)).epsilon(1.0e-5));
+        CHECK(water.rho_from_p_h(p, h) ==
+              Approx(iapws::rho_from_p_h(p, h)).epsilon(1.0e-5));
+      }
+    }
+  }
+
+  SECTION("Verify fallback outside of the tabulated envelope") {
+    CHECK(water.h1(10.0, 450.0) == iapws::h1(10.0, 450.0));
+    CHECK(water.nu1(20.0, 450.0) == iapws::nu1(20.0, 450.0));
+  }
+}
+
+TEST_CASE("Verify invalid water property settings", "[properties]") {
+  pugi::xml_document doc;
+  auto node = doc.append_child("properties");
+  node.append_child("type").text().set("tabulated");
+  node.append_child("temperature").text().set("300.0 640.0");
+
+  CHECK_THROWS(enrico::WaterProperties{node, 15.5});
+}